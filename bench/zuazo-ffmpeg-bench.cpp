@@ -0,0 +1,659 @@
+/*
+ * Benchmark suite for zuazo-ffmpeg
+ *
+ * Generates synthetic media locally and measures each stage of the pipeline
+ * (open, demux, seek, decode and pixel format conversion) in isolation and
+ * end to end. Results are written as JSON so that they can be compared
+ * between releases. Uploading is not benchmarked, so no Vulkan device is
+ * required.
+ *
+ * Usage:
+ * zuazo-ffmpeg-bench [--output <file.json>] [--directory <dir>] [--frames <n>] [--resolutions <WxH,...>] [--keep] [--help]
+ */
+
+#include "FFmpeg/InputFormatContext.h"
+#include "FFmpeg/OutputFormatContext.h"
+#include "FFmpeg/OutputIOContext.h"
+#include "FFmpeg/CodecContext.h"
+#include "FFmpeg/SWScaleContext.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/FFmpeg/Frame.h>
+#include <zuazo/FFmpeg/Packet.h>
+#include <zuazo/FFmpeg/CodecParameters.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" {
+	#include <libavcodec/avcodec.h>
+	#include <libavformat/avformat.h>
+	#include <libavutil/imgutils.h>
+	#include <libavutil/opt.h>
+	#include <libavutil/mathematics.h>
+}
+
+using namespace Zuazo;
+
+using Seconds = std::chrono::duration<double>;
+
+/*
+ * Media matrix
+ */
+
+struct MediaDescriptor {
+	const char*								codec;
+	std::vector<const char*>				encoders; //Candidates, in order of preference
+	AVPixelFormat							pixelFormat;
+	std::vector<std::pair<const char*, const char*>> options;
+	std::vector<std::pair<const char*, const char*>> containers; //Format and extension
+};
+
+static const std::vector<MediaDescriptor> MEDIA = {
+	{ "h264", 		{ "libx264", "h264" },			AV_PIX_FMT_YUV420P, 	{ { "preset", "veryfast" } },	{ { "mp4", "mp4" }, { "mov", "mov" }, { "mpegts", "ts" } } },
+	{ "hevc", 		{ "libx265", "hevc" },			AV_PIX_FMT_YUV420P, 	{ { "preset", "veryfast" } },	{ { "mp4", "mp4" }, { "mpegts", "ts" } } },
+	{ "prores",		{ "prores_ks", "prores" },		AV_PIX_FMT_YUV422P10LE,	{ },							{ { "mov", "mov" } } },
+	{ "dnxhr",		{ "dnxhd" },					AV_PIX_FMT_YUV422P,		{ { "profile", "dnxhr_sq" } },	{ { "mxf", "mxf" }, { "mov", "mov" } } },
+	{ "mpeg2",		{ "mpeg2video" },				AV_PIX_FMT_YUV420P,		{ },							{ { "mpegts", "ts" }, { "mxf", "mxf" }, { "mov", "mov" } } }
+};
+
+static constexpr int FRAME_RATE = 25;
+static constexpr AVPixelFormat CONVERSION_FORMAT = AV_PIX_FMT_BGRA; //What the uploader usually produces
+
+
+
+/*
+ * JSON output
+ */
+
+class JSONObject {
+public:
+	JSONObject& add(const std::string& key, const std::string& value) {
+		std::ostringstream os;
+		os << '"';
+		for(const auto c : value) {
+			if(c == '"' || c == '\\') os << '\\';
+			os << c;
+		}
+		os << '"';
+		return addRaw(key, os.str());
+	}
+
+	JSONObject& add(const std::string& key, const char* value) {
+		return add(key, std::string(value));
+	}
+
+	JSONObject& add(const std::string& key, double value) {
+		std::ostringstream os;
+		os << value;
+		return addRaw(key, os.str());
+	}
+
+	JSONObject& add(const std::string& key, int64_t value) {
+		return addRaw(key, std::to_string(value));
+	}
+
+	JSONObject& add(const std::string& key, const JSONObject& value) {
+		return addRaw(key, value.str());
+	}
+
+	JSONObject& add(const std::string& key, const std::vector<JSONObject>& values) {
+		std::string array = "[";
+		for(size_t i = 0; i < values.size(); ++i) {
+			if(i > 0) array += ",\n";
+			array += values[i].str();
+		}
+		array += "]";
+		return addRaw(key, array);
+	}
+
+	std::string str() const {
+		return "{" + m_content + "}";
+	}
+
+private:
+	std::string m_content;
+
+	JSONObject& addRaw(const std::string& key, const std::string& value) {
+		if(!m_content.empty()) m_content += ",";
+		m_content += "\"" + key + "\":" + value;
+		return *this;
+	}
+};
+
+
+
+/*
+ * Helpers
+ */
+
+static FFmpeg::PixelFormat toPixelFormat(AVPixelFormat fmt) {
+	return static_cast<FFmpeg::PixelFormat>(fmt);
+}
+
+static AVRational toAVRational(Math::Rational<int> rat) {
+	return AVRational{ rat.getNumerator(), rat.getDenominator() };
+}
+
+static void allocateFrame(FFmpeg::Frame& frame, Resolution res, AVPixelFormat fmt) {
+	frame.unref();
+	frame.setResolution(res);
+	frame.setPixelFormat(toPixelFormat(fmt));
+	if(av_frame_get_buffer(static_cast<AVFrame*>(frame), 0) < 0) {
+		throw Exception("Unable to allocate a frame");
+	}
+}
+
+//Similar to lavfi's testsrc: diagonal gradients with a moving box
+static void drawTestPattern(FFmpeg::Frame& frame, int index) {
+	auto* avFrame = static_cast<AVFrame*>(frame);
+	assert(avFrame->format == AV_PIX_FMT_YUV420P);
+	const auto width = avFrame->width;
+	const auto height = avFrame->height;
+	const auto boxSize = height / 4;
+	const auto boxX = (index * 8) % std::max(width - boxSize, 1);
+	const auto boxY = height / 2 - boxSize / 2;
+
+	for(int y = 0; y < height; ++y) {
+		auto* row = avFrame->data[0] + y * avFrame->linesize[0];
+		for(int x = 0; x < width; ++x) {
+			const bool inBox = x >= boxX && x < boxX + boxSize && y >= boxY && y < boxY + boxSize;
+			row[x] = inBox ? 235 : static_cast<uint8_t>(16 + (x + y + index * 4) % 220);
+		}
+	}
+
+	for(int y = 0; y < height / 2; ++y) {
+		auto* rowU = avFrame->data[1] + y * avFrame->linesize[1];
+		auto* rowV = avFrame->data[2] + y * avFrame->linesize[2];
+		for(int x = 0; x < width / 2; ++x) {
+			rowU[x] = static_cast<uint8_t>(16 + (x * 2 + index) % 224);
+			rowV[x] = static_cast<uint8_t>(16 + (y * 2) % 224);
+		}
+	}
+}
+
+static const AVCodec* findEncoder(const MediaDescriptor& media) {
+	for(const auto* name : media.encoders) {
+		const auto* codec = avcodec_find_encoder_by_name(name);
+		if(codec) {
+			return codec;
+		}
+	}
+
+	return nullptr;
+}
+
+template<typename F>
+static Seconds measure(F&& func) {
+	const auto begin = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::steady_clock::now() - begin;
+}
+
+
+
+/*
+ * Media generation
+ */
+
+static void writePackets(	FFmpeg::CodecContext& encoder,
+							FFmpeg::OutputFormatContext& output,
+							FFmpeg::Packet& packet )
+{
+	const auto srcTimeBase = toAVRational(encoder.getTimeBase());
+	const auto dstTimeBase = toAVRational(output.getStreams()[0].getTimeBase());
+
+	while(encoder.readPacket(packet) == 0) {
+		packet.setStreamIndex(0);
+		av_packet_rescale_ts(packet, srcTimeBase, dstTimeBase);
+		if(output.writePacket(packet) < 0) {
+			throw Exception("Unable to write a packet");
+		}
+	}
+}
+
+static void generate(	const MediaDescriptor& media,
+						const char* format,
+						Resolution resolution,
+						int frameCount,
+						const std::string& path )
+{
+	const auto* codec = findEncoder(media);
+	if(!codec) {
+		throw Exception("Encoder not available");
+	}
+
+	//Configure the encoder
+	FFmpeg::CodecContext encoder(codec);
+	FFmpeg::CodecParameters codecPar;
+	codecPar.setMediaType(FFmpeg::MediaType::video);
+	codecPar.setCodecId(static_cast<FFmpeg::CodecID>(codec->id));
+	codecPar.setResolution(resolution);
+	codecPar.setPixelFormat(toPixelFormat(media.pixelFormat));
+	encoder.setParameters(codecPar);
+	encoder.setTimeBase(Math::Rational<int>(1, FRAME_RATE));
+	encoder.setFrameRate(Math::Rational<int>(FRAME_RATE, 1));
+	encoder.setGOPSize(FRAME_RATE);
+	encoder.setThreadCount(0);
+	for(const auto& option : media.options) {
+		av_opt_set(static_cast<AVCodecContext*>(encoder)->priv_data, option.first, option.second, 0);
+	}
+
+	std::unique_ptr<FFmpeg::OutputIOContext> ioContext; //Declared first, so that it outlives output
+	FFmpeg::OutputFormatContext output(path.c_str(), format);
+	if(output.requiresGlobalHeader()) {
+		encoder.setFlags(encoder.getFlags() | AV_CODEC_FLAG_GLOBAL_HEADER);
+	}
+
+	if(encoder.open(codec) < 0) {
+		throw Exception("Unable to open the encoder");
+	}
+
+	//Configure the output
+	if(output.addStream(encoder.getParameters(), encoder.getTimeBase()) < 0) {
+		throw Exception("Unable to add the stream");
+	}
+	if(output.requiresIOContext()) {
+		ioContext = std::make_unique<FFmpeg::OutputIOContext>(path.c_str());
+		output.setIOContext(*ioContext);
+	}
+	if(output.writeHeader() < 0) {
+		throw Exception("Unable to write the header");
+	}
+
+	//Encode the test pattern
+	FFmpeg::Frame pattern, frame;
+	FFmpeg::Packet packet;
+	FFmpeg::SWScaleContext converter;
+	allocateFrame(pattern, resolution, AV_PIX_FMT_YUV420P);
+	allocateFrame(frame, resolution, media.pixelFormat);
+	if(media.pixelFormat != AV_PIX_FMT_YUV420P) {
+		converter.recreate(
+			resolution, toPixelFormat(AV_PIX_FMT_YUV420P),
+			resolution, toPixelFormat(media.pixelFormat)
+		);
+	}
+
+	for(int i = 0; i < frameCount; ++i) {
+		av_frame_make_writable(static_cast<AVFrame*>(pattern));
+		av_frame_make_writable(static_cast<AVFrame*>(frame));
+		drawTestPattern(pattern, i);
+
+		if(media.pixelFormat != AV_PIX_FMT_YUV420P) {
+			converter.scale(
+				pattern.getData().data(), pattern.getLineSizes().data(),
+				0, resolution.height,
+				frame.getData().data(), frame.getLineSizes().data()
+			);
+		} else {
+			av_frame_copy(static_cast<AVFrame*>(frame), static_cast<const AVFrame*>(pattern));
+		}
+
+		frame.setPTS(i);
+		if(encoder.sendFrame(frame) < 0) {
+			throw Exception("Unable to encode a frame");
+		}
+		writePackets(encoder, output, packet);
+	}
+
+	//Drain the encoder
+	encoder.sendEndOfStream();
+	writePackets(encoder, output, packet);
+	output.writeTrailer();
+}
+
+
+
+/*
+ * Benchmarks
+ */
+
+static JSONObject benchmarkOpen(const std::string& path) {
+	constexpr int ITERATIONS = 10;
+	std::vector<double> times;
+
+	for(int i = 0; i < ITERATIONS; ++i) {
+		times.push_back(measure([&path] { FFmpeg::InputFormatContext input(path.c_str()); }).count());
+	}
+
+	std::sort(times.begin(), times.end());
+	return JSONObject()
+		.add("iterations", int64_t(ITERATIONS))
+		.add("minMs", times.front() * 1e3)
+		.add("medianMs", times[times.size() / 2] * 1e3)
+		.add("maxMs", times.back() * 1e3);
+}
+
+static JSONObject benchmarkDemux(const std::string& path, std::vector<FFmpeg::Packet>& packets) {
+	FFmpeg::InputFormatContext input(path.c_str());
+	const auto videoStream = input.findBestStream(FFmpeg::MediaType::video);
+	FFmpeg::Packet packet;
+	int64_t packetCount = 0;
+	int64_t byteCount = 0;
+
+	const auto elapsed = measure([&] {
+		while(input.readPacket(packet) == 0) {
+			++packetCount;
+			byteCount += packet.getData().size();
+
+			//Keep them for decoding in isolation
+			if(packet.getStreamIndex() == videoStream) {
+				packets.push_back(packet);
+			}
+			packet.unref();
+		}
+	}).count();
+
+	return JSONObject()
+		.add("packets", packetCount)
+		.add("bytes", byteCount)
+		.add("packetsPerSecond", packetCount / elapsed)
+		.add("megabytesPerSecond", byteCount / elapsed / 1e6);
+}
+
+static JSONObject benchmarkSeek(const std::string& path) {
+	constexpr int ITERATIONS = 20;
+	FFmpeg::InputFormatContext input(path.c_str());
+	const auto duration = input.getDuration();
+	FFmpeg::Packet packet;
+	std::vector<double> times;
+
+	//Deterministic pseudo-random positions, so that runs are comparable
+	uint32_t seed = 0x2545F491;
+	for(int i = 0; i < ITERATIONS; ++i) {
+		seed = seed * 1664525 + 1013904223;
+		const auto target = FFmpeg::Duration(duration.count() > 0 ? (seed % duration.count()) : 0);
+
+		times.push_back(measure([&] {
+			input.seek(target, FFmpeg::SeekFlags::backward);
+			input.readPacket(packet); //Seeking is lazy in some demuxers
+		}).count());
+		packet.unref();
+	}
+
+	std::sort(times.begin(), times.end());
+	return JSONObject()
+		.add("iterations", int64_t(ITERATIONS))
+		.add("minMs", times.front() * 1e3)
+		.add("medianMs", times[times.size() / 2] * 1e3)
+		.add("maxMs", times.back() * 1e3);
+}
+
+static JSONObject benchmarkDecode(	const std::string& path,
+									const std::vector<FFmpeg::Packet>& packets,
+									FFmpeg::Frame& lastFrame )
+{
+	FFmpeg::InputFormatContext input(path.c_str());
+	const auto& codecPar = input.getStreams()[input.findBestStream(FFmpeg::MediaType::video)].getCodecParameters();
+	const auto* codec = avcodec_find_decoder(static_cast<AVCodecID>(codecPar.getCodecId()));
+
+	FFmpeg::CodecContext decoder(codec);
+	decoder.setParameters(codecPar);
+	decoder.setThreadCount(0);
+	decoder.setThreadType(FFmpeg::ThreadType::frame);
+	if(decoder.open(codec) < 0) {
+		throw Exception("Unable to open the decoder");
+	}
+
+	FFmpeg::Frame frame;
+	int64_t frameCount = 0;
+	const auto receive = [&] {
+		while(decoder.readFrame(frame) == 0) {
+			++frameCount;
+		}
+
+		//The last failing call leaves the frame empty
+		if(frame.getResolution()) {
+			lastFrame.ref(frame);
+		}
+	};
+
+	//Packets are already in memory, so only decoding is measured
+	const auto elapsed = measure([&] {
+		for(const auto& packet : packets) {
+			decoder.sendPacket(packet);
+			receive();
+		}
+
+		decoder.sendPacket(FFmpeg::Packet()); //Drain
+		receive();
+	}).count();
+
+	return JSONObject()
+		.add("decoder", codec->name)
+		.add("frames", frameCount)
+		.add("framesPerSecond", frameCount / elapsed);
+}
+
+static JSONObject benchmarkConvert(const FFmpeg::Frame& src, int iterations) {
+	const auto resolution = src.getResolution();
+	FFmpeg::Frame dst;
+	allocateFrame(dst, resolution, CONVERSION_FORMAT);
+
+	FFmpeg::SWScaleContext converter(
+		resolution, src.getPixelFormat(),
+		resolution, toPixelFormat(CONVERSION_FORMAT)
+	);
+
+	const auto elapsed = measure([&] {
+		for(int i = 0; i < iterations; ++i) {
+			converter.scale(
+				src.getData().data(), src.getLineSizes().data(),
+				0, resolution.height,
+				dst.getData().data(), dst.getLineSizes().data()
+			);
+		}
+	}).count();
+
+	const auto srcBytes = av_image_get_buffer_size(static_cast<AVPixelFormat>(src.getPixelFormat()), resolution.width, resolution.height, 1);
+	const auto dstBytes = av_image_get_buffer_size(CONVERSION_FORMAT, resolution.width, resolution.height, 1);
+
+	return JSONObject()
+		.add("source", av_get_pix_fmt_name(static_cast<AVPixelFormat>(src.getPixelFormat())))
+		.add("destination", av_get_pix_fmt_name(CONVERSION_FORMAT))
+		.add("framesPerSecond", iterations / elapsed)
+		.add("gigabytesPerSecond", double(srcBytes + dstBytes) * iterations / elapsed / 1e9);
+}
+
+static JSONObject benchmarkEndToEnd(const std::string& path) {
+	FFmpeg::CodecContext decoder;
+	FFmpeg::SWScaleContext converter;
+	FFmpeg::Packet packet;
+	FFmpeg::Frame frame, dst;
+	int64_t frameCount = 0;
+
+	const auto receive = [&] {
+		while(decoder.readFrame(frame) == 0) {
+			const auto resolution = frame.getResolution();
+			if(dst.getResolution() != resolution) {
+				allocateFrame(dst, resolution, CONVERSION_FORMAT);
+				converter.recreate(
+					resolution, frame.getPixelFormat(),
+					resolution, toPixelFormat(CONVERSION_FORMAT)
+				);
+			}
+
+			converter.scale(
+				frame.getData().data(), frame.getLineSizes().data(),
+				0, resolution.height,
+				dst.getData().data(), dst.getLineSizes().data()
+			);
+			++frameCount;
+		}
+	};
+
+	const auto elapsed = measure([&] {
+		FFmpeg::InputFormatContext input(path.c_str());
+		const auto videoStream = input.findBestStream(FFmpeg::MediaType::video);
+		const auto& codecPar = input.getStreams()[videoStream].getCodecParameters();
+		const auto* codec = avcodec_find_decoder(static_cast<AVCodecID>(codecPar.getCodecId()));
+
+		decoder = FFmpeg::CodecContext(codec);
+		decoder.setParameters(codecPar);
+		decoder.setThreadCount(0);
+		decoder.setThreadType(FFmpeg::ThreadType::frame);
+		if(decoder.open(codec) < 0) {
+			throw Exception("Unable to open the decoder");
+		}
+
+		while(input.readPacket(packet) == 0) {
+			if(packet.getStreamIndex() == videoStream) {
+				decoder.sendPacket(packet);
+				receive();
+			}
+			packet.unref();
+		}
+
+		decoder.sendPacket(FFmpeg::Packet()); //Drain
+		receive();
+	}).count();
+
+	return JSONObject()
+		.add("frames", frameCount)
+		.add("framesPerSecond", frameCount / elapsed)
+		.add("totalMs", elapsed * 1e3);
+}
+
+
+
+/*
+ * Main
+ */
+
+struct Options {
+	std::string					output;
+	std::string					directory = ".";
+	int							frameCount = 120;
+	std::vector<Resolution>		resolutions = { Resolution(1280, 720), Resolution(1920, 1080), Resolution(3840, 2160) };
+	bool						keep = false;
+	bool						help = false;
+};
+
+static void printUsage(std::ostream& os, const char* program) {
+	os << "Usage: " << program << " [--output <file.json>] [--directory <dir>] [--frames <n>] [--resolutions <WxH,...>] [--keep] [--help]" << std::endl;
+}
+
+static Options parseOptions(int argc, const char* argv[]) {
+	Options result;
+
+	for(int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const auto next = [&] () -> std::string {
+			if(i + 1 >= argc) throw Exception("Missing value for " + arg);
+			return argv[++i];
+		};
+
+		if(arg == "--output") {
+			result.output = next();
+		} else if(arg == "--directory") {
+			result.directory = next();
+		} else if(arg == "--frames") {
+			result.frameCount = std::stoi(next());
+		} else if(arg == "--resolutions") {
+			result.resolutions.clear();
+			std::istringstream list(next());
+			std::string item;
+			while(std::getline(list, item, ',')) {
+				int width, height;
+				if(std::sscanf(item.c_str(), "%dx%d", &width, &height) != 2) {
+					throw Exception("Invalid resolution: " + item);
+				}
+				result.resolutions.emplace_back(width, height);
+			}
+		} else if(arg == "--keep") {
+			result.keep = true;
+		} else if(arg == "--help") {
+			result.help = true;
+		} else {
+			throw Exception("Unknown argument: " + arg);
+		}
+	}
+
+	return result;
+}
+
+int main(int argc, const char* argv[]) {
+	Options options;
+	try {
+		options = parseOptions(argc, argv);
+	} catch(const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		printUsage(std::cerr, *argv);
+		return 1;
+	}
+
+	if(options.help) {
+		printUsage(std::cout, *argv);
+		return 0;
+	}
+
+	av_log_set_level(AV_LOG_ERROR);
+	std::vector<JSONObject> results;
+
+	for(const auto& media : MEDIA) {
+		for(const auto& container : media.containers) {
+			for(const auto resolution : options.resolutions) {
+				const auto resolutionName = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+				const auto path = options.directory + "/zuazo-ffmpeg-bench-" + media.codec + "-" + resolutionName + "." + container.second;
+				std::cerr << "Benchmarking " << media.codec << " in " << container.first << " at " << resolutionName << "..." << std::endl;
+
+				JSONObject result;
+				result
+					.add("codec", media.codec)
+					.add("container", container.first)
+					.add("resolution", resolutionName);
+
+				try {
+					result.add("generateMs", measure([&] {
+						generate(media, container.first, resolution, options.frameCount, path);
+					}).count() * 1e3);
+
+					std::vector<FFmpeg::Packet> packets;
+					FFmpeg::Frame lastFrame;
+					result
+						.add("open", benchmarkOpen(path))
+						.add("demux", benchmarkDemux(path, packets))
+						.add("seek", benchmarkSeek(path))
+						.add("decode", benchmarkDecode(path, packets, lastFrame))
+						.add("convert", benchmarkConvert(lastFrame, options.frameCount))
+						.add("endToEnd", benchmarkEndToEnd(path))
+						.add("status", "ok");
+				} catch(const Exception& e) {
+					//Unsupported combinations are reported, not fatal
+					result.add("status", "error").add("error", e.what());
+				}
+
+				if(!options.keep) {
+					std::remove(path.c_str());
+				}
+
+				results.push_back(std::move(result));
+			}
+		}
+	}
+
+	const auto report = JSONObject()
+		.add("version", "0.1.0")
+		.add("libavformat", LIBAVFORMAT_IDENT)
+		.add("libavcodec", LIBAVCODEC_IDENT)
+		.add("frames", int64_t(options.frameCount))
+		.add("results", results)
+		.str();
+
+	if(options.output.empty()) {
+		std::cout << report << std::endl;
+	} else {
+		std::ofstream(options.output) << report << std::endl;
+	}
+
+	return 0;
+}
\ No newline at end of file
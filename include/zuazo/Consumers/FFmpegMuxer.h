@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../FFmpeg/StreamParameters.h"
+#include "../FFmpeg/CodecParameters.h"
+
+#include <zuazo/ZuazoBase.h>
+#include <zuazo/Utils/Pimpl.h>
+#include <zuazo/Math/Rational.h>
+
+#include <string>
+#include <cstddef>
+
+namespace Zuazo::Consumers {
+
+class FFmpegMuxer
+	: public Utils::Pimpl<struct FFmpegMuxerImpl>
+	, public ZuazoBase
+{
+	friend FFmpegMuxerImpl;
+public:
+	using Streams = Utils::BufferView<const FFmpeg::StreamParameters>;
+
+	FFmpegMuxer(Instance& instance, std::string name, std::string url = "", std::string format = "");
+	FFmpegMuxer(const FFmpegMuxer& other) = delete;
+	FFmpegMuxer(FFmpegMuxer&& other);
+	~FFmpegMuxer();
+
+	FFmpegMuxer&			operator=(const FFmpegMuxer& other) = delete;
+	FFmpegMuxer&			operator=(FFmpegMuxer&& other);
+
+	using ZuazoBase::update;
+
+	int						addStream(FFmpeg::CodecParameters codecPar, Math::Rational<int> timeBase);
+	void					clearStreams();
+	size_t					getStreamCount() const;
+	Streams					getStreams() const;
+
+	bool					requiresGlobalHeader() const;
+
+	void					setIOBufferSize(size_t size);
+	size_t					getIOBufferSize() const;
+
+	void					setIOThreadEnabled(bool ena);
+	bool					getIOThreadEnabled() const;
+
+	void					setInterleaveQueueSize(size_t size);
+	size_t					getInterleaveQueueSize() const;
+
+	bool					flush();
+	int						getWriteError() const; //First error writing packets. Nothing else is written afterwards
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../FFmpeg/Chrono.h"
+#include "../FFmpeg/StreamParameters.h"
+
+#include <zuazo/ZuazoBase.h>
+#include <zuazo/Utils/Pimpl.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+namespace Zuazo::Consumers {
+
+class FFmpegRemuxer
+	: public Utils::Pimpl<struct FFmpegRemuxerImpl>
+	, public ZuazoBase
+{
+	friend FFmpegRemuxerImpl;
+public:
+	using Streams = Utils::BufferView<const FFmpeg::StreamParameters>;
+
+	struct Result {
+		uint64_t							packetCount = 0;
+		uint64_t							byteCount = 0;
+		std::chrono::steady_clock::duration	elapsed = {};
+	};
+
+	FFmpegRemuxer(	Instance& instance, 
+					std::string name, 
+					std::string inputUrl = "", 
+					std::string outputUrl = "", 
+					std::string outputFormat = "" );
+	FFmpegRemuxer(const FFmpegRemuxer& other) = delete;
+	FFmpegRemuxer(FFmpegRemuxer&& other);
+	~FFmpegRemuxer();
+
+	FFmpegRemuxer&				operator=(const FFmpegRemuxer& other) = delete;
+	FFmpegRemuxer&				operator=(FFmpegRemuxer&& other);
+
+	using ZuazoBase::update;
+
+	Streams						getInputStreams() const;
+
+	void						setStreamSelection(std::vector<int> streams);
+	const std::vector<int>&		getStreamSelection() const;
+
+	void						setInPoint(FFmpeg::Duration in);
+	FFmpeg::Duration			getInPoint() const;
+
+	void						setOutPoint(FFmpeg::Duration out);
+	FFmpeg::Duration			getOutPoint() const;
+
+	bool						step();
+	Result						run();
+	bool						isFinished() const;
+	const Result&				getResult() const;
+
+};
+
+}
\ No newline at end of file
@@ -161,6 +161,12 @@ ZUAZO_ENUM_COMP_OPERATORS(FrameSideDataType)
 
 enum class Discard : int {
 	none = -16,
+	def = 0,
+	nonRef = 8,
+	bidir = 16,
+	nonIntra = 24,
+	nonKey = 32,
+	all = 48,
 };
 
 ZUAZO_ENUM_ARITHMETIC_OPERATORS(Discard)
@@ -182,6 +188,20 @@ ZUAZO_ENUM_BIT_OPERATORS(ThreadType)
 
 
 
+//Presets for the decoder's threading
+enum class DecodingProfile : int {
+	throughput,		//Frame threading. Adds a delay of one frame per thread
+	lowLatency,		//Slice threading with low delay flags
+	scrub,			//Low latency trading accuracy for speed. Meant for seeking
+};
+
+ZUAZO_ENUM_ARITHMETIC_OPERATORS(DecodingProfile)
+ZUAZO_ENUM_COMP_OPERATORS(DecodingProfile)
+
+std::ostream& operator<<(std::ostream& os, DecodingProfile profile);
+
+
+
 enum class SeekFlags : int {
 	none		= 0,
 	backward 	= Utils::bit(0),
@@ -196,6 +216,19 @@ ZUAZO_ENUM_BIT_OPERATORS(SeekFlags)
 
 
 
+enum class PacketFlags : int {
+	none		= 0,
+	key		 	= Utils::bit(0),
+	corrupt		= Utils::bit(1),
+	discard		= Utils::bit(2),
+	trusted		= Utils::bit(3),
+	disposable	= Utils::bit(4),
+};
+
+ZUAZO_ENUM_BIT_OPERATORS(PacketFlags)
+
+
+
 enum class HWDeviceType : int {
 	none			= 0, 
 	vdpau			= 1,
@@ -232,6 +265,7 @@ char toString(FFmpeg::PictureType type);
 //std::string_view toString(FFmpeg::FrameSideDataType type);
 //std::string_view toString(FFmpeg::Discard disc);
 //std::string_view toString(FFmpeg::ThreadType disc);
+std::string_view toString(FFmpeg::DecodingProfile profile);
 //std::string_view toString(FFmpeg::SeekFlags seek);
 std::string_view toString(FFmpeg::HWDeviceType type);
 
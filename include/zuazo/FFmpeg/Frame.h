@@ -32,6 +32,7 @@ public:
 
 	void										swap(Frame& other);
 
+	int											ref(const Frame& other);
 	void								        unref();
 
 	Utils::BufferView<std::byte*>				getData();
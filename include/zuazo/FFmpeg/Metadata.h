@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Chrono.h"
+
+#include <zuazo/Chromaticities.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Zuazo::FFmpeg {
+
+//SMPTE 12M timecode
+struct Timecode {
+	uint8_t								hours;
+	uint8_t								minutes;
+	uint8_t								seconds;
+	uint8_t								frames;
+	bool								dropFrame;
+
+	bool								operator==(const Timecode& other) const;
+	bool								operator!=(const Timecode& other) const;
+
+	//Frame count since 00:00:00:00 at the given nominal rate (i.e. 30 for 29.97)
+	int64_t								toFrameNumber(int fps) const;
+	static Timecode						fromFrameNumber(int64_t frameNumber, int fps, bool dropFrame);
+
+	//HH:MM:SS:FF, using ';' as the last separator for drop frame timecodes
+	std::string							toString() const;
+	static std::optional<Timecode>		fromString(std::string_view str);
+
+};
+
+//SCTE-35 splice command
+struct SpliceCue {
+	enum class Command : uint8_t {
+		spliceInsert = 0x05,
+		timeSignal = 0x06,
+	};
+
+	Command								command;
+	uint32_t							eventId; //Only for splice inserts
+	bool								outOfNetwork;
+	bool								cancel;
+	Duration							breakDuration; //Zero if not specified
+	Duration							time; //Splice point. Frame time if immediate
+
+};
+
+//HDR10 static metadata
+struct HDRMetadata {
+	struct ContentLightLevel {
+		uint32_t						maxCLL; //cd/m2
+		uint32_t						maxFALL; //cd/m2
+	};
+
+	Chromaticities						masteringDisplay; //Primaries, white point and peak luminance
+	double								masteringDisplayMinLuminance; //cd/m2. Zero if unknown
+	std::optional<ContentLightLevel>	contentLightLevel;
+
+};
+
+//Metadata attached to each frame. Kept small and fixed-size, so that it can
+//be passed around by value
+struct FrameMetadata {
+	std::optional<Timecode>				timecode;
+	std::optional<SpliceCue>			spliceCue; //Cues are delivered on the first frame at or after them
+
+};
+
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Enumerations.h"
+
 #include <zuazo/Utils/BufferView.h>
 
 #include <cstddef>
@@ -28,6 +30,7 @@ public:
 
 	void								swap(Packet& other);
 
+	int									ref(const Packet& other);
 	void								unref();
 
 	void								setPTS(int64_t pts);
@@ -45,6 +48,9 @@ public:
 	void								setStreamIndex(int idx);
 	int									getStreamIndex() const;
 
+	void								setFlags(PacketFlags flags);
+	PacketFlags							getFlags() const;
+
 	Utils::BufferView<std::byte> 		getData();
 	Utils::BufferView<const std::byte>	getData() const;
 
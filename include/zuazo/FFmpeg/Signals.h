@@ -2,6 +2,7 @@
 
 #include "Packet.h"
 #include "Frame.h"
+#include "Metadata.h"
 
 #include <zuazo/Signal/NamingConventions.h>
 
@@ -12,6 +13,8 @@ namespace Zuazo::FFmpeg {
 
 using PacketStream = std::shared_ptr<const FFmpeg::Packet>;
 using FrameStream = std::shared_ptr<const FFmpeg::Frame>;
+using MetadataStream = std::shared_ptr<const FFmpeg::FrameMetadata>;
+using HDRMetadataStream = std::shared_ptr<const FFmpeg::HDRMetadata>;
 
 }
 
@@ -30,4 +33,12 @@ constexpr std::string_view makeInputName<FFmpeg::FrameStream>() noexcept { retur
 template<>
 constexpr std::string_view makeOutputName<FFmpeg::FrameStream>() noexcept { return "frameOut"; }
 
+
+template<>
+constexpr std::string_view makeOutputName<FFmpeg::MetadataStream>() noexcept { return "metadataOut"; }
+
+
+template<>
+constexpr std::string_view makeOutputName<FFmpeg::HDRMetadataStream>() noexcept { return "hdrMetadataOut"; }
+
 }
\ No newline at end of file
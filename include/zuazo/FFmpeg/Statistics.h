@@ -0,0 +1,195 @@
+#pragma once
+
+#include <zuazo/Instance.h>
+#include <zuazo/Utils/Pimpl.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Zuazo::FFmpeg {
+
+/*
+ * LatencyHistogram
+ */
+
+//Lock-free histogram with power-of-two nanosecond buckets.
+//Recording is wait-free, so it can be kept enabled on the hot path
+class LatencyHistogram {
+public:
+	using Clock = std::chrono::steady_clock;
+	using Latency = std::chrono::nanoseconds;
+
+	static constexpr size_t BUCKET_COUNT = 40; //Up to ~18 minutes
+
+	struct Snapshot {
+		std::array<uint64_t, BUCKET_COUNT> buckets;
+		uint64_t			count;
+		Latency				total;
+		Latency				maximum;
+
+		Latency				getMean() const;
+		Latency				getPercentile(double p) const;
+	};
+
+	LatencyHistogram();
+	LatencyHistogram(const LatencyHistogram& other) = delete;
+	~LatencyHistogram() = default;
+
+	LatencyHistogram&		operator=(const LatencyHistogram& other) = delete;
+
+	void					record(Latency latency) noexcept;
+	Snapshot				getSnapshot() const;
+	void					reset();
+
+	static constexpr size_t getBucketIndex(Latency latency) noexcept;
+	static constexpr Latency getBucketUpperBound(size_t index) noexcept;
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets;
+	std::atomic<uint64_t>	m_count;
+	std::atomic<int64_t>	m_total;
+	std::atomic<int64_t>	m_maximum;
+
+};
+
+
+
+/*
+ * ScopedLatency
+ */
+
+class ScopedLatency {
+public:
+	explicit ScopedLatency(LatencyHistogram& histogram) noexcept;
+	ScopedLatency(const ScopedLatency& other) = delete;
+	~ScopedLatency();
+
+	ScopedLatency&			operator=(const ScopedLatency& other) = delete;
+
+private:
+	LatencyHistogram&		m_histogram;
+	LatencyHistogram::Clock::time_point m_start;
+
+};
+
+
+
+/*
+ * Counter
+ */
+
+class Counter {
+public:
+	Counter();
+	Counter(const Counter& other) = delete;
+	~Counter() = default;
+
+	Counter&				operator=(const Counter& other) = delete;
+
+	void					add(uint64_t count = 1) noexcept;
+	uint64_t				get() const noexcept;
+	void					reset() noexcept;
+
+private:
+	std::atomic<uint64_t>	m_value;
+
+};
+
+
+
+/*
+ * Gauge
+ */
+
+//Instantaneous value (i.e. a queue depth) which also keeps track of its peak
+class Gauge {
+public:
+	Gauge();
+	Gauge(const Gauge& other) = delete;
+	~Gauge() = default;
+
+	Gauge&					operator=(const Gauge& other) = delete;
+
+	void					set(int64_t value) noexcept;
+	int64_t					get() const noexcept;
+	int64_t					getMaximum() const noexcept;
+	void					reset() noexcept;
+
+private:
+	std::atomic<int64_t>	m_value;
+	std::atomic<int64_t>	m_maximum;
+
+};
+
+
+
+/*
+ * Statistics
+ */
+
+//Snapshot of the instrumentation of a component
+struct Statistics {
+	std::string 												name;
+	std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> latencies;
+	std::vector<std::pair<std::string, uint64_t>>				counters;
+	std::vector<std::pair<std::string, int64_t>>				gauges;
+	std::vector<Statistics>										children;
+
+	Statistics(std::string name = "");
+
+	void					addLatency(std::string name, const LatencyHistogram& histogram);
+	void					addCounter(std::string name, const Counter& counter);
+	void					addGauge(std::string name, const Gauge& gauge);
+	void					addChild(Statistics child);
+};
+
+std::ostream& operator<<(std::ostream& os, const Statistics& stats);
+
+
+
+/*
+ * StatisticsDumper
+ */
+
+//Periodically takes snapshots from a source in a dedicated thread
+class StatisticsDumper
+	: public Utils::Pimpl<struct StatisticsDumperImpl>
+{
+	friend StatisticsDumperImpl;
+public:
+	using Source = std::function<Statistics()>;
+	using Callback = std::function<void(const Statistics&)>;
+
+	StatisticsDumper(	Source source,
+						std::chrono::milliseconds period = std::chrono::seconds(1),
+						Callback callback = {} ); //Defaults to logging to std::clog
+	//The instance is locked while taking the periodic snapshots, as required
+	//by the statistics of the sources, processors and consumers. Hence, it
+	//must not be destroyed while holding the lock
+	StatisticsDumper(	Instance& instance,
+						Source source,
+						std::chrono::milliseconds period = std::chrono::seconds(1),
+						Callback callback = {} );
+	StatisticsDumper(const StatisticsDumper& other) = delete;
+	StatisticsDumper(StatisticsDumper&& other);
+	~StatisticsDumper();
+
+	StatisticsDumper&		operator=(const StatisticsDumper& other) = delete;
+	StatisticsDumper&		operator=(StatisticsDumper&& other);
+
+	void					dump(); //Requires the instance lock, if any
+
+};
+
+}
+
+#include "Statistics.inl"
\ No newline at end of file
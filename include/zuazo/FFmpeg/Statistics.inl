@@ -0,0 +1,108 @@
+#include "Statistics.h"
+
+namespace Zuazo::FFmpeg {
+
+/*
+ * LatencyHistogram
+ */
+
+inline void LatencyHistogram::record(Latency latency) noexcept {
+	const auto ns = std::max(latency.count(), Latency::rep(0));
+
+	//Relaxed ordering is enough, as each of the values is independent
+	m_buckets[getBucketIndex(Latency(ns))].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_total.fetch_add(ns, std::memory_order_relaxed);
+
+	auto maximum = m_maximum.load(std::memory_order_relaxed);
+	while(maximum < ns && !m_maximum.compare_exchange_weak(maximum, ns, std::memory_order_relaxed));
+}
+
+constexpr size_t LatencyHistogram::getBucketIndex(Latency latency) noexcept {
+	//Bucket i holds [2^i, 2^(i+1)) ns. Bucket 0 also holds 0ns
+	auto ns = static_cast<uint64_t>(std::max(latency.count(), Latency::rep(0)));
+	size_t result = 0;
+	while(ns > 1 && result < BUCKET_COUNT - 1) {
+		ns >>= 1;
+		++result;
+	}
+
+	return result;
+}
+
+constexpr LatencyHistogram::Latency LatencyHistogram::getBucketUpperBound(size_t index) noexcept {
+	return Latency(Latency::rep(1) << (index + 1));
+}
+
+
+
+/*
+ * ScopedLatency
+ */
+
+inline ScopedLatency::ScopedLatency(LatencyHistogram& histogram) noexcept
+	: m_histogram(histogram)
+	, m_start(LatencyHistogram::Clock::now())
+{
+}
+
+inline ScopedLatency::~ScopedLatency() {
+	m_histogram.record(LatencyHistogram::Clock::now() - m_start);
+}
+
+
+
+/*
+ * Counter
+ */
+
+inline Counter::Counter()
+	: m_value(0)
+{
+}
+
+inline void Counter::add(uint64_t count) noexcept {
+	m_value.fetch_add(count, std::memory_order_relaxed);
+}
+
+inline uint64_t Counter::get() const noexcept {
+	return m_value.load(std::memory_order_relaxed);
+}
+
+inline void Counter::reset() noexcept {
+	m_value.store(0, std::memory_order_relaxed);
+}
+
+
+
+/*
+ * Gauge
+ */
+
+inline Gauge::Gauge()
+	: m_value(0)
+	, m_maximum(0)
+{
+}
+
+inline void Gauge::set(int64_t value) noexcept {
+	m_value.store(value, std::memory_order_relaxed);
+
+	auto maximum = m_maximum.load(std::memory_order_relaxed);
+	while(maximum < value && !m_maximum.compare_exchange_weak(maximum, value, std::memory_order_relaxed));
+}
+
+inline int64_t Gauge::get() const noexcept {
+	return m_value.load(std::memory_order_relaxed);
+}
+
+inline int64_t Gauge::getMaximum() const noexcept {
+	return m_maximum.load(std::memory_order_relaxed);
+}
+
+inline void Gauge::reset() noexcept {
+	m_value.store(0, std::memory_order_relaxed);
+	m_maximum.store(0, std::memory_order_relaxed);
+}
+
+}
\ No newline at end of file
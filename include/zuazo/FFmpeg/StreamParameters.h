@@ -8,6 +8,7 @@
 #include <zuazo/Math/Rational.h>
 
 #include <cstddef>
+#include <string_view>
 
 struct AVStream;
 
@@ -66,6 +67,10 @@ public:
 	void								setRealFrameRate(Math::Rational<int> rate);
 	Math::Rational<int>					getRealFrameRate() const;
 
+	int									getPTSWrapBits() const;
+
+	std::string_view					getMetadata(const char* key) const; //Empty if not present
+
 	void								setCodecParameters(const CodecParameters& codecPar);
 	const CodecParameters&				getCodecParameters() const;
 
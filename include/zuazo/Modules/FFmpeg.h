@@ -3,6 +3,7 @@
 #include <zuazo/Instance.h>
 
 #include <memory>
+#include <string>
 
 namespace Zuazo::Modules {
 
@@ -17,6 +18,11 @@ public:
 
 	static const FFmpeg& 				get();
 
+	static void							setTracingEnabled(bool ena);
+	static bool							getTracingEnabled();
+	static bool							writeTrace(const std::string& path);
+	static void							clearTrace();
+
 private:
 	FFmpeg();
 	FFmpeg(const FFmpeg& other) = delete;
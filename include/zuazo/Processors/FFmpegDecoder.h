@@ -3,9 +3,11 @@
 #include <zuazo/ZuazoBase.h>
 #include <zuazo/Signal/ProcessorLayout.h>
 #include <zuazo/Utils/Pimpl.h>
+#include <zuazo/Resolution.h>
 #include <zuazo/FFmpeg/Signals.h>
 #include <zuazo/FFmpeg/Enumerations.h>
 #include <zuazo/FFmpeg/CodecParameters.h>
+#include <zuazo/FFmpeg/Statistics.h>
 
 #include <functional>
 
@@ -36,8 +38,14 @@ public:
 	using ZuazoBase::update;
 
 	void							readPacket();
+	void							readPacket(FFmpeg::PacketStream packet); //Bypasses the input
 	void							flush();
 
+	//Applies the settings to an opened decoder by recreating its codec
+	//context. Unlike closing and opening it, it does not go through 
+	//ZuazoBase, so it may be called from the thread which updates it
+	void							reconfigure();
+
 	void							setCodecParameters(FFmpeg::CodecParameters codecPar);
 	const FFmpeg::CodecParameters& 	getCodecParameters() const;	
 
@@ -51,12 +59,29 @@ public:
 	void							setThreadCount(int cnt);
 	int								getThreadCount() const;	
 
+	void							setLowDelay(bool ena);
+	bool							getLowDelay() const;
+
+	void							setFastDecoding(bool ena);
+	bool							getFastDecoding() const;
+
+	//When set, frames are decoded at a reduced quality, targeting this
+	//resolution. Uses lowres when supported, otherwise the loop filter is skipped
+	void							setPreviewResolution(Resolution res);
+	Resolution						getPreviewResolution() const;
+
+	//Sets the threading, low delay and fast decoding settings from a preset.
+	//As other settings, it is applied on the next open() or reconfigure()
+	void							setProfile(FFmpeg::DecodingProfile profile);
+
 	void							setPixelFormatNegotiationCallback(PixelFormatNegotiationCallback cbk);
 	const PixelFormatNegotiationCallback& getPixelFormatNegotiationCallback() const;
 
 	void							setDemuxCallback(DemuxCallback cbk);
 	const DemuxCallback&			getDemuxCallback() const;
 
+	FFmpeg::Statistics				getStatistics() const;
+
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <zuazo/ZuazoBase.h>
+#include <zuazo/Video.h>
+#include <zuazo/Signal/ProcessorLayout.h>
+#include <zuazo/Utils/Pimpl.h>
+#include <zuazo/FFmpeg/Signals.h>
+#include <zuazo/FFmpeg/Enumerations.h>
+
+#include <cstddef>
+
+namespace Zuazo::Processors {
+
+class FFmpegDownloader
+	: public Utils::Pimpl<struct FFmpegDownloaderImpl>
+	, public ZuazoBase
+	, public Signal::ProcessorLayout<Video, FFmpeg::FrameStream>
+{
+	friend FFmpegDownloaderImpl;
+public:
+	FFmpegDownloader(	Instance& instance, 
+						std::string name,
+						FFmpeg::PixelFormat pixelFormat = FFmpeg::PixelFormat::none );
+	FFmpegDownloader(const FFmpegDownloader& other) = delete;
+	FFmpegDownloader(FFmpegDownloader&& other);
+	~FFmpegDownloader();
+
+	FFmpegDownloader&		operator=(const FFmpegDownloader& other) = delete;
+	FFmpegDownloader&		operator=(FFmpegDownloader&& other);
+
+	void					setPixelFormat(FFmpeg::PixelFormat fmt);
+	FFmpeg::PixelFormat		getPixelFormat() const;
+
+	void					setBufferCount(size_t count);
+	size_t					getBufferCount() const;
+
+	static bool 			isSupportedOutput(FFmpeg::PixelFormat fmt);
+
+};
+
+}
\ No newline at end of file
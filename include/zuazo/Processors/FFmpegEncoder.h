@@ -0,0 +1,96 @@
+#pragma once
+
+#include <zuazo/ZuazoBase.h>
+#include <zuazo/Signal/ProcessorLayout.h>
+#include <zuazo/Utils/Pimpl.h>
+#include <zuazo/Math/Rational.h>
+#include <zuazo/FFmpeg/Signals.h>
+#include <zuazo/FFmpeg/Enumerations.h>
+#include <zuazo/FFmpeg/CodecParameters.h>
+#include <zuazo/FFmpeg/Statistics.h>
+
+#include <functional>
+#include <string>
+#include <cstddef>
+
+namespace Zuazo::Processors {
+
+class FFmpegEncoder
+	: public Utils::Pimpl<struct FFmpegEncoderImpl>
+	, public ZuazoBase
+	, public Signal::ProcessorLayout<FFmpeg::FrameStream, FFmpeg::PacketStream>
+{
+	friend FFmpegEncoderImpl;
+public:
+	using MuxCallback = std::function<void()>;
+
+	FFmpegEncoder(	Instance& instance,
+					std::string name,
+					FFmpeg::CodecParameters codecPar = {},
+					MuxCallback muxCbk = {});
+	FFmpegEncoder(const FFmpegEncoder& other) = delete;
+	FFmpegEncoder(FFmpegEncoder&& other);
+	~FFmpegEncoder();
+
+	FFmpegEncoder&					operator=(const FFmpegEncoder& other) = delete;
+	FFmpegEncoder&					operator=(FFmpegEncoder&& other);
+
+	using ZuazoBase::update;
+
+	void							flush();
+
+	void							setCodecParameters(FFmpeg::CodecParameters codecPar);
+	const FFmpeg::CodecParameters& 	getCodecParameters() const;
+	FFmpeg::CodecParameters			getEncodedCodecParameters() const;
+
+	void							setCodecName(std::string name);
+	const std::string&				getCodecName() const;
+
+	void							setFrameRate(Math::Rational<int> rate);
+	Math::Rational<int>				getFrameRate() const;
+	Math::Rational<int>				getTimeBase() const;
+
+	void							setInputTimeBase(Math::Rational<int> tb);
+	Math::Rational<int>				getInputTimeBase() const;
+
+	void							setThreadType(FFmpeg::ThreadType type);
+	FFmpeg::ThreadType				getThreadType() const;
+
+	void							setThreadCount(int cnt);
+	int								getThreadCount() const;
+
+	void							setBitrate(int64_t bps);
+	int64_t							getBitrate() const;
+
+	void							setMinBitrate(int64_t bps);
+	int64_t							getMinBitrate() const;
+
+	void							setMaxBitrate(int64_t bps);
+	int64_t							getMaxBitrate() const;
+
+	void							setBufferSize(int bits);
+	int								getBufferSize() const;
+
+	void							setGOPSize(int size);
+	int								getGOPSize() const;
+
+	void							setMaxBFrames(int cnt);
+	int								getMaxBFrames() const;
+
+	void							setGlobalQuality(int quality);
+	int								getGlobalQuality() const;
+
+	void							setGlobalHeaderEnabled(bool ena);
+	bool							getGlobalHeaderEnabled() const;
+
+	void							setQueueSize(size_t size);
+	size_t							getQueueSize() const;
+
+	void							setMuxCallback(MuxCallback cbk);
+	const MuxCallback&				getMuxCallback() const;
+
+	FFmpeg::Statistics				getStatistics() const;
+
+};
+
+}
\ No newline at end of file
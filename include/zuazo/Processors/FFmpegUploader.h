@@ -6,6 +6,7 @@
 #include <zuazo/Utils/Pimpl.h>
 #include <zuazo/FFmpeg/Signals.h>
 #include <zuazo/FFmpeg/CodecParameters.h>
+#include <zuazo/FFmpeg/Statistics.h>
 
 namespace Zuazo::Processors {
 
@@ -26,6 +27,17 @@ public:
 	FFmpegUploader&			operator=(const FFmpegUploader& other) = delete;
 	FFmpegUploader&			operator=(FFmpegUploader&& other);
 
+	//Allows negotiating resolutions smaller than the decoded frames. 
+	//Frames are downscaled on the CPU before uploading them
+	void					setDownscalingEnabled(bool ena);
+	bool					getDownscalingEnabled() const;
+
+	//HDR10 static metadata of the last frame. Also pushed through the 
+	//HDR metadata output along with each frame. Null for SDR frames
+	const FFmpeg::HDRMetadataStream& getHDRMetadata() const;
+
+	FFmpeg::Statistics		getStatistics() const;
+
 	static bool 			isSupportedInput(FFmpeg::PixelFormat fmt);
 
 };
@@ -2,6 +2,9 @@
 
 #include "../FFmpeg/Enumerations.h"
 #include "../FFmpeg/StreamParameters.h"
+#include "../FFmpeg/Statistics.h"
+#include "../FFmpeg/Metadata.h"
+#include "../FFmpeg/Signals.h"
 
 #include <zuazo/ZuazoBase.h>
 #include <zuazo/Video.h>
@@ -31,6 +34,48 @@ public:
 	FFmpegClip& 			operator=(const FFmpegClip& other) = delete;
 	FFmpegClip& 			operator=(FFmpegClip&& other);
 
+	//Profile used for steady playback. When adaptive, the scrub profile is 
+	//used while seeking around
+	void					setDecodingProfile(FFmpeg::DecodingProfile profile);
+	FFmpeg::DecodingProfile	getDecodingProfile() const;
+
+	void					setAdaptiveDecodingProfile(bool ena);
+	bool					getAdaptiveDecodingProfile() const;
+
+	//Decodes and uploads at the negotiated resolution, trading quality
+	//for speed. Useful for multiviewer tiles
+	void					setPreviewEnabled(bool ena);
+	bool					getPreviewEnabled() const;
+
+	//See FFmpegDemuxer. Applied when the clip is (re)opened
+	void					setAsyncIOEnabled(bool ena);
+	bool					getAsyncIOEnabled() const;
+
+	void					setDirectIOEnabled(bool ena);
+	bool					getDirectIOEnabled() const;
+
+	void					setSharingEnabled(bool ena);
+	bool					getSharingEnabled() const;
+
+	void					setSegmentedURLEnabled(bool ena);
+	bool					getSegmentedURLEnabled() const;
+
+	void					setFollowTimeout(Duration timeout);
+	Duration				getFollowTimeout() const;
+
+	//Timecode and SCTE-35 cues of the current frame. They are also pushed
+	//through the metadata output along with each frame
+	const FFmpeg::FrameMetadata& getMetadata() const;
+
+	//Moves to the frame labeled with the given timecode. Returns false if 
+	//the clip has no timecode reference
+	bool					setTimecode(const FFmpeg::Timecode& timecode);
+
+	//See FFmpegUploader
+	const FFmpeg::HDRMetadataStream& getHDRMetadata() const;
+
+	FFmpeg::Statistics		getStatistics() const;
+
 };
 	
 }
\ No newline at end of file
@@ -3,12 +3,19 @@
 #include "../FFmpeg/Enumerations.h"
 #include "../FFmpeg/Chrono.h"
 #include "../FFmpeg/StreamParameters.h"
+#include "../FFmpeg/Statistics.h"
+#include "../FFmpeg/Signals.h"
 
 #include <zuazo/ZuazoBase.h>
 #include <zuazo/Utils/Pimpl.h>
 #include <zuazo/Chrono.h>
 
+#include <deque>
+#include <functional>
+#include <limits>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace Zuazo::Sources {
 
@@ -19,6 +26,11 @@ class FFmpegDemuxer
 	friend FFmpegDemuxerImpl;
 public:
 	using Streams = Utils::BufferView<const FFmpeg::StreamParameters>;
+	using Options = std::unordered_map<std::string, std::string>;
+	using InterruptCallback = std::function<bool()>;
+	using Segments = std::vector<std::string>;
+	using PacketQueue = std::deque<FFmpeg::PacketStream>;
+	using PacketQueues = std::vector<PacketQueue>; //Indexed by the stream
 
 	FFmpegDemuxer(Instance& instance, std::string name, std::string url = "");
 	FFmpegDemuxer(const FFmpegDemuxer& other) = delete;
@@ -30,15 +42,68 @@ public:
 
 	using ZuazoBase::update;
 
+	//Reads up to maxPackets or maxBytes at once, appending them to the queue
+	//of their stream instead of pushing them through the outputs. Returns 
+	//early after reading a packet of stopStream (if not negative). Returns
+	//the amount of packets read. At the end of file no flush packets are queued
+	size_t					readBatch(	PacketQueues& queues, 
+										size_t maxPackets, 
+										size_t maxBytes = std::numeric_limits<size_t>::max(),
+										int stopStream = -1 );
+
+	void					setOptions(Options options);
+	const Options&			getOptions() const;
+
+	void					setInterruptCallback(InterruptCallback cbk);
+	const InterruptCallback& getInterruptCallback() const;
+
+	//Read local files ahead of the demuxer. When available, io_uring is used,
+	//sharing a single ring among all the demuxers of the instance
+	void					setAsyncIOEnabled(bool ena);
+	bool					getAsyncIOEnabled() const;
+
+	//Bypass the page cache (O_DIRECT) when reading asynchronously
+	void					setDirectIOEnabled(bool ena);
+	bool					getDirectIOEnabled() const;
+
+	//Share the opened input with other demuxers of the same instance which
+	//use the same URL and options. Packets are read once while they are 
+	//near each other. Seeking away or falling behind reopens the input
+	void					setSharingEnabled(bool ena);
+	bool					getSharingEnabled() const;
+
+	//Local files played back to back with a continuous timeline
+	void					setSegments(Segments segments);
+	const Segments&			getSegments() const;
+
+	//Treat local directories and m3u8 manifests given as the URL as a list
+	//of segments. Otherwise FFmpeg opens them (i.e. with its HLS demuxer)
+	void					setSegmentedURLEnabled(bool ena);
+	bool					getSegmentedURLEnabled() const;
+
+	//How long the last segment is waited to grow before signaling the end 
+	//of file. Allows playing recordings while written. Zero disables it
+	void					setFollowTimeout(FFmpeg::Duration timeout);
+	FFmpeg::Duration		getFollowTimeout() const;
+
+	//Unwraps timestamps and joins discontinuities, so that packets form a
+	//continuous timeline. Seeks are given in this timeline
+	void					setTimestampNormalizationEnabled(bool ena);
+	bool					getTimestampNormalizationEnabled() const;
+
 	Streams					getStreams() const;
 	int						findBestStream(FFmpeg::MediaType type) const;
 	int						getLastStreamIndex() const;
+	bool					isEndOfFile() const;
 	FFmpeg::Duration		getDuration() const;
 
 	bool					seek(int stream, int64_t timestamp, FFmpeg::SeekFlags flags = FFmpeg::SeekFlags::none);
 	bool					seek(FFmpeg::Duration timestamp, FFmpeg::SeekFlags flags = FFmpeg::SeekFlags::none);
+	//Fails without flushing if the input is shared with other demuxers
 	bool					flush();
 
+	FFmpeg::Statistics		getStatistics() const;
+
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "FFmpegDemuxer.h"
+#include "../FFmpeg/Statistics.h"
+
+#include <zuazo/ZuazoBase.h>
+#include <zuazo/Video.h>
+#include <zuazo/Chrono.h>
+#include <zuazo/Signal/SourceLayout.h>
+#include <zuazo/Utils/Pimpl.h>
+
+namespace Zuazo::Sources {
+
+//Source for non seekable inputs (UDP, SRT, pipes...) which are paced by
+//the wall clock instead of the clip's timeline
+class FFmpegLiveSource
+	: public Utils::Pimpl<struct FFmpegLiveSourceImpl>
+	, public ZuazoBase
+	, public VideoBase
+	, public Signal::SourceLayout<Video>
+{
+	friend FFmpegLiveSourceImpl;
+public:
+	using DemuxerOptions = FFmpegDemuxer::Options;
+
+	FFmpegLiveSource(	Instance& instance,
+						std::string name,
+						std::string url );
+
+	FFmpegLiveSource(const FFmpegLiveSource& other) = delete;
+	FFmpegLiveSource(FFmpegLiveSource&& other);
+	~FFmpegLiveSource();
+
+	FFmpegLiveSource& 		operator=(const FFmpegLiveSource& other) = delete;
+	FFmpegLiveSource& 		operator=(FFmpegLiveSource&& other);
+
+	void					setJitterBufferDelay(Duration delay);
+	Duration				getJitterBufferDelay() const;
+
+	void					setDemuxerOptions(DemuxerOptions options);
+	const DemuxerOptions&	getDemuxerOptions() const;
+
+	FFmpeg::Statistics		getStatistics() const;
+
+	static const DemuxerOptions& getDefaultDemuxerOptions();
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <zuazo/FFmpeg/Statistics.h>
+
+#include <zuazo/ZuazoBase.h>
+#include <zuazo/Video.h>
+#include <zuazo/ClipBase.h>
+#include <zuazo/Chrono.h>
+#include <zuazo/Signal/SourceLayout.h>
+#include <zuazo/Utils/Pimpl.h>
+
+#include <string>
+#include <vector>
+
+namespace Zuazo::Sources {
+
+//Plays a sequence of files back to back. The next item is opened and
+//pre-rolled in the background, so that transitions are gapless
+class FFmpegPlaylist
+	: public Utils::Pimpl<struct FFmpegPlaylistImpl>
+	, public ZuazoBase
+	, public VideoBase
+	, public ClipBase
+	, public Signal::SourceLayout<Video>
+{
+	friend FFmpegPlaylistImpl;
+public:
+	struct Item {
+		std::string			url;
+		Duration			inPoint = Duration();
+		Duration			outPoint = Duration::max(); //Until the end of the file
+	};
+
+	using Items = std::vector<Item>;
+
+	FFmpegPlaylist(	Instance& instance,
+					std::string name,
+					Items items = {} );
+
+	FFmpegPlaylist(const FFmpegPlaylist& other) = delete;
+	FFmpegPlaylist(FFmpegPlaylist&& other);
+	~FFmpegPlaylist();
+
+	FFmpegPlaylist& 		operator=(const FFmpegPlaylist& other) = delete;
+	FFmpegPlaylist& 		operator=(FFmpegPlaylist&& other);
+
+	void					setItems(Items items);
+	const Items&			getItems() const;
+
+	//How long before the end of the current item the next one starts opening
+	void					setPreloadTime(Duration time);
+	Duration				getPreloadTime() const;
+
+	int						getCurrentIndex() const; //-1 if none
+
+	FFmpeg::Statistics		getStatistics() const;
+
+};
+
+}
\ No newline at end of file
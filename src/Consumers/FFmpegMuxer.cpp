@@ -0,0 +1,453 @@
+#include <zuazo/Consumers/FFmpegMuxer.h>
+
+#include "../FFmpeg/OutputFormatContext.h"
+#include "../FFmpeg/OutputIOContext.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/Utils/Functions.h>
+#include <zuazo/Signal/Input.h>
+#include <zuazo/FFmpeg/Signals.h>
+
+#include <memory>
+#include <deque>
+#include <vector>
+#include <cassert>
+
+extern "C" {
+	#include <libavformat/avformat.h>
+	#include <libavutil/mathematics.h>
+}
+
+
+namespace Zuazo::Consumers {
+
+/*
+ * FFmpegMuxerImpl
+ */
+
+struct FFmpegMuxerImpl {
+	struct StreamDescriptor {
+		FFmpeg::CodecParameters		codecParameters;
+		Math::Rational<int>			timeBase;
+	};
+
+	struct Open {
+		using Input = Signal::Input<FFmpeg::PacketStream>;
+
+		struct StreamQueue {
+			std::deque<FFmpeg::PacketStream> packets;
+			AVRational				srcTimeBase;
+			AVRational				dstTimeBase;
+			bool					ended;
+		};
+
+		std::unique_ptr<FFmpeg::OutputIOContext> ioContext; //Declared first, so that it outlives formatContext
+		FFmpeg::OutputFormatContext	formatContext;
+		std::vector<Input> 			pads;
+		std::vector<StreamQueue>	queues;
+		size_t						queuedCount;
+		size_t						maxQueuedCount;
+		FFmpeg::Packet				scratchPacket;
+		int							writeError; //Writing stops after the first error
+
+		Open(	const FFmpegMuxer& muxer,
+				const std::string& url,
+				const std::string& format,
+				const std::vector<StreamDescriptor>& streams,
+				size_t ioBufferSize,
+				bool ioThreadEnabled,
+				size_t interleaveQueueSize )
+			: ioContext()
+			, formatContext(url.c_str(), format.empty() ? nullptr : format.c_str())
+			, pads(createPads(muxer, streams.size()))
+			, queues(streams.size())
+			, queuedCount(0)
+			, maxQueuedCount(interleaveQueueSize)
+			, scratchPacket()
+			, writeError(0)
+		{
+			for(size_t i = 0; i < streams.size(); ++i) {
+				if(formatContext.addStream(streams[i].codecParameters, streams[i].timeBase) < 0) {
+					throw Exception("Unable to add a stream to the output: " + url);
+				}
+			}
+
+			if(formatContext.requiresIOContext()) {
+				ioContext = Utils::makeUnique<FFmpeg::OutputIOContext>(url.c_str(), ioBufferSize, ioThreadEnabled);
+				formatContext.setIOContext(*ioContext);
+			}
+
+			if(formatContext.writeHeader() < 0) {
+				throw Exception("Unable to write the header for file: " + url);
+			}
+
+			//The muxer may have changed the time bases when writing the header
+			const auto outputStreams = formatContext.getStreams();
+			for(size_t i = 0; i < queues.size(); ++i) {
+				const auto srcTimeBase = streams[i].timeBase;
+				const auto dstTimeBase = outputStreams[i].getTimeBase();
+				queues[i].srcTimeBase = AVRational{ srcTimeBase.getNumerator(), srcTimeBase.getDenominator() };
+				queues[i].dstTimeBase = AVRational{ dstTimeBase.getNumerator(), dstTimeBase.getDenominator() };
+				queues[i].ended = false;
+			}
+		}
+
+		~Open() {
+			interleave(true);
+			formatContext.writeTrailer();
+		}
+
+		void update() {
+			//Gather all the incoming packets
+			for(size_t i = 0; i < pads.size(); ++i) {
+				if(pads[i].hasChanged()) {
+					const auto& packet = pads[i].pull();
+
+					if(packet && packet->getData().size() > 0) {
+						queues[i].packets.push_back(packet);
+						queues[i].ended = false;
+						++queuedCount;
+					} else {
+						//Empty packets signal the end of the stream
+						queues[i].ended = true;
+					}
+				}
+			}
+
+			interleave(false);
+		}
+
+		bool flush() {
+			interleave(true);
+
+			bool result = writeError == 0 && formatContext.flush() >= 0;
+			if(ioContext) {
+				result = result && ioContext->flush() >= 0;
+			}
+
+			return result;
+		}
+
+	private:
+		void interleave(bool all) {
+			while(true) {
+				//Find the queued packet with the lowest DTS
+				int next = -1;
+				bool ready = true;
+				for(size_t i = 0; i < queues.size(); ++i) {
+					if(queues[i].packets.empty()) {
+						//This stream could still provide a earlier packet
+						ready = ready && queues[i].ended;
+					} else if(next < 0 || compare(i, next) < 0) {
+						next = i;
+					}
+				}
+
+				if(next < 0) {
+					break; //Nothing to write
+				}
+
+				if(!ready && !all && queuedCount <= maxQueuedCount) {
+					break; //Wait for the rest of the streams
+				}
+
+				write(next);
+			}
+		}
+
+		void write(size_t index) {
+			auto& queue = queues[index];
+			assert(!queue.packets.empty());
+
+			//Reference it to avoid modifying the shared packet. After an
+			//error (disk full, broken pipe...) packets are discarded
+			if(writeError == 0 && scratchPacket.ref(*queue.packets.front()) >= 0) {
+				scratchPacket.setStreamIndex(index);
+				av_packet_rescale_ts(scratchPacket, queue.srcTimeBase, queue.dstTimeBase);
+				const auto result = formatContext.writePacket(scratchPacket);
+				if(result < 0) {
+					writeError = result;
+				}
+				scratchPacket.unref();
+			}
+
+			queue.packets.pop_front();
+			--queuedCount;
+		}
+
+		int compare(size_t a, size_t b) const {
+			return av_compare_ts(
+				getTimeStamp(*queues[a].packets.front()), queues[a].srcTimeBase,
+				getTimeStamp(*queues[b].packets.front()), queues[b].srcTimeBase
+			);
+		}
+
+		static int64_t getTimeStamp(const FFmpeg::Packet& packet) {
+			const auto dts = packet.getDTS();
+			return (dts != AV_NOPTS_VALUE) ? dts : packet.getPTS();
+		}
+
+		static std::vector<Input> createPads(const FFmpegMuxer& muxer, size_t streamCount) {
+			std::vector<Input> result;
+			result.reserve(streamCount);
+
+			for(size_t i = 0; i < streamCount; i++) {
+				result.emplace_back(muxer, Signal::makeInputName<FFmpeg::PacketStream>(i));
+			}
+
+			return result;
+		}
+
+	};
+
+	std::string 					url;
+	std::string 					format;
+	std::vector<StreamDescriptor>	streams;
+	size_t							ioBufferSize;
+	bool							ioThreadEnabled;
+	size_t							interleaveQueueSize;
+
+	std::unique_ptr<Open> 			opened;
+
+	FFmpegMuxerImpl(std::string url, std::string format)
+		: url(std::move(url))
+		, format(std::move(format))
+		, streams()
+		, ioBufferSize(FFmpeg::OutputIOContext::DEFAULT_BUFFER_SIZE)
+		, ioThreadEnabled(true)
+		, interleaveQueueSize(256)
+	{
+	}
+
+	~FFmpegMuxerImpl() = default;
+
+	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& muxer = static_cast<FFmpegMuxer&>(base);
+		assert(!opened);
+
+		//Create in a unlocked environment
+		if(lock) lock->unlock();
+		std::unique_ptr<Open> newOpened;
+		try {
+			//May throw! (nothing has been done yet, so don't worry about cleaning)
+			newOpened = Utils::makeUnique<Open>(
+				muxer,
+				url,
+				format,
+				streams,
+				ioBufferSize,
+				ioThreadEnabled,
+				interleaveQueueSize
+			);
+		} catch(...) {
+			if(lock) lock->lock();
+			throw;
+		}
+		if(lock) lock->lock();
+
+		//Apply changes after locking
+		opened = std::move(newOpened);
+		for(auto& pad : opened->pads) {
+			muxer.registerPad(pad);
+		}
+
+		assert(opened);
+	}
+
+	void asyncOpen(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		open(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void close(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& muxer = static_cast<FFmpegMuxer&>(base);
+		assert(opened);
+
+		//Apply changes while locked
+		for(auto& pad : opened->pads) {
+			muxer.removePad(pad);
+		}
+		auto oldOpened = std::move(opened);
+
+		//Destroy stuff in a unlocked environment. This finishes writing the file
+		if(lock) lock->unlock();
+		oldOpened.reset();
+		if(lock) lock->lock();
+
+		assert(!opened);
+	}
+
+	void asyncClose(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		close(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void update() {
+		if(opened) {
+			opened->update();
+		}
+	}
+
+
+
+	int addStream(FFmpeg::CodecParameters codecPar, Math::Rational<int> timeBase) {
+		streams.push_back(StreamDescriptor{ std::move(codecPar), timeBase });
+		return streams.size() - 1;
+	}
+
+	void clearStreams() {
+		streams.clear();
+	}
+
+	size_t getStreamCount() const {
+		return streams.size();
+	}
+
+	FFmpegMuxer::Streams getStreams() const {
+		return opened
+		? opened->formatContext.getStreams()
+		: FFmpegMuxer::Streams();
+	}
+
+	bool requiresGlobalHeader() const {
+		if(opened) {
+			return opened->formatContext.requiresGlobalHeader();
+		} else {
+			const auto* outputFormat = av_guess_format(
+				format.empty() ? nullptr : format.c_str(),
+				url.c_str(),
+				nullptr
+			);
+			return outputFormat && (outputFormat->flags & AVFMT_GLOBALHEADER);
+		}
+	}
+
+
+	void setIOBufferSize(size_t size) {
+		ioBufferSize = size;
+	}
+
+	size_t getIOBufferSize() const {
+		return ioBufferSize;
+	}
+
+
+	void setIOThreadEnabled(bool ena) {
+		ioThreadEnabled = ena;
+	}
+
+	bool getIOThreadEnabled() const {
+		return ioThreadEnabled;
+	}
+
+
+	void setInterleaveQueueSize(size_t size) {
+		interleaveQueueSize = size;
+	}
+
+	size_t getInterleaveQueueSize() const {
+		return interleaveQueueSize;
+	}
+
+
+	bool flush() {
+		return opened
+		? opened->flush()
+		: false;
+	}
+
+	int getWriteError() const {
+		return opened ? opened->writeError : 0;
+	}
+};
+
+
+
+/*
+ * FFmpegMuxer
+ */
+
+FFmpegMuxer::FFmpegMuxer(Instance& instance, std::string name, std::string url, std::string format)
+	: Utils::Pimpl<FFmpegMuxerImpl>({}, std::move(url), std::move(format))
+	, ZuazoBase(
+		instance,
+		std::move(name),
+		{},
+		ZuazoBase::MoveCallback(),
+		std::bind(&FFmpegMuxerImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegMuxerImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegMuxerImpl::close, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegMuxerImpl::asyncClose, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegMuxerImpl::update, std::ref(**this)) )
+{
+}
+
+FFmpegMuxer::FFmpegMuxer(FFmpegMuxer&& other) = default;
+
+FFmpegMuxer::~FFmpegMuxer() = default;
+
+FFmpegMuxer& FFmpegMuxer::operator=(FFmpegMuxer&& other) = default;
+
+
+
+int FFmpegMuxer::addStream(FFmpeg::CodecParameters codecPar, Math::Rational<int> timeBase) {
+	return (*this)->addStream(std::move(codecPar), timeBase);
+}
+
+void FFmpegMuxer::clearStreams() {
+	(*this)->clearStreams();
+}
+
+size_t FFmpegMuxer::getStreamCount() const {
+	return (*this)->getStreamCount();
+}
+
+FFmpegMuxer::Streams FFmpegMuxer::getStreams() const {
+	return (*this)->getStreams();
+}
+
+
+bool FFmpegMuxer::requiresGlobalHeader() const {
+	return (*this)->requiresGlobalHeader();
+}
+
+
+void FFmpegMuxer::setIOBufferSize(size_t size) {
+	(*this)->setIOBufferSize(size);
+}
+
+size_t FFmpegMuxer::getIOBufferSize() const {
+	return (*this)->getIOBufferSize();
+}
+
+
+void FFmpegMuxer::setIOThreadEnabled(bool ena) {
+	(*this)->setIOThreadEnabled(ena);
+}
+
+bool FFmpegMuxer::getIOThreadEnabled() const {
+	return (*this)->getIOThreadEnabled();
+}
+
+
+void FFmpegMuxer::setInterleaveQueueSize(size_t size) {
+	(*this)->setInterleaveQueueSize(size);
+}
+
+size_t FFmpegMuxer::getInterleaveQueueSize() const {
+	return (*this)->getInterleaveQueueSize();
+}
+
+
+bool FFmpegMuxer::flush() {
+	return (*this)->flush();
+}
+
+int FFmpegMuxer::getWriteError() const {
+	return (*this)->getWriteError();
+}
+
+
+}
\ No newline at end of file
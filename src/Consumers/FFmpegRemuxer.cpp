@@ -0,0 +1,531 @@
+#include <zuazo/Consumers/FFmpegRemuxer.h>
+
+#include "../FFmpeg/Reclaimer.h"
+#include "../FFmpeg/RecyclingPool.h"
+
+#include <zuazo/Sources/FFmpegDemuxer.h>
+#include <zuazo/Consumers/FFmpegMuxer.h>
+#include <zuazo/Utils/Functions.h>
+#include <zuazo/Signal/Input.h>
+#include <zuazo/Signal/Output.h>
+#include <zuazo/FFmpeg/Signals.h>
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+extern "C" {
+	#include <libavutil/avutil.h>
+	#include <libavutil/mathematics.h>
+}
+
+namespace Zuazo::Consumers {
+
+/*
+ * FFmpegRemuxerImpl
+ */
+
+struct FFmpegRemuxerImpl {
+	struct Open {
+		using PacketPool = FFmpeg::RecyclingPool<FFmpeg::Packet>;
+		using Output = Signal::Output<FFmpeg::PacketStream>;
+		using DemuxerOutput = Signal::PadProxy<Signal::Output<FFmpeg::PacketStream>>;
+
+		struct StreamState {
+			const DemuxerOutput*	source;
+			int						outputIndex;
+			AVRational				timeBase;
+			bool					reference;
+			bool					started;
+			bool					ended;
+		};
+
+		Sources::FFmpegDemuxer&		demuxer;
+		FFmpegMuxer&				muxer;
+		std::vector<StreamState>	streams;
+		std::vector<Output>			outputs;
+		PacketPool					pool;
+
+		FFmpeg::Duration			inPoint;
+		FFmpeg::Duration			outPoint;
+		int64_t						startTime; //In AV_TIME_BASE units
+		size_t						activeCount;
+		bool						finished;
+		FFmpegRemuxer::Result		result;
+
+		Open(	const FFmpegRemuxer& remuxer,
+				Sources::FFmpegDemuxer& demux,
+				FFmpegMuxer& mux,
+				const std::vector<int>& selection,
+				FFmpeg::Duration in,
+				FFmpeg::Duration out )
+			: demuxer(demux)
+			, muxer(mux)
+			, streams(createStreamStates(demuxer, selection))
+			, outputs(createOutputs(remuxer, selection.size()))
+			, pool(FFmpeg::Reclaimer::getShared(&remuxer.getInstance()))
+			, inPoint(in)
+			, outPoint(out)
+			, startTime(AV_NOPTS_VALUE)
+			, activeCount(selection.size())
+			, finished(selection.empty())
+			, result()
+		{
+			//Route the selected streams to the muxer
+			for(size_t i = 0; i < outputs.size(); ++i) {
+				auto& input = Signal::getInput<FFmpeg::PacketStream>(muxer, Signal::makeInputName<FFmpeg::PacketStream>(i));
+				input << outputs[i].getProxy();
+			}
+
+			//Go to the keyframe before the in point
+			if(inPoint > FFmpeg::Duration::zero()) {
+				demuxer.seek(inPoint, FFmpeg::SeekFlags::backward);
+			}
+		}
+
+		~Open() = default;
+
+		bool step() {
+			if(finished) {
+				return false;
+			}
+
+			const auto t0 = std::chrono::steady_clock::now();
+
+			demuxer.update();
+			const auto index = demuxer.getLastStreamIndex();
+
+			if(index >= 0) {
+				assert(static_cast<size_t>(index) < streams.size());
+				auto& stream = streams[index];
+
+				assert(stream.source);
+				const auto& packet = stream.source->getLastElement();
+				if(packet && packet->getData().size() > 0) {
+					process(stream, packet);
+				} else {
+					//Reached the end of the file
+					finished = true;
+				}
+			} else {
+				//Error reading
+				finished = true;
+			}
+
+			if(finished) {
+				//Write everything that is buffered in the muxer
+				muxer.flush();
+			}
+
+			result.elapsed += std::chrono::steady_clock::now() - t0;
+			return !finished;
+		}
+
+	private:
+		void process(StreamState& stream, const FFmpeg::PacketStream& packet) {
+			if(stream.outputIndex < 0 || stream.ended) {
+				return; //Stream is not selected or it is already trimmed
+			}
+
+			const auto timeStamp = getTimeStamp(*packet);
+			if(timeStamp == AV_NOPTS_VALUE) {
+				return; //Nothing can be done without timing
+			}
+
+			const auto rescaledTimeStamp = av_rescale_q(timeStamp, stream.timeBase, AVRational{ 1, AV_TIME_BASE });
+			const bool isKey = (packet->getFlags() & FFmpeg::PacketFlags::key) != FFmpeg::PacketFlags::none;
+
+			//Start each stream at a keyframe, so that the output is decodable from the beginning
+			if(!stream.started) {
+				if(!isKey) {
+					return;
+				}
+
+				if(stream.reference) {
+					if(startTime == AV_NOPTS_VALUE) startTime = rescaledTimeStamp;
+				} else if(startTime == AV_NOPTS_VALUE || rescaledTimeStamp < startTime) {
+					return; //Wait until the reference stream has started
+				}
+
+				stream.started = true;
+			}
+
+			//End each stream at the first keyframe after the out point, so that the last GOP is complete
+			if(rescaledTimeStamp >= outPoint.count() && isKey) {
+				stream.ended = true;
+				assert(activeCount > 0);
+				finished = (--activeCount == 0);
+				return;
+			}
+
+			//Reference the packet, so that its contents are not copied, and rebase it
+			auto rebasedPacket = pool.acquire();
+			assert(rebasedPacket);
+			if(rebasedPacket->ref(*packet) < 0) {
+				return;
+			}
+
+			const auto offset = av_rescale_q(startTime, AVRational{ 1, AV_TIME_BASE }, stream.timeBase);
+			if(rebasedPacket->getPTS() != AV_NOPTS_VALUE) {
+				rebasedPacket->setPTS(rebasedPacket->getPTS() - offset);
+			}
+			if(rebasedPacket->getDTS() != AV_NOPTS_VALUE) {
+				rebasedPacket->setDTS(rebasedPacket->getDTS() - offset);
+			}
+
+			++result.packetCount;
+			result.byteCount += rebasedPacket->getData().size();
+
+			//Write it
+			outputs[stream.outputIndex].push(std::move(rebasedPacket));
+			muxer.update();
+		}
+
+		static int64_t getTimeStamp(const FFmpeg::Packet& packet) {
+			const auto pts = packet.getPTS();
+			return (pts != AV_NOPTS_VALUE) ? pts : packet.getDTS();
+		}
+
+		static std::vector<StreamState> createStreamStates(	Sources::FFmpegDemuxer& demuxer,
+															const std::vector<int>& selection )
+		{
+			const auto inputStreams = demuxer.getStreams();
+			std::vector<StreamState> result(inputStreams.size());
+
+			for(size_t i = 0; i < result.size(); ++i) {
+				const auto timeBase = inputStreams[i].getTimeBase();
+				const auto& output = Signal::getOutput<FFmpeg::PacketStream>(demuxer, Signal::makeOutputName<FFmpeg::PacketStream>(i));
+
+				result[i].source = &output;
+				result[i].outputIndex = -1;
+				result[i].timeBase = AVRational{ timeBase.getNumerator(), timeBase.getDenominator() };
+				result[i].reference = false;
+				result[i].started = false;
+				result[i].ended = false;
+			}
+
+			//Assign the output indices
+			for(size_t i = 0; i < selection.size(); ++i) {
+				assert(selection[i] >= 0 && static_cast<size_t>(selection[i]) < result.size());
+				result[selection[i]].outputIndex = i;
+			}
+
+			//The first video stream dictates where the output starts. If there is none, use the first one
+			if(!selection.empty()) {
+				const auto ite = std::find_if(
+					selection.cbegin(), selection.cend(),
+					[&inputStreams] (int index) -> bool {
+						return inputStreams[index].getCodecParameters().getMediaType() == FFmpeg::MediaType::video;
+					}
+				);
+
+				result[ite != selection.cend() ? *ite : selection.front()].reference = true;
+			}
+
+			return result;
+		}
+
+		static std::vector<Output> createOutputs(const FFmpegRemuxer& remuxer, size_t count) {
+			std::vector<Output> result;
+			result.reserve(count);
+
+			for(size_t i = 0; i < count; i++) {
+				result.emplace_back(remuxer, Signal::makeOutputName<FFmpeg::PacketStream>(i));
+			}
+
+			return result;
+		}
+
+	};
+
+	std::reference_wrapper<FFmpegRemuxer> owner;
+
+	Sources::FFmpegDemuxer 			demuxer;
+	FFmpegMuxer						muxer;
+
+	std::vector<int>				streamSelection;
+	FFmpeg::Duration				inPoint;
+	FFmpeg::Duration				outPoint;
+
+	std::unique_ptr<Open>			opened;
+
+	FFmpegRemuxerImpl(	FFmpegRemuxer& remuxer,
+						Instance& instance,
+						std::string inputUrl,
+						std::string outputUrl,
+						std::string outputFormat )
+		: owner(remuxer)
+		, demuxer(instance, "Demuxer", std::move(inputUrl))
+		, muxer(instance, "Muxer", std::move(outputUrl), std::move(outputFormat))
+		, streamSelection()
+		, inPoint(FFmpeg::Duration::zero())
+		, outPoint(FFmpeg::Duration::max())
+	{
+	}
+
+	~FFmpegRemuxerImpl() = default;
+
+	void moved(ZuazoBase& base) {
+		owner = static_cast<FFmpegRemuxer&>(base);
+	}
+
+	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& remuxer = static_cast<FFmpegRemuxer&>(base);
+		assert(&owner.get() == &remuxer);
+		assert(!opened);
+
+		//Open the input first, as its streams are needed to configure the output
+		//May throw! (nothing has been done yet, so don't worry about cleaning)
+		if(lock) {
+			demuxer.asyncOpen(*lock);
+		} else {
+			demuxer.open();
+		}
+
+		try {
+			//Configure the output streams
+			const auto selection = getSelectedStreams();
+			const auto streams = demuxer.getStreams();
+			muxer.clearStreams();
+			for(const auto index : selection) {
+				auto codecPar = FFmpeg::CodecParameters(streams[index].getCodecParameters());
+				codecPar.setCodecTag(0); //Let the output container choose its own tag
+				muxer.addStream(std::move(codecPar), streams[index].getTimeBase());
+			}
+
+			if(lock) {
+				muxer.asyncOpen(*lock);
+			} else {
+				muxer.open();
+			}
+
+			opened = Utils::makeUnique<Open>(
+				remuxer,
+				demuxer,
+				muxer,
+				selection,
+				inPoint,
+				outPoint
+			);
+		} catch(...) {
+			//Leave the childs closed, as the remuxer remains closed
+			if(lock && !lock->owns_lock()) {
+				lock->lock();
+			}
+
+			if(muxer.isOpen()) {
+				if(lock) {
+					muxer.asyncClose(*lock);
+				} else {
+					muxer.close();
+				}
+			}
+
+			if(lock) {
+				demuxer.asyncClose(*lock);
+			} else {
+				demuxer.close();
+			}
+
+			throw;
+		}
+
+		assert(opened);
+	}
+
+	void asyncOpen(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		open(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void close(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& remuxer = static_cast<FFmpegRemuxer&>(base);
+		assert(&owner.get() == &remuxer); (void)(remuxer);
+		assert(opened);
+
+		opened.reset();
+
+		//Close childs asynchronously if possible. Closing the muxer finishes the file
+		if(lock) {
+			muxer.asyncClose(*lock);
+			demuxer.asyncClose(*lock);
+		} else {
+			muxer.close();
+			demuxer.close();
+		}
+
+		assert(!opened);
+	}
+
+	void asyncClose(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		close(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void update() {
+		step();
+	}
+
+
+	FFmpegRemuxer::Streams getInputStreams() const {
+		return demuxer.getStreams();
+	}
+
+
+	void setStreamSelection(std::vector<int> streams) {
+		streamSelection = std::move(streams);
+	}
+
+	const std::vector<int>& getStreamSelection() const {
+		return streamSelection;
+	}
+
+
+	void setInPoint(FFmpeg::Duration in) {
+		inPoint = in;
+	}
+
+	FFmpeg::Duration getInPoint() const {
+		return inPoint;
+	}
+
+
+	void setOutPoint(FFmpeg::Duration out) {
+		outPoint = out;
+	}
+
+	FFmpeg::Duration getOutPoint() const {
+		return outPoint;
+	}
+
+
+	bool step() {
+		return opened ? opened->step() : false;
+	}
+
+	FFmpegRemuxer::Result run() {
+		while(step());
+		return getResult();
+	}
+
+	bool isFinished() const {
+		return opened ? opened->finished : true;
+	}
+
+	const FFmpegRemuxer::Result& getResult() const {
+		static const FFmpegRemuxer::Result EMPTY_RESULT;
+		return opened ? opened->result : EMPTY_RESULT;
+	}
+
+private:
+	std::vector<int> getSelectedStreams() const {
+		const auto streamCount = static_cast<int>(demuxer.getStreams().size());
+		std::vector<int> result;
+
+		if(streamSelection.empty()) {
+			//Select everything
+			result.resize(streamCount);
+			for(int i = 0; i < streamCount; ++i) {
+				result[i] = i;
+			}
+		} else {
+			//Only select the valid ones
+			std::copy_if(
+				streamSelection.cbegin(), streamSelection.cend(),
+				std::back_inserter(result),
+				[streamCount] (int index) -> bool {
+					return index >= 0 && index < streamCount;
+				}
+			);
+		}
+
+		return result;
+	}
+
+};
+
+
+
+/*
+ * FFmpegRemuxer
+ */
+
+FFmpegRemuxer::FFmpegRemuxer(	Instance& instance,
+								std::string name,
+								std::string inputUrl,
+								std::string outputUrl,
+								std::string outputFormat )
+	: Utils::Pimpl<FFmpegRemuxerImpl>({}, *this, instance, std::move(inputUrl), std::move(outputUrl), std::move(outputFormat))
+	, ZuazoBase(
+		instance,
+		std::move(name),
+		{},
+		std::bind(&FFmpegRemuxerImpl::moved, std::ref(**this), std::placeholders::_1),
+		std::bind(&FFmpegRemuxerImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegRemuxerImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegRemuxerImpl::close, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegRemuxerImpl::asyncClose, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegRemuxerImpl::update, std::ref(**this)) )
+{
+}
+
+FFmpegRemuxer::FFmpegRemuxer(FFmpegRemuxer&& other) = default;
+
+FFmpegRemuxer::~FFmpegRemuxer() = default;
+
+FFmpegRemuxer& FFmpegRemuxer::operator=(FFmpegRemuxer&& other) = default;
+
+
+
+FFmpegRemuxer::Streams FFmpegRemuxer::getInputStreams() const {
+	return (*this)->getInputStreams();
+}
+
+
+void FFmpegRemuxer::setStreamSelection(std::vector<int> streams) {
+	(*this)->setStreamSelection(std::move(streams));
+}
+
+const std::vector<int>& FFmpegRemuxer::getStreamSelection() const {
+	return (*this)->getStreamSelection();
+}
+
+
+void FFmpegRemuxer::setInPoint(FFmpeg::Duration in) {
+	(*this)->setInPoint(in);
+}
+
+FFmpeg::Duration FFmpegRemuxer::getInPoint() const {
+	return (*this)->getInPoint();
+}
+
+
+void FFmpegRemuxer::setOutPoint(FFmpeg::Duration out) {
+	(*this)->setOutPoint(out);
+}
+
+FFmpeg::Duration FFmpegRemuxer::getOutPoint() const {
+	return (*this)->getOutPoint();
+}
+
+
+bool FFmpegRemuxer::step() {
+	return (*this)->step();
+}
+
+FFmpegRemuxer::Result FFmpegRemuxer::run() {
+	return (*this)->run();
+}
+
+bool FFmpegRemuxer::isFinished() const {
+	return (*this)->isFinished();
+}
+
+const FFmpegRemuxer::Result& FFmpegRemuxer::getResult() const {
+	return (*this)->getResult();
+}
+
+}
\ No newline at end of file
@@ -109,6 +109,131 @@ ThreadType CodecContext::getThreadType() const {
 }
 
 
+void CodecContext::setFlags(int flags) {
+	get().flags = flags;
+}
+
+int CodecContext::getFlags() const {
+	return get().flags;
+}
+
+
+void CodecContext::setFlags2(int flags) {
+	get().flags2 = flags;
+}
+
+int CodecContext::getFlags2() const {
+	return get().flags2;
+}
+
+
+void CodecContext::setLowres(int lowres) {
+	get().lowres = lowres;
+}
+
+int CodecContext::getLowres() const {
+	return get().lowres;
+}
+
+
+void CodecContext::setSkipLoopFilter(Discard discard) {
+	get().skip_loop_filter = static_cast<AVDiscard>(discard);
+}
+
+Discard CodecContext::getSkipLoopFilter() const {
+	return static_cast<Discard>(get().skip_loop_filter);
+}
+
+
+void CodecContext::setTimeBase(Math::Rational<int> tb) {
+	get().time_base.num = tb.getNumerator();
+	get().time_base.den = tb.getDenominator();
+}
+
+Math::Rational<int> CodecContext::getTimeBase() const {
+	return Math::Rational<int>(
+		get().time_base.num,
+		get().time_base.den
+	);
+}
+
+
+void CodecContext::setFrameRate(Math::Rational<int> rate) {
+	get().framerate.num = rate.getNumerator();
+	get().framerate.den = rate.getDenominator();
+}
+
+Math::Rational<int> CodecContext::getFrameRate() const {
+	return Math::Rational<int>(
+		get().framerate.num,
+		get().framerate.den
+	);
+}
+
+
+void CodecContext::setBitrate(int64_t bps) {
+	get().bit_rate = bps;
+}
+
+int64_t CodecContext::getBitrate() const {
+	return get().bit_rate;
+}
+
+
+void CodecContext::setMinBitrate(int64_t bps) {
+	get().rc_min_rate = bps;
+}
+
+int64_t CodecContext::getMinBitrate() const {
+	return get().rc_min_rate;
+}
+
+
+void CodecContext::setMaxBitrate(int64_t bps) {
+	get().rc_max_rate = bps;
+}
+
+int64_t CodecContext::getMaxBitrate() const {
+	return get().rc_max_rate;
+}
+
+
+void CodecContext::setBufferSize(int bits) {
+	get().rc_buffer_size = bits;
+}
+
+int CodecContext::getBufferSize() const {
+	return get().rc_buffer_size;
+}
+
+
+void CodecContext::setGOPSize(int size) {
+	get().gop_size = size;
+}
+
+int CodecContext::getGOPSize() const {
+	return get().gop_size;
+}
+
+
+void CodecContext::setMaxBFrames(int cnt) {
+	get().max_b_frames = cnt;
+}
+
+int CodecContext::getMaxBFrames() const {
+	return get().max_b_frames;
+}
+
+
+void CodecContext::setGlobalQuality(int quality) {
+	get().global_quality = quality;
+}
+
+int CodecContext::getGlobalQuality() const {
+	return get().global_quality;
+}
+
+
 
 int CodecContext::sendPacket(const Packet& packet) {
 	return avcodec_send_packet(&get(), packet);
@@ -126,6 +251,11 @@ int CodecContext::readFrame(Frame& frame) {
 	return avcodec_receive_frame(&get(), frame);
 }
 
+int CodecContext::sendEndOfStream() {
+	//Sending a null frame enters the draining mode of the encoder
+	return avcodec_send_frame(&get(), nullptr);
+}
+
 
 
 void CodecContext::flush() {
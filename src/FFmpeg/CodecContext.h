@@ -6,6 +6,7 @@
 #include <zuazo/FFmpeg/CodecParameters.h>
 
 #include <zuazo/Utils/BufferView.h>
+#include <zuazo/Math/Rational.h>
 
 #include <cstddef>
 
@@ -53,10 +54,50 @@ public:
 	void								setThreadType(ThreadType type);
 	ThreadType							getThreadType() const;
 
+	void								setFlags(int flags);
+	int									getFlags() const;
+
+	void								setFlags2(int flags);
+	int									getFlags2() const;
+
+	void								setLowres(int lowres);
+	int									getLowres() const;
+
+	void								setSkipLoopFilter(Discard discard);
+	Discard								getSkipLoopFilter() const;
+
+	void								setTimeBase(Math::Rational<int> tb);
+	Math::Rational<int>					getTimeBase() const;
+
+	void								setFrameRate(Math::Rational<int> rate);
+	Math::Rational<int>					getFrameRate() const;
+
+	void								setBitrate(int64_t bps);
+	int64_t								getBitrate() const;
+
+	void								setMinBitrate(int64_t bps);
+	int64_t								getMinBitrate() const;
+
+	void								setMaxBitrate(int64_t bps);
+	int64_t								getMaxBitrate() const;
+
+	void								setBufferSize(int bits);
+	int									getBufferSize() const;
+
+	void								setGOPSize(int size);
+	int									getGOPSize() const;
+
+	void								setMaxBFrames(int cnt);
+	int									getMaxBFrames() const;
+
+	void								setGlobalQuality(int quality);
+	int									getGlobalQuality() const;
+
 	int									sendPacket(const Packet& packet);
 	int									readPacket(Packet& packet);
 	int									sendFrame(const Frame& frame);
 	int									readFrame(Frame& frame);
+	int									sendEndOfStream();
 
 	void								flush();
 
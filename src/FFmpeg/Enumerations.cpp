@@ -75,6 +75,12 @@ static_assert(static_cast<AVFrameSideDataType>(FrameSideDataType::videoEncParams
 
 static_assert(sizeof(AVDiscard) == sizeof(Discard), "Discard enum's size does not match");
 static_assert(static_cast<AVDiscard>(Discard::none) == AVDISCARD_NONE, "Discard null value must match");
+static_assert(static_cast<AVDiscard>(Discard::def) == AVDISCARD_DEFAULT, "Discard DEFAULT value must match");
+static_assert(static_cast<AVDiscard>(Discard::nonRef) == AVDISCARD_NONREF, "Discard NONREF value must match");
+static_assert(static_cast<AVDiscard>(Discard::bidir) == AVDISCARD_BIDIR, "Discard BIDIR value must match");
+static_assert(static_cast<AVDiscard>(Discard::nonIntra) == AVDISCARD_NONINTRA, "Discard NONINTRA value must match");
+static_assert(static_cast<AVDiscard>(Discard::nonKey) == AVDISCARD_NONKEY, "Discard NONKEY value must match");
+static_assert(static_cast<AVDiscard>(Discard::all) == AVDISCARD_ALL, "Discard ALL value must match");
 
 static_assert(static_cast<int>(ThreadType::none) == 0, "ThreadType null value must match");
 static_assert(static_cast<int>(ThreadType::frame) == FF_THREAD_FRAME, "ThreadType FRAME value must match");
@@ -86,6 +92,13 @@ static_assert(static_cast<int>(SeekFlags::byte) == AVSEEK_FLAG_BYTE, "Seek BYTE
 static_assert(static_cast<int>(SeekFlags::any) == AVSEEK_FLAG_ANY, "Seek ANY value must match");
 static_assert(static_cast<int>(SeekFlags::frame) == AVSEEK_FLAG_FRAME, "Seek FRAME value must match");
 
+static_assert(static_cast<int>(PacketFlags::none) == 0, "Packet flags null value must match");
+static_assert(static_cast<int>(PacketFlags::key) == AV_PKT_FLAG_KEY, "Packet flags KEY value must match");
+static_assert(static_cast<int>(PacketFlags::corrupt) == AV_PKT_FLAG_CORRUPT, "Packet flags CORRUPT value must match");
+static_assert(static_cast<int>(PacketFlags::discard) == AV_PKT_FLAG_DISCARD, "Packet flags DISCARD value must match");
+static_assert(static_cast<int>(PacketFlags::trusted) == AV_PKT_FLAG_TRUSTED, "Packet flags TRUSTED value must match");
+static_assert(static_cast<int>(PacketFlags::disposable) == AV_PKT_FLAG_DISPOSABLE, "Packet flags DISPOSABLE value must match");
+
 static_assert(static_cast<int>(HWDeviceType::none) == AV_HWDEVICE_TYPE_NONE, "Hardware device type none value must match");
 static_assert(static_cast<int>(HWDeviceType::vdpau) == AV_HWDEVICE_TYPE_VDPAU, "Hardware device type VDPAU value must match");
 static_assert(static_cast<int>(HWDeviceType::cuda) == AV_HWDEVICE_TYPE_CUDA, "Hardware device type CUDA value must match");
@@ -147,6 +160,10 @@ std::ostream& operator<<(std::ostream& os, PictureType type) {
 	return os << std::string_view(&str, 1);
 }
 
+std::ostream& operator<<(std::ostream& os, DecodingProfile profile) {
+	return os << toString(profile);
+}
+
 std::ostream& operator<<(std::ostream& os, HWDeviceType type) {
 	return os << toString(type);
 }
@@ -191,6 +208,15 @@ char toString(FFmpeg::PictureType type) {
 	return av_get_picture_type_char(static_cast<AVPictureType>(type));
 }
 
+std::string_view toString(FFmpeg::DecodingProfile profile) {
+	switch(profile) {
+	case FFmpeg::DecodingProfile::throughput:	return "throughput";
+	case FFmpeg::DecodingProfile::lowLatency:	return "lowLatency";
+	case FFmpeg::DecodingProfile::scrub:		return "scrub";
+	default:									return "";
+	}
+}
+
 std::string_view toString(FFmpeg::HWDeviceType type) {
 	return std::string_view(av_hwdevice_get_type_name(static_cast<AVHWDeviceType>(type)));
 }
@@ -2,6 +2,11 @@
 
 #include <zuazo/Utils/CPU.h>
 
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <limits>
+
 extern "C" {
 	#include <libavutil/avutil.h>
 	#include <libavutil/pixfmt.h>
@@ -194,378 +199,343 @@ Zuazo::ColorRange fromFFmpeg(ColorRange range) {
 
 
 
-static AVPixelFormat toFFmpegLUT(const PixelFormatConversion& fmt) {
-	if(fmt.isYCbCr) {
-		switch(fmt.colorFormat) {
-		//8bpc
-		case ColorFormat::B8G8R8G8:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_UYVY422;
-			default: break;
-			}
-			break;
+/*
+ * Pixel format table
+ */
 
-		case ColorFormat::G8R8G8B8:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_YVYU422;
-			default: break;
-			}
-			break;
+enum class PixelFormatMapping {
+	bidirectional,
+	toFFmpegOnly,		//Native endian aliases. When read back they yield an equivalent layout
+	fromFFmpegOnly		//Deprecated or padded variants of another entry
+};
 
-		case ColorFormat::G8B8G8R8:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_YUYV422;
-			default: break;
-			}
-			break;
+struct PixelFormatEntry {
+	AVPixelFormat			pixelFormat;
+	PixelFormatConversion	conversion;
+	PixelFormatMapping		mapping;
 
-		case ColorFormat::G8_B8_R8_A8:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb444:			return AV_PIX_FMT_YUVA444P;
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_YUVA422P;
-			case ColorSubsampling::rb420:			return AV_PIX_FMT_YUVA420P;
-			default: break;
-			}
-			break;
+	constexpr bool isToFFmpeg() const noexcept {
+		return mapping != PixelFormatMapping::fromFFmpegOnly;
+	}
 
-		case ColorFormat::G8_B8_R8:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb444:			return AV_PIX_FMT_YUV444P;
-			case ColorSubsampling::rb440:			return AV_PIX_FMT_YUV440P;
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_YUV422P;
-			case ColorSubsampling::rb420:			return AV_PIX_FMT_YUV420P;
-			case ColorSubsampling::rb411:			return AV_PIX_FMT_YUV411P;
-			case ColorSubsampling::rb410:			return AV_PIX_FMT_YUV410P;
-			default: break;
-			}
-			break;
+	constexpr bool isFromFFmpeg() const noexcept {
+		return mapping != PixelFormatMapping::toFFmpegOnly;
+	}
+};
+
+/*
+ * Comments have been obtained from:
+ * libavutil/pixfmt.h
+ * 
+ * U = Cb => B
+ * V = Cr => R
+ *
+ * Although it may seem that zuazo supports 10 and 12 bit formats, they are
+ * not compatible with FFmpeg, as FFmpeg uses padding on the MSB, whilst zuazo
+ * uses padding at the LSB.
+ *
+ * FFmpeg: (10bit)
+ *  0000 00XX XXXX XXXX
+ * Zuazo: (10bit)
+ *  XXXX XXXX XX00 0000
+ */
+static constexpr PixelFormatEntry PIXEL_FORMAT_TABLE[] = {
+	{ AV_PIX_FMT_YUV420P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb420, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:2:0, 12bpp, (1 Cr & Cb sample per 2x2 Y samples)
+	{ AV_PIX_FMT_YUYV422,	{ ColorFormat::G8B8G8R8, ColorSubsampling::rb422, true },					PixelFormatMapping::bidirectional },	//packed YUV 4:2:2, 16bpp, Y0 Cb Y1 Cr
+	{ AV_PIX_FMT_RGB24,		{ ColorFormat::R8G8B8, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed RGB 8:8:8, 24bpp, RGBRGB...
+	{ AV_PIX_FMT_BGR24,		{ ColorFormat::B8G8R8, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed RGB 8:8:8, 24bpp, BGRBGR...
+	{ AV_PIX_FMT_YUV422P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb422, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:2:2, 16bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	{ AV_PIX_FMT_YUV444P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb444, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:4:4, 24bpp, (1 Cr & Cb sample per 1x1 Y samples)
+	{ AV_PIX_FMT_YUV410P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb410, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:1:0,  9bpp, (1 Cr & Cb sample per 4x4 Y samples)
+	{ AV_PIX_FMT_YUV411P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb411, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:1:1, 12bpp, (1 Cr & Cb sample per 4x1 Y samples)
+	{ AV_PIX_FMT_GRAY8,		{ ColorFormat::Y8, ColorSubsampling::rb444, false },						PixelFormatMapping::bidirectional },	//       Y        ,  8bpp
+	//{ AV_PIX_FMT_MONOWHITE,	NOT SUPPORTED },																								//       Y        ,  1bpp, 0 is white, 1 is black, in each byte pixels are ordered from the msb to the lsb
+	//{ AV_PIX_FMT_MONOBLACK,	NOT SUPPORTED },																								//       Y        ,  1bpp, 0 is black, 1 is white, in each byte pixels are ordered from the msb to the lsb
+	//{ AV_PIX_FMT_PAL8,	NOT SUPPORTED },																									//8 bits with AV_PIX_FMT_RGB32 palette
+	{ AV_PIX_FMT_YUVJ420P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb420, true },					PixelFormatMapping::fromFFmpegOnly },	//planar YUV 4:2:0, 12bpp, full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV420P and setting color_range
+	{ AV_PIX_FMT_YUVJ422P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb422, true },					PixelFormatMapping::fromFFmpegOnly },	//planar YUV 4:2:2, 16bpp, full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV422P and setting color_range
+	{ AV_PIX_FMT_YUVJ444P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb444, true },					PixelFormatMapping::fromFFmpegOnly },	//planar YUV 4:4:4, 24bpp, full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV444P and setting color_range
+	{ AV_PIX_FMT_UYVY422,	{ ColorFormat::B8G8R8G8, ColorSubsampling::rb422, true },					PixelFormatMapping::bidirectional },	//packed YUV 4:2:2, 16bpp, Cb Y0 Cr Y1
+	//{ AV_PIX_FMT_UYYVYY411,	NOT SUPPORTED },																								//packed YUV 4:1:1, 12bpp, Cb Y0 Y1 Cr Y2 Y3
+	//{ AV_PIX_FMT_BGR8,	NOT SUPPORTED },																									//packed RGB 3:3:2,  8bpp, (msb)2B 3G 3R(lsb)
+	//{ AV_PIX_FMT_BGR4,	NOT SUPPORTED },																									//packed RGB 1:2:1 bitstream,  4bpp, (msb)1B 2G 1R(lsb), a byte contains two pixels, the first pixel in the byte is the one composed by the 4 msb bits
+	//{ AV_PIX_FMT_BGR4_BYTE,	NOT SUPPORTED },																								//packed RGB 1:2:1,  8bpp, (msb)1B 2G 1R(lsb)
+	//{ AV_PIX_FMT_RGB8,	NOT SUPPORTED },																									//packed RGB 3:3:2,  8bpp, (msb)2R 3G 3B(lsb)
+	//{ AV_PIX_FMT_RGB4,	NOT SUPPORTED },																									//packed RGB 1:2:1 bitstream,  4bpp, (msb)1R 2G 1B(lsb), a byte contains two pixels, the first pixel in the byte is the one composed by the 4 msb bits
+	//{ AV_PIX_FMT_RGB4_BYTE,	NOT SUPPORTED },																								//packed RGB 1:2:1,  8bpp, (msb)1R 2G 1B(lsb)
+	{ AV_PIX_FMT_NV12,		{ ColorFormat::G8_B8R8, ColorSubsampling::rb420, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:2:0, 12bpp, 1 plane for Y and 1 plane for the UV components, which are interleaved (first byte U and the following byte V)
+	{ AV_PIX_FMT_NV21,		{ ColorFormat::G8_R8B8, ColorSubsampling::rb420, true },					PixelFormatMapping::bidirectional },	//as above, but U and V bytes are swapped
+
+	{ AV_PIX_FMT_ARGB,		{ ColorFormat::A8R8G8B8, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed ARGB 8:8:8:8, 32bpp, ARGBARGB...
+	{ AV_PIX_FMT_RGBA,		{ ColorFormat::R8G8B8A8, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed RGBA 8:8:8:8, 32bpp, RGBARGBA...
+	{ AV_PIX_FMT_ABGR,		{ ColorFormat::A8B8G8R8, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed ABGR 8:8:8:8, 32bpp, ABGRABGR...
+	{ AV_PIX_FMT_BGRA,		{ ColorFormat::B8G8R8A8, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed BGRA 8:8:8:8, 32bpp, BGRABGRA...
+
+	{ AV_PIX_FMT_GRAY16,	{ ColorFormat::Y16, ColorSubsampling::rb444, false },						PixelFormatMapping::bidirectional },	//       Y        , 16bpp
+	{ AV_PIX_FMT_YUV440P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb440, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:4:0 (1 Cr & Cb sample per 1x2 Y samples)
+	{ AV_PIX_FMT_YUVJ440P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb440, true },					PixelFormatMapping::fromFFmpegOnly },	//planar YUV 4:4:0 full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV440P and setting color_range
+	{ AV_PIX_FMT_YUVA420P,	{ ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb420, true },				PixelFormatMapping::bidirectional },	//planar YUV 4:2:0, 20bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
+
+	{ AV_PIX_FMT_RGB48,		{ ColorFormat::R16G16B16, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed RGB 16:16:16, 48bpp, 16R, 16G, 16B, the 2-byte value for each R/G/B
+	{ AV_PIX_FMT_RGB565,	{ ColorFormat::R5G6B5_16, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed RGB 5:6:5, 16bpp, (msb)   5R 6G 5B(lsb)
+	{ AV_PIX_FMT_RGB555,	{ ColorFormat::X1R5G5B5_16, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//packed RGB 5:5:5, 16bpp, (msb)1X 5R 5G 5B(lsb), X=unused/undefined
+
+	{ AV_PIX_FMT_BGR48,		{ ColorFormat::B16G16R16, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed RGB 16:16:16, 48bpp, 16B, 16G, 16R, the 2-byte value for each R/G/B
+	{ AV_PIX_FMT_BGR565,	{ ColorFormat::B5G6R5_16, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//packed BGR 5:6:5, 16bpp, (msb)   5B 6G 5R(lsb)
+	{ AV_PIX_FMT_BGR555,	{ ColorFormat::X1B5G5R5_16, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//packed BGR 5:5:5, 16bpp, (msb)1X 5B 5G 5R(lsb), X=unused/undefined
+
+	{ AV_PIX_FMT_YUV420P16,	{ ColorFormat::G16_B16_R16, ColorSubsampling::rb420, true },				PixelFormatMapping::bidirectional },	//planar YUV 4:2:0, 24bpp, (1 Cr & Cb sample per 2x2 Y samples)
+	{ AV_PIX_FMT_YUV422P16,	{ ColorFormat::G16_B16_R16, ColorSubsampling::rb422, true },				PixelFormatMapping::bidirectional },	//planar YUV 4:2:2, 32bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	{ AV_PIX_FMT_YUV444P16,	{ ColorFormat::G16_B16_R16, ColorSubsampling::rb444, true },				PixelFormatMapping::bidirectional },	//planar YUV 4:4:4, 48bpp, (1 Cr & Cb sample per 1x1 Y samples)
+	//{ AV_PIX_FMT_DXVA2_VLD,	NOT SUPPORTED },																								//HW decoding through DXVA2, Picture.data[3] contains a LPDIRECT3DSURFACE9 pointer
+
+	{ AV_PIX_FMT_RGB444,	{ ColorFormat::X4R4G4B4_16, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//packed RGB 4:4:4, 16bpp, (msb)4X 4R 4G 4B(lsb), X=unused/undefined
+	{ AV_PIX_FMT_BGR444,	{ ColorFormat::X4B4G4R4_16, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//packed BGR 4:4:4, 16bpp, (msb)4X 4B 4G 4R(lsb), X=unused/undefined
+	{ AV_PIX_FMT_YA8,		{ ColorFormat::Y8A8, ColorSubsampling::rb444, false },						PixelFormatMapping::bidirectional },	//8 bits gray, 8 bits alpha
 
-		case ColorFormat::G8_B8R8:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb444:			return AV_PIX_FMT_NV24;
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_NV16;
-			case ColorSubsampling::rb420:			return AV_PIX_FMT_NV12;
-			default: break;
-			}
-			break;
+	/**
+	 * The following 12 formats have the disadvantage of needing 1 format for each bit depth.
+	 * Notice that each 9/10 bits sample is stored in 16 bits with extra padding.
+	 * If you want to support multiple bit depths, then using AV_PIX_FMT_YUV420P16* with the bpp stored separately is better.
+	 */
+	//{ AV_PIX_FMT_YUV420P9,	NOT SUPPORTED },																								//planar YUV 4:2:0, 13.5bpp, (1 Cr & Cb sample per 2x2 Y samples)
+	//{ AV_PIX_FMT_YUV420P10,	NOT SUPPORTED },																								//planar YUV 4:2:0, 15bpp, (1 Cr & Cb sample per 2x2 Y samples)
+	//{ AV_PIX_FMT_YUV422P10,	NOT SUPPORTED },																								//planar YUV 4:2:2, 20bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	//{ AV_PIX_FMT_YUV444P9,	NOT SUPPORTED },																								//planar YUV 4:4:4, 27bpp, (1 Cr & Cb sample per 1x1 Y samples)
+	//{ AV_PIX_FMT_YUV444P10,	NOT SUPPORTED },																								//planar YUV 4:4:4, 30bpp, (1 Cr & Cb sample per 1x1 Y samples)
+	//{ AV_PIX_FMT_YUV422P9,	NOT SUPPORTED },																								//planar YUV 4:2:2, 18bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	{ AV_PIX_FMT_GBRP,		{ ColorFormat::G8_B8_R8, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//planar GBR 4:4:4 24bpp
+	//{ AV_PIX_FMT_GBRP9,	NOT SUPPORTED },																									//planar GBR 4:4:4 27bpp
+	//{ AV_PIX_FMT_GBRP10,	NOT SUPPORTED },																									//planar GBR 4:4:4 30bpp*/
+	{ AV_PIX_FMT_GBRP16,	{ ColorFormat::G16_B16_R16, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//planar GBR 4:4:4 48bpp
+	{ AV_PIX_FMT_YUVA422P,	{ ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb422, true },				PixelFormatMapping::bidirectional },	//planar YUV 4:2:2 24bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
+	{ AV_PIX_FMT_YUVA444P,	{ ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb444, true },				PixelFormatMapping::bidirectional },	//planar YUV 4:4:4 32bpp, (1 Cr & Cb sample per 1x1 Y & A samples)
+	//{ AV_PIX_FMT_YUVA420P9,	NOT SUPPORTED },																								//planar YUV 4:2:0 22.5bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
+	//{ AV_PIX_FMT_YUVA422P9,	NOT SUPPORTED },																								//planar YUV 4:2:2 27bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
+	//{ AV_PIX_FMT_YUVA444P9,	NOT SUPPORTED },																								//planar YUV 4:4:4 36bpp, (1 Cr & Cb sample per 1x1 Y & A samples)
+	//{ AV_PIX_FMT_YUVA420P10,	NOT SUPPORTED },																								//planar YUV 4:2:0 25bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
+	//{ AV_PIX_FMT_YUVA422P10,	NOT SUPPORTED },																								//planar YUV 4:2:2 30bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
+	//{ AV_PIX_FMT_YUVA444P10,	NOT SUPPORTED },																								//planar YUV 4:4:4 40bpp, (1 Cr & Cb sample per 1x1 Y & A samples)
+	{ AV_PIX_FMT_YUVA420P16,	{ ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb420, true },		PixelFormatMapping::bidirectional },	//planar YUV 4:2:0 40bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
+	{ AV_PIX_FMT_YUVA422P16,	{ ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb422, true },		PixelFormatMapping::bidirectional },	//planar YUV 4:2:2 48bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
+	{ AV_PIX_FMT_YUVA444P16,	{ ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb444, true },		PixelFormatMapping::bidirectional },	//planar YUV 4:4:4 64bpp, (1 Cr & Cb sample per 1x1 Y & A samples)*/
 
-		case ColorFormat::G8_R8B8:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb444:			return AV_PIX_FMT_NV42;
-			case ColorSubsampling::rb420:			return AV_PIX_FMT_NV21;
-			default: break;
-			}
-			break;
+	//{ AV_PIX_FMT_VDPAU,	NOT SUPPORTED },																									//HW acceleration through VDPAU, Picture.data[3] contains a VdpVideoSurface
 
+	//{ AV_PIX_FMT_XYZ12,	NOT SUPPORTED },																									//packed XYZ 4:4:4, 36 bpp, (msb) 12X, 12Y, 12Z (lsb), the 2-byte value for each X/Y/Z, the 4 lower bits are set to 0
 
-		//10bpc
-		//12bpc	
-		//Although it may seem that zuazo supports 10 and 12 bit formats, they are
-		//not compatible with FFmpeg, as FFmpeg uses padding on the MSB, whilst zuazo
-		//uses padding at the LSB.
-		//
-		//FFmpeg: (10bit)
-		// 0000 00XX XXXX XXXX
-		//Zuazo: (10bit)
-		// XXXX XXXX XX00 0000
-
-
-		//16bpc
-		case ColorFormat::A16G16B16R16:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb444:			return AV_PIX_FMT_AYUV64;
-			default: break;
-			}
-			break;
+	{ AV_PIX_FMT_NV16,		{ ColorFormat::G8_B8R8, ColorSubsampling::rb422, true },					PixelFormatMapping::bidirectional },	//interleaved chroma YUV 4:2:2, 16bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	//{ AV_PIX_FMT_NV20,	NOT SUPPORTED },																									//interleaved chroma YUV 4:2:2, 20bpp, (1 Cr & Cb sample per 2x1 Y samples)
 
-		case ColorFormat::G16_B16_R16_A16:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb444:			return AV_PIX_FMT_YUVA444P16;
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_YUVA422P16;
-			case ColorSubsampling::rb420:			return AV_PIX_FMT_YUVA420P16;
-			default: break;
-			}
-			break;
+	{ AV_PIX_FMT_RGBA64,	{ ColorFormat::R16G16B16A16, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//packed RGBA 16:16:16:16, 64bpp, 16R, 16G, 16B, 16A, the 2-byte value for each R/G/B/A component
+	{ AV_PIX_FMT_BGRA64,	{ ColorFormat::B16G16R16A16, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//packed RGBA 16:16:16:16, 64bpp, 16B, 16G, 16R, 16A, the 2-byte value for each R/G/B/A component
 
-		case ColorFormat::G16_B16_R16:
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb444:			return AV_PIX_FMT_YUV444P16;
-			case ColorSubsampling::rb422:			return AV_PIX_FMT_YUV422P16;
-			case ColorSubsampling::rb420:			return AV_PIX_FMT_YUV420P16;
-			default: break;
-			}
-			break;
+	{ AV_PIX_FMT_YVYU422,	{ ColorFormat::G8R8G8B8, ColorSubsampling::rb422, true },					PixelFormatMapping::bidirectional },	//packed YUV 4:2:2, 16bpp, Y0 Cr Y1 Cb
 
-		case Utils::bele(ColorFormat::G16_B16R16, ColorFormat::G16_R16B16):
-			switch (fmt.colorSubsampling) {
-			case ColorSubsampling::rb420:			return AV_PIX_FMT_P016;
-			default: break;
-			}
-			break;
+	{ AV_PIX_FMT_YA16,		{ ColorFormat::Y16A16, ColorSubsampling::rb444, false },					PixelFormatMapping::bidirectional },	//16 bits gray, 16 bits alpha
 
+	{ AV_PIX_FMT_GBRAP,		{ ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb444, false },				PixelFormatMapping::bidirectional },	//planar GBRA 4:4:4:4 32bpp
+	{ AV_PIX_FMT_GBRAP16,	{ ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb444, false },			PixelFormatMapping::bidirectional },	//planar GBRA 4:4:4:4 64bpp
 
-		default: break;
-		}
-	} else if(fmt.colorSubsampling == ColorSubsampling::rb444) {
-		//RGB with no subsampling
-		switch(fmt.colorFormat) {
-		//4bpc
-		case ColorFormat::X4R4G4B4_16: 				return AV_PIX_FMT_RGB444;
-		case ColorFormat::X4B4G4R4_16: 				return AV_PIX_FMT_BGR444;
-
-		//5bpc
-		case ColorFormat::X1R5G5B5_16: 				return AV_PIX_FMT_RGB555;
-		case ColorFormat::X1B5G5R5_16: 				return AV_PIX_FMT_BGR555;
-
-		//6bpc
-		case ColorFormat::R5G6B5_16: 				return AV_PIX_FMT_RGB565;
-		case ColorFormat::B5G6R5_16: 				return AV_PIX_FMT_BGR565;
-
-		//8bpc
-		case ColorFormat::Y8: 						return AV_PIX_FMT_GRAY8;
-		case ColorFormat::Y8A8: 					return AV_PIX_FMT_YA8;
-
-		case ColorFormat::R8G8B8: 					return AV_PIX_FMT_RGB24;
-		case ColorFormat::B8G8R8: 					return AV_PIX_FMT_BGR24;
-
-		case ColorFormat::A8R8G8B8:					return AV_PIX_FMT_ARGB;
-		case ColorFormat::A8B8G8R8:					return AV_PIX_FMT_ABGR;
-		case ColorFormat::R8G8B8A8:					return AV_PIX_FMT_RGBA;
-		case ColorFormat::B8G8R8A8:					return AV_PIX_FMT_BGRA;
-
-		case ColorFormat::A8R8G8B8_32:				return AV_PIX_FMT_RGB32;
-		case ColorFormat::A8B8G8R8_32:				return AV_PIX_FMT_BGR32;
-		case ColorFormat::R8G8B8A8_32:				return AV_PIX_FMT_RGB32_1;
-		case ColorFormat::B8G8R8A8_32:				return AV_PIX_FMT_BGR32_1;
-
-		case ColorFormat::X8R8G8B8_32:				return AV_PIX_FMT_0RGB32;
-		case ColorFormat::X8B8G8R8_32:				return AV_PIX_FMT_0BGR32;
-		case ColorFormat::R8G8B8X8_32:				return AV_PIX_FMT_NE(RGB0, 0BGR);
-		case ColorFormat::B8G8R8X8_32:				return AV_PIX_FMT_NE(BGR0, 0RGB);
-
-		case ColorFormat::G8_B8_R8_A8:				return AV_PIX_FMT_GBRAP;
-		case ColorFormat::G8_B8_R8:					return AV_PIX_FMT_GBRP;
-
-		
-		//10bpc
-		//12bpc
-		//Same as above
-
-		//16bpc
-		case ColorFormat::Y16:						return AV_PIX_FMT_GRAY16;
-		case ColorFormat::Y16A16:					return AV_PIX_FMT_YA16;
-
-		case ColorFormat::R16G16B16:				return AV_PIX_FMT_RGB48;
-		case ColorFormat::B16G16R16:				return AV_PIX_FMT_BGR48;
-
-		case ColorFormat::R16G16B16A16:				return AV_PIX_FMT_RGBA64;
-		case ColorFormat::B16G16R16A16:				return AV_PIX_FMT_BGRA64;
-
-		case ColorFormat::G16_B16_R16_A16:			return AV_PIX_FMT_GBRAP16;
-		case ColorFormat::G16_B16_R16:				return AV_PIX_FMT_GBRP16;
-
-		//32bpc
-		case ColorFormat::Y32f:  					return AV_PIX_FMT_GRAYF32;
-		
-		case ColorFormat::G32f_B32f_R32f_A32f:		return AV_PIX_FMT_GBRAPF32;
-		case ColorFormat::G32f_B32f_R32f:			return AV_PIX_FMT_GBRPF32;
-		
-		default: break;
-		}
-	}
+	//{ AV_PIX_FMT_QSV,		NOT SUPPORTED },																									//HW acceleration through QSV, data[3] contains a pointer to the mfxFrameSurface1 structure.
+	//{ AV_PIX_FMT_MMAL,	NOT SUPPORTED },																									//HW acceleration though MMAL, data[3] contains a pointer to the MMAL_BUFFER_HEADER_T structure.
+	//{ AV_PIX_FMT_D3D11VA_VLD,	NOT SUPPORTED },																								//HW decoding through Direct3D11 via old API, Picture.data[3] contains a ID3D11VideoDecoderOutputView pointer
+	//{ AV_PIX_FMT_CUDA,	NOT SUPPORTED },																									
 
-	return AV_PIX_FMT_NONE;
-}
+	{ AV_PIX_FMT_0RGB,		{ Utils::bele(ColorFormat::X8R8G8B8_32, ColorFormat::B8G8R8X8_32), ColorSubsampling::rb444, false },	PixelFormatMapping::bidirectional },	//packed RGB 8:8:8, 32bpp, XRGBXRGB...   X=unused/undefined
+	{ AV_PIX_FMT_RGB0,		{ Utils::bele(ColorFormat::R8G8B8X8_32, ColorFormat::X8B8G8R8_32), ColorSubsampling::rb444, false },	PixelFormatMapping::bidirectional },	//packed RGB 8:8:8, 32bpp, RGBXRGBX...   X=unused/undefined
+	{ AV_PIX_FMT_0BGR,		{ Utils::bele(ColorFormat::X8B8G8R8_32, ColorFormat::R8G8B8X8_32), ColorSubsampling::rb444, false },	PixelFormatMapping::bidirectional },	//packed BGR 8:8:8, 32bpp, XBGRXBGR...   X=unused/undefined
+	{ AV_PIX_FMT_BGR0,		{ Utils::bele(ColorFormat::B8G8R8X8_32, ColorFormat::X8R8G8B8_32), ColorSubsampling::rb444, false },	PixelFormatMapping::bidirectional },	//packed BGR 8:8:8, 32bpp, BGRXBGRX...   X=unused/undefined
 
-PixelFormat toFFmpeg(const PixelFormatConversion& fmt) {
-	return static_cast<PixelFormat>(toFFmpegLUT(fmt));
-}
+	//{ AV_PIX_FMT_YUV420P12,	NOT SUPPORTED },																								//planar YUV 4:2:0,18bpp, (1 Cr & Cb sample per 2x2 Y samples)
+	//{ AV_PIX_FMT_YUV420P14,	NOT SUPPORTED },																								//planar YUV 4:2:0,21bpp, (1 Cr & Cb sample per 2x2 Y samples)
+	//{ AV_PIX_FMT_YUV422P12,	NOT SUPPORTED },																								//planar YUV 4:2:2,24bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	//{ AV_PIX_FMT_YUV422P14,	NOT SUPPORTED },																								//planar YUV 4:2:2,28bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	//{ AV_PIX_FMT_YUV444P12,	NOT SUPPORTED },																								//planar YUV 4:4:4,36bpp, (1 Cr & Cb sample per 1x1 Y samples)
+	//{ AV_PIX_FMT_YUV444P14,	NOT SUPPORTED },																								//planar YUV 4:4:4,42bpp, (1 Cr & Cb sample per 1x1 Y samples)
+	//{ AV_PIX_FMT_GBRP12,	NOT SUPPORTED },																									//planar GBR 4:4:4 36bpp
+	//{ AV_PIX_FMT_GBRP14,	NOT SUPPORTED },																									//planar GBR 4:4:4 42bpp
+	{ AV_PIX_FMT_YUVJ411P,	{ ColorFormat::G8_B8_R8, ColorSubsampling::rb411, true },					PixelFormatMapping::fromFFmpegOnly },	//planar YUV 4:1:1, 12bpp, (1 Cr & Cb sample per 4x1 Y samples) full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV411P and setting color_range
 
+	//{ AV_PIX_FMT_BAYER_BGGR8,	NOT SUPPORTED },																								//bayer, BGBG..(odd line), GRGR..(even line), 8-bit samples
+	//{ AV_PIX_FMT_BAYER_RGGB8,	NOT SUPPORTED },																								//bayer, RGRG..(odd line), GBGB..(even line), 8-bit samples
+	//{ AV_PIX_FMT_BAYER_GBRG8,	NOT SUPPORTED },																								//bayer, GBGB..(odd line), RGRG..(even line), 8-bit samples
+	//{ AV_PIX_FMT_BAYER_GRBG8,	NOT SUPPORTED },																								//bayer, GRGR..(odd line), BGBG..(even line), 8-bit samples
+	//{ AV_PIX_FMT_BAYER_BGGR16,	NOT SUPPORTED },																							//bayer, BGBG..(odd line), GRGR..(even line), 16-bit samples
+	//{ AV_PIX_FMT_BAYER_RGGB16,	NOT SUPPORTED },																							//bayer, RGRG..(odd line), GBGB..(even line), 16-bit samples
+	//{ AV_PIX_FMT_BAYER_GBRG16,	NOT SUPPORTED },																							//bayer, GBGB..(odd line), RGRG..(even line), 16-bit samples
+	//{ AV_PIX_FMT_BAYER_GRBG16,	NOT SUPPORTED },																							//bayer, GRGR..(odd line), BGBG..(even line), 16-bit samples
 
-static PixelFormatConversion fromFFmpegLUT(AVPixelFormat fmt) {
-	/*
-	* Comments have been obtained from:
-	* libavutil/pixfmt.h
-	* 
-	* U = Cb => B
-	* V = Cr => R
-	*/
-
-	switch(fmt) {
-	case AV_PIX_FMT_YUV420P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb420, true };				//planar YUV 4:2:0, 12bpp, (1 Cr & Cb sample per 2x2 Y samples)
-	case AV_PIX_FMT_YUYV422:			return { ColorFormat::G8B8G8R8, ColorSubsampling::rb422, true };	  			//packed YUV 4:2:2, 16bpp, Y0 Cb Y1 Cr
-	case AV_PIX_FMT_RGB24:	    		return { ColorFormat::R8G8B8, ColorSubsampling::rb444, false }; 				//packed RGB 8:8:8, 24bpp, RGBRGB...
-	case AV_PIX_FMT_BGR24:	    		return { ColorFormat::B8G8R8, ColorSubsampling::rb444, false };				//packed RGB 8:8:8, 24bpp, BGRBGR...
-	case AV_PIX_FMT_YUV422P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb422, true };				//planar YUV 4:2:2, 16bpp, (1 Cr & Cb sample per 2x1 Y samples)
-	case AV_PIX_FMT_YUV444P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb444, true };				//planar YUV 4:4:4, 24bpp, (1 Cr & Cb sample per 1x1 Y samples)
-	case AV_PIX_FMT_YUV410P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb410, true };				//planar YUV 4:1:0,  9bpp, (1 Cr & Cb sample per 4x4 Y samples)
-	case AV_PIX_FMT_YUV411P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb411, true };				//planar YUV 4:1:1, 12bpp, (1 Cr & Cb sample per 4x1 Y samples)
-	case AV_PIX_FMT_GRAY8:	    		return { ColorFormat::Y8, ColorSubsampling::rb444, false }; 					//       Y        ,  8bpp
-	//case AV_PIX_FMT_MONOWHITE:		return {}; /*NOT SUPPORTED*/													//       Y        ,  1bpp, 0 is white, 1 is black, in each byte pixels are ordered from the msb to the lsb
-	//case AV_PIX_FMT_MONOBLACK:		return {}; /*NOT SUPPORTED*/ 													//       Y        ,  1bpp, 0 is black, 1 is white, in each byte pixels are ordered from the msb to the lsb
-	//case AV_PIX_FMT_PAL8:	 			return {}; /*NOT SUPPORTED*/ 													//8 bits with AV_PIX_FMT_RGB32 palette
-	case AV_PIX_FMT_YUVJ420P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb420, true };				//planar YUV 4:2:0, 12bpp, full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV420P and setting color_range
-	case AV_PIX_FMT_YUVJ422P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb422, true };				//planar YUV 4:2:2, 16bpp, full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV422P and setting color_range
-	case AV_PIX_FMT_YUVJ444P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb444, true };				//planar YUV 4:4:4, 24bpp, full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV444P and setting color_range
-	case AV_PIX_FMT_UYVY422:			return { ColorFormat::B8G8R8G8, ColorSubsampling::rb422, true };				//packed YUV 4:2:2, 16bpp, Cb Y0 Cr Y1
-	//case AV_PIX_FMT_UYYVYY411:		return {}; /*NOT SUPPORTED*/  													//packed YUV 4:1:1, 12bpp, Cb Y0 Y1 Cr Y2 Y3
-	//case AV_PIX_FMT_BGR8:	    		return {}; /*NOT SUPPORTED*/													//packed RGB 3:3:2,  8bpp, (msb)2B 3G 3R(lsb)
-	//case AV_PIX_FMT_BGR4:	    		return {}; /*NOT SUPPORTED*/													//packed RGB 1:2:1 bitstream,  4bpp, (msb)1B 2G 1R(lsb), a byte contains two pixels, the first pixel in the byte is the one composed by the 4 msb bits
-	//case AV_PIX_FMT_BGR4_BYTE:		return {}; /*NOT SUPPORTED*/													//packed RGB 1:2:1,  8bpp, (msb)1B 2G 1R(lsb)
-	//case AV_PIX_FMT_RGB8:	    		return {}; /*NOT SUPPORTED*/													//packed RGB 3:3:2,  8bpp, (msb)2R 3G 3B(lsb)
-	//case AV_PIX_FMT_RGB4:	    		return {}; /*NOT SUPPORTED*/													//packed RGB 1:2:1 bitstream,  4bpp, (msb)1R 2G 1B(lsb), a byte contains two pixels, the first pixel in the byte is the one composed by the 4 msb bits
-	//case AV_PIX_FMT_RGB4_BYTE:		return {}; /*NOT SUPPORTED*/													//packed RGB 1:2:1,  8bpp, (msb)1R 2G 1B(lsb)
-	case AV_PIX_FMT_NV12:	    		return { ColorFormat::G8_B8R8, ColorSubsampling::rb420, true };  				//planar YUV 4:2:0, 12bpp, 1 plane for Y and 1 plane for the UV components, which are interleaved (first byte U and the following byte V)
-	case AV_PIX_FMT_NV21:	    		return { ColorFormat::G8_R8B8, ColorSubsampling::rb420, true };				//as above, but U and V bytes are swapped
-
-	case AV_PIX_FMT_ARGB:				return { ColorFormat::A8R8G8B8, ColorSubsampling::rb444, false };				//packed ARGB 8:8:8:8, 32bpp, ARGBARGB...
-	case AV_PIX_FMT_RGBA:				return { ColorFormat::R8G8B8A8, ColorSubsampling::rb444, false };				//packed RGBA 8:8:8:8, 32bpp, RGBARGBA...
-	case AV_PIX_FMT_ABGR:				return { ColorFormat::A8B8G8R8, ColorSubsampling::rb444, false };				//packed ABGR 8:8:8:8, 32bpp, ABGRABGR...
-	case AV_PIX_FMT_BGRA:				return { ColorFormat::B8G8R8A8, ColorSubsampling::rb444, false };				//packed BGRA 8:8:8:8, 32bpp, BGRABGRA...
-
-	case AV_PIX_FMT_GRAY16:				return { ColorFormat::Y16, ColorSubsampling::rb444, false };					//       Y        , 16bpp
-	case AV_PIX_FMT_YUV440P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb440, true };				//planar YUV 4:4:0 (1 Cr & Cb sample per 1x2 Y samples)
-	case AV_PIX_FMT_YUVJ440P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb440, true };				//planar YUV 4:4:0 full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV440P and setting color_range
-	case AV_PIX_FMT_YUVA420P:			return { ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb420, true };			//planar YUV 4:2:0, 20bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
-
-	case AV_PIX_FMT_RGB48: 				return { ColorFormat::R16G16B16, ColorSubsampling::rb444, false }; 			//packed RGB 16:16:16, 48bpp, 16R, 16G, 16B, the 2-byte value for each R/G/B
-	case AV_PIX_FMT_RGB565: 			return { ColorFormat::R5G6B5_16, ColorSubsampling::rb444, false }; 			//packed RGB 5:6:5, 16bpp, (msb)   5R 6G 5B(lsb)
-	case AV_PIX_FMT_RGB555:				return { ColorFormat::X1R5G5B5_16, ColorSubsampling::rb444, false }; 			//packed RGB 5:5:5, 16bpp, (msb)1X 5R 5G 5B(lsb), X=unused/undefined
-
-	case AV_PIX_FMT_BGR48:   			return { ColorFormat::B16G16R16, ColorSubsampling::rb444, false }; 			//packed RGB 16:16:16, 48bpp, 16B, 16G, 16R, the 2-byte value for each R/G/B
-	case AV_PIX_FMT_BGR565:				return { ColorFormat::B5G6R5_16, ColorSubsampling::rb444, false }; 			//packed BGR 5:6:5, 16bpp, (msb)   5B 6G 5R(lsb)
-	case AV_PIX_FMT_BGR555:				return { ColorFormat::X1B5G5R5_16, ColorSubsampling::rb444, false }; 			//packed BGR 5:5:5, 16bpp, (msb)1X 5B 5G 5R(lsb), X=unused/undefined
-
-	case AV_PIX_FMT_YUV420P16: 			return { ColorFormat::G16_B16_R16, ColorSubsampling::rb420, true }; 			//planar YUV 4:2:0, 24bpp, (1 Cr & Cb sample per 2x2 Y samples)
-	case AV_PIX_FMT_YUV422P16: 			return { ColorFormat::G16_B16_R16, ColorSubsampling::rb422, true }; 			//planar YUV 4:2:2, 32bpp, (1 Cr & Cb sample per 2x1 Y samples)
-	case AV_PIX_FMT_YUV444P16: 			return { ColorFormat::G16_B16_R16, ColorSubsampling::rb444, true }; 			//planar YUV 4:4:4, 48bpp, (1 Cr & Cb sample per 1x1 Y samples)
-	//case AV_PIX_FMT_DXVA2_VLD: 		return {}; /*NOT SUPPORTED*/   													//HW decoding through DXVA2, Picture.data[3] contains a LPDIRECT3DSURFACE9 pointer
-
-	case AV_PIX_FMT_RGB444:				return { ColorFormat::X4R4G4B4_16, ColorSubsampling::rb444, false }; 			//packed RGB 4:4:4, 16bpp, (msb)4X 4R 4G 4B(lsb), X=unused/undefined
-	case AV_PIX_FMT_BGR444: 			return { ColorFormat::X4B4G4R4_16, ColorSubsampling::rb444, false }; 			//packed BGR 4:4:4, 16bpp, (msb)4X 4B 4G 4R(lsb), X=unused/undefined
-	case AV_PIX_FMT_YA8:				return { ColorFormat::Y8A8, ColorSubsampling::rb444, false }; 					//8 bits gray, 8 bits alpha
+	//{ AV_PIX_FMT_XVMC,	NOT SUPPORTED },																									//XVideo Motion Acceleration via common packet passing
 
-	/**
-	 * The following 12 formats have the disadvantage of needing 1 format for each bit depth.
-	 * Notice that each 9/10 bits sample is stored in 16 bits with extra padding.
-	 * If you want to support multiple bit depths, then using AV_PIX_FMT_YUV420P16* with the bpp stored separately is better.
-	 */
-	//case AV_PIX_FMT_YUV420P9:			return {}; /*NOT SUPPORTED*/													//planar YUV 4:2:0, 13.5bpp, (1 Cr & Cb sample per 2x2 Y samples)
-	//case AV_PIX_FMT_YUV420P10:		return {}; /*NOT SUPPORTED*/													//planar YUV 4:2:0, 15bpp, (1 Cr & Cb sample per 2x2 Y samples)
-	//case AV_PIX_FMT_YUV422P10:		return {}; /*NOT SUPPORTED*/													//planar YUV 4:2:2, 20bpp, (1 Cr & Cb sample per 2x1 Y samples)
-	//case AV_PIX_FMT_YUV444P9:			return {}; /*NOT SUPPORTED*/													//planar YUV 4:4:4, 27bpp, (1 Cr & Cb sample per 1x1 Y samples)
-	//case AV_PIX_FMT_YUV444P10:		return {}; /*NOT SUPPORTED*/													//planar YUV 4:4:4, 30bpp, (1 Cr & Cb sample per 1x1 Y samples)
-	//case AV_PIX_FMT_YUV422P9:			return {}; /*NOT SUPPORTED*/													//planar YUV 4:2:2, 18bpp, (1 Cr & Cb sample per 2x1 Y samples)
-	//case AV_PIX_FMT_GBRP:				return {}; /*NOT SUPPORTED*/ 													//planar GBR 4:4:4 24bpp
-	//case AV_PIX_FMT_GBRP9:			return {}; /*NOT SUPPORTED*/													//planar GBR 4:4:4 27bpp
-	//case AV_PIX_FMT_GBRP10:			return {}; /*NOT SUPPORTED*/													//planar GBR 4:4:4 30bpp*/
-	case AV_PIX_FMT_GBRP16:				return { ColorFormat::G16_B16_R16, ColorSubsampling::rb444, false };			//planar GBR 4:4:4 48bpp
-	case AV_PIX_FMT_YUVA422P:			return { ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb422, true };			//planar YUV 4:2:2 24bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
-	case AV_PIX_FMT_YUVA444P:			return { ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb444, true };			//planar YUV 4:4:4 32bpp, (1 Cr & Cb sample per 1x1 Y & A samples)
-	//case AV_PIX_FMT_YUVA420P9:		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:0 22.5bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
-	//case AV_PIX_FMT_YUVA422P9:		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:2 27bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
-	//case AV_PIX_FMT_YUVA444P9:		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:4:4 36bpp, (1 Cr & Cb sample per 1x1 Y & A samples)
-	//case AV_PIX_FMT_YUVA420P10:		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:0 25bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
-	//case AV_PIX_FMT_YUVA422P10:		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:2 30bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
-	//case AV_PIX_FMT_YUVA444P10:		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:4:4 40bpp, (1 Cr & Cb sample per 1x1 Y & A samples)
-	case AV_PIX_FMT_YUVA420P16:			return { ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb420, true };		//planar YUV 4:2:0 40bpp, (1 Cr & Cb sample per 2x2 Y & A samples)
-	case AV_PIX_FMT_YUVA422P16:			return { ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb422, true };		//planar YUV 4:2:2 48bpp, (1 Cr & Cb sample per 2x1 Y & A samples)
-	case AV_PIX_FMT_YUVA444P16:			return { ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb444, true };		//planar YUV 4:4:4 64bpp, (1 Cr & Cb sample per 1x1 Y & A samples)*/
+	//{ AV_PIX_FMT_YUV440P10,	NOT SUPPORTED },																								//planar YUV 4:4:0,20bpp, (1 Cr & Cb sample per 1x2 Y samples)
+	//{ AV_PIX_FMT_YUV440P12,	NOT SUPPORTED },																								//planar YUV 4:4:0,24bpp, (1 Cr & Cb sample per 1x2 Y samples)
+	{ AV_PIX_FMT_AYUV64,	{ ColorFormat::A16G16B16R16, ColorSubsampling::rb444, true },				PixelFormatMapping::bidirectional },	//packed AYUV 4:4:4,64bpp (1 Cr & Cb sample per 1x1 Y & A samples)
+
+	//{ AV_PIX_FMT_VIDEOTOOLBOX,	NOT SUPPORTED },																							//hardware decoding through Videotoolbox
+
+	//{ AV_PIX_FMT_P010,	NOT SUPPORTED },																									//like NV12, with 10bpp per component, data in the high bits, zeros in the low bits
+
+	//{ AV_PIX_FMT_GBRAP12,	NOT SUPPORTED },																									//planar GBR 4:4:4:4 48bpp
+	//{ AV_PIX_FMT_GBRAP10,	NOT SUPPORTED },																									//planar GBR 4:4:4:4 40bpp
 
-	//case AV_PIX_FMT_VDPAU: 			return {}; /*NOT SUPPORTED*/     												//HW acceleration through VDPAU, Picture.data[3] contains a VdpVideoSurface
+	//{ AV_PIX_FMT_MEDIACODEC,	NOT SUPPORTED },																								//hardware decoding through MediaCodec
 
-	//case AV_PIX_FMT_XYZ12:			return {}; /*NOT SUPPORTED*/  													//packed XYZ 4:4:4, 36 bpp, (msb) 12X, 12Y, 12Z (lsb), the 2-byte value for each X/Y/Z, the 4 lower bits are set to 0
+	//{ AV_PIX_FMT_GRAY12,	NOT SUPPORTED },																									//       Y        , 12bpp
+	//{ AV_PIX_FMT_GRAY10,	NOT SUPPORTED },																									//       Y        , 10bpp
 
-	case AV_PIX_FMT_NV16: 				return { ColorFormat::G8_B8R8, ColorSubsampling::rb422, true };	 			//interleaved chroma YUV 4:2:2, 16bpp, (1 Cr & Cb sample per 2x1 Y samples)
-	//case AV_PIX_FMT_NV20:      		return {}; /*NOT SUPPORTED*/ 													//interleaved chroma YUV 4:2:2, 20bpp, (1 Cr & Cb sample per 2x1 Y samples)
+	{ AV_PIX_FMT_P016,		{ ColorFormat::G16_B16R16, ColorSubsampling::rb420, true },					PixelFormatMapping::bidirectional },	//like NV12, with 16bpp per component
 
-	case AV_PIX_FMT_RGBA64:     		return { ColorFormat::R16G16B16A16, ColorSubsampling::rb444, false };			//packed RGBA 16:16:16:16, 64bpp, 16R, 16G, 16B, 16A, the 2-byte value for each R/G/B/A component
-	case AV_PIX_FMT_BGRA64:    			return { ColorFormat::B16G16R16A16, ColorSubsampling::rb444, false };			//packed RGBA 16:16:16:16, 64bpp, 16B, 16G, 16R, 16A, the 2-byte value for each R/G/B/A component
+	//{ AV_PIX_FMT_D3D11,	NOT SUPPORTED },																									//Hardware surfaces for Direct3D11.
 
-	case AV_PIX_FMT_YVYU422:			return { ColorFormat::G8R8G8B8, ColorSubsampling::rb422, true };	 			//packed YUV 4:2:2, 16bpp, Y0 Cr Y1 Cb
+	//{ AV_PIX_FMT_GRAY9,	NOT SUPPORTED },																									//       Y        , 9bpp
 
-	case AV_PIX_FMT_YA16:      			return { ColorFormat::Y16A16, ColorSubsampling::rb444, false }; 				//16 bits gray, 16 bits alpha
+	{ AV_PIX_FMT_GBRPF32,	{ ColorFormat::G32f_B32f_R32f, ColorSubsampling::rb444, false },			PixelFormatMapping::bidirectional },	//IEEE-754 single precision planar GBR 4:4:4,     96bpp
+	{ AV_PIX_FMT_GBRAPF32,	{ ColorFormat::G32f_B32f_R32f_A32f, ColorSubsampling::rb444, false },		PixelFormatMapping::bidirectional },	//IEEE-754 single precision planar GBRA 4:4:4:4, 128bpp
 
-	case AV_PIX_FMT_GBRAP:  			return { ColorFormat::G8_B8_R8_A8, ColorSubsampling::rb444, false };			//planar GBRA 4:4:4:4 32bpp
-	case AV_PIX_FMT_GBRAP16:  			return { ColorFormat::G16_B16_R16_A16, ColorSubsampling::rb444, false };		//planar GBRA 4:4:4:4 64bpp
+	//{ AV_PIX_FMT_DRM_PRIME,	NOT SUPPORTED },																								//DRM-managed buffers exposed through PRIME buffer sharing.
 
-	//case AV_PIX_FMT_QSV: 				return {}; /*NOT SUPPORTED*/ 													//HW acceleration through QSV, data[3] contains a pointer to the mfxFrameSurface1 structure.
-	//case AV_PIX_FMT_MMAL: 			return {}; /*NOT SUPPORTED*/ 													//HW acceleration though MMAL, data[3] contains a pointer to the MMAL_BUFFER_HEADER_T structure.
-	//case AV_PIX_FMT_D3D11VA_VLD: 		return {}; /*NOT SUPPORTED*/ 													//HW decoding through Direct3D11 via old API, Picture.data[3] contains a ID3D11VideoDecoderOutputView pointer
-	//case AV_PIX_FMT_CUDA: 			return {}; /*NOT SUPPORTED*/
+	//{ AV_PIX_FMT_OPENCL,	NOT SUPPORTED },																									//Hardware surfaces for OpenCL.
 
-	case AV_PIX_FMT_0RGB: 				return { Utils::bele(ColorFormat::X8R8G8B8_32, ColorFormat::B8G8R8X8_32), ColorSubsampling::rb444, false };  //packed RGB 8:8:8, 32bpp, XRGBXRGB...   X=unused/undefined
-	case AV_PIX_FMT_RGB0: 				return { Utils::bele(ColorFormat::R8G8B8X8_32, ColorFormat::X8B8G8R8_32), ColorSubsampling::rb444, false };  //packed RGB 8:8:8, 32bpp, RGBXRGBX...   X=unused/undefined
-	case AV_PIX_FMT_0BGR: 				return { Utils::bele(ColorFormat::X8B8G8R8_32, ColorFormat::R8G8B8X8_32), ColorSubsampling::rb444, false };  //packed BGR 8:8:8, 32bpp, XBGRXBGR...   X=unused/undefined
-	case AV_PIX_FMT_BGR0: 				return { Utils::bele(ColorFormat::B8G8R8X8_32, ColorFormat::X8R8G8B8_32), ColorSubsampling::rb444, false };  //packed BGR 8:8:8, 32bpp, BGRXBGRX...   X=unused/undefined
+	{ AV_PIX_FMT_GRAY14,	{ ColorFormat::Y16, ColorSubsampling::rb444, false },						PixelFormatMapping::fromFFmpegOnly },	//       Y        , 14bpp
 
-	//case AV_PIX_FMT_YUV420P12: 		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:0,18bpp, (1 Cr & Cb sample per 2x2 Y samples)
-	//case AV_PIX_FMT_YUV420P14: 		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:0,21bpp, (1 Cr & Cb sample per 2x2 Y samples)
-	//case AV_PIX_FMT_YUV422P12: 		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:2,24bpp, (1 Cr & Cb sample per 2x1 Y samples)
-	//case AV_PIX_FMT_YUV422P14: 		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:2:2,28bpp, (1 Cr & Cb sample per 2x1 Y samples)
-	//case AV_PIX_FMT_YUV444P12: 		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:4:4,36bpp, (1 Cr & Cb sample per 1x1 Y samples)
-	//case AV_PIX_FMT_YUV444P14: 		return {}; /*NOT SUPPORTED*/ 													//planar YUV 4:4:4,42bpp, (1 Cr & Cb sample per 1x1 Y samples)
-	//case AV_PIX_FMT_GBRP12:    		return {}; /*NOT SUPPORTED*/ 													//planar GBR 4:4:4 36bpp
-	//case AV_PIX_FMT_GBRP14:    		return {}; /*NOT SUPPORTED*/ 													//planar GBR 4:4:4 42bpp
-	case AV_PIX_FMT_YUVJ411P:			return { ColorFormat::G8_B8_R8, ColorSubsampling::rb411, true };	    		//planar YUV 4:1:1, 12bpp, (1 Cr & Cb sample per 4x1 Y samples) full scale (JPEG), deprecated in favor of AV_PIX_FMT_YUV411P and setting color_range
+	{ AV_PIX_FMT_GRAYF32,	{ ColorFormat::Y32f, ColorSubsampling::rb444, false },						PixelFormatMapping::bidirectional },	//IEEE-754 single precision Y, 32bpp
 
-	//case AV_PIX_FMT_BAYER_BGGR8:  	return {}; /*NOT SUPPORTED*/ 													//bayer, BGBG..(odd line), GRGR..(even line), 8-bit samples
-	//case AV_PIX_FMT_BAYER_RGGB8:  	return {}; /*NOT SUPPORTED*/ 													//bayer, RGRG..(odd line), GBGB..(even line), 8-bit samples
-	//case AV_PIX_FMT_BAYER_GBRG8:  	return {}; /*NOT SUPPORTED*/ 													//bayer, GBGB..(odd line), RGRG..(even line), 8-bit samples
-	//case AV_PIX_FMT_BAYER_GRBG8:  	return {}; /*NOT SUPPORTED*/ 													//bayer, GRGR..(odd line), BGBG..(even line), 8-bit samples
-	//case AV_PIX_FMT_BAYER_BGGR16:		return {}; /*NOT SUPPORTED*/ 													//bayer, BGBG..(odd line), GRGR..(even line), 16-bit samples
-	//case AV_PIX_FMT_BAYER_RGGB16:		return {}; /*NOT SUPPORTED*/ 													//bayer, RGRG..(odd line), GBGB..(even line), 16-bit samples
-	//case AV_PIX_FMT_BAYER_GBRG16:		return {}; /*NOT SUPPORTED*/ 													//bayer, GBGB..(odd line), RGRG..(even line), 16-bit samples
-	//case AV_PIX_FMT_BAYER_GRBG16:		return {}; /*NOT SUPPORTED*/ 													//bayer, GRGR..(odd line), BGBG..(even line), 16-bit samples
+	//{ AV_PIX_FMT_YUVA422P12,	NOT SUPPORTED },																								//planar YUV 4:2:2,24bpp, (1 Cr & Cb sample per 2x1 Y samples), 12b alpha
+	//{ AV_PIX_FMT_YUVA444P12,	NOT SUPPORTED },																								//planar YUV 4:4:4,36bpp, (1 Cr & Cb sample per 1x1 Y samples), 12b alpha
 
-	//case AV_PIX_FMT_XVMC:				return {}; /*NOT SUPPORTED*/													//XVideo Motion Acceleration via common packet passing
+	{ AV_PIX_FMT_NV24,		{ ColorFormat::G8_B8R8, ColorSubsampling::rb444, true },					PixelFormatMapping::bidirectional },	//planar YUV 4:4:4, 24bpp, 1 plane for Y and 1 plane for the UV components, which are interleaved (first byte U and the following byte V)
+	{ AV_PIX_FMT_NV42,		{ ColorFormat::G8_R8B8, ColorSubsampling::rb444, true },					PixelFormatMapping::bidirectional },	//as above, but U and V bytes are swapped
 
-	//case AV_PIX_FMT_YUV440P10: 		return {}; /*NOT SUPPORTED*/													//planar YUV 4:4:0,20bpp, (1 Cr & Cb sample per 1x2 Y samples)
-	//case AV_PIX_FMT_YUV440P12: 		return {}; /*NOT SUPPORTED*/													//planar YUV 4:4:0,24bpp, (1 Cr & Cb sample per 1x2 Y samples)
-	case AV_PIX_FMT_AYUV64:   			return { ColorFormat::A16G16B16R16, ColorSubsampling::rb444, true };			//packed AYUV 4:4:4,64bpp (1 Cr & Cb sample per 1x1 Y & A samples)
+	//{ AV_PIX_FMT_VULKAN,	NOT SUPPORTED },																									//Vulkan hardware images.
 
-	//case AV_PIX_FMT_VIDEOTOOLBOX:		return {}; /*NOT SUPPORTED*/													//hardware decoding through Videotoolbox
+	//{ AV_PIX_FMT_Y210,	NOT SUPPORTED },																									//packed YUV 4:2:2 like YUYV422, 20bpp, data in the high bits
 
-	//case AV_PIX_FMT_P010: 			return {}; /*NOT SUPPORTED*/													//like NV12, with 10bpp per component, data in the high bits, zeros in the low bits
+	//Native endian packed RGB. Read back as their byte ordered counterparts
+	{ AV_PIX_FMT_RGB32,		{ ColorFormat::A8R8G8B8_32, ColorSubsampling::rb444, false },				PixelFormatMapping::toFFmpegOnly },
+	{ AV_PIX_FMT_BGR32,		{ ColorFormat::A8B8G8R8_32, ColorSubsampling::rb444, false },				PixelFormatMapping::toFFmpegOnly },
+	{ AV_PIX_FMT_RGB32_1,	{ ColorFormat::R8G8B8A8_32, ColorSubsampling::rb444, false },				PixelFormatMapping::toFFmpegOnly },
+	{ AV_PIX_FMT_BGR32_1,	{ ColorFormat::B8G8R8A8_32, ColorSubsampling::rb444, false },				PixelFormatMapping::toFFmpegOnly },
+};
 
-	//case AV_PIX_FMT_GBRAP12:  		return {}; /*NOT SUPPORTED*/ 													//planar GBR 4:4:4:4 48bpp
-	//case AV_PIX_FMT_GBRAP10:  		return {}; /*NOT SUPPORTED*/ 													//planar GBR 4:4:4:4 40bpp
+static constexpr bool operator==(const PixelFormatConversion& lhs, const PixelFormatConversion& rhs) noexcept {
+	return 	lhs.colorFormat == rhs.colorFormat &&
+			lhs.colorSubsampling == rhs.colorSubsampling &&
+			lhs.isYCbCr == rhs.isYCbCr ;
+}
 
-	//case AV_PIX_FMT_MEDIACODEC: 		return {}; /*NOT SUPPORTED*/													//hardware decoding through MediaCodec
+template<typename F>
+static constexpr size_t getPixelFormatTableMaximum(F&& func) noexcept {
+	size_t result = 0;
 
-	//case AV_PIX_FMT_GRAY12:   		return {}; /*NOT SUPPORTED*/													//       Y        , 12bpp
-	//case AV_PIX_FMT_GRAY10:   		return {}; /*NOT SUPPORTED*/													//       Y        , 10bpp
+	for(const auto& entry : PIXEL_FORMAT_TABLE) {
+		result = std::max(result, static_cast<size_t>(func(entry)));
+	}
 
-	case AV_PIX_FMT_P016:  				return { ColorFormat::G16_B16R16, ColorSubsampling::rb420, true };				//like NV12, with 16bpp per component
+	return result;
+}
 
-	//case AV_PIX_FMT_D3D11:			return {}; /*NOT SUPPORTED*/													//Hardware surfaces for Direct3D11.
+//Sizes of the lookup tables. Only the used range of each enum is considered
+static constexpr size_t PIXEL_FORMAT_COUNT = getPixelFormatTableMaximum([] (const PixelFormatEntry& entry) { return entry.pixelFormat; }) + 1;
+static constexpr size_t COLOR_FORMAT_COUNT = getPixelFormatTableMaximum([] (const PixelFormatEntry& entry) { return entry.conversion.colorFormat; }) + 1;
+static constexpr size_t COLOR_SUBSAMPLING_COUNT = getPixelFormatTableMaximum([] (const PixelFormatEntry& entry) { return entry.conversion.colorSubsampling; }) + 1;
 
-	//case AV_PIX_FMT_GRAY9:			return {}; /*NOT SUPPORTED*/													//       Y        , 9bpp
+static constexpr size_t getConversionIndex(const PixelFormatConversion& conv) noexcept {
+	const auto colorFormat = static_cast<size_t>(conv.colorFormat);
+	const auto colorSubsampling = static_cast<size_t>(conv.colorSubsampling);
 
-	case AV_PIX_FMT_GBRPF32:  			return { ColorFormat::G32f_B32f_R32f, ColorSubsampling::rb444, false };			//IEEE-754 single precision planar GBR 4:4:4,     96bpp
-	case AV_PIX_FMT_GBRAPF32: 			return { ColorFormat::G32f_B32f_R32f_A32f, ColorSubsampling::rb444, false };	//IEEE-754 single precision planar GBRA 4:4:4:4, 128bpp
+	return (colorFormat < COLOR_FORMAT_COUNT && colorSubsampling < COLOR_SUBSAMPLING_COUNT) ?
+			(static_cast<size_t>(conv.isYCbCr)*COLOR_SUBSAMPLING_COUNT + colorSubsampling)*COLOR_FORMAT_COUNT + colorFormat :
+			std::numeric_limits<size_t>::max() ;
+}
 
-	//case AV_PIX_FMT_DRM_PRIME:		return {}; /*NOT SUPPORTED*/													//DRM-managed buffers exposed through PRIME buffer sharing.
+static constexpr auto TO_FFMPEG_LUT = [] {
+	std::array<AVPixelFormat, 2*COLOR_SUBSAMPLING_COUNT*COLOR_FORMAT_COUNT> result = {};
 
-	//case AV_PIX_FMT_OPENCL:			return {}; /*NOT SUPPORTED*/													//Hardware surfaces for OpenCL.
+	for(auto& fmt : result) {
+		fmt = AV_PIX_FMT_NONE;
+	}
+
+	for(const auto& entry : PIXEL_FORMAT_TABLE) {
+		if(entry.isToFFmpeg()) {
+			result[getConversionIndex(entry.conversion)] = entry.pixelFormat;
+		}
+	}
 
-	case AV_PIX_FMT_GRAY14:   			return { ColorFormat::Y16, ColorSubsampling::rb444, false };					//       Y        , 14bpp
+	return result;
+}();
 
-	case AV_PIX_FMT_GRAYF32:  			return { ColorFormat::Y32f, ColorSubsampling::rb444, false };					//IEEE-754 single precision Y, 32bpp
+static constexpr auto FROM_FFMPEG_LUT = [] {
+	std::array<PixelFormatConversion, PIXEL_FORMAT_COUNT> result = {};
 
-	//case AV_PIX_FMT_YUVA422P12: 		return {}; /*NOT SUPPORTED*/													//planar YUV 4:2:2,24bpp, (1 Cr & Cb sample per 2x1 Y samples), 12b alpha
-	//case AV_PIX_FMT_YUVA444P12: 		return {}; /*NOT SUPPORTED*/													//planar YUV 4:4:4,36bpp, (1 Cr & Cb sample per 1x1 Y samples), 12b alpha
+	for(auto& conv : result) {
+		conv = PixelFormatConversion{ ColorFormat::none, ColorSubsampling::none, false };
+	}
 
-	case AV_PIX_FMT_NV24:      			return { ColorFormat::G8_B8R8, ColorSubsampling::rb444, true };					//planar YUV 4:4:4, 24bpp, 1 plane for Y and 1 plane for the UV components, which are interleaved (first byte U and the following byte V)
-	case AV_PIX_FMT_NV42:     			return { ColorFormat::G8_R8B8, ColorSubsampling::rb444, true };					//as above, but U and V bytes are swapped
+	for(const auto& entry : PIXEL_FORMAT_TABLE) {
+		if(entry.isFromFFmpeg()) {
+			result[static_cast<size_t>(entry.pixelFormat)] = entry.conversion;
+		}
+	}
 
-	//case AV_PIX_FMT_VULKAN:			return {}; /*NOT SUPPORTED*/													//Vulkan hardware images.
+	return result;
+}();
 
-	//case AV_PIX_FMT_Y210:   			return {}; /*NOT SUPPORTED*/													//packed YUV 4:2:2 like YUYV422, 20bpp, data in the high bits
+static constexpr AVPixelFormat toFFmpegLUT(const PixelFormatConversion& fmt) noexcept {
+	const auto index = getConversionIndex(fmt);
+	return index < TO_FFMPEG_LUT.size() ? TO_FFMPEG_LUT[index] : AV_PIX_FMT_NONE;
+}
 
+static constexpr PixelFormatConversion fromFFmpegLUT(AVPixelFormat fmt) noexcept {
+	const auto index = static_cast<size_t>(fmt);
+	return 	index < FROM_FFMPEG_LUT.size() ? 
+			FROM_FFMPEG_LUT[index] : 
+			PixelFormatConversion{ ColorFormat::none, ColorSubsampling::none, false } ;
+}
 
-	default: 							return { ColorFormat::none, ColorSubsampling::none, false };
+static constexpr bool isPixelFormatTableUnique() noexcept {
+	//Each direction must be a function, so keys cannot be repeated
+	for(auto i = std::cbegin(PIXEL_FORMAT_TABLE); i != std::cend(PIXEL_FORMAT_TABLE); ++i) {
+		for(auto j = std::next(i); j != std::cend(PIXEL_FORMAT_TABLE); ++j) {
+			if(i->isFromFFmpeg() && j->isFromFFmpeg() && i->pixelFormat == j->pixelFormat) return false;
+			if(i->isToFFmpeg() && j->isToFFmpeg() && i->conversion == j->conversion) return false;
+		}
 	}
+
+	return true;
+}
+
+static constexpr bool isPixelFormatTableConsistent() noexcept {
+	for(const auto& entry : PIXEL_FORMAT_TABLE) {
+		switch(entry.mapping) {
+		case PixelFormatMapping::bidirectional:
+			//Both ways must result in the original value
+			if(!(fromFFmpegLUT(toFFmpegLUT(entry.conversion)) == entry.conversion)) return false;
+			if(toFFmpegLUT(fromFFmpegLUT(entry.pixelFormat)) != entry.pixelFormat) return false;
+			break;
+
+		case PixelFormatMapping::toFFmpegOnly:
+			//Produced formats must be understood when they come back
+			if(fromFFmpegLUT(entry.pixelFormat).colorFormat == ColorFormat::none) return false;
+			break;
+
+		case PixelFormatMapping::fromFFmpegOnly:
+			//Aliases must have a canonical counterpart
+			if(toFFmpegLUT(entry.conversion) == AV_PIX_FMT_NONE) return false;
+			break;
+		}
+	}
+
+	return true;
+}
+
+static_assert(isPixelFormatTableUnique(), "Pixel format table has repeated keys");
+static_assert(isPixelFormatTableConsistent(), "Pixel format table does not round trip");
+
+
+
+PixelFormat toFFmpeg(const PixelFormatConversion& fmt) {
+	return static_cast<PixelFormat>(toFFmpegLUT(fmt));
 }
 
 PixelFormatConversion fromFFmpeg(PixelFormat fmt) {
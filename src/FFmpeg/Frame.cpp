@@ -63,6 +63,12 @@ void Frame::swap(Frame& other) {
 
 
 
+int Frame::ref(const Frame& other) {
+	//Shares the data buffers of the other frame, no copies involved
+	unref();
+	return av_frame_ref(&get(), &other.get());
+}
+
 void Frame::unref() {
 	av_frame_unref(&get());
 }
@@ -4,20 +4,59 @@
 
 extern "C" {
 	#include <libavformat/avformat.h>
+	#include <libavutil/dict.h>
 }
 
 namespace Zuazo::FFmpeg {
 
-InputFormatContext::InputFormatContext(const char* url) 
+InputFormatContext::InputFormatContext()
 	: m_handle(nullptr)
 {
-	if(avformat_open_input(&m_handle, url, NULL, NULL) != 0) {
-		//Opening the input
+}
+
+InputFormatContext::InputFormatContext(const char* url) 
+	: InputFormatContext(url, Options())
+{
+}
+
+InputFormatContext::InputFormatContext(	const char* url, 
+										const Options& options,
+										InterruptCallback interruptCbk,
+										void* interruptOpaque,
+										AVIOContext* ioContext ) 
+	: m_handle(avformat_alloc_context())
+{
+	if(!m_handle) {
+		throw Exception("Unable to allocate the input format context");
+	}
+
+	//The interrupt callback needs to be set before opening, as it may block
+	m_handle->interrupt_callback.callback = interruptCbk;
+	m_handle->interrupt_callback.opaque = interruptOpaque;
+
+	//Use the provided IO context instead of letting FFmpeg open the URL
+	if(ioContext) {
+		m_handle->pb = ioContext;
+		m_handle->flags |= AVFMT_FLAG_CUSTOM_IO;
+	}
+
+	//Convert the options into a dictionary
+	AVDictionary* dict = nullptr;
+	for(const auto& option : options) {
+		av_dict_set(&dict, option.first.c_str(), option.second.c_str(), 0);
+	}
+
+	const auto openResult = avformat_open_input(&m_handle, url, NULL, &dict);
+	av_dict_free(&dict); //Unused options are ignored
+	if(openResult != 0) {
+		//Opening the input. The context has been freed by FFmpeg
+		assert(!m_handle);
 		throw Exception("Unable to open the input for file: " + std::string(url));
 	}
 
 	if(avformat_find_stream_info(m_handle, NULL) < 0) {
-		//Error getting stream info
+		//Error getting stream info. Destructor won't be called, so close it here
+		avformat_close_input(&m_handle);
 		throw Exception("Unable to find stream info for the file: " + std::string(url));
 	}
 
@@ -71,6 +110,10 @@ Duration InputFormatContext::getDuration() const {
 	return Duration(get().duration);
 }
 
+Duration InputFormatContext::getStartTime() const {
+	return Duration(get().start_time);
+}
+
 
 int InputFormatContext::play() {
 	return av_read_play(&get());
@@ -9,8 +9,11 @@
 
 #include <cstddef>
 #include <chrono>
+#include <string>
+#include <unordered_map>
 
 struct AVFormatContext;
+struct AVIOContext;
 
 namespace Zuazo::FFmpeg {
 
@@ -20,9 +23,16 @@ public:
 	using ConstHandle = const AVFormatContext*;
 
 	using Streams = Utils::BufferView<const StreamParameters>;
+	using Options = std::unordered_map<std::string, std::string>;
+	using InterruptCallback = int(*)(void*);
 
 	InputFormatContext();
 	InputFormatContext(const char* url);
+	InputFormatContext(	const char* url, 
+						const Options& options,
+						InterruptCallback interruptCbk = nullptr,
+						void* interruptOpaque = nullptr,
+						AVIOContext* ioContext = nullptr ); //Not owned. Must outlive this
 	InputFormatContext(const InputFormatContext& other) = delete;
 	InputFormatContext(InputFormatContext&& other);
 	~InputFormatContext();
@@ -39,6 +49,7 @@ public:
 	int									findBestStream(MediaType type) const;
 	
 	Duration							getDuration() const;
+	Duration							getStartTime() const;
 
 	int									play();
 	int									pause();
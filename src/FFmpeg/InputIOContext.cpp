@@ -0,0 +1,662 @@
+#include "InputIOContext.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/Utils/Functions.h>
+
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#if defined(ZUAZO_FFMPEG_IO_URING)
+	#include <liburing.h>
+#endif
+
+extern "C" {
+	#include <libavformat/avio.h>
+	#include <libavutil/error.h>
+	#include <libavutil/mem.h>
+}
+
+namespace Zuazo::FFmpeg {
+
+static constexpr size_t IO_BUFFER_SIZE = 64 << 10; //64KiB
+static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+static constexpr unsigned RING_DEPTH = 256;
+static constexpr auto FOLLOW_POLL_INTERVAL = std::chrono::milliseconds(20);
+
+
+
+/*
+ * InputIOContext::Ring
+ */
+
+class InputIOContext::Ring {
+public:
+	struct Request {
+		void(*completion)(Request& request, int result);
+	};
+
+#if defined(ZUAZO_FFMPEG_IO_URING)
+	explicit Ring(unsigned depth) {
+		if(io_uring_queue_init(depth, &m_ring, 0) < 0) {
+			throw Exception("Unable to create the io_uring instance");
+		}
+
+		m_completionThread = std::thread(&Ring::completionThreadFunc, std::ref(*this));
+	}
+
+	~Ring() {
+		//Wake up the completion thread with an empty request
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			io_uring_sqe* sqe;
+			while(!(sqe = io_uring_get_sqe(&m_ring))) {
+				//The submission queue is full. Hand it to the kernel to make room
+				io_uring_submit(&m_ring);
+				std::this_thread::yield();
+			}
+
+			io_uring_prep_nop(sqe);
+			io_uring_sqe_set_data(sqe, nullptr);
+			io_uring_submit(&m_ring);
+		}
+
+		assert(m_completionThread.joinable());
+		m_completionThread.join();
+		io_uring_queue_exit(&m_ring);
+	}
+
+	bool submit(Request& request, int fd, void* data, size_t size, int64_t offset) {
+		//Several readers may submit concurrently, but only one may access the submission queue
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto* sqe = io_uring_get_sqe(&m_ring);
+		if(!sqe) {
+			return false;
+		}
+
+		io_uring_prep_read(sqe, fd, data, size, offset);
+		io_uring_sqe_set_data(sqe, &request);
+		return io_uring_submit(&m_ring) > 0;
+	}
+
+private:
+	io_uring					m_ring;
+	std::mutex					m_mutex;
+	std::thread					m_completionThread;
+
+	void completionThreadFunc() {
+		for(;;) {
+			io_uring_cqe* cqe;
+			const auto waitResult = io_uring_wait_cqe(&m_ring, &cqe);
+			if(waitResult == -EINTR) {
+				continue;
+			} else if(waitResult < 0) {
+				break;
+			}
+
+			auto* request = static_cast<Request*>(io_uring_cqe_get_data(cqe));
+			const auto result = cqe->res;
+			io_uring_cqe_seen(&m_ring, cqe);
+
+			if(!request) {
+				break; //Exit request
+			}
+
+			request->completion(*request, result);
+		}
+	}
+#else
+	explicit Ring(unsigned) {
+		throw Exception("io_uring support has not been compiled");
+	}
+
+	bool submit(Request&, int, void*, size_t, int64_t) {
+		return false;
+	}
+#endif
+
+};
+
+
+
+/*
+ * InputIOContext::Reader
+ */
+
+struct InputIOContext::Reader {
+	struct AlignedDeleter {
+		void operator()(uint8_t* ptr) const {
+			std::free(ptr);
+		}
+	};
+
+	struct Block : Ring::Request {
+		enum class State {
+			empty,
+			pending,
+			ready
+		};
+
+		Reader*										reader;
+		std::unique_ptr<uint8_t, AlignedDeleter>	data;
+		int64_t										offset;
+		int											result;
+		State										state;
+	};
+
+	int							fd;
+	RingPtr						ring;
+	size_t						blockSize;
+	int64_t						size;
+	int64_t						position;
+
+	FollowCallback				followCallback;
+	std::chrono::steady_clock::duration followTimeout;
+	std::chrono::steady_clock::time_point lastGrowth;
+
+	std::mutex					mutex;
+	std::condition_variable		cond;
+	std::vector<Block>			blocks;
+
+	Reader(const char* path, RingPtr ring, bool direct, size_t blockSize, size_t readAhead)
+		: fd(openFile(path, direct))
+		, ring(std::move(ring))
+		, blockSize(alignBlockSize(blockSize))
+		, size(0)
+		, position(0)
+		, followCallback()
+		, followTimeout()
+		, lastGrowth(std::chrono::steady_clock::now())
+		, blocks(std::max(readAhead, size_t(1)))
+	{
+		struct stat info;
+		if(fstat(fd, &info) < 0 || !S_ISREG(info.st_mode)) {
+			//Only regular files can be read ahead
+			close(fd);
+			throw Exception("Unable to read ahead the file: " + std::string(path));
+		}
+		size = info.st_size;
+
+		for(auto& block : blocks) {
+			block.completion = completionCallback;
+			block.reader = this;
+			block.data.reset(static_cast<uint8_t*>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, this->blockSize)));
+			block.offset = -1;
+			block.result = 0;
+			block.state = Block::State::empty;
+
+			if(!block.data) {
+				close(fd);
+				throw Exception("Unable to allocate the read ahead buffers");
+			}
+		}
+	}
+
+	~Reader() {
+		//The buffers can not be released while the kernel is writing on them
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cond.wait(lock, [this] {
+				return std::none_of(
+					blocks.cbegin(), blocks.cend(),
+					[] (const Block& block) -> bool {
+						return block.state == Block::State::pending;
+					}
+				);
+			});
+		}
+
+		close(fd);
+	}
+
+	int read(uint8_t* buf, int bufSize, bool retry = true) {
+		assert(buf);
+		assert(bufSize >= 0);
+
+		if(position >= size && !waitGrowth()) {
+			return AVERROR_EOF;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		//Ensure that the blocks in front of the current position are being read
+		const auto blockOffset = position - position % static_cast<int64_t>(blockSize);
+		Block* block;
+		for(;;) {
+			prefetch(lock, blockOffset);
+			block = findBlock(blockOffset);
+			if(block) {
+				break;
+			}
+
+			//Every block is still being read for a previous position
+			cond.wait(lock);
+		}
+
+		cond.wait(lock, [block] { return block->state == Block::State::ready; });
+		lock.unlock();
+
+		//Only this thread may recycle a ready block, so it can be accessed unlocked
+		if(block->result < 0) {
+			const auto error = block->result;
+			block->state = Block::State::empty; //Retry on the next call
+			return AVERROR(-error);
+		}
+
+		const auto available = block->offset + block->result - position;
+		if(available <= 0) {
+			//The block was read before the file grew. Read it again
+			block->state = Block::State::empty;
+			return (retry && position < size) ? read(buf, bufSize, false) : AVERROR_EOF;
+		}
+
+		const auto count = std::min(available, static_cast<int64_t>(bufSize));
+		std::memcpy(buf, block->data.get() + (position - block->offset), count);
+		position += count;
+		return count;
+	}
+
+	int64_t seek(int64_t offset, int whence) {
+		if(whence & AVSEEK_SIZE) {
+			return size;
+		}
+
+		int64_t target;
+		switch(whence & ~AVSEEK_FORCE) {
+		case SEEK_SET: target = offset; break;
+		case SEEK_CUR: target = position + offset; break;
+		case SEEK_END: target = size + offset; break;
+		default: return AVERROR(EINVAL);
+		}
+
+		if(target < 0) {
+			return AVERROR(EINVAL);
+		}
+
+		//Read ahead will be re-targeted on the next read
+		position = target;
+		return target;
+	}
+
+	static int readCallback(void* opaque, uint8_t* buf, int bufSize) {
+		assert(opaque);
+		return static_cast<Reader*>(opaque)->read(buf, bufSize);
+	}
+
+	static int64_t seekCallback(void* opaque, int64_t offset, int whence) {
+		assert(opaque);
+		return static_cast<Reader*>(opaque)->seek(offset, whence);
+	}
+
+private:
+	bool waitGrowth() {
+		//Poll the size of the file until it grows
+		for(;;) {
+			if(updateSize()) {
+				return true;
+			}
+
+			const auto now = std::chrono::steady_clock::now();
+			if(!followCallback || now - lastGrowth >= followTimeout || !followCallback()) {
+				return false;
+			}
+
+			std::this_thread::sleep_for(FOLLOW_POLL_INTERVAL);
+		}
+	}
+
+	bool updateSize() {
+		struct stat info;
+		if(fstat(fd, &info) < 0 || info.st_size <= size) {
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		size = info.st_size;
+		lastGrowth = std::chrono::steady_clock::now();
+
+		//Blocks which were read short can not be trusted anymore
+		for(auto& block : blocks) {
+			if(	block.state == Block::State::ready && 
+				block.result >= 0 && 
+				static_cast<size_t>(block.result) < blockSize ) 
+			{
+				block.state = Block::State::empty;
+			}
+		}
+
+		return true;
+	}
+
+	static size_t alignBlockSize(size_t blockSize) {
+		//O_DIRECT requires aligned offsets and sizes
+		const auto blockCount = (blockSize + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT;
+		return std::max(blockCount, size_t(1)) * DIRECT_IO_ALIGNMENT;
+	}
+
+	static int openFile(const char* path, bool direct) {
+		int fd = -1;
+
+#if defined(O_DIRECT)
+		if(direct) {
+			fd = open(path, O_RDONLY | O_CLOEXEC | O_DIRECT);
+			//If unsupported by the filesystem, fall back to buffered reads
+		}
+#else
+		Utils::ignore(direct);
+#endif
+
+		if(fd < 0) {
+			fd = open(path, O_RDONLY | O_CLOEXEC);
+		}
+
+		if(fd < 0) {
+			throw Exception("Unable to open the input for file: " + std::string(path));
+		}
+
+		return fd;
+	}
+
+	Block* findBlock(int64_t offset) {
+		const auto ite = std::find_if(
+			blocks.begin(), blocks.end(),
+			[offset] (const Block& block) -> bool {
+				return block.state != Block::State::empty && block.offset == offset;
+			}
+		);
+
+		return ite != blocks.end() ? &(*ite) : nullptr;
+	}
+
+	Block* findRecyclable(int64_t windowBegin) {
+		//Blocks outside the read ahead window which are not being written
+		const auto windowEnd = windowBegin + static_cast<int64_t>(blocks.size() * blockSize);
+		const auto ite = std::find_if(
+			blocks.begin(), blocks.end(),
+			[windowBegin, windowEnd] (const Block& block) -> bool {
+				return 	block.state == Block::State::empty ||
+						(block.state == Block::State::ready && (block.offset < windowBegin || block.offset >= windowEnd));
+			}
+		);
+
+		return ite != blocks.end() ? &(*ite) : nullptr;
+	}
+
+	void prefetch(std::unique_lock<std::mutex>& lock, int64_t windowBegin) {
+		if(!ring) {
+			prefetchSync(lock, windowBegin);
+			return;
+		}
+
+		for(size_t i = 0; i < blocks.size(); ++i) {
+			const auto offset = windowBegin + static_cast<int64_t>(i * blockSize);
+			if(offset >= size) {
+				break;
+			}
+
+			if(findBlock(offset)) {
+				continue; //Already requested
+			}
+
+			auto* block = findRecyclable(windowBegin);
+			if(!block) {
+				break; //All the blocks are busy
+			}
+
+			block->offset = offset;
+			block->result = 0;
+			block->state = Block::State::pending;
+
+			if(!ring->submit(*block, fd, block->data.get(), blockSize, offset)) {
+				if(i == 0) {
+					//The current block is needed right away. Read it in a unlocked
+					//environment, so that completions of other readers are not blocked
+					lock.unlock();
+					const auto result = pread(fd, block->data.get(), blockSize, offset);
+					lock.lock();
+
+					block->result = result < 0 ? -errno : static_cast<int>(result);
+					block->state = Block::State::ready;
+				} else {
+					block->state = Block::State::empty;
+				}
+
+				break;
+			}
+		}
+	}
+
+	void prefetchSync(std::unique_lock<std::mutex>& lock, int64_t windowBegin) {
+		//Once the current block is missing, read the whole window in a single
+		//call, so that the following reads are served from memory
+		if(findBlock(windowBegin)) {
+			return;
+		}
+
+		std::vector<Block*> claimed;
+		claimed.reserve(blocks.size());
+		for(size_t i = 0; i < blocks.size(); ++i) {
+			const auto offset = windowBegin + static_cast<int64_t>(i * blockSize);
+			if(offset >= size || findBlock(offset)) {
+				break; //Keep it contiguous
+			}
+
+			auto* block = findRecyclable(windowBegin);
+			if(!block) {
+				break; //All the blocks are busy
+			}
+
+			block->offset = offset;
+			block->result = 0;
+			block->state = Block::State::pending;
+			claimed.push_back(block);
+		}
+
+		if(claimed.empty()) {
+			return;
+		}
+
+		std::vector<iovec> iov(claimed.size());
+		for(size_t i = 0; i < claimed.size(); ++i) {
+			iov[i].iov_base = claimed[i]->data.get();
+			iov[i].iov_len = blockSize;
+		}
+
+		//Read in a unlocked environment, so that completions of other readers are not blocked
+		lock.unlock();
+		const auto result = preadv(fd, iov.data(), static_cast<int>(iov.size()), windowBegin);
+		const auto error = errno;
+		lock.lock();
+
+		//Distribute the result among the blocks
+		for(size_t i = 0; i < claimed.size(); ++i) {
+			auto& block = *claimed[i];
+
+			if(result < 0) {
+				//Report it on the current block. Leave the rest empty
+				block.result = -error;
+				block.state = (i == 0) ? Block::State::ready : Block::State::empty;
+			} else {
+				const auto remaining = result - static_cast<int64_t>(i * blockSize);
+				block.result = static_cast<int>(std::clamp(remaining, int64_t(0), static_cast<int64_t>(blockSize)));
+				block.state = Block::State::ready;
+			}
+		}
+	}
+
+	static void completionCallback(Ring::Request& request, int result) {
+		auto& block = static_cast<Block&>(request);
+		assert(block.reader);
+
+		//Notify while locked, as the reader may be destroyed as soon as it is released
+		std::lock_guard<std::mutex> lock(block.reader->mutex);
+		block.result = result;
+		block.state = Block::State::ready;
+		block.reader->cond.notify_all();
+	}
+};
+
+
+
+/*
+ * InputIOContext
+ */
+
+InputIOContext::InputIOContext()
+	: m_handle(nullptr)
+	, m_reader()
+{
+}
+
+InputIOContext::InputIOContext(	const char* path,
+								RingPtr ring,
+								bool direct,
+								size_t blockSize,
+								size_t readAhead )
+	: m_handle(nullptr)
+	, m_reader(Utils::makeUnique<Reader>(path, std::move(ring), direct, blockSize, readAhead))
+{
+	auto* buffer = static_cast<unsigned char*>(av_malloc(IO_BUFFER_SIZE));
+	if(!buffer) {
+		throw Exception("Unable to allocate the input buffer");
+	}
+
+	m_handle = avio_alloc_context(
+		buffer,					//Buffer
+		IO_BUFFER_SIZE,			//Buffer size
+		0,						//Write flag
+		m_reader.get(),			//Opaque
+		Reader::readCallback,	//Read callback
+		nullptr,				//Write callback
+		Reader::seekCallback	//Seek callback
+	);
+
+	if(!m_handle) {
+		av_free(buffer);
+		throw Exception("Unable to allocate the input IO context");
+	}
+
+	//At this point it should have been successful
+	assert(m_handle);
+}
+
+InputIOContext::InputIOContext(InputIOContext&& other)
+	: m_handle(other.m_handle)
+	, m_reader(std::move(other.m_reader))
+{
+	other.m_handle = nullptr;
+}
+
+InputIOContext::~InputIOContext() {
+	if(m_handle) {
+		av_freep(&m_handle->buffer);
+		avio_context_free(&m_handle);
+	}
+}
+
+
+
+InputIOContext& InputIOContext::operator=(InputIOContext&& other) {
+	InputIOContext(std::move(other)).swap(*this);
+	return *this;
+}
+
+
+
+void InputIOContext::swap(InputIOContext& other) {
+	std::swap(m_handle, other.m_handle);
+	std::swap(m_reader, other.m_reader);
+}
+
+void InputIOContext::setFollowCallback(FollowCallback cbk, std::chrono::steady_clock::duration timeout) {
+	assert(m_reader);
+	m_reader->followCallback = std::move(cbk);
+	m_reader->followTimeout = timeout;
+	m_reader->lastGrowth = std::chrono::steady_clock::now();
+}
+
+
+
+InputIOContext::operator Handle() {
+	return m_handle;
+}
+
+InputIOContext::operator ConstHandle() const {
+	return m_handle;
+}
+
+
+
+InputIOContext::RingPtr InputIOContext::getSharedRing(const void* owner) {
+#if defined(ZUAZO_FFMPEG_IO_URING)
+	static std::mutex mutex;
+	static std::unordered_map<const void*, std::weak_ptr<Ring>> rings;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Drop the rings which are no longer in use
+	for(auto ite = rings.begin(); ite != rings.end(); ) {
+		ite = ite->second.expired() ? rings.erase(ite) : std::next(ite);
+	}
+
+	auto& entry = rings[owner];
+	auto result = entry.lock();
+	if(!result) {
+		try {
+			result = std::make_shared<Ring>(RING_DEPTH);
+			entry = result;
+		} catch(const Exception&) {
+			//io_uring is not supported by the kernel. Fall back to plain reads
+			rings.erase(owner);
+		}
+	}
+
+	return result;
+#else
+	Utils::ignore(owner);
+	return nullptr;
+#endif
+}
+
+const char* InputIOContext::getLocalPath(const char* url) {
+	constexpr char FILE_PROTOCOL[] = "file:";
+	constexpr size_t FILE_PROTOCOL_LENGTH = sizeof(FILE_PROTOCOL) - 1;
+
+	if(!url || !*url || std::strcmp(url, "-") == 0) {
+		return nullptr; //Empty or standard input
+	} else if(std::strncmp(url, FILE_PROTOCOL, FILE_PROTOCOL_LENGTH) == 0) {
+		return url + FILE_PROTOCOL_LENGTH;
+	} else if(std::strstr(url, "://") || std::strncmp(url, "pipe:", 5) == 0) {
+		return nullptr; //Other protocol
+	} else {
+		return url;
+	}
+}
+
+
+
+AVIOContext& InputIOContext::get() {
+	assert(m_handle);
+	return *m_handle;
+}
+
+const AVIOContext& InputIOContext::get() const {
+	assert(m_handle);
+	return *m_handle;
+}
+
+}
\ No newline at end of file
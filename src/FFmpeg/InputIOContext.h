@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+struct AVIOContext;
+
+namespace Zuazo::FFmpeg {
+
+//Read only IO context for local files. Several blocks are kept in flight
+//ahead of the current position. When a ring is provided, they are read
+//asynchronously through io_uring. Otherwise the whole window is read with
+//a single plain read once the current block is missing
+class InputIOContext {
+public:
+	using Handle = AVIOContext*;
+	using ConstHandle = const AVIOContext*;
+
+	class Ring;
+	using RingPtr = std::shared_ptr<Ring>;
+
+	//Called when the end of a file is reached. Returns true if it may still grow
+	using FollowCallback = std::function<bool()>;
+
+	static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20; //1MiB
+	static constexpr size_t DEFAULT_READ_AHEAD = 8;
+
+	InputIOContext();
+	InputIOContext(	const char* path,
+					RingPtr ring = nullptr,
+					bool direct = false,
+					size_t blockSize = DEFAULT_BLOCK_SIZE,
+					size_t readAhead = DEFAULT_READ_AHEAD );
+	InputIOContext(const InputIOContext& other) = delete;
+	InputIOContext(InputIOContext&& other);
+	~InputIOContext();
+
+	InputIOContext& 					operator=(const InputIOContext& other) = delete;
+	InputIOContext&						operator=(InputIOContext&& other);
+
+	operator Handle();
+	operator ConstHandle() const;
+
+	void								swap(InputIOContext& other);
+
+	//Keeps reading a growing file instead of signaling the end of file. 
+	//Given up when it has not grown for the timeout or the callback
+	//returns false
+	void								setFollowCallback(FollowCallback cbk, std::chrono::steady_clock::duration timeout);
+
+	//Returns the ring shared by all the readers with the same owner. 
+	//nullptr if io_uring is not available
+	static RingPtr						getSharedRing(const void* owner);
+
+	//Returns the path of the file if the URL refers to a local file, nullptr otherwise
+	static const char*					getLocalPath(const char* url);
+
+private:
+	struct Reader;
+
+	Handle								m_handle;
+	std::unique_ptr<Reader>				m_reader;
+
+	AVIOContext&						get();
+	const AVIOContext&					get() const;
+
+};
+
+}
\ No newline at end of file
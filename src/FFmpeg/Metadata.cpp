@@ -0,0 +1,123 @@
+#include <zuazo/FFmpeg/Metadata.h>
+
+#include <cstdio>
+
+namespace Zuazo::FFmpeg {
+
+/*
+ * Timecode
+ */
+
+static constexpr int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+static int64_t getDroppedFrames(int fps, bool dropFrame) {
+	//Only defined for multiples of 30 (29.97, 59.94...). Two frame numbers
+	//per 30 are skipped every minute, except for each tenth minute
+	return (dropFrame && fps > 0 && fps % 30 == 0) ? fps / 30 * 2 : 0;
+}
+
+static int64_t getFramesPerDay(int fps, bool dropFrame) {
+	const auto dropped = getDroppedFrames(fps, dropFrame);
+	const auto minutes = SECONDS_PER_DAY / 60;
+	return SECONDS_PER_DAY * fps - dropped * (minutes - minutes / 10);
+}
+
+
+bool Timecode::operator==(const Timecode& other) const {
+	return 	hours == other.hours &&
+			minutes == other.minutes &&
+			seconds == other.seconds &&
+			frames == other.frames &&
+			dropFrame == other.dropFrame ;
+}
+
+bool Timecode::operator!=(const Timecode& other) const {
+	return !operator==(other);
+}
+
+
+int64_t Timecode::toFrameNumber(int fps) const {
+	const int64_t totalMinutes = 60 * hours + minutes;
+	const int64_t totalSeconds = 60 * totalMinutes + seconds;
+	const auto dropped = getDroppedFrames(fps, dropFrame);
+
+	return totalSeconds * fps + frames - dropped * (totalMinutes - totalMinutes / 10);
+}
+
+Timecode Timecode::fromFrameNumber(int64_t frameNumber, int fps, bool dropFrame) {
+	Timecode result = {};
+	result.dropFrame = dropFrame;
+
+	if(fps <= 0) {
+		return result;
+	}
+
+	//Wrap around at 24h
+	const auto framesPerDay = getFramesPerDay(fps, dropFrame);
+	frameNumber %= framesPerDay;
+	if(frameNumber < 0) {
+		frameNumber += framesPerDay;
+	}
+
+	//Add back the skipped frame numbers
+	const auto dropped = getDroppedFrames(fps, dropFrame);
+	if(dropped) {
+		const int64_t framesPerMinute = 60 * fps - dropped;
+		const int64_t framesPer10Minutes = 600 * fps - 9 * dropped;
+		const auto tens = frameNumber / framesPer10Minutes;
+		const auto remainder = frameNumber % framesPer10Minutes;
+
+		frameNumber += 9 * dropped * tens;
+		if(remainder > dropped) {
+			frameNumber += dropped * ((remainder - dropped) / framesPerMinute);
+		}
+	}
+
+	result.frames = static_cast<uint8_t>(frameNumber % fps);
+	result.seconds = static_cast<uint8_t>(frameNumber / fps % 60);
+	result.minutes = static_cast<uint8_t>(frameNumber / (fps * 60) % 60);
+	result.hours = static_cast<uint8_t>(frameNumber / (fps * 3600) % 24);
+	return result;
+}
+
+
+std::string Timecode::toString() const {
+	char result[16];
+	std::snprintf(
+		result, sizeof(result),
+		"%02u:%02u:%02u%c%02u",
+		hours, minutes, seconds,
+		dropFrame ? ';' : ':',
+		frames
+	);
+	return result;
+}
+
+std::optional<Timecode> Timecode::fromString(std::string_view str) {
+	const std::string tmp(str); //Ensure null termination
+	unsigned hh, mm, ss, ff;
+	char separator;
+
+	if(std::sscanf(tmp.c_str(), "%u:%u:%u%c%u", &hh, &mm, &ss, &separator, &ff) != 5) {
+		return std::nullopt;
+	}
+
+	if(hh >= 24 || mm >= 60 || ss >= 60 || ff >= 256) {
+		return std::nullopt;
+	}
+
+	//Both ';' and '.' are used for drop frame
+	if(separator != ':' && separator != ';' && separator != '.') {
+		return std::nullopt;
+	}
+
+	return Timecode{
+		static_cast<uint8_t>(hh),
+		static_cast<uint8_t>(mm),
+		static_cast<uint8_t>(ss),
+		static_cast<uint8_t>(ff),
+		separator != ':'
+	};
+}
+
+}
\ No newline at end of file
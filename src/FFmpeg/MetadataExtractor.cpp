@@ -0,0 +1,456 @@
+#include "MetadataExtractor.h"
+
+#include <zuazo/Math/Comparisons.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+	#include <libavutil/avutil.h>
+	#include <libavutil/mathematics.h>
+	#include <libavcodec/codec_id.h>
+}
+
+namespace Zuazo::FFmpeg {
+
+static constexpr AVRational MPEG_TIME_BASE = { 1, 90000 };
+static constexpr int64_t MPEG_WRAP = int64_t(1) << 33;
+static constexpr int64_t MAX_SPLICE_DISTANCE = int64_t(600) * 90000; //10min. Beyond it, the splice time is considered bogus
+static constexpr uint8_t SPLICE_INFO_TABLE_ID = 0xFC;
+
+//Reads big endian bit fields
+class BitReader {
+public:
+	BitReader(Utils::BufferView<const std::byte> data)
+		: m_data(data)
+		, m_position(0)
+		, m_failed(false)
+	{
+	}
+
+	uint64_t read(unsigned bits) {
+		uint64_t result = 0;
+
+		if(m_position + bits > m_data.size() * 8) {
+			m_failed = true;
+			return result;
+		}
+
+		for(unsigned i = 0; i < bits; ++i, ++m_position) {
+			const auto byte = std::to_integer<unsigned>(m_data[m_position / 8]);
+			result = (result << 1) | ((byte >> (7 - m_position % 8)) & 1);
+		}
+
+		return result;
+	}
+
+	void skip(unsigned bits) {
+		read(bits);
+	}
+
+	bool hasFailed() const {
+		return m_failed;
+	}
+
+private:
+	Utils::BufferView<const std::byte> m_data;
+	size_t							m_position;
+	bool							m_failed;
+
+};
+
+static std::optional<int64_t> readSpliceTime(BitReader& reader) {
+	if(reader.read(1)) { //time_specified_flag
+		reader.skip(6); //reserved
+		return static_cast<int64_t>(reader.read(33));
+	}
+
+	reader.skip(7); //reserved
+	return std::nullopt;
+}
+
+static unsigned fromBCD(uint32_t value) {
+	return (value & 0xF) + 10 * (value >> 4);
+}
+
+
+
+MetadataExtractor::MetadataExtractor(Streams streams, int videoStream)
+	: m_streams()
+	, m_videoStream(-1)
+	, m_rateNum(0)
+	, m_rateDen(1)
+	, m_fps(0)
+	, m_referenceMutex()
+	, m_reference()
+	, m_cues()
+{
+	m_streams.reserve(streams.size());
+	for(const auto& stream : streams) {
+		const auto timeBase = stream.getTimeBase();
+		const auto codecId = static_cast<AVCodecID>(stream.getCodecParameters().getCodecId());
+
+		m_streams.push_back(StreamState{
+			timeBase.getNumerator(),
+			timeBase.getDenominator(),
+			codecId == AV_CODEC_ID_SCTE_35
+		});
+	}
+
+	if(videoStream < 0 || static_cast<size_t>(videoStream) >= streams.size()) {
+		return; //Only cues
+	}
+
+	const auto& video = streams[videoStream];
+	m_videoStream = videoStream;
+
+	//Obtain the frame rate which the timecode refers to
+	auto rate = video.getRealFrameRate();
+	if(rate.getNumerator() <= 0 || rate.getDenominator() <= 0) {
+		rate = video.getAverageFrameRate();
+	}
+	if(rate.getNumerator() > 0 && rate.getDenominator() > 0) {
+		m_rateNum = rate.getNumerator();
+		m_rateDen = rate.getDenominator();
+		m_fps = static_cast<int>((m_rateNum + m_rateDen / 2) / m_rateDen);
+	}
+
+	//Parse the start timecode once. Prefer the one of the video stream,
+	//otherwise use the one of any other stream (i.e. a tmcd track)
+	auto start = Timecode::fromString(video.getMetadata("timecode"));
+	for(size_t i = 0; i < streams.size() && !start; ++i) {
+		start = Timecode::fromString(streams[i].getMetadata("timecode"));
+	}
+
+	if(start && m_fps > 0) {
+		const auto startTime = video.getStartTime();
+		m_reference = Reference{
+			start->toFrameNumber(m_fps),
+			(startTime != AV_NOPTS_VALUE) ? toDuration(m_streams[m_videoStream], startTime) : Duration(),
+			start->dropFrame
+		};
+	}
+}
+
+
+
+bool MetadataExtractor::isCueStream(int stream) const {
+	return 	stream >= 0 &&
+			static_cast<size_t>(stream) < m_streams.size() &&
+			m_streams[stream].cues;
+}
+
+void MetadataExtractor::parse(const Packet& packet) {
+	const auto index = packet.getStreamIndex();
+	if(!isCueStream(index)) {
+		return;
+	}
+
+	const auto cue = parseSpliceInfo(packet, m_streams[index]);
+	if(cue) {
+		pushCue(*cue);
+	}
+}
+
+
+void MetadataExtractor::extract(const Frame& frame, FrameMetadata& result) {
+	result = FrameMetadata();
+	if(m_videoStream < 0) {
+		return;
+	}
+
+	const auto& stream = m_streams[m_videoStream];
+	auto pts = frame.getPTS();
+	if(pts == AV_NOPTS_VALUE) {
+		pts = frame.getBestEffortTS();
+	}
+
+	const auto sideDataTimecode = getSideDataTimecode(frame);
+	if(pts == AV_NOPTS_VALUE) {
+		//Can not be placed in the timeline
+		result.timecode = sideDataTimecode;
+		return;
+	}
+
+	const auto begin = toDuration(stream, pts);
+
+	{
+		std::lock_guard<std::mutex> lock(m_referenceMutex);
+
+		if(sideDataTimecode) {
+			//Embedded timecodes are authoritative
+			result.timecode = sideDataTimecode;
+			if(m_fps > 0) {
+				m_reference = Reference{ sideDataTimecode->toFrameNumber(m_fps), begin, sideDataTimecode->dropFrame };
+			}
+		} else if(m_reference && m_fps > 0) {
+			//Count frames from the reference
+			result.timecode = Timecode::fromFrameNumber(
+				m_reference->frameNumber + toFrameCount(begin - m_reference->timestamp),
+				m_fps,
+				m_reference->dropFrame
+			);
+		}
+	}
+
+	//Deliver the first pending cue which is due within this frame. The rest
+	//are left for the following ones
+	const auto packetDuration = frame.getPacketDuration();
+	const auto end = begin + ((packetDuration > 0) ? toDuration(stream, packetDuration) : fromFrameCount(1));
+	if(!m_cues.empty() && m_cues.front().time < end) {
+		result.spliceCue = m_cues.front();
+		result.spliceCue->time = Math::max(result.spliceCue->time, begin); //Immediate ones
+		m_cues.pop_front();
+	}
+}
+
+
+void MetadataExtractor::flush() {
+	m_cues.clear();
+}
+
+
+std::optional<Duration> MetadataExtractor::toTimeStamp(const Timecode& timecode) const {
+	std::lock_guard<std::mutex> lock(m_referenceMutex);
+
+	if(!m_reference || m_fps <= 0) {
+		return std::nullopt;
+	}
+
+	//Interpret it as the reference does
+	auto target = timecode;
+	target.dropFrame = m_reference->dropFrame;
+
+	const auto delta = target.toFrameNumber(m_fps) - m_reference->frameNumber;
+	return m_reference->timestamp + fromFrameCount(delta);
+}
+
+
+
+std::optional<Timecode> MetadataExtractor::getSideDataTimecode(const Frame& frame) const {
+	for(const auto& sideData : frame.getSideData()) {
+		const auto data = sideData.getData();
+
+		switch(sideData.getType()) {
+		case FrameSideDataType::S12MTimecode: {
+			//Count followed by up to 3 SMPTE 12M binary timecodes
+			uint32_t values[2];
+			if(data.size() < sizeof(values)) {
+				break;
+			}
+
+			std::memcpy(values, data.data(), sizeof(values));
+			if(values[0] < 1) {
+				break;
+			}
+
+			const auto tc = values[1];
+			auto frames = fromBCD(tc >> 24 & 0x3F);
+			if(m_fps > 30) {
+				//Frame pairs are counted, the field bit tells which one
+				const auto fieldBit = (m_fps == 50) ? (1U << 7) : (1U << 23);
+				frames = frames * 2 + ((tc & fieldBit) ? 1 : 0);
+			}
+
+			return Timecode{
+				static_cast<uint8_t>(fromBCD(tc & 0x3F)),
+				static_cast<uint8_t>(fromBCD(tc >> 8 & 0x7F)),
+				static_cast<uint8_t>(fromBCD(tc >> 16 & 0x7F)),
+				static_cast<uint8_t>(frames),
+				(tc & (1U << 30)) != 0
+			};
+		}
+
+		case FrameSideDataType::gopTimecode: {
+			//25 bit MPEG-2 GOP timecode
+			int64_t tc;
+			if(data.size() < sizeof(tc)) {
+				break;
+			}
+
+			std::memcpy(&tc, data.data(), sizeof(tc));
+			return Timecode{
+				static_cast<uint8_t>(tc >> 19 & 0x1F),
+				static_cast<uint8_t>(tc >> 13 & 0x3F),
+				static_cast<uint8_t>(tc >> 6 & 0x3F),
+				static_cast<uint8_t>(tc & 0x3F),
+				(tc & (1 << 24)) != 0
+			};
+		}
+
+		default:
+			break;
+		}
+	}
+
+	return std::nullopt;
+}
+
+std::optional<SpliceCue> MetadataExtractor::parseSpliceInfo(const Packet& packet, const StreamState& stream) const {
+	BitReader reader(packet.getData());
+	SpliceCue result = {};
+	std::optional<int64_t> spliceTime;
+
+	//splice_info_section()
+	if(reader.read(8) != SPLICE_INFO_TABLE_ID) {
+		return std::nullopt;
+	}
+
+	reader.skip(4); //section_syntax_indicator, private_indicator, sap_type
+	reader.skip(12); //section_length
+	reader.skip(8); //protocol_version
+	const auto encrypted = reader.read(1);
+	reader.skip(6); //encryption_algorithm
+	const auto ptsAdjustment = static_cast<int64_t>(reader.read(33));
+	reader.skip(8); //cw_index
+	reader.skip(12); //tier
+	reader.skip(12); //splice_command_length
+	const auto commandType = reader.read(8);
+
+	if(encrypted) {
+		return std::nullopt;
+	}
+
+	switch(commandType) {
+	case static_cast<uint64_t>(SpliceCue::Command::spliceInsert): {
+		result.command = SpliceCue::Command::spliceInsert;
+		result.eventId = static_cast<uint32_t>(reader.read(32));
+		result.cancel = reader.read(1);
+		reader.skip(7); //reserved
+
+		if(!result.cancel) {
+			result.outOfNetwork = reader.read(1);
+			const auto programSplice = reader.read(1);
+			const auto hasDuration = reader.read(1);
+			const auto immediate = reader.read(1);
+			reader.skip(4); //reserved
+
+			if(programSplice) {
+				if(!immediate) {
+					spliceTime = readSpliceTime(reader);
+				}
+			} else {
+				//Use the time of the first component
+				const auto componentCount = reader.read(8);
+				for(uint64_t i = 0; i < componentCount && !reader.hasFailed(); ++i) {
+					reader.skip(8); //component_tag
+					if(!immediate) {
+						const auto componentTime = readSpliceTime(reader);
+						if(i == 0) {
+							spliceTime = componentTime;
+						}
+					}
+				}
+			}
+
+			if(hasDuration) {
+				reader.skip(7); //auto_return, reserved
+				result.breakDuration = Duration(av_rescale_q(
+					static_cast<int64_t>(reader.read(33)),
+					MPEG_TIME_BASE,
+					AVRational{ Duration::period::num, Duration::period::den }
+				));
+			}
+		}
+		break;
+	}
+
+	case static_cast<uint64_t>(SpliceCue::Command::timeSignal):
+		result.command = SpliceCue::Command::timeSignal;
+		spliceTime = readSpliceTime(reader);
+		break;
+
+	default:
+		return std::nullopt; //splice_null and others are not cues
+	}
+
+	if(reader.hasFailed()) {
+		return std::nullopt;
+	}
+
+	//Place it in the timeline
+	auto timestamp = packet.getPTS();
+	if(timestamp == AV_NOPTS_VALUE) {
+		timestamp = packet.getDTS();
+	}
+
+	if(timestamp == AV_NOPTS_VALUE) {
+		result.time = Duration::min(); //Due on the next frame
+		return result;
+	}
+
+	result.time = toDuration(stream, timestamp);
+	if(spliceTime) {
+		//The splice time is given in the 33 bit clock of the program. As
+		//timestamps may have been unwrapped, take it relative to the packet
+		const auto packetTime = av_rescale_q(
+			timestamp,
+			AVRational{ static_cast<int>(stream.timeBaseNum), static_cast<int>(stream.timeBaseDen) },
+			MPEG_TIME_BASE
+		);
+
+		auto delta = (*spliceTime + ptsAdjustment - packetTime) % MPEG_WRAP;
+		if(delta < 0) {
+			delta += MPEG_WRAP;
+		}
+		if(delta >= MPEG_WRAP / 2) {
+			delta -= MPEG_WRAP;
+		}
+
+		if(std::abs(delta) <= MAX_SPLICE_DISTANCE) {
+			result.time += Duration(av_rescale_q(
+				delta,
+				MPEG_TIME_BASE,
+				AVRational{ Duration::period::num, Duration::period::den }
+			));
+		}
+	}
+
+	return result;
+}
+
+void MetadataExtractor::pushCue(const SpliceCue& cue) {
+	//Keep them sorted, placing the latest one last among equals
+	const auto ite = std::upper_bound(
+		m_cues.cbegin(), m_cues.cend(),
+		cue.time,
+		[] (Duration time, const SpliceCue& other) -> bool {
+			return time < other.time;
+		}
+	);
+
+	m_cues.insert(ite, cue);
+}
+
+
+
+int64_t MetadataExtractor::toFrameCount(Duration duration) const {
+	return (m_rateNum > 0)
+	? av_rescale_q(
+		duration.count(),
+		AVRational{ Duration::period::num, Duration::period::den },
+		AVRational{ static_cast<int>(m_rateDen), static_cast<int>(m_rateNum) }
+	)
+	: 0;
+}
+
+Duration MetadataExtractor::fromFrameCount(int64_t count) const {
+	return (m_rateNum > 0)
+	? Duration(av_rescale_q(
+		count,
+		AVRational{ static_cast<int>(m_rateDen), static_cast<int>(m_rateNum) },
+		AVRational{ Duration::period::num, Duration::period::den }
+	))
+	: Duration();
+}
+
+Duration MetadataExtractor::toDuration(const StreamState& stream, int64_t timestamp) {
+	return Duration(av_rescale_q(
+		timestamp,
+		AVRational{ static_cast<int>(stream.timeBaseNum), static_cast<int>(stream.timeBaseDen) },
+		AVRational{ Duration::period::num, Duration::period::den }
+	));
+}
+
+}
\ No newline at end of file
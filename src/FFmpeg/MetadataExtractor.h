@@ -0,0 +1,86 @@
+#pragma once
+
+#include <zuazo/FFmpeg/Packet.h>
+#include <zuazo/FFmpeg/Frame.h>
+#include <zuazo/FFmpeg/StreamParameters.h>
+#include <zuazo/FFmpeg/Metadata.h>
+#include <zuazo/FFmpeg/Chrono.h>
+
+#include <zuazo/Utils/BufferView.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace Zuazo::FFmpeg {
+
+//Obtains the timecode of the frames of a video stream and the SCTE-35 cues
+//carried on data streams. The start timecode of the streams is parsed once
+//and frames are labeled counting from it. Timecodes found in the side data
+//of the frames take precedence, becoming the new reference
+class MetadataExtractor {
+public:
+	using Streams = Utils::BufferView<const StreamParameters>;
+
+	MetadataExtractor(Streams streams, int videoStream);
+	MetadataExtractor(const MetadataExtractor& other) = delete;
+	MetadataExtractor(MetadataExtractor&& other) = delete;
+	~MetadataExtractor() = default;
+
+	MetadataExtractor&					operator=(const MetadataExtractor& other) = delete;
+	MetadataExtractor&					operator=(MetadataExtractor&& other) = delete;
+
+	bool								isCueStream(int stream) const;
+	void								parse(const Packet& packet);
+
+	//Frames are expected to belong to the video stream. Pending cues are
+	//delivered once their time is reached
+	void								extract(const Frame& frame, FrameMetadata& result);
+
+	//Called after seeking. Drops the pending cues
+	void								flush();
+
+	//Timestamp of the frame labeled with the given timecode. Nothing if the
+	//stream has no timecode reference yet. Thread safe
+	std::optional<Duration>				toTimeStamp(const Timecode& timecode) const;
+
+private:
+	struct StreamState {
+		int64_t							timeBaseNum;
+		int64_t							timeBaseDen;
+		bool							cues; //Carries SCTE-35
+	};
+
+	//Timecode of a known frame
+	struct Reference {
+		int64_t							frameNumber;
+		Duration						timestamp;
+		bool							dropFrame;
+	};
+
+	std::vector<StreamState>			m_streams;
+	int									m_videoStream;
+	int64_t								m_rateNum;
+	int64_t								m_rateDen;
+	int									m_fps; //Nominal, i.e. 30 for 29.97
+
+	mutable std::mutex					m_referenceMutex;
+	std::optional<Reference>			m_reference;
+
+	std::deque<SpliceCue>				m_cues; //Sorted by their time
+
+	std::optional<Timecode>				getSideDataTimecode(const Frame& frame) const;
+	std::optional<SpliceCue>			parseSpliceInfo(const Packet& packet, const StreamState& stream) const;
+	void								pushCue(const SpliceCue& cue);
+
+	int64_t								toFrameCount(Duration duration) const;
+	Duration							fromFrameCount(int64_t count) const;
+
+	static Duration						toDuration(const StreamState& stream, int64_t timestamp);
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "OutputFormatContext.h"
+
+#include <zuazo/Exception.h>
+
+#include <cassert>
+
+extern "C" {
+	#include <libavformat/avformat.h>
+}
+
+namespace Zuazo::FFmpeg {
+
+OutputFormatContext::OutputFormatContext()
+	: m_handle(nullptr)
+{
+}
+
+OutputFormatContext::OutputFormatContext(const char* url, const char* format) 
+	: m_handle(nullptr)
+{
+	if(avformat_alloc_output_context2(&m_handle, nullptr, format, url) < 0) {
+		//Guessing the output format from the name
+		throw Exception("Unable to create the output for file: " + std::string(url));
+	}
+
+	//At this point it should have been successful
+	assert(m_handle);
+}
+
+OutputFormatContext::OutputFormatContext(OutputFormatContext&& other)
+	: m_handle(other.m_handle)
+{
+	other.m_handle = nullptr;
+}
+
+OutputFormatContext::~OutputFormatContext() {
+	//Custom IO contexts are not owned, so they are not freed
+	avformat_free_context(m_handle);
+}
+
+
+
+OutputFormatContext& OutputFormatContext::operator=(OutputFormatContext&& other) {
+	OutputFormatContext(std::move(other)).swap(*this);
+	return *this;
+}
+
+
+
+void OutputFormatContext::swap(OutputFormatContext& other) {
+	std::swap(m_handle, other.m_handle);
+}
+
+
+
+OutputFormatContext::operator Handle() {
+	return m_handle;
+}
+
+OutputFormatContext::operator ConstHandle() const {
+	return m_handle;
+}
+
+
+
+OutputFormatContext::Streams OutputFormatContext::getStreams() const {
+	static_assert(sizeof(StreamParameters::Handle) == sizeof(StreamParameters), "In order to reinterpret cast, size must match");
+	return Streams(reinterpret_cast<const StreamParameters*>(get().streams), get().nb_streams);
+}
+
+int OutputFormatContext::addStream(const CodecParameters& codecPar, Math::Rational<int> timeBase) {
+	auto* stream = avformat_new_stream(&get(), nullptr);
+	if(!stream) {
+		return AVERROR(ENOMEM);
+	}
+
+	const auto result = avcodec_parameters_copy(stream->codecpar, codecPar);
+	if(result < 0) {
+		return result;
+	}
+
+	//This is only a hint. The muxer may change it when writing the header
+	stream->time_base.num = timeBase.getNumerator();
+	stream->time_base.den = timeBase.getDenominator();
+
+	return stream->index;
+}
+
+
+bool OutputFormatContext::requiresIOContext() const {
+	assert(get().oformat);
+	return !(get().oformat->flags & AVFMT_NOFILE);
+}
+
+bool OutputFormatContext::requiresGlobalHeader() const {
+	assert(get().oformat);
+	return get().oformat->flags & AVFMT_GLOBALHEADER;
+}
+
+void OutputFormatContext::setIOContext(AVIOContext* ioContext) {
+	get().pb = ioContext;
+	get().flags |= AVFMT_FLAG_CUSTOM_IO;
+}
+
+
+int OutputFormatContext::writeHeader() {
+	return avformat_write_header(&get(), nullptr);
+}
+
+int OutputFormatContext::writePacket(Packet& pkt) {
+	return av_write_frame(
+		&get(),					//AVOutputFormatContext handle
+		static_cast<Packet::Handle>(pkt) //Packet handle
+	);
+}
+
+int OutputFormatContext::writeTrailer() {
+	return av_write_trailer(&get());
+}
+
+int OutputFormatContext::flush() {
+	//Passing a null packet flushes the data buffered in the muxer
+	return av_write_frame(&get(), nullptr);
+}
+
+
+
+AVFormatContext& OutputFormatContext::get() {
+	assert(m_handle);
+	return *m_handle;
+}
+
+const AVFormatContext& OutputFormatContext::get() const {
+	assert(m_handle);
+	return *m_handle;
+}
+
+}
\ No newline at end of file
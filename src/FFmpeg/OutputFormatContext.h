@@ -0,0 +1,59 @@
+#pragma once
+
+#include <zuazo/FFmpeg/Packet.h>
+#include <zuazo/FFmpeg/StreamParameters.h>
+#include <zuazo/FFmpeg/CodecParameters.h>
+#include <zuazo/FFmpeg/Enumerations.h>
+
+#include <zuazo/Utils/BufferView.h>
+#include <zuazo/Math/Rational.h>
+
+#include <cstddef>
+
+struct AVFormatContext;
+struct AVIOContext;
+
+namespace Zuazo::FFmpeg {
+
+class OutputFormatContext {
+public:
+	using Handle = AVFormatContext*;
+	using ConstHandle = const AVFormatContext*;
+
+	using Streams = Utils::BufferView<const StreamParameters>;
+
+	OutputFormatContext();
+	OutputFormatContext(const char* url, const char* format = nullptr);
+	OutputFormatContext(const OutputFormatContext& other) = delete;
+	OutputFormatContext(OutputFormatContext&& other);
+	~OutputFormatContext();
+
+	OutputFormatContext& 				operator=(const OutputFormatContext& other) = delete;
+	OutputFormatContext&				operator=(OutputFormatContext&& other);
+
+	operator Handle();
+	operator ConstHandle() const;
+
+	void								swap(OutputFormatContext& other);
+
+	Streams 							getStreams() const;
+	int									addStream(const CodecParameters& codecPar, Math::Rational<int> timeBase);
+
+	bool								requiresIOContext() const;
+	bool								requiresGlobalHeader() const;
+	void								setIOContext(AVIOContext* ioContext);
+
+	int									writeHeader();
+	int									writePacket(Packet& pkt);
+	int									writeTrailer();
+	int									flush();
+
+private:
+	Handle								m_handle;
+
+	AVFormatContext&					get();
+	const AVFormatContext&				get() const;
+	
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include "OutputIOContext.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/Utils/Functions.h>
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+extern "C" {
+	#include <libavformat/avio.h>
+	#include <libavutil/mem.h>
+}
+
+namespace Zuazo::FFmpeg {
+
+/*
+ * OutputIOContext::Writer
+ */
+
+struct OutputIOContext::Writer {
+	struct Operation {
+		std::vector<uint8_t>	data;
+		int64_t					seekPosition; //Negative if it is a write operation
+	};
+
+	AVIOContext*				file;
+	bool						threaded;
+	size_t						maxPendingBytes;
+
+	int64_t						position;
+	int64_t						size;
+	int							error;
+
+	std::mutex					mutex;
+	std::condition_variable		cond;
+	std::deque<Operation>		operations;
+	std::vector<std::vector<uint8_t>> freeBlocks;
+	size_t						pendingBytes;
+	bool						busy;
+	bool						exit;
+	std::thread					writingThread;
+
+	Writer(const char* url, size_t bufferSize, bool threaded, size_t maxPendingBuffers)
+		: file(nullptr)
+		, threaded(threaded)
+		, maxPendingBytes(bufferSize * std::max(maxPendingBuffers, size_t(1)))
+		, position(0)
+		, size(0)
+		, error(0)
+		, pendingBytes(0)
+		, busy(false)
+		, exit(false)
+	{
+		if(avio_open(&file, url, AVIO_FLAG_WRITE) < 0) {
+			throw Exception("Unable to open the output for file: " + std::string(url));
+		}
+
+		if(threaded) {
+			writingThread = std::thread(&Writer::writingThreadFunc, std::ref(*this));
+		}
+	}
+
+	~Writer() {
+		if(threaded) {
+			//Stop the writing thread once it has finished its work
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				exit = true;
+			}
+			cond.notify_all();
+
+			assert(writingThread.joinable());
+			writingThread.join();
+		}
+
+		avio_closep(&file);
+	}
+
+	int write(const uint8_t* buf, int bufSize) {
+		assert(buf);
+		assert(bufSize >= 0);
+
+		if(threaded) {
+			std::unique_lock<std::mutex> lock(mutex);
+
+			//Only block if the disk has fallen very far behind
+			cond.wait(lock, [this] { return pendingBytes < maxPendingBytes || error < 0; });
+			if(error < 0) {
+				return error;
+			}
+
+			//Reuse a previously allocated block if possible
+			Operation operation;
+			if(!freeBlocks.empty()) {
+				operation.data = std::move(freeBlocks.back());
+				freeBlocks.pop_back();
+			}
+			operation.data.assign(buf, buf + bufSize);
+			operation.seekPosition = -1;
+
+			pendingBytes += bufSize;
+			operations.push_back(std::move(operation));
+			lock.unlock();
+			cond.notify_all();
+		} else {
+			avio_write(file, buf, bufSize);
+			if(file->error < 0) {
+				return file->error;
+			}
+		}
+
+		position += bufSize;
+		size = std::max(size, position);
+		return bufSize;
+	}
+
+	int64_t seek(int64_t offset, int whence) {
+		if(whence & AVSEEK_SIZE) {
+			return size;
+		}
+
+		int64_t target;
+		switch(whence & ~AVSEEK_FORCE) {
+		case SEEK_SET: target = offset; break;
+		case SEEK_CUR: target = position + offset; break;
+		case SEEK_END: target = size + offset; break;
+		default: return AVERROR(EINVAL);
+		}
+
+		if(threaded) {
+			//Seeks are enqueued as well, so that they are ordered with respect to the writes
+			std::unique_lock<std::mutex> lock(mutex);
+			if(error < 0) {
+				return error;
+			}
+
+			operations.push_back(Operation{ {}, target });
+			lock.unlock();
+			cond.notify_all();
+		} else {
+			const auto result = avio_seek(file, target, SEEK_SET);
+			if(result < 0) {
+				return result;
+			}
+		}
+
+		position = target;
+		return target;
+	}
+
+	int flush() {
+		if(threaded) {
+			//Wait until everything has been written
+			std::unique_lock<std::mutex> lock(mutex);
+			cond.wait(lock, [this] { return (operations.empty() && !busy) || error < 0; });
+			if(error < 0) {
+				return error;
+			}
+		}
+
+		avio_flush(file);
+		return file->error;
+	}
+
+	static int writeCallback(void* opaque, uint8_t* buf, int bufSize) {
+		assert(opaque);
+		return static_cast<Writer*>(opaque)->write(buf, bufSize);
+	}
+
+	static int64_t seekCallback(void* opaque, int64_t offset, int whence) {
+		assert(opaque);
+		return static_cast<Writer*>(opaque)->seek(offset, whence);
+	}
+
+private:
+	void writingThreadFunc() {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while(!(exit && operations.empty())) {
+			if(!operations.empty()) {
+				auto operation = std::move(operations.front());
+				operations.pop_front();
+				busy = true;
+
+				//Access the disk in a unlocked environment
+				lock.unlock();
+				if(operation.seekPosition >= 0) {
+					avio_seek(file, operation.seekPosition, SEEK_SET);
+				} else {
+					avio_write(file, operation.data.data(), operation.data.size());
+				}
+				lock.lock();
+
+				if(file->error < 0) {
+					error = file->error;
+				}
+
+				//Recycle the block
+				pendingBytes -= operation.data.size();
+				if(operation.data.capacity() > 0 && freeBlocks.size() < 4) {
+					operation.data.clear();
+					freeBlocks.push_back(std::move(operation.data));
+				}
+
+				busy = false;
+				cond.notify_all();
+			} else {
+				cond.wait(lock);
+			}
+		}
+	}
+};
+
+
+
+/*
+ * OutputIOContext
+ */
+
+OutputIOContext::OutputIOContext()
+	: m_handle(nullptr)
+	, m_writer()
+{
+}
+
+OutputIOContext::OutputIOContext(	const char* url,
+									size_t bufferSize,
+									bool threaded,
+									size_t maxPendingBuffers )
+	: m_handle(nullptr)
+	, m_writer(Utils::makeUnique<Writer>(url, bufferSize, threaded, maxPendingBuffers))
+{
+	auto* buffer = static_cast<unsigned char*>(av_malloc(bufferSize));
+	if(!buffer) {
+		throw Exception("Unable to allocate the output buffer");
+	}
+
+	m_handle = avio_alloc_context(
+		buffer,					//Buffer
+		bufferSize,				//Buffer size
+		1,						//Write flag
+		m_writer.get(),			//Opaque
+		nullptr,				//Read callback
+		Writer::writeCallback,	//Write callback
+		Writer::seekCallback	//Seek callback
+	);
+
+	if(!m_handle) {
+		av_free(buffer);
+		throw Exception("Unable to allocate the output IO context");
+	}
+
+	//At this point it should have been successful
+	assert(m_handle);
+}
+
+OutputIOContext::OutputIOContext(OutputIOContext&& other)
+	: m_handle(other.m_handle)
+	, m_writer(std::move(other.m_writer))
+{
+	other.m_handle = nullptr;
+}
+
+OutputIOContext::~OutputIOContext() {
+	if(m_handle) {
+		//Write the remaining data before closing
+		flush();
+		av_freep(&m_handle->buffer);
+		avio_context_free(&m_handle);
+	}
+}
+
+
+
+OutputIOContext& OutputIOContext::operator=(OutputIOContext&& other) {
+	OutputIOContext(std::move(other)).swap(*this);
+	return *this;
+}
+
+
+
+void OutputIOContext::swap(OutputIOContext& other) {
+	std::swap(m_handle, other.m_handle);
+	std::swap(m_writer, other.m_writer);
+}
+
+
+
+OutputIOContext::operator Handle() {
+	return m_handle;
+}
+
+OutputIOContext::operator ConstHandle() const {
+	return m_handle;
+}
+
+
+
+int OutputIOContext::flush() {
+	avio_flush(&get());
+	assert(m_writer);
+	return m_writer->flush();
+}
+
+
+
+AVIOContext& OutputIOContext::get() {
+	assert(m_handle);
+	return *m_handle;
+}
+
+const AVIOContext& OutputIOContext::get() const {
+	assert(m_handle);
+	return *m_handle;
+}
+
+}
\ No newline at end of file
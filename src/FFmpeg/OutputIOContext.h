@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+struct AVIOContext;
+
+namespace Zuazo::FFmpeg {
+
+class OutputIOContext {
+public:
+	using Handle = AVIOContext*;
+	using ConstHandle = const AVIOContext*;
+
+	static constexpr size_t DEFAULT_BUFFER_SIZE = 4 << 20; //4MiB
+	static constexpr size_t DEFAULT_MAX_PENDING_BUFFERS = 16;
+
+	OutputIOContext();
+	OutputIOContext(const char* url, 
+					size_t bufferSize = DEFAULT_BUFFER_SIZE, 
+					bool threaded = true,
+					size_t maxPendingBuffers = DEFAULT_MAX_PENDING_BUFFERS );
+	OutputIOContext(const OutputIOContext& other) = delete;
+	OutputIOContext(OutputIOContext&& other);
+	~OutputIOContext();
+
+	OutputIOContext& 					operator=(const OutputIOContext& other) = delete;
+	OutputIOContext&					operator=(OutputIOContext&& other);
+
+	operator Handle();
+	operator ConstHandle() const;
+
+	void								swap(OutputIOContext& other);
+
+	int									flush();
+
+private:
+	struct Writer;
+
+	Handle								m_handle;
+	std::unique_ptr<Writer>				m_writer;
+
+	AVIOContext&						get();
+	const AVIOContext&					get() const;
+
+};
+
+}
\ No newline at end of file
@@ -69,6 +69,12 @@ void Packet::swap(Packet& other) {
 
 
 
+int Packet::ref(const Packet& other) {
+	//Shares the data buffer of the other packet, no copies involved
+	unref();
+	return av_packet_ref(&get(), &other.get());
+}
+
 void Packet::unref() {
 	av_packet_unref(&get());
 }
@@ -120,6 +126,15 @@ int Packet::getStreamIndex() const {
 }
 
 
+void Packet::setFlags(PacketFlags flags) {
+	get().flags = static_cast<int>(flags);
+}
+
+PacketFlags Packet::getFlags() const {
+	return static_cast<PacketFlags>(get().flags);
+}
+
+
 Utils::BufferView<std::byte> Packet::getData() {
 	return Utils::BufferView<std::byte>(reinterpret_cast<std::byte*>(get().data), get().size);
 }
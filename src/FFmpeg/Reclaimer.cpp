@@ -0,0 +1,110 @@
+#include "Reclaimer.h"
+
+#include "Tracing.h"
+
+#include <cassert>
+#include <system_error>
+#include <unordered_map>
+
+namespace Zuazo::FFmpeg {
+
+/*
+ * Reclaimer
+ */
+
+Reclaimer::Reclaimer()
+	: m_mutex()
+	, m_condition()
+	, m_queue()
+	, m_exit(false)
+	, m_thread()
+{
+	m_thread = std::thread(&Reclaimer::threadFunc, this);
+}
+
+Reclaimer::~Reclaimer() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+
+	//The thread drains the queue before exiting
+	m_condition.notify_all();
+	assert(m_thread.joinable());
+	m_thread.join();
+}
+
+
+
+bool Reclaimer::schedule(ClientRef client) noexcept {
+	try {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(client));
+	} catch(...) {
+		return false;
+	}
+
+	m_condition.notify_one();
+	return true;
+}
+
+
+
+std::shared_ptr<Reclaimer> Reclaimer::getShared(const void* owner) {
+	static std::mutex mutex;
+	static std::unordered_map<const void*, std::weak_ptr<Reclaimer>> reclaimers;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Drop the reclaimers which are no longer in use
+	for(auto ite = reclaimers.begin(); ite != reclaimers.end(); ) {
+		ite = ite->second.expired() ? reclaimers.erase(ite) : std::next(ite);
+	}
+
+	auto& entry = reclaimers[owner];
+	auto result = entry.lock();
+	if(!result) {
+		try {
+			result = std::make_shared<Reclaimer>();
+			entry = result;
+		} catch(const std::system_error&) {
+			//Could not launch the thread. Elements will be unreferenced by the pools
+			reclaimers.erase(owner);
+		}
+	}
+
+	return result;
+}
+
+
+
+void Reclaimer::threadFunc() {
+	Tracing::setThreadName("FFmpeg reclaimer");
+	std::vector<ClientRef> batch;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while(!m_exit || !m_queue.empty()) {
+		if(!m_queue.empty()) {
+			//Take all the queued clients at once. Swapping keeps both allocations around
+			batch.swap(m_queue);
+
+			//Reclaim in a unlocked environment
+			lock.unlock();
+			{
+				ZUAZO_FFMPEG_TRACE_SCOPE("Reclaimer::reclaim");
+				for(auto& client : batch) {
+					const auto ptr = client.lock();
+					if(ptr) {
+						ptr->reclaim();
+					}
+				}
+			}
+			batch.clear();
+			lock.lock();
+		} else {
+			m_condition.wait(lock);
+		}
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Zuazo::FFmpeg {
+
+//Background thread where the released frames and packets are unreferenced,
+//so that threads dropping them (i.e. the rendering thread) do not free
+//buffers or hardware surfaces. Clients are queued when they have work
+//pending and serviced in batches. A single reclaimer is shared by all the
+//pools of the same owner
+class Reclaimer {
+public:
+	class Client {
+	public:
+		virtual ~Client() = default;
+
+		virtual void						reclaim() noexcept = 0;
+	};
+
+	using ClientRef = std::weak_ptr<Client>;
+
+	Reclaimer();
+	Reclaimer(const Reclaimer& other) = delete;
+	Reclaimer(Reclaimer&& other) = delete;
+	~Reclaimer();
+
+	Reclaimer&							operator=(const Reclaimer& other) = delete;
+	Reclaimer&							operator=(Reclaimer&& other) = delete;
+
+	//Returns false if it could not be queued
+	bool								schedule(ClientRef client) noexcept;
+
+	//Returns the reclaimer shared by all the pools with the same owner.
+	//nullptr if the thread can not be created
+	static std::shared_ptr<Reclaimer>	getShared(const void* owner);
+
+private:
+	std::mutex							m_mutex;
+	std::condition_variable				m_condition;
+	std::vector<ClientRef>				m_queue;
+	bool								m_exit;
+	std::thread							m_thread;
+
+	void								threadFunc();
+
+};
+
+}
\ No newline at end of file
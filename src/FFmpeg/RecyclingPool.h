@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Reclaimer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Zuazo::FFmpeg {
+
+//Pool of Frames or Packets handed out as shared pointers. Each slot stores
+//the element along with room for the control block of the shared pointer,
+//so once a slot exists, acquiring it again does not allocate. Released
+//slots are queued on a recycle list without unreferencing their contents,
+//which is done when acquired again, by calling recycle() or on the thread
+//of a reclaimer. This way, the thread releasing the last reference does not
+//pay for it
+template<typename T>
+class RecyclingPool {
+public:
+	using Element = std::shared_ptr<T>;
+
+	static constexpr size_t DEFAULT_MAX_PENDING = 4; //Buffers may belong to a bounded hardware pool
+
+	explicit RecyclingPool(bool unref = true, size_t maxPending = DEFAULT_MAX_PENDING);
+	explicit RecyclingPool(std::shared_ptr<Reclaimer> reclaimer, size_t maxPending = DEFAULT_MAX_PENDING);
+	RecyclingPool(const RecyclingPool& other) = delete;
+	RecyclingPool(RecyclingPool&& other) = default;
+	~RecyclingPool();
+
+	RecyclingPool&						operator=(const RecyclingPool& other) = delete;
+	RecyclingPool&						operator=(RecyclingPool&& other);
+
+	Element								acquire();
+
+	//Unreferences the released elements. May be called from any thread
+	void								recycle();
+
+private:
+	struct State;
+
+	//Control blocks of libstdc++ and libc++ are well below this
+	static constexpr size_t CONTROL_BLOCK_SIZE = 64;
+
+	struct Slot {
+		std::aligned_storage_t<CONTROL_BLOCK_SIZE, alignof(std::max_align_t)> controlBlock;
+		T								element;
+		std::shared_ptr<State>			state;
+		bool							pending; //Released but not unreferenced yet
+	};
+
+	struct State : Reclaimer::Client {
+		std::mutex						mutex;
+		std::vector<Slot*>				released;
+		size_t							pendingCount;
+		size_t							maxPending;
+		bool							unref;
+		bool							alive; //Cleared when the pool is destroyed
+		std::weak_ptr<Reclaimer>		reclaimer; //Not owned, as it may release the state on its thread
+		bool							scheduled;
+
+		void							reclaim() noexcept override;
+	};
+
+	//Places the control block inside the slot
+	template<typename U>
+	struct Allocator {
+		using value_type = U;
+
+		Slot*							slot;
+
+		explicit Allocator(Slot* slot) noexcept : slot(slot) {}
+		template<typename V>
+		Allocator(const Allocator<V>& other) noexcept : slot(other.slot) {}
+
+		U*								allocate(size_t n);
+		void							deallocate(U* ptr, size_t n) noexcept;
+
+		template<typename V>
+		bool operator==(const Allocator<V>& other) const noexcept { return slot == other.slot; }
+		template<typename V>
+		bool operator!=(const Allocator<V>& other) const noexcept { return slot != other.slot; }
+	};
+
+	struct Deleter {
+		void operator()(T*) const noexcept {} //Released when the control block is deallocated
+	};
+
+	std::shared_ptr<State>				m_state;
+	std::shared_ptr<Reclaimer>			m_reclaimer;
+
+	static void							release(Slot* slot) noexcept;
+
+};
+
+}
+
+#include "RecyclingPool.inl"
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "RecyclingPool.h"
+
+namespace Zuazo::FFmpeg {
+
+/*
+ * RecyclingPool
+ */
+
+template<typename T>
+inline RecyclingPool<T>::RecyclingPool(bool unref, size_t maxPending)
+	: m_state(std::make_shared<State>())
+{
+	m_state->pendingCount = 0;
+	m_state->maxPending = maxPending;
+	m_state->unref = unref;
+	m_state->alive = true;
+	m_state->scheduled = false;
+}
+
+template<typename T>
+inline RecyclingPool<T>::RecyclingPool(std::shared_ptr<Reclaimer> reclaimer, size_t maxPending)
+	: RecyclingPool(true, maxPending)
+{
+	m_reclaimer = std::move(reclaimer);
+	m_state->reclaimer = m_reclaimer;
+}
+
+template<typename T>
+inline RecyclingPool<T>::~RecyclingPool() {
+	if(m_state) {
+		std::vector<Slot*> slots;
+
+		{
+			//Slots in use will be deleted when released
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			m_state->alive = false;
+			slots.swap(m_state->released);
+		}
+
+		for(auto* slot : slots) {
+			delete slot;
+		}
+	}
+}
+
+
+
+template<typename T>
+inline RecyclingPool<T>& RecyclingPool<T>::operator=(RecyclingPool&& other) {
+	//Let the temporary release the current state
+	RecyclingPool tmp(std::move(other));
+	std::swap(m_state, tmp.m_state);
+	std::swap(m_reclaimer, tmp.m_reclaimer);
+	return *this;
+}
+
+
+
+template<typename T>
+inline typename RecyclingPool<T>::Element RecyclingPool<T>::acquire() {
+	assert(m_state);
+	Slot* slot = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		if(!m_state->released.empty()) {
+			slot = m_state->released.back();
+			m_state->released.pop_back();
+			if(slot->pending) {
+				--m_state->pendingCount;
+			}
+		}
+	}
+
+	if(slot) {
+		//Unreference what was left by the previous user
+		if(slot->pending) {
+			slot->element.unref();
+			slot->pending = false;
+		}
+	} else {
+		slot = new Slot();
+		slot->state = m_state;
+		slot->pending = false;
+	}
+
+	assert(slot);
+	try {
+		return Element(&slot->element, Deleter(), Allocator<T>(slot));
+	} catch(...) {
+		delete slot;
+		throw;
+	}
+}
+
+template<typename T>
+inline void RecyclingPool<T>::recycle() {
+	assert(m_state);
+	m_state->reclaim();
+}
+
+
+
+template<typename T>
+inline void RecyclingPool<T>::State::reclaim() noexcept {
+	std::vector<Slot*> slots;
+
+	{
+		//Take them out of the list, so that they are not acquired meanwhile
+		std::lock_guard<std::mutex> lock(mutex);
+		scheduled = false;
+
+		const auto ite = std::partition(
+			released.begin(), released.end(),
+			[] (const Slot* slot) -> bool {
+				return !slot->pending;
+			}
+		);
+
+		try {
+			slots.assign(ite, released.end());
+		} catch(...) {
+			return; //Leave them for acquire()
+		}
+
+		released.erase(ite, released.end());
+		pendingCount = 0;
+	}
+
+	for(auto* slot : slots) {
+		slot->element.unref();
+		slot->pending = false;
+	}
+
+	if(!slots.empty()) {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if(alive) {
+			try {
+				released.insert(released.end(), slots.cbegin(), slots.cend());
+				slots.clear();
+			} catch(...) {
+				//Could not store them. Delete them below
+			}
+		}
+
+		lock.unlock();
+		for(auto* slot : slots) {
+			delete slot;
+		}
+	}
+}
+
+
+
+template<typename T>
+inline void RecyclingPool<T>::release(Slot* slot) noexcept {
+	assert(slot);
+	assert(slot->state);
+	auto& state = *(slot->state);
+	std::unique_lock<std::mutex> lock(state.mutex);
+
+	if(state.unref) {
+		if(state.pendingCount < state.maxPending) {
+			//Defer it
+			slot->pending = true;
+			++state.pendingCount;
+		} else {
+			//Too many buffers held. Do it here
+			lock.unlock();
+			slot->element.unref();
+			lock.lock();
+		}
+	}
+
+	//Note that the state may be destroyed when deleting the slot
+	if(!state.alive) {
+		lock.unlock();
+		delete slot;
+		return;
+	}
+
+	try {
+		state.released.push_back(slot);
+	} catch(...) {
+		if(slot->pending) {
+			--state.pendingCount;
+		}
+
+		lock.unlock();
+		delete slot;
+		return;
+	}
+
+	//Hand the unref to the reclaimer. The slot must not be used after unlocking
+	std::shared_ptr<Reclaimer> reclaimer;
+	std::weak_ptr<State> client;
+	if(slot->pending && !state.scheduled) {
+		reclaimer = state.reclaimer.lock();
+		if(reclaimer) {
+			client = slot->state;
+			state.scheduled = true;
+		}
+	}
+
+	lock.unlock();
+
+	if(reclaimer && !reclaimer->schedule(client)) {
+		//Leave it for acquire()
+		const auto ptr = client.lock();
+		if(ptr) {
+			std::lock_guard<std::mutex> lock(ptr->mutex);
+			ptr->scheduled = false;
+		}
+	}
+}
+
+
+
+template<typename T>
+template<typename U>
+inline U* RecyclingPool<T>::Allocator<U>::allocate(size_t n) {
+	if(sizeof(U) * n <= sizeof(slot->controlBlock) && alignof(U) <= alignof(decltype(slot->controlBlock))) {
+		return reinterpret_cast<U*>(&slot->controlBlock);
+	}
+
+	//Does not fit. Should not happen with mainstream implementations
+	return static_cast<U*>(::operator new(sizeof(U) * n));
+}
+
+template<typename T>
+template<typename U>
+inline void RecyclingPool<T>::Allocator<U>::deallocate(U* ptr, size_t) noexcept {
+	if(static_cast<void*>(ptr) != static_cast<void*>(&slot->controlBlock)) {
+		::operator delete(ptr);
+	}
+
+	//The element is no longer referenced
+	RecyclingPool<T>::release(slot);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,684 @@
+#include "SegmentedInputContext.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/Utils/Functions.h>
+#include <zuazo/Math/Comparisons.h>
+
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <fstream>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+extern "C" {
+	#include <libavutil/avutil.h>
+	#include <libavutil/mathematics.h>
+}
+
+namespace Zuazo::FFmpeg {
+
+static constexpr auto RESCAN_INTERVAL = std::chrono::milliseconds(250);
+static constexpr AVRational MICROSECONDS = { 1, 1000000 }; //Same as FFmpeg::Duration
+
+
+
+/*
+ * SegmentedInputContext::Playlist
+ */
+
+struct SegmentedInputContext::Playlist {
+	enum class Source {
+		list,
+		directory,
+		manifest
+	};
+
+	struct Entry {
+		std::string								path;
+		std::optional<Duration>					duration; //Unknown until opened
+		bool									exact; //Measured after reading it completely
+	};
+
+	struct Segment {
+		size_t									index;
+		std::unique_ptr<InputIOContext>			ioContext; //Declared first, so that it outlives formatContext
+		InputFormatContext						formatContext;
+		Duration								startTime;
+		Duration								endTime; //Latest timestamp seen
+		Duration								offset; //Position in the timeline, relative to its origin
+	};
+
+	using SegmentPtr = std::shared_ptr<Segment>;
+
+	Source									source;
+	std::string								url;
+	Options									options;
+	InterruptCallback						interruptCbk;
+	void*									interruptOpaque;
+	IOSettings								ioSettings;
+
+	mutable std::mutex						mutex; //Following a file may scan from other threads
+	std::vector<Entry>						entries;
+	bool									ended;
+	std::chrono::steady_clock::time_point	lastScan;
+
+	SegmentPtr								reference; //First opened segment. Streams and the origin of the timeline are described by it
+	SegmentPtr								current;
+	size_t									nextIndex;
+	std::future<SegmentPtr>					next; //Declared last, so that it is joined first
+
+	Playlist(	Source source,
+				std::string url,
+				Segments segments,
+				const Options& options,
+				InterruptCallback interruptCbk,
+				void* interruptOpaque,
+				IOSettings ioSettings )
+		: source(source)
+		, url(std::move(url))
+		, options(options)
+		, interruptCbk(interruptCbk)
+		, interruptOpaque(interruptOpaque)
+		, ioSettings(std::move(ioSettings))
+		, entries()
+		, ended(false)
+		, lastScan()
+		, reference()
+		, current()
+		, nextIndex(0)
+		, next()
+	{
+		entries.reserve(segments.size());
+		for(auto& segment : segments) {
+			entries.push_back(Entry{ std::move(segment), std::nullopt, false });
+		}
+
+		scan();
+		if(entries.empty()) {
+			throw Exception("No segments found for: " + this->url);
+		}
+
+		//May throw!
+		activate(openSegment(0, entries.front().path));
+		assert(reference);
+		assert(current);
+	}
+
+	~Playlist() = default;
+
+
+	Streams getStreams() const {
+		assert(reference);
+		return reference->formatContext.getStreams();
+	}
+
+	int findBestStream(MediaType type) const {
+		assert(reference);
+		return reference->formatContext.findBestStream(type);
+	}
+
+	Duration getDuration() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return getOffset(entries.size());
+	}
+
+	size_t getSegmentCount() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return entries.size();
+	}
+
+	int getCurrentSegment() const {
+		return current ? static_cast<int>(current->index) : -1;
+	}
+
+
+	int seek(int stream, int64_t timestamp, SeekFlags flags) {
+		if(stream < 0) {
+			return seek(Duration(timestamp), flags);
+		}
+
+		//Convert it into the timeline
+		const auto streams = getStreams();
+		if(static_cast<size_t>(stream) >= streams.size()) {
+			return AVERROR(EINVAL);
+		}
+
+		const auto timeBase = toAVRational(streams[stream].getTimeBase());
+		return seek(Duration(av_rescale_q(timestamp, timeBase, MICROSECONDS)), flags);
+	}
+
+	int seek(Duration timestamp, SeekFlags flags) {
+		if((flags & (SeekFlags::byte | SeekFlags::frame)) != SeekFlags::none) {
+			return AVERROR(ENOSYS); //Meaningless across segments
+		}
+
+		//Timestamps are given in the timeline of the reference segment
+		timestamp -= getOrigin();
+
+		size_t index;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			index = findSegment(timestamp);
+		}
+
+		SegmentPtr segment;
+		try {
+			segment = acquire(index);
+		} catch(const Exception&) {
+			return AVERROR(EIO);
+		}
+
+		if(segment != current) {
+			activate(std::move(segment));
+		}
+
+		assert(current);
+		return current->formatContext.seek(timestamp - current->offset + current->startTime, flags);
+	}
+
+	int readPacket(Packet& packet) {
+		while(current) {
+			const auto result = current->formatContext.readPacket(packet);
+			if(result == 0) {
+				rebase(*current, packet);
+				return 0;
+			} else if(result != AVERROR_EOF) {
+				return result;
+			}
+
+			//End of this segment. Continue with the next one
+			finish(*current);
+			if(!advance()) {
+				break;
+			}
+		}
+
+		return AVERROR_EOF;
+	}
+
+	int flush() {
+		return current ? current->formatContext.flush() : 0;
+	}
+
+private:
+	Duration getOrigin() const {
+		//Keep the start time of the first segment, so that the timestamps
+		//match the start time reported by its streams
+		assert(reference);
+		return reference->startTime;
+	}
+
+	bool advance() {
+		assert(current);
+
+		for(auto index = current->index + 1; ; ++index) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if(index >= entries.size() && !ended) {
+					scan(); //Look for new segments
+				}
+
+				if(index >= entries.size()) {
+					return false;
+				}
+			}
+
+			try {
+				activate(acquire(index));
+				return true;
+			} catch(const Exception&) {
+				//Unable to open it. Leave it out of the timeline
+				std::lock_guard<std::mutex> lock(mutex);
+				entries[index].duration = Duration::zero();
+				entries[index].exact = true;
+			}
+		}
+	}
+
+	SegmentPtr acquire(size_t index) {
+		if(current && current->index == index) {
+			return current;
+		}
+
+		//Use the preloaded one if possible
+		if(next.valid() && nextIndex == index) {
+			auto result = next.get();
+			if(result) {
+				return result;
+			}
+		}
+
+		std::string path;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			assert(index < entries.size());
+			path = entries[index].path;
+		}
+
+		return openSegment(index, path); //May throw
+	}
+
+	void activate(SegmentPtr segment) {
+		assert(segment);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto& entry = entries[segment->index];
+			if(!entry.exact) {
+				const auto duration = segment->formatContext.getDuration();
+				if(duration.count() != AV_NOPTS_VALUE && duration > Duration::zero()) {
+					entry.duration = duration;
+				}
+			}
+
+			segment->offset = getOffset(segment->index);
+		}
+
+		current = std::move(segment);
+		if(!reference) {
+			reference = current;
+		}
+
+		//Open the next one ahead of time
+		preload(current->index + 1);
+	}
+
+	void finish(const Segment& segment) {
+		//Now the actual duration is known
+		std::lock_guard<std::mutex> lock(mutex);
+		auto& entry = entries[segment.index];
+		entry.duration = Math::max(segment.endTime - segment.startTime, Duration::zero());
+		entry.exact = true;
+	}
+
+	void preload(size_t index) {
+		std::string path;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(index >= entries.size()) {
+				return; //Not listed yet
+			}
+
+			path = entries[index].path;
+		}
+
+		if(next.valid() && nextIndex == index) {
+			return; //Already loading
+		}
+
+		nextIndex = index;
+		next = std::async(
+			std::launch::async,
+			[this, index, path] () -> SegmentPtr {
+				try {
+					return openSegment(index, path);
+				} catch(const Exception&) {
+					return nullptr; //It will be retried when needed
+				}
+			}
+		);
+	}
+
+	SegmentPtr openSegment(size_t index, const std::string& path) {
+		auto result = std::make_shared<Segment>();
+		result->index = index;
+
+		//Always use our own IO context, so that growing files can be followed
+		result->ioContext = Utils::makeUnique<InputIOContext>(path.c_str(), ioSettings.ring, ioSettings.direct);
+		if(ioSettings.followTimeout > Duration::zero()) {
+			result->ioContext->setFollowCallback(
+				std::bind(&Playlist::isGrowing, this, index),
+				ioSettings.followTimeout
+			);
+		}
+
+		result->formatContext = InputFormatContext(
+			path.c_str(),
+			options,
+			interruptCbk,
+			interruptOpaque,
+			*result->ioContext
+		);
+
+		const auto startTime = result->formatContext.getStartTime();
+		result->startTime = (startTime.count() != AV_NOPTS_VALUE) ? startTime : Duration::zero();
+		result->endTime = result->startTime;
+		result->offset = Duration::zero();
+
+		return result;
+	}
+
+	bool isGrowing(size_t index) {
+		//Only the last segment of an unfinished list may be being written
+		std::lock_guard<std::mutex> lock(mutex);
+		if(index + 1 < entries.size() || ended) {
+			return false;
+		}
+
+		if(std::chrono::steady_clock::now() - lastScan >= RESCAN_INTERVAL) {
+			scan();
+		}
+
+		return index + 1 >= entries.size() && !ended;
+	}
+
+	void rebase(Segment& segment, Packet& packet) const {
+		assert(reference);
+
+		const auto streamIndex = packet.getStreamIndex();
+		const auto srcStreams = segment.formatContext.getStreams();
+		const auto dstStreams = reference->formatContext.getStreams();
+		if(streamIndex < 0 || static_cast<size_t>(streamIndex) >= Math::min(srcStreams.size(), dstStreams.size())) {
+			return;
+		}
+
+		const auto srcTimeBase = toAVRational(srcStreams[streamIndex].getTimeBase());
+		const auto dstTimeBase = toAVRational(dstStreams[streamIndex].getTimeBase());
+		const auto pts = packet.getPTS();
+		const auto dts = packet.getDTS();
+
+		//Keep track of the end of the segment
+		const auto timeStamp = (pts != AV_NOPTS_VALUE) ? pts : dts;
+		if(timeStamp != AV_NOPTS_VALUE) {
+			const auto end = av_rescale_q(timeStamp + Math::max(packet.getDuration(), int64_t(0)), srcTimeBase, MICROSECONDS);
+			segment.endTime = Math::max(segment.endTime, Duration(end));
+		}
+
+		//Place it in the timeline
+		const auto shift = av_rescale_q((getOrigin() + segment.offset - segment.startTime).count(), MICROSECONDS, dstTimeBase);
+		if(pts != AV_NOPTS_VALUE) {
+			packet.setPTS(av_rescale_q(pts, srcTimeBase, dstTimeBase) + shift);
+		}
+		if(dts != AV_NOPTS_VALUE) {
+			packet.setDTS(av_rescale_q(dts, srcTimeBase, dstTimeBase) + shift);
+		}
+		packet.setDuration(av_rescale_q(packet.getDuration(), srcTimeBase, dstTimeBase));
+	}
+
+	size_t findSegment(Duration timestamp) const {
+		assert(!entries.empty());
+
+		const auto estimate = getEstimatedDuration();
+		auto offset = Duration::zero();
+		for(size_t i = 0; i < entries.size(); ++i) {
+			offset += entries[i].duration.value_or(estimate);
+			if(timestamp < offset) {
+				return i;
+			}
+		}
+
+		return entries.size() - 1;
+	}
+
+	Duration getOffset(size_t index) const {
+		const auto estimate = getEstimatedDuration();
+		auto result = Duration::zero();
+		for(size_t i = 0; i < Math::min(index, entries.size()); ++i) {
+			result += entries[i].duration.value_or(estimate);
+		}
+
+		return result;
+	}
+
+	Duration getEstimatedDuration() const {
+		//Average of the known durations
+		auto sum = Duration::zero();
+		size_t count = 0;
+		for(const auto& entry : entries) {
+			if(entry.duration) {
+				sum += *entry.duration;
+				++count;
+			}
+		}
+
+		return count ? sum / static_cast<Duration::rep>(count) : Duration::zero();
+	}
+
+	void scan() {
+		lastScan = std::chrono::steady_clock::now();
+
+		switch(source) {
+		case Source::directory: scanDirectory(); break;
+		case Source::manifest: scanManifest(); break;
+		default: break;
+		}
+	}
+
+	void scanDirectory() {
+		std::vector<std::string> paths;
+
+		auto* dir = opendir(url.c_str());
+		if(dir) {
+			while(const auto* entry = readdir(dir)) {
+				if(entry->d_name[0] == '.') {
+					continue; //Hidden, current and parent
+				}
+
+				auto path = url + '/' + entry->d_name;
+				struct stat info;
+				if(stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+					paths.push_back(std::move(path));
+				}
+			}
+
+			closedir(dir);
+		}
+
+		//Segments are expected to be named in order. Only newer ones are appended
+		std::sort(paths.begin(), paths.end());
+		for(auto& path : paths) {
+			if(entries.empty() || path > entries.back().path) {
+				entries.push_back(Entry{ std::move(path), std::nullopt, false });
+			}
+		}
+	}
+
+	void scanManifest() {
+		std::ifstream file(url);
+		if(!file) {
+			return;
+		}
+
+		const auto separator = url.rfind('/');
+		const auto directory = (separator != std::string::npos) ? url.substr(0, separator + 1) : std::string();
+
+		std::vector<Entry> listed;
+		std::optional<Duration> duration;
+		bool endList = false;
+
+		std::string line;
+		while(std::getline(file, line)) {
+			const bool terminated = !file.eof(); //Otherwise it is the last line
+
+			//Remove trailing whitespace (including CR)
+			while(!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+				line.pop_back();
+			}
+
+			if(line.empty()) {
+				continue;
+			} else if(line.rfind("#EXTINF:", 0) == 0) {
+				const auto seconds = std::strtod(line.c_str() + std::strlen("#EXTINF:"), nullptr);
+				duration = Duration(static_cast<Duration::rep>(seconds * Duration::period::den / Duration::period::num));
+			} else if(line.rfind("#EXT-X-ENDLIST", 0) == 0) {
+				endList = true;
+			} else if(line.front() != '#') {
+				if(line.find("://") == std::string::npos) { //Only local files are supported
+					auto path = (line.front() == '/') ? line : directory + line;
+
+					//An unterminated entry may be partially written. Wait for its file to exist
+					struct stat info;
+					if(!terminated && stat(path.c_str(), &info) != 0) {
+						break;
+					}
+
+					listed.push_back(Entry{ std::move(path), duration, false });
+				}
+				duration.reset();
+			}
+		}
+
+		//The manifest is expected to be only appended
+		for(size_t i = entries.size(); i < listed.size(); ++i) {
+			entries.push_back(std::move(listed[i]));
+		}
+		ended = endList;
+	}
+
+	static AVRational toAVRational(Math::Rational<int> rat) {
+		return AVRational{ rat.getNumerator(), rat.getDenominator() };
+	}
+
+};
+
+
+
+/*
+ * SegmentedInputContext
+ */
+
+SegmentedInputContext::SegmentedInputContext()
+	: m_playlist()
+{
+}
+
+SegmentedInputContext::SegmentedInputContext(	Segments segments,
+												const Options& options,
+												InterruptCallback interruptCbk,
+												void* interruptOpaque,
+												IOSettings ioSettings )
+	: m_playlist(Utils::makeUnique<Playlist>(
+		Playlist::Source::list,
+		segments.empty() ? std::string() : segments.front(),
+		std::move(segments),
+		options,
+		interruptCbk,
+		interruptOpaque,
+		std::move(ioSettings) ))
+{
+}
+
+SegmentedInputContext::SegmentedInputContext(	const char* url,
+												const Options& options,
+												InterruptCallback interruptCbk,
+												void* interruptOpaque,
+												IOSettings ioSettings )
+	: m_playlist()
+{
+	if(!isSegmentedURL(url)) {
+		throw Exception("Not a segmented input: " + std::string(url));
+	}
+
+	const char* path = InputIOContext::getLocalPath(url);
+	assert(path);
+
+	struct stat info;
+	const auto isDirectory = stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+
+	m_playlist = Utils::makeUnique<Playlist>(
+		isDirectory ? Playlist::Source::directory : Playlist::Source::manifest,
+		path,
+		Segments(),
+		options,
+		interruptCbk,
+		interruptOpaque,
+		std::move(ioSettings)
+	);
+}
+
+SegmentedInputContext::SegmentedInputContext(SegmentedInputContext&& other) = default;
+
+SegmentedInputContext::~SegmentedInputContext() = default;
+
+
+
+SegmentedInputContext& SegmentedInputContext::operator=(SegmentedInputContext&& other) = default;
+
+
+
+void SegmentedInputContext::swap(SegmentedInputContext& other) {
+	std::swap(m_playlist, other.m_playlist);
+}
+
+
+
+SegmentedInputContext::Streams SegmentedInputContext::getStreams() const {
+	assert(m_playlist);
+	return m_playlist->getStreams();
+}
+
+int SegmentedInputContext::findBestStream(MediaType type) const {
+	assert(m_playlist);
+	return m_playlist->findBestStream(type);
+}
+
+
+Duration SegmentedInputContext::getDuration() const {
+	assert(m_playlist);
+	return m_playlist->getDuration();
+}
+
+size_t SegmentedInputContext::getSegmentCount() const {
+	return m_playlist ? m_playlist->getSegmentCount() : 0;
+}
+
+int SegmentedInputContext::getCurrentSegment() const {
+	return m_playlist ? m_playlist->getCurrentSegment() : -1;
+}
+
+
+int SegmentedInputContext::seek(int stream, int64_t timestamp, SeekFlags flags) {
+	assert(m_playlist);
+	return m_playlist->seek(stream, timestamp, flags);
+}
+
+int SegmentedInputContext::seek(Duration timestamp, SeekFlags flags) {
+	assert(m_playlist);
+	return m_playlist->seek(timestamp, flags);
+}
+
+int SegmentedInputContext::readPacket(Packet& pkt) {
+	assert(m_playlist);
+	return m_playlist->readPacket(pkt);
+}
+
+int SegmentedInputContext::flush() {
+	assert(m_playlist);
+	return m_playlist->flush();
+}
+
+
+
+bool SegmentedInputContext::isSegmentedURL(const char* url) {
+	const char* path = InputIOContext::getLocalPath(url);
+	if(!path) {
+		return false;
+	}
+
+	struct stat info;
+	if(stat(path, &info) == 0 && S_ISDIR(info.st_mode)) {
+		return true;
+	}
+
+	//Look at the extension
+	const std::string_view pathView(path);
+	for(const std::string_view extension : { ".m3u8", ".m3u" }) {
+		if(	pathView.size() > extension.size() &&
+			pathView.compare(pathView.size() - extension.size(), extension.size(), extension) == 0 )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+}
\ No newline at end of file
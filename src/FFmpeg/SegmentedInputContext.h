@@ -0,0 +1,75 @@
+#pragma once
+
+#include "InputFormatContext.h"
+#include "InputIOContext.h"
+
+#include <zuazo/FFmpeg/Packet.h>
+#include <zuazo/FFmpeg/Enumerations.h>
+#include <zuazo/FFmpeg/Chrono.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Zuazo::FFmpeg {
+
+//Plays a list of local files back to back as a single input with a 
+//continuous timeline. The list may be given explicitly or read from a 
+//directory or a m3u8 style manifest. These are scanned again when the 
+//last segment is reached, so that recordings can be played while written
+class SegmentedInputContext {
+public:
+	using Streams = InputFormatContext::Streams;
+	using Options = InputFormatContext::Options;
+	using InterruptCallback = InputFormatContext::InterruptCallback;
+	using Segments = std::vector<std::string>;
+
+	struct IOSettings {
+		InputIOContext::RingPtr			ring;
+		bool							direct;
+		Duration						followTimeout; //Zero disables following growing files
+	};
+
+	SegmentedInputContext();
+	SegmentedInputContext(	Segments segments,
+							const Options& options,
+							InterruptCallback interruptCbk = nullptr,
+							void* interruptOpaque = nullptr,
+							IOSettings ioSettings = IOSettings() );
+	SegmentedInputContext(	const char* url, //Directory or manifest
+							const Options& options,
+							InterruptCallback interruptCbk = nullptr,
+							void* interruptOpaque = nullptr,
+							IOSettings ioSettings = IOSettings() );
+	SegmentedInputContext(const SegmentedInputContext& other) = delete;
+	SegmentedInputContext(SegmentedInputContext&& other);
+	~SegmentedInputContext();
+
+	SegmentedInputContext& 				operator=(const SegmentedInputContext& other) = delete;
+	SegmentedInputContext&				operator=(SegmentedInputContext&& other);
+
+	void								swap(SegmentedInputContext& other);
+
+	Streams 							getStreams() const;
+	int									findBestStream(MediaType type) const;
+	
+	Duration							getDuration() const;
+	size_t								getSegmentCount() const;
+	int									getCurrentSegment() const; //-1 if none
+
+	int									seek(int stream, int64_t timestamp, SeekFlags flags = SeekFlags::none);
+	int									seek(Duration timestamp, SeekFlags flags = SeekFlags::none);
+	int									readPacket(Packet& pkt);
+	int									flush();
+
+	//True for local directories and m3u8 manifests
+	static bool							isSegmentedURL(const char* url);
+
+private:
+	struct Playlist;
+
+	std::unique_ptr<Playlist>			m_playlist;
+
+};
+
+}
\ No newline at end of file
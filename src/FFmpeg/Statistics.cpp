@@ -0,0 +1,249 @@
+#include <zuazo/FFmpeg/Statistics.h>
+
+#include <zuazo/Utils/Functions.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+
+namespace Zuazo::FFmpeg {
+
+/*
+ * LatencyHistogram
+ */
+
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+
+
+LatencyHistogram::Snapshot LatencyHistogram::getSnapshot() const {
+	Snapshot result;
+
+	//Values are read independently, so the result may be slightly inconsistent if recording concurrently
+	for(size_t i = 0; i < BUCKET_COUNT; ++i) {
+		result.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+	}
+	result.count = m_count.load(std::memory_order_relaxed);
+	result.total = Latency(m_total.load(std::memory_order_relaxed));
+	result.maximum = Latency(m_maximum.load(std::memory_order_relaxed));
+
+	return result;
+}
+
+void LatencyHistogram::reset() {
+	for(auto& bucket : m_buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_total.store(0, std::memory_order_relaxed);
+	m_maximum.store(0, std::memory_order_relaxed);
+}
+
+
+
+LatencyHistogram::Latency LatencyHistogram::Snapshot::getMean() const {
+	return count > 0 ? total / static_cast<Latency::rep>(count) : Latency();
+}
+
+LatencyHistogram::Latency LatencyHistogram::Snapshot::getPercentile(double p) const {
+	//Count the samples in the buckets, as the count may not match exactly
+	uint64_t sampleCount = 0;
+	for(const auto bucket : buckets) {
+		sampleCount += bucket;
+	}
+
+	if(sampleCount == 0) {
+		return Latency();
+	}
+
+	//Find the bucket where the percentile lies. Report its upper bound
+	const auto threshold = static_cast<uint64_t>(std::clamp(p, 0.0, 1.0) * sampleCount);
+	uint64_t accumulated = 0;
+	for(size_t i = 0; i < BUCKET_COUNT; ++i) {
+		accumulated += buckets[i];
+		if(accumulated > threshold || accumulated == sampleCount) {
+			return std::min(getBucketUpperBound(i), maximum);
+		}
+	}
+
+	return maximum;
+}
+
+
+
+/*
+ * Statistics
+ */
+
+Statistics::Statistics(std::string name)
+	: name(std::move(name))
+	, latencies()
+	, counters()
+	, gauges()
+	, children()
+{
+}
+
+void Statistics::addLatency(std::string name, const LatencyHistogram& histogram) {
+	latencies.emplace_back(std::move(name), histogram.getSnapshot());
+}
+
+void Statistics::addCounter(std::string name, const Counter& counter) {
+	counters.emplace_back(std::move(name), counter.get());
+}
+
+void Statistics::addGauge(std::string name, const Gauge& gauge) {
+	auto maximumName = name + ".max";
+	gauges.emplace_back(std::move(name), gauge.get());
+	gauges.emplace_back(std::move(maximumName), gauge.getMaximum());
+}
+
+void Statistics::addChild(Statistics child) {
+	children.push_back(std::move(child));
+}
+
+
+
+static void print(std::ostream& os, const Statistics& stats, const std::string& prefix) {
+	const auto path = prefix.empty() ? stats.name : prefix + "." + stats.name;
+
+	for(const auto& latency : stats.latencies) {
+		const auto& snapshot = latency.second;
+		os 	<< path << "." << latency.first << ": "
+			<< "count=" << snapshot.count << " "
+			<< "mean=" << snapshot.getMean().count() << "ns "
+			<< "p50=" << snapshot.getPercentile(0.50).count() << "ns "
+			<< "p99=" << snapshot.getPercentile(0.99).count() << "ns "
+			<< "max=" << snapshot.maximum.count() << "ns\n";
+	}
+
+	for(const auto& counter : stats.counters) {
+		os << path << "." << counter.first << ": " << counter.second << "\n";
+	}
+
+	for(const auto& gauge : stats.gauges) {
+		os << path << "." << gauge.first << ": " << gauge.second << "\n";
+	}
+
+	for(const auto& child : stats.children) {
+		print(os, child, path);
+	}
+}
+
+std::ostream& operator<<(std::ostream& os, const Statistics& stats) {
+	print(os, stats, "");
+	return os;
+}
+
+
+
+/*
+ * StatisticsDumperImpl
+ */
+
+struct StatisticsDumperImpl {
+	Instance*					instance;
+	StatisticsDumper::Source	source;
+	std::chrono::milliseconds	period;
+	StatisticsDumper::Callback	callback;
+
+	std::mutex					mutex;
+	std::condition_variable		cond;
+	bool						exit;
+	std::thread					thread;
+
+	StatisticsDumperImpl(	Instance* instance,
+							StatisticsDumper::Source source,
+							std::chrono::milliseconds period,
+							StatisticsDumper::Callback callback )
+		: instance(instance)
+		, source(std::move(source))
+		, period(period)
+		, callback(callback ? std::move(callback) : StatisticsDumper::Callback(defaultCallback))
+		, exit(false)
+	{
+		assert(this->source);
+		thread = std::thread(&StatisticsDumperImpl::threadFunc, std::ref(*this));
+	}
+
+	~StatisticsDumperImpl() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			exit = true;
+		}
+		cond.notify_all();
+
+		assert(thread.joinable());
+		thread.join();
+	}
+
+	void dump() {
+		callback(source());
+	}
+
+private:
+	void threadFunc() {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while(!cond.wait_for(lock, period, [this] { return exit; })) {
+			//Take the snapshot under the instance lock, as the sources may be
+			//closed concurrently
+			lock.unlock();
+			std::unique_lock<Instance> instanceLock;
+			if(instance) {
+				instanceLock = std::unique_lock<Instance>(*instance);
+			}
+			const auto statistics = source();
+			if(instanceLock) {
+				instanceLock.unlock(); //Don't block the rendering while logging
+			}
+			callback(statistics);
+			lock.lock();
+		}
+	}
+
+	static void defaultCallback(const Statistics& stats) {
+		std::clog << stats << std::flush;
+	}
+
+};
+
+
+
+/*
+ * StatisticsDumper
+ */
+
+StatisticsDumper::StatisticsDumper(	Source source,
+									std::chrono::milliseconds period,
+									Callback callback )
+	: Utils::Pimpl<StatisticsDumperImpl>({}, nullptr, std::move(source), period, std::move(callback))
+{
+}
+
+StatisticsDumper::StatisticsDumper(	Instance& instance,
+									Source source,
+									std::chrono::milliseconds period,
+									Callback callback )
+	: Utils::Pimpl<StatisticsDumperImpl>({}, &instance, std::move(source), period, std::move(callback))
+{
+}
+
+StatisticsDumper::StatisticsDumper(StatisticsDumper&& other) = default;
+
+StatisticsDumper::~StatisticsDumper() = default;
+
+StatisticsDumper& StatisticsDumper::operator=(StatisticsDumper&& other) = default;
+
+
+
+void StatisticsDumper::dump() {
+	(*this)->dump();
+}
+
+}
\ No newline at end of file
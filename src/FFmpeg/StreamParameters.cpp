@@ -147,6 +147,16 @@ Math::Rational<int> StreamParameters::getRealFrameRate() const {
 	);
 }
 
+int StreamParameters::getPTSWrapBits() const {
+	return get().pts_wrap_bits;
+}
+
+
+std::string_view StreamParameters::getMetadata(const char* key) const {
+	const auto* entry = av_dict_get(get().metadata, key, nullptr, 0);
+	return (entry && entry->value) ? std::string_view(entry->value) : std::string_view();
+}
+
 
 void StreamParameters::setCodecParameters(const CodecParameters& codecPar) {
 	assert(static_cast<CodecParameters::ConstHandle>(codecPar));
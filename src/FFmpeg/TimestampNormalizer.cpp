@@ -0,0 +1,238 @@
+#include "TimestampNormalizer.h"
+
+#include <zuazo/Math/Comparisons.h>
+
+#include <algorithm>
+#include <cassert>
+
+extern "C" {
+	#include <libavutil/avutil.h>
+	#include <libavutil/mathematics.h>
+}
+
+namespace Zuazo::FFmpeg {
+
+static constexpr int MAX_WRAP_BITS = 62; //Larger ones won't wrap in practice
+
+TimestampNormalizer::TimestampNormalizer(Streams streams)
+	: m_streams()
+	, m_regions{ Region{ Duration::min(), Duration::zero() } }
+	, m_offset(Duration::zero())
+	, m_previousOffset()
+	, m_end()
+	, m_wrapCount(0)
+	, m_discontinuityCount(0)
+{
+	m_streams.reserve(streams.size());
+	for(const auto& stream : streams) {
+		const auto timeBase = stream.getTimeBase();
+		const auto wrapBits = stream.getPTSWrapBits();
+
+		m_streams.push_back(StreamState{
+			timeBase.getNumerator(),
+			timeBase.getDenominator(),
+			(wrapBits > 0 && wrapBits <= MAX_WRAP_BITS) ? (int64_t(1) << wrapBits) : int64_t(0),
+			0,
+			std::nullopt,
+			std::nullopt
+		});
+	}
+}
+
+
+
+void TimestampNormalizer::normalize(Packet& packet) {
+	const auto index = packet.getStreamIndex();
+	if(index < 0 || static_cast<size_t>(index) >= m_streams.size()) {
+		return;
+	}
+
+	auto& stream = m_streams[index];
+	const auto pts = packet.getPTS();
+	const auto dts = packet.getDTS();
+
+	//Decoding timestamps are monotonic, so prefer them to detect discontinuities
+	const auto reference = (dts != AV_NOPTS_VALUE) ? dts : pts;
+	if(reference == AV_NOPTS_VALUE) {
+		return;
+	}
+
+	const auto unwrapped = unwrap(stream, reference);
+	const auto wrapShift = unwrapped - reference;
+	const auto time = toDuration(stream, unwrapped);
+	const auto offset = selectOffset(stream, time);
+	const auto offsetShift = fromDuration(stream, offset);
+
+	if(dts != AV_NOPTS_VALUE) {
+		packet.setDTS(dts + wrapShift + offsetShift);
+	}
+
+	if(pts != AV_NOPTS_VALUE) {
+		//The presentation timestamp may have wrapped on its own, as it is ahead
+		auto unwrappedPTS = pts + wrapShift;
+		if(stream.wrap && unwrappedPTS < unwrapped - stream.wrap / 2) {
+			unwrappedPTS += stream.wrap;
+		}
+
+		packet.setPTS(unwrappedPTS + offsetShift);
+	}
+
+	//Keep track of the furthest point
+	const auto normalized = time + offset;
+	const auto end = normalized + toDuration(stream, Math::max(packet.getDuration(), int64_t(0)));
+	stream.last = normalized;
+	m_end = m_end ? Math::max(*m_end, end) : end;
+}
+
+
+
+Duration TimestampNormalizer::toInput(Duration timestamp) const {
+	return timestamp - getRegion(timestamp).offset;
+}
+
+int64_t TimestampNormalizer::toInput(int stream, int64_t timestamp) const {
+	if(stream < 0 || static_cast<size_t>(stream) >= m_streams.size()) {
+		return timestamp;
+	}
+
+	const auto& state = m_streams[stream];
+	return timestamp - fromDuration(state, getRegion(toDuration(state, timestamp)).offset);
+}
+
+
+void TimestampNormalizer::reset(Duration timestamp) {
+	//Continue with the offset of the region it has landed on
+	const auto& region = getRegion(timestamp);
+	const auto input = timestamp - region.offset;
+
+	m_offset = region.offset;
+	m_previousOffset.reset();
+	m_end.reset();
+
+	for(auto& stream : m_streams) {
+		//Use the target as a hint for unwrapping
+		stream.lastInput = fromDuration(stream, input);
+		stream.last.reset();
+	}
+}
+
+void TimestampNormalizer::reset(int stream, int64_t timestamp) {
+	if(stream < 0 || static_cast<size_t>(stream) >= m_streams.size()) {
+		reset(Duration(timestamp));
+	} else {
+		reset(toDuration(m_streams[stream], timestamp));
+	}
+}
+
+
+size_t TimestampNormalizer::getWrapCount() const {
+	return m_wrapCount;
+}
+
+size_t TimestampNormalizer::getDiscontinuityCount() const {
+	return m_discontinuityCount;
+}
+
+
+
+int64_t TimestampNormalizer::unwrap(StreamState& stream, int64_t timestamp) {
+	auto result = timestamp + stream.wrapOffset;
+
+	if(stream.wrap && stream.lastInput) {
+		//Choose the cycle which is closest to the previous timestamp
+		const auto half = stream.wrap / 2;
+		while(result < *stream.lastInput - half) {
+			result += stream.wrap;
+			stream.wrapOffset += stream.wrap;
+			++m_wrapCount;
+		}
+
+		while(result > *stream.lastInput + half && stream.wrapOffset >= stream.wrap) {
+			result -= stream.wrap;
+			stream.wrapOffset -= stream.wrap;
+		}
+	}
+
+	stream.lastInput = result;
+	return result;
+}
+
+Duration TimestampNormalizer::selectOffset(const StreamState& stream, Duration timestamp) {
+	if(isContinuous(stream, timestamp + m_offset)) {
+		return m_offset;
+	}
+
+	//Packets from other streams may arrive late from before the discontinuity
+	if(m_previousOffset && isContinuous(stream, timestamp + *m_previousOffset)) {
+		return *m_previousOffset;
+	}
+
+	//Discontinuity. Continue right after the furthest point reached
+	assert(m_end);
+	m_previousOffset = m_offset;
+	m_offset = *m_end - timestamp;
+	++m_discontinuityCount;
+
+	//Regions beyond this point are superseded
+	const auto begin = *m_end;
+	m_regions.erase(
+		std::remove_if(
+			m_regions.begin() + 1, m_regions.end(),
+			[begin] (const Region& region) -> bool {
+				return region.begin >= begin;
+			}
+		),
+		m_regions.end()
+	);
+	m_regions.push_back(Region{ begin, m_offset });
+
+	return m_offset;
+}
+
+bool TimestampNormalizer::isContinuous(const StreamState& stream, Duration timestamp) const {
+	if(stream.last && timestamp < *stream.last - BACKWARD_THRESHOLD) {
+		return false; //Gone back in time
+	}
+
+	if(m_end && timestamp > *m_end + FORWARD_THRESHOLD) {
+		return false; //Gone too far ahead. Compared with all streams, as some are sparse
+	}
+
+	return true;
+}
+
+const TimestampNormalizer::Region& TimestampNormalizer::getRegion(Duration timestamp) const {
+	assert(!m_regions.empty());
+
+	//Regions are sorted by their beginning. Find the last one before the timestamp
+	const auto ite = std::upper_bound(
+		m_regions.cbegin(), m_regions.cend(),
+		timestamp,
+		[] (Duration ts, const Region& region) -> bool {
+			return ts < region.begin;
+		}
+	);
+
+	assert(ite != m_regions.cbegin());
+	return *std::prev(ite);
+}
+
+
+
+Duration TimestampNormalizer::toDuration(const StreamState& stream, int64_t timestamp) {
+	return Duration(av_rescale_q(
+		timestamp,
+		AVRational{ static_cast<int>(stream.timeBaseNum), static_cast<int>(stream.timeBaseDen) },
+		AVRational{ Duration::period::num, Duration::period::den }
+	));
+}
+
+int64_t TimestampNormalizer::fromDuration(const StreamState& stream, Duration timestamp) {
+	return av_rescale_q(
+		timestamp.count(),
+		AVRational{ Duration::period::num, Duration::period::den },
+		AVRational{ static_cast<int>(stream.timeBaseNum), static_cast<int>(stream.timeBaseDen) }
+	);
+}
+
+}
\ No newline at end of file
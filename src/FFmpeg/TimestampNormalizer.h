@@ -0,0 +1,81 @@
+#pragma once
+
+#include <zuazo/FFmpeg/Packet.h>
+#include <zuazo/FFmpeg/StreamParameters.h>
+#include <zuazo/FFmpeg/Chrono.h>
+
+#include <zuazo/Utils/BufferView.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace Zuazo::FFmpeg {
+
+//Rewrites the timestamps of demuxed packets so that they form a continuous
+//timeline. Wrapped timestamps (i.e. 33 bit MPEG-TS) are unwrapped and 
+//discontinuities are joined right after the previous packets. Timestamps 
+//are left untouched until the first of them is found
+class TimestampNormalizer {
+public:
+	using Streams = Utils::BufferView<const StreamParameters>;
+
+	static constexpr Duration BACKWARD_THRESHOLD = Duration(1000000); //1s
+	static constexpr Duration FORWARD_THRESHOLD = Duration(10000000); //10s
+
+	TimestampNormalizer(Streams streams);
+	TimestampNormalizer(const TimestampNormalizer& other) = default;
+	TimestampNormalizer(TimestampNormalizer&& other) = default;
+	~TimestampNormalizer() = default;
+
+	TimestampNormalizer&				operator=(const TimestampNormalizer& other) = default;
+	TimestampNormalizer&				operator=(TimestampNormalizer&& other) = default;
+
+	void								normalize(Packet& packet);
+
+	//Conversion from the normalized timeline into the one of the input
+	Duration							toInput(Duration timestamp) const;
+	int64_t								toInput(int stream, int64_t timestamp) const;
+
+	//Called after seeking. The target is given in the normalized timeline
+	void								reset(Duration timestamp);
+	void								reset(int stream, int64_t timestamp);
+
+	size_t								getWrapCount() const;
+	size_t								getDiscontinuityCount() const;
+
+private:
+	struct StreamState {
+		int64_t							timeBaseNum;
+		int64_t							timeBaseDen;
+		int64_t							wrap; //Zero if it does not wrap
+		int64_t							wrapOffset;
+		std::optional<int64_t>			lastInput; //Unwrapped
+		std::optional<Duration>			last; //Normalized
+	};
+
+	struct Region {
+		Duration						begin; //Normalized
+		Duration						offset;
+	};
+
+	std::vector<StreamState>			m_streams;
+	std::vector<Region>					m_regions;
+	Duration							m_offset;
+	std::optional<Duration>				m_previousOffset;
+	std::optional<Duration>				m_end;
+	size_t								m_wrapCount;
+	size_t								m_discontinuityCount;
+
+	int64_t								unwrap(StreamState& stream, int64_t timestamp);
+	Duration							selectOffset(const StreamState& stream, Duration timestamp);
+	bool								isContinuous(const StreamState& stream, Duration timestamp) const;
+	const Region&						getRegion(Duration timestamp) const;
+
+	static Duration						toDuration(const StreamState& stream, int64_t timestamp);
+	static int64_t						fromDuration(const StreamState& stream, Duration timestamp);
+
+};
+
+}
\ No newline at end of file
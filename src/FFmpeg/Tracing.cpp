@@ -0,0 +1,259 @@
+#include "Tracing.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cassert>
+
+namespace Zuazo::FFmpeg::Tracing {
+
+std::atomic<bool> g_enabled(false);
+
+/*
+ * ThreadBuffer
+ */
+
+//Ring of events written only by its thread. Readers never block the writer
+struct ThreadBuffer {
+	struct Event {
+		const char*				name;
+		Clock::time_point		begin;
+		Clock::time_point		end;
+	};
+
+	static constexpr size_t CAPACITY = 1 << 16;
+
+	uint32_t						threadId;
+	std::string						threadName; //Protected by the registry mutex
+	bool							exited; //Protected by the registry mutex
+	std::array<Event, CAPACITY>		events;
+	std::atomic<uint64_t>			writeCount;
+	std::atomic<uint64_t>			clearCount;
+
+	explicit ThreadBuffer(uint32_t id)
+		: threadId(id)
+		, threadName()
+		, exited(false)
+		, events()
+		, writeCount(0)
+		, clearCount(0)
+	{
+	}
+
+	void push(const char* name, Clock::time_point begin, Clock::time_point end) noexcept {
+		const auto index = writeCount.load(std::memory_order_relaxed);
+		events[index % CAPACITY] = Event{ name, begin, end };
+		writeCount.store(index + 1, std::memory_order_release); //Publish it
+	}
+
+	template<typename F>
+	void forEach(F&& func) const {
+		const auto end = writeCount.load(std::memory_order_acquire);
+		const auto begin = std::max(clearCount.load(std::memory_order_relaxed), end > CAPACITY ? end - CAPACITY : 0);
+
+		//Old events may be overwritten while reading if the writer wraps around.
+		//This is acceptable for diagnostics
+		for(auto i = begin; i < end; ++i) {
+			func(events[i % CAPACITY]);
+		}
+	}
+
+	void clear() {
+		clearCount.store(writeCount.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+};
+
+
+
+/*
+ * Registry
+ */
+
+struct Registry {
+	//Exited threads are kept until their events are written, but not too many
+	static constexpr size_t MAX_EXITED_COUNT = 16;
+
+	std::mutex									mutex;
+	std::vector<std::shared_ptr<ThreadBuffer>>	buffers;
+	uint32_t									nextThreadId;
+	Clock::time_point							epoch;
+
+	Registry()
+		: mutex()
+		, buffers()
+		, nextThreadId(1)
+		, epoch(Clock::now())
+	{
+	}
+
+	std::shared_ptr<ThreadBuffer> createBuffer(std::string threadName) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto result = std::make_shared<ThreadBuffer>(nextThreadId++);
+		result->threadName = std::move(threadName);
+		buffers.push_back(result);
+		return result;
+	}
+
+	void retireBuffer(ThreadBuffer& buffer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		buffer.exited = true;
+
+		//Release the oldest exited threads beyond the limit
+		auto exitedCount = std::count_if(
+			buffers.cbegin(), buffers.cend(),
+			[] (const std::shared_ptr<ThreadBuffer>& buffer) -> bool {
+				return buffer->exited;
+			}
+		);
+		for(auto ite = buffers.begin(); ite != buffers.end() && exitedCount > static_cast<ptrdiff_t>(MAX_EXITED_COUNT); ) {
+			if((*ite)->exited) {
+				ite = buffers.erase(ite);
+				--exitedCount;
+			} else {
+				++ite;
+			}
+		}
+	}
+
+	void releaseExited() {
+		//Requires the mutex to be locked
+		buffers.erase(
+			std::remove_if(
+				buffers.begin(), buffers.end(),
+				[] (const std::shared_ptr<ThreadBuffer>& buffer) -> bool {
+					return buffer->exited;
+				}
+			),
+			buffers.end()
+		);
+	}
+
+	static Registry& get() {
+		static Registry registry;
+		return registry;
+	}
+};
+
+//Hands the buffer back to the registry when the thread exits
+struct ThreadBufferHolder {
+	std::shared_ptr<ThreadBuffer>	buffer;
+
+	~ThreadBufferHolder() {
+		if(buffer) {
+			Registry::get().retireBuffer(*buffer);
+		}
+	}
+};
+
+static thread_local std::string t_threadName;
+static thread_local ThreadBufferHolder t_threadBuffer;
+
+static ThreadBuffer* getThreadBuffer() noexcept {
+	//Only locks the first time each thread records an event. The registry
+	//keeps a reference so that the events survive the thread
+	if(!t_threadBuffer.buffer) {
+		try {
+			t_threadBuffer.buffer = Registry::get().createBuffer(t_threadName);
+		} catch(...) {
+			return nullptr; //Unable to allocate it. It will be retried on the next event
+		}
+	}
+
+	assert(t_threadBuffer.buffer);
+	return t_threadBuffer.buffer.get();
+}
+
+
+
+void setEnabled(bool ena) {
+	g_enabled.store(ena, std::memory_order_relaxed);
+}
+
+void setThreadName(std::string name) {
+	//Buffers are only allocated when tracing, so just remember the name otherwise
+	if(t_threadBuffer.buffer) {
+		std::lock_guard<std::mutex> lock(Registry::get().mutex);
+		t_threadBuffer.buffer->threadName = name;
+	}
+
+	t_threadName = std::move(name);
+}
+
+void record(const char* name, Clock::time_point begin, Clock::time_point end) noexcept {
+	auto* buffer = getThreadBuffer();
+	if(buffer) {
+		buffer->push(name, begin, end);
+	} //Otherwise the event is dropped
+}
+
+static void writeEscaped(std::ostream& os, const std::string& str) {
+	for(const auto c : str) {
+		if(c == '"' || c == '\\') {
+			os << '\\';
+		}
+		os << c;
+	}
+}
+
+bool writeChromeTrace(const std::string& path) {
+	std::ofstream file(path);
+	if(!file) {
+		return false;
+	}
+
+	auto& registry = Registry::get();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	//Chrome's trace event format. Timestamps are in microseconds
+	using Microseconds = std::chrono::duration<double, std::micro>;
+	bool first = true;
+	const auto separator = [&first, &file] {
+		if(!first) file << ",\n";
+		first = false;
+	};
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	for(const auto& buffer : registry.buffers) {
+		assert(buffer);
+
+		if(!buffer->threadName.empty()) {
+			separator();
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+				 << ",\"args\":{\"name\":\"";
+			writeEscaped(file, buffer->threadName);
+			file << "\"}}";
+		}
+
+		buffer->forEach([&] (const ThreadBuffer::Event& event) {
+			separator();
+			file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+				 << ",\"ts\":" << Microseconds(event.begin - registry.epoch).count()
+				 << ",\"dur\":" << Microseconds(event.end - event.begin).count() << "}";
+		});
+	}
+
+	file << "\n]}\n";
+	if(!file) {
+		return false;
+	}
+
+	//The events of the exited threads have been written, so release them
+	registry.releaseExited();
+	return true;
+}
+
+void clear() {
+	auto& registry = Registry::get();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	registry.releaseExited();
+	for(const auto& buffer : registry.buffers) {
+		buffer->clear();
+	}
+}
+
+}
\ No newline at end of file
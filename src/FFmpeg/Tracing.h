@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+#define ZUAZO_FFMPEG_TRACE_CONCAT_IMPL(a, b) a##b
+#define ZUAZO_FFMPEG_TRACE_CONCAT(a, b) ZUAZO_FFMPEG_TRACE_CONCAT_IMPL(a, b)
+
+//Records a complete event spanning from here until the end of the enclosing scope.
+//name must have static storage duration
+#define ZUAZO_FFMPEG_TRACE_SCOPE(name) \
+	const ::Zuazo::FFmpeg::Tracing::Scope ZUAZO_FFMPEG_TRACE_CONCAT(zuazoFFmpegTraceScope, __LINE__)(name)
+
+namespace Zuazo::FFmpeg::Tracing {
+
+using Clock = std::chrono::steady_clock;
+
+extern std::atomic<bool> g_enabled;
+
+inline bool isEnabled() noexcept {
+	return g_enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool ena);
+void setThreadName(std::string name);
+void record(const char* name, Clock::time_point begin, Clock::time_point end) noexcept;
+bool writeChromeTrace(const std::string& path); //Releases the events of the exited threads
+void clear();
+
+
+
+/*
+ * Scope
+ */
+
+class Scope {
+public:
+	explicit Scope(const char* name) noexcept
+		: m_name(isEnabled() ? name : nullptr)
+		, m_begin(m_name ? Clock::now() : Clock::time_point())
+	{
+	}
+
+	Scope(const Scope& other) = delete;
+
+	~Scope() {
+		if(m_name) {
+			record(m_name, m_begin, Clock::now());
+		}
+	}
+
+	Scope&					operator=(const Scope& other) = delete;
+
+private:
+	const char*				m_name; //nullptr when disabled
+	Clock::time_point		m_begin;
+
+};
+
+}
\ No newline at end of file
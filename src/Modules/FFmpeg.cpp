@@ -1,5 +1,7 @@
 #include <zuazo/Modules/FFmpeg.h>
 
+#include "../FFmpeg/Tracing.h"
+
 #include <cassert>
 
 namespace Zuazo::Modules {
@@ -23,4 +25,23 @@ const FFmpeg& FFmpeg::get() {
 	return *s_singleton;
 }
 
+
+
+void FFmpeg::setTracingEnabled(bool ena) {
+	Zuazo::FFmpeg::Tracing::setEnabled(ena);
+}
+
+bool FFmpeg::getTracingEnabled() {
+	return Zuazo::FFmpeg::Tracing::isEnabled();
+}
+
+bool FFmpeg::writeTrace(const std::string& path) {
+	//Chrome trace event format. Can be opened with chrome://tracing or Perfetto
+	return Zuazo::FFmpeg::Tracing::writeChromeTrace(path);
+}
+
+void FFmpeg::clearTrace() {
+	Zuazo::FFmpeg::Tracing::clear();
+}
+
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include <zuazo/Processors/FFmpegDecoder.h>
 
 #include "../FFmpeg/CodecContext.h"
+#include "../FFmpeg/Reclaimer.h"
+#include "../FFmpeg/RecyclingPool.h"
+#include "../FFmpeg/Tracing.h"
 
 #include <zuazo/Utils/Functions.h>
-#include <zuazo/Utils/Pool.h>
 #include <zuazo/Signal/Input.h>
 #include <zuazo/Signal/Output.h>
 #include <zuazo/FFmpeg/Frame.h>
@@ -25,15 +27,27 @@ namespace Zuazo::Processors {
  */
 
 struct FFmpegDecoderImpl {
+	struct Metrics {
+		FFmpeg::LatencyHistogram	decodeLatency;
+		FFmpeg::LatencyHistogram	receiveLatency;
+		FFmpeg::LatencyHistogram	sendLatency;
+		FFmpeg::Counter				packetCount;
+		FFmpeg::Counter				frameCount;
+		FFmpeg::Counter				errorCount;
+		FFmpeg::Counter				flushCount;
+		FFmpeg::Gauge				packetQueueDepth;
+	};
+
 	struct Open {
 		using PacketQueue = std::queue<FFmpeg::PacketStream>;
-		using FramePool = Utils::Pool<FFmpeg::Frame>;
+		using FramePool = FFmpeg::RecyclingPool<FFmpeg::Frame>;
 
 		const AVCodec*			codec;
 		FFmpeg::CodecContext	codecContext;
 		
 		PacketQueue				packetQueue;
 		FramePool				framePool;
+		Metrics&				metrics;
 
 		inline static const auto flushPacket = FFmpeg::Packet();
 
@@ -41,11 +55,17 @@ struct FFmpegDecoderImpl {
 				bool hwAccelEnabled,
 				FFmpeg::ThreadType threadType,
 				int threadCount, 
-				void* opaque ) 
+				bool lowDelay,
+				bool fastDecoding,
+				Resolution previewResolution,
+				void* opaque,
+				std::shared_ptr<FFmpeg::Reclaimer> reclaimer,
+				Metrics& metrics ) 
 			: codec(findDecoder(codecPar))
 			, codecContext(codec)
 			, packetQueue()
-			, framePool()
+			, framePool(std::move(reclaimer))
+			, metrics(metrics)
 		{
 			if(codecContext.setParameters(codecPar) < 0) {
 				return; //ERROR
@@ -54,8 +74,13 @@ struct FFmpegDecoderImpl {
 			codecContext.setOpaque(opaque);
 			codecContext.setPixelFormatNegotiationCallback(FFmpegDecoderImpl::pixelFormatNegotiationCallback);
 
-			//Set the hardware device
-			if(hwAccelEnabled) {
+			//Decode at a reduced quality if only a preview is needed
+			if(previewResolution) {
+				configurePreview(codecContext, codec, codecPar.getResolution(), previewResolution);
+			}
+
+			//Set the hardware device. Hardware decoders do not support lowres
+			if(hwAccelEnabled && codecContext.getLowres() == 0) {
 				static_cast<AVCodecContext*>(codecContext)->hw_device_ctx = createHwDeviceContext(codec);
 			}
 
@@ -63,6 +88,16 @@ struct FFmpegDecoderImpl {
 			codecContext.setThreadCount(threadCount);
 			codecContext.setThreadType(threadType);
 
+			//Output frames as soon as possible
+			if(lowDelay) {
+				codecContext.setFlags(codecContext.getFlags() | AV_CODEC_FLAG_LOW_DELAY);
+			}
+
+			//Allow non spec compliant speedup tricks
+			if(fastDecoding) {
+				codecContext.setFlags2(codecContext.getFlags2() | AV_CODEC_FLAG2_FAST);
+			}
+
 			if(codecContext.open(codec) != 0) {
 				return; //ERROR
 			}
@@ -71,6 +106,8 @@ struct FFmpegDecoderImpl {
 		~Open() = default;
 
 		FFmpeg::FrameStream decode(const FFmpegDecoder::DemuxCallback& demuxCbk) {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegDecoder::decode");
+			FFmpeg::ScopedLatency decodeLatency(metrics.decodeLatency);
 			auto frame = framePool.acquire();
 			assert(frame);
 
@@ -78,42 +115,92 @@ struct FFmpegDecoderImpl {
 			//frame->unref(); //done by readFrame()
 
 			int readError;
-			while((readError = codecContext.readFrame(*frame)) != 0) {
+			while((readError = receiveFrame(*frame)) != 0) {
 				switch(readError) {
 				case AVERROR(EAGAIN):
 					//In order to decode a frame we need another packet. Retrieve it from the queue
-					while(packetQueue.empty()) demuxCbk(); //If there are no elements on the queue, populate it.
+					if(packetQueue.empty()) {
+						demuxCbk(); //If there are no elements on the queue, populate it.
+						if(packetQueue.empty()) {
+							//Demuxing did not yield any packet (i.e. it was interrupted). Give up
+							return FFmpeg::FrameStream();
+						}
+					}
 					assert(!packetQueue.empty());
 
 					assert(packetQueue.front());
-					if(codecContext.sendPacket(*packetQueue.front()) == 0) {
+					if(sendPacket(*packetQueue.front()) == 0) {
 						//Succeeded sending this packet. Remove it from the queue
 						packetQueue.pop();
+						metrics.packetQueueDepth.set(packetQueue.size());
 					}
 
 					break;
 
 				default:
 					//Unknown error
+					metrics.errorCount.add();
 					return FFmpeg::FrameStream();
 				}
 			}
 
+			metrics.frameCount.add();
 			return frame;
 		}
 
-		void read(const FFmpeg::PacketStream& pkt) {
+		void read(FFmpeg::PacketStream pkt) {
 			assert(pkt);
-			packetQueue.push(pkt);
+			packetQueue.push(std::move(pkt));
+			metrics.packetCount.add();
+			metrics.packetQueueDepth.set(packetQueue.size());
 		}
 
 		void flush() {
 			//Empty the packet queue
 			while(packetQueue.size() > 0) packetQueue.pop();
 			codecContext.flush();
+			metrics.flushCount.add();
+			metrics.packetQueueDepth.set(0);
 		}
 
 	private:
+		int receiveFrame(FFmpeg::Frame& frame) {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegDecoder::receiveFrame");
+			FFmpeg::ScopedLatency latency(metrics.receiveLatency);
+			return codecContext.readFrame(frame);
+		}
+
+		int sendPacket(const FFmpeg::Packet& packet) {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegDecoder::sendPacket");
+			FFmpeg::ScopedLatency latency(metrics.sendLatency);
+			return codecContext.sendPacket(packet);
+		}
+
+		static void configurePreview(	FFmpeg::CodecContext& codecContext,
+										const AVCodec* codec,
+										Resolution srcResolution,
+										Resolution dstResolution )
+		{
+			//Each lowres level halves the resolution. Use the highest one 
+			//which does not go below the requested resolution
+			int lowres = 0;
+			if(codec && srcResolution) {
+				while(	lowres < codec->max_lowres &&
+						(srcResolution.width >> (lowres + 1)) >= dstResolution.width &&
+						(srcResolution.height >> (lowres + 1)) >= dstResolution.height ) 
+				{
+					++lowres;
+				}
+			}
+
+			if(lowres > 0) {
+				codecContext.setLowres(lowres);
+			} else {
+				//Not supported by the codec, at least save the deblocking
+				codecContext.setSkipLoopFilter(FFmpeg::Discard::all);
+			}
+		}
+
 		static const AVCodec* findDecoder(const FFmpeg::CodecParameters& codecPar) {
 			const auto id = codecPar.getCodecId();
 			return avcodec_find_decoder(static_cast<AVCodecID>(id));
@@ -155,10 +242,14 @@ struct FFmpegDecoderImpl {
 	bool							hwAccelEnabled;
 	FFmpeg::ThreadType				threadType;
 	int								threadCount;
+	bool							lowDelay;
+	bool							fastDecoding;
+	Resolution						previewResolution;
 
 	FFmpegDecoder::PixelFormatNegotiationCallback pixFmtCallback;
 	FFmpegDecoder::DemuxCallback	demuxCallback;
 
+	Metrics							metrics;
 	std::unique_ptr<Open> 			opened;
 
 	FFmpegDecoderImpl(	FFmpegDecoder& owner, 
@@ -172,8 +263,12 @@ struct FFmpegDecoderImpl {
 		, hwAccelEnabled(false)
 		, threadType(FFmpeg::ThreadType::none)
 		, threadCount(1)
+		, lowDelay(false)
+		, fastDecoding(false)
+		, previewResolution()
 		, pixFmtCallback(std::move(pixFmtCbk))
 		, demuxCallback(std::move(demuxCbk))
+		, metrics()
 	{
 	}
 
@@ -188,18 +283,12 @@ struct FFmpegDecoderImpl {
 
 	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
 		const auto& decoder = static_cast<FFmpegDecoder&>(base);
-		assert(&decoder == &owner.get()); (void)(decoder);
+		assert(&decoder == &owner.get());
 		assert(!opened);
 
 		//Create in a unlocked environment
 		if(lock) lock->unlock(); //FIXME, if it throws, lock must be re-locked
-		auto newOpened = Utils::makeUnique<Open>(
-			codecParameters, 
-			hwAccelEnabled,
-			threadType,
-			threadCount, 
-			this
-		);
+		auto newOpened = createOpen(decoder);
 		if(lock) lock->lock();
 
 		//Apply changes after locking
@@ -250,11 +339,26 @@ struct FFmpegDecoderImpl {
 		}
 	}
 
+	void readPacket(FFmpeg::PacketStream packet) {
+		if(opened) {
+			opened->read(std::move(packet));
+		}
+	}
+
 	void flush() {
 		if(opened) opened->flush();
 		frameOut.reset();
 	}
 
+	void reconfigure() {
+		if(opened) {
+			//Replace the codec context, keeping the decoder open
+			opened = createOpen(owner.get());
+			packetIn.reset();
+			frameOut.reset();
+		}
+	}
+
 
 	void setCodecParameters(FFmpeg::CodecParameters codecPar) {
 		codecParameters = std::move(codecPar);
@@ -308,6 +412,61 @@ struct FFmpegDecoderImpl {
 	}	
 
 
+	void setLowDelay(bool ena) {
+		lowDelay = ena;
+	}
+
+	bool getLowDelay() const {
+		return lowDelay;
+	}
+
+
+	void setFastDecoding(bool ena) {
+		fastDecoding = ena;
+	}
+
+	bool getFastDecoding() const {
+		return fastDecoding;
+	}
+
+
+	void setPreviewResolution(Resolution res) {
+		previewResolution = res;
+	}
+
+	Resolution getPreviewResolution() const {
+		return previewResolution;
+	}
+
+
+	void setProfile(FFmpeg::DecodingProfile profile) {
+		//Use all the available cores in any case
+		threadCount = 0;
+
+		switch(profile) {
+		case FFmpeg::DecodingProfile::lowLatency:
+			//Each frame is split across threads, so no additional delay is introduced
+			threadType = FFmpeg::ThreadType::slice;
+			lowDelay = true;
+			fastDecoding = false;
+			break;
+
+		case FFmpeg::DecodingProfile::scrub:
+			threadType = FFmpeg::ThreadType::slice;
+			lowDelay = true;
+			fastDecoding = true;
+			break;
+
+		default: //throughput
+			//Frame threading adds a frame of delay per thread. Don't care about it
+			threadType = FFmpeg::ThreadType::frame;
+			lowDelay = false;
+			fastDecoding = false;
+			break;
+		}
+	}
+
+
 	void setPixelFormatNegotiationCallback(FFmpegDecoder::PixelFormatNegotiationCallback cbk) {
 		pixFmtCallback = std::move(cbk);
 	}
@@ -325,7 +484,38 @@ struct FFmpegDecoderImpl {
 		return demuxCallback;
 	}
 
+
+	FFmpeg::Statistics getStatistics() const {
+		FFmpeg::Statistics result(owner.get().getName());
+
+		result.addLatency("decode", metrics.decodeLatency);
+		result.addLatency("receiveFrame", metrics.receiveLatency);
+		result.addLatency("sendPacket", metrics.sendLatency);
+		result.addCounter("packets", metrics.packetCount);
+		result.addCounter("frames", metrics.frameCount);
+		result.addCounter("errors", metrics.errorCount);
+		result.addCounter("flushes", metrics.flushCount);
+		result.addGauge("packetQueueDepth", metrics.packetQueueDepth);
+
+		return result;
+	}
+
 private:
+	std::unique_ptr<Open> createOpen(const FFmpegDecoder& decoder) {
+		return Utils::makeUnique<Open>(
+			codecParameters, 
+			hwAccelEnabled,
+			threadType,
+			threadCount, 
+			lowDelay,
+			fastDecoding,
+			previewResolution,
+			this,
+			FFmpeg::Reclaimer::getShared(&decoder.getInstance()), //Frames are often dropped by the renderer
+			metrics
+		);
+	}
+
 	static FFmpeg::PixelFormat pixelFormatNegotiationCallback(	FFmpeg::CodecContext::Handle codecContext, 
 																const FFmpeg::PixelFormat* formats ) 
 	{
@@ -377,10 +567,18 @@ void FFmpegDecoder::readPacket() {
 	return (*this)->readPacket();
 }
 
+void FFmpegDecoder::readPacket(FFmpeg::PacketStream packet) {
+	return (*this)->readPacket(std::move(packet));
+}
+
 void FFmpegDecoder::flush() {
 	(*this)->flush();
 }
 
+void FFmpegDecoder::reconfigure() {
+	(*this)->reconfigure();
+}
+
 
 void FFmpegDecoder::setCodecParameters(FFmpeg::CodecParameters codecPar) {
 	(*this)->setCodecParameters(std::move(codecPar));
@@ -422,6 +620,38 @@ int FFmpegDecoder::getThreadCount() const {
 }
 
 
+void FFmpegDecoder::setLowDelay(bool ena) {
+	(*this)->setLowDelay(ena);
+}
+
+bool FFmpegDecoder::getLowDelay() const {
+	return (*this)->getLowDelay();
+}
+
+
+void FFmpegDecoder::setFastDecoding(bool ena) {
+	(*this)->setFastDecoding(ena);
+}
+
+bool FFmpegDecoder::getFastDecoding() const {
+	return (*this)->getFastDecoding();
+}
+
+
+void FFmpegDecoder::setPreviewResolution(Resolution res) {
+	(*this)->setPreviewResolution(res);
+}
+
+Resolution FFmpegDecoder::getPreviewResolution() const {
+	return (*this)->getPreviewResolution();
+}
+
+
+void FFmpegDecoder::setProfile(FFmpeg::DecodingProfile profile) {
+	(*this)->setProfile(profile);
+}
+
+
 void FFmpegDecoder::setPixelFormatNegotiationCallback(PixelFormatNegotiationCallback cbk) {
 	(*this)->setPixelFormatNegotiationCallback(std::move(cbk));
 }
@@ -439,4 +669,9 @@ const FFmpegDecoder::DemuxCallback& FFmpegDecoder::getDemuxCallback() const {
 	return (*this)->getDemuxCallback();
 }
 
+
+FFmpeg::Statistics FFmpegDecoder::getStatistics() const {
+	return (*this)->getStatistics();
+}
+
 }
\ No newline at end of file
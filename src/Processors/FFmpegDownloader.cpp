@@ -0,0 +1,632 @@
+#include <zuazo/Processors/FFmpegDownloader.h>
+
+#include "../FFmpeg/RecyclingPool.h"
+#include "../FFmpeg/SWScaleContext.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/Utils/Functions.h>
+#include <zuazo/Signal/Input.h>
+#include <zuazo/Signal/Output.h>
+#include <zuazo/Graphics/Vulkan.h>
+#include <zuazo/Graphics/Frame.h>
+#include <zuazo/FFmpeg/Frame.h>
+#include <zuazo/FFmpeg/Signals.h>
+#include <zuazo/FFmpeg/FFmpegConversions.h>
+
+#include <memory>
+#include <vector>
+#include <queue>
+#include <array>
+#include <limits>
+#include <cassert>
+
+extern "C" {
+	#include <libavutil/frame.h>
+	#include <libavutil/imgutils.h>
+}
+
+namespace Zuazo::Processors {
+
+/*
+ * FFmpegDownloaderImpl
+ */
+
+struct FFmpegDownloaderImpl {
+	struct Open {
+		using FramePool = FFmpeg::RecyclingPool<FFmpeg::Frame>;
+
+		struct ReadbackBuffer {
+			vk::UniqueBuffer				buffer;
+			vk::UniqueDeviceMemory			memory;
+			std::byte*						data;
+			vk::UniqueCommandBuffer			commandBuffer;
+			vk::UniqueFence					fence;
+			Video							source; //Kept alive until the copy has finished
+		};
+
+		static constexpr size_t MAX_PLANES = 4;
+
+		const Graphics::Vulkan&				vulkan;
+		Graphics::Frame::Descriptor			frameDescriptor;
+		Resolution							resolution;
+		FFmpeg::PixelFormat					srcFormat;
+		FFmpeg::PixelFormat					dstFormat;
+		std::array<int, MAX_PLANES>			lineSizes;
+		std::array<size_t, MAX_PLANES>		planeOffsets;
+
+		vk::UniqueCommandPool				commandPool;
+		std::vector<ReadbackBuffer>			ring;
+		size_t								readIndex;
+		size_t								pendingCount;
+
+		FramePool							framePool;
+		FFmpeg::SWScaleContext				swscaleContext;
+
+		Open(	const Graphics::Vulkan& vulkan,
+				const Graphics::Frame::Descriptor& frameDesc,
+				FFmpeg::PixelFormat pixelFormat,
+				size_t bufferCount )
+			: vulkan(vulkan)
+			, frameDescriptor(frameDesc)
+			, resolution(frameDesc.getResolution())
+			, srcFormat(getReadbackFormat(frameDesc))
+			, dstFormat(pixelFormat != FFmpeg::PixelFormat::none ? pixelFormat : srcFormat)
+			, lineSizes{}
+			, planeOffsets{}
+			, commandPool(createCommandPool(vulkan))
+			, ring()
+			, readIndex(0)
+			, pendingCount(0)
+			, framePool(false) //Buffers are reused when possible
+			, swscaleContext()
+		{
+			if(srcFormat == FFmpeg::PixelFormat::none) {
+				throw Exception("Unsupported frame format for downloading");
+			}
+
+			//Obtain the layout of a tightly packed frame
+			av_image_fill_linesizes(lineSizes.data(), static_cast<AVPixelFormat>(srcFormat), resolution.width);
+			const auto bufferSize = calculatePlaneOffsets(planeOffsets, srcFormat, resolution, lineSizes);
+
+			//Create the ring of readback buffers
+			ring.resize(std::max(bufferCount, size_t(1)));
+			for(auto& readbackBuffer : ring) {
+				createReadbackBuffer(readbackBuffer, bufferSize);
+			}
+
+			if(srcFormat != dstFormat) {
+				constexpr int SWS_NO_SCALING_FILTER = 0x10;
+				swscaleContext.recreate(
+					resolution, srcFormat,
+					resolution, dstFormat,
+					SWS_NO_SCALING_FILTER
+				);
+			}
+		}
+
+		~Open() {
+			//Wait for all the pending copies
+			while(pendingCount > 0) {
+				auto& readbackBuffer = ring[readIndex];
+				waitFence(readbackBuffer);
+				readbackBuffer.source.reset();
+				readIndex = (readIndex + 1) % ring.size();
+				--pendingCount;
+			}
+		}
+
+		bool isCompatible(const Graphics::Frame::Descriptor& frameDesc) const {
+			return frameDescriptor == frameDesc;
+		}
+
+		bool isFull() const {
+			return pendingCount == ring.size();
+		}
+
+		bool isEmpty() const {
+			return pendingCount == 0;
+		}
+
+		void download(const Video& frame) {
+			assert(frame);
+			assert(!isFull());
+
+			const auto index = (readIndex + pendingCount) % ring.size();
+			auto& readbackBuffer = ring[index];
+			assert(!readbackBuffer.source);
+
+			const auto& dispatcher = vulkan.getDispatcher();
+			auto& commandBuffer = *readbackBuffer.commandBuffer;
+
+			//Record the copy of each of the planes into the readback buffer
+			commandBuffer.begin(
+				vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit),
+				dispatcher
+			);
+
+			const auto planes = frame->getImage().getPlanes();
+			assert(planes.size() <= MAX_PLANES);
+			for(size_t i = 0; i < planes.size(); ++i) {
+				const auto image = planes[i].getImage();
+				const auto extent = planes[i].getExtent();
+				const vk::ImageSubresourceRange subresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+				//Transition the image for the transfer
+				commandBuffer.pipelineBarrier(
+					vk::PipelineStageFlagBits::eAllCommands,
+					vk::PipelineStageFlagBits::eTransfer,
+					{}, {}, {},
+					vk::ImageMemoryBarrier(
+						vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eTransferRead,
+						vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+						VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+						image, subresourceRange
+					),
+					dispatcher
+				);
+
+				commandBuffer.copyImageToBuffer(
+					image, vk::ImageLayout::eTransferSrcOptimal,
+					*readbackBuffer.buffer,
+					vk::BufferImageCopy(
+						planeOffsets[i], 0, 0, //Tightly packed
+						vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+						vk::Offset3D(0, 0, 0),
+						extent
+					),
+					dispatcher
+				);
+
+				//Leave it as it was
+				commandBuffer.pipelineBarrier(
+					vk::PipelineStageFlagBits::eTransfer,
+					vk::PipelineStageFlagBits::eAllCommands,
+					{}, {}, {},
+					vk::ImageMemoryBarrier(
+						vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead,
+						vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+						VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+						image, subresourceRange
+					),
+					dispatcher
+				);
+			}
+
+			//Make the result visible to the host
+			commandBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eHost,
+				{}, {},
+				vk::BufferMemoryBarrier(
+					vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead,
+					VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+					*readbackBuffer.buffer, 0, VK_WHOLE_SIZE
+				),
+				{},
+				dispatcher
+			);
+
+			commandBuffer.end(dispatcher);
+
+			//Submit it. It will be collected once it has finished, so that it overlaps with the rendering of the next frames
+			vulkan.getDevice().resetFences(*readbackBuffer.fence, dispatcher);
+			vulkan.getGraphicsQueue().submit(
+				vk::SubmitInfo(0, nullptr, nullptr, 1, &commandBuffer),
+				*readbackBuffer.fence,
+				dispatcher
+			);
+
+			readbackBuffer.source = frame;
+			++pendingCount;
+		}
+
+		FFmpeg::FrameStream readback(bool wait) {
+			FFmpeg::FrameStream result;
+
+			if(pendingCount > 0) {
+				auto& readbackBuffer = ring[readIndex];
+
+				if(wait || isSignaled(readbackBuffer)) {
+					waitFence(readbackBuffer);
+					readbackBuffer.source.reset();
+					result = convert(readbackBuffer);
+
+					readIndex = (readIndex + 1) % ring.size();
+					--pendingCount;
+				}
+			}
+
+			return result;
+		}
+
+	private:
+		FFmpeg::FrameStream convert(const ReadbackBuffer& readbackBuffer) {
+			auto frame = framePool.acquire();
+			assert(frame);
+
+			//Ensure that the frame is usable. Previous consumers may still reference its buffers
+			if(	frame->getResolution() != resolution ||
+				frame->getPixelFormat() != dstFormat ||
+				!av_frame_is_writable(static_cast<AVFrame*>(*frame)) )
+			{
+				frame->unref();
+				frame->setResolution(resolution);
+				frame->setPixelFormat(dstFormat);
+				if(av_frame_get_buffer(static_cast<AVFrame*>(*frame), 0) < 0) {
+					return FFmpeg::FrameStream(); //ERROR
+				}
+			}
+
+			//Obtain the source planes
+			std::array<const std::byte*, MAX_PLANES> srcData = {};
+			for(size_t i = 0; i < MAX_PLANES; ++i) {
+				srcData[i] = lineSizes[i] ? readbackBuffer.data + planeOffsets[i] : nullptr;
+			}
+
+			if(srcFormat == dstFormat) {
+				//No need for conversion, simply copy
+				av_image_copy(
+					reinterpret_cast<uint8_t**>(frame->getData().data()),
+					frame->getLineSizes().data(),
+					reinterpret_cast<const uint8_t**>(srcData.data()),
+					lineSizes.data(),
+					static_cast<AVPixelFormat>(srcFormat),
+					resolution.width, resolution.height
+				);
+			} else {
+				swscaleContext.scale(
+					srcData.data(),
+					lineSizes.data(),
+					0, resolution.height,
+					frame->getData().data(),
+					frame->getLineSizes().data()
+				);
+			}
+
+			return frame;
+		}
+
+		void createReadbackBuffer(ReadbackBuffer& readbackBuffer, size_t size) {
+			const auto& device = vulkan.getDevice();
+			const auto& dispatcher = vulkan.getDispatcher();
+
+			readbackBuffer.buffer = device.createBufferUnique(
+				vk::BufferCreateInfo(
+					{},
+					size,
+					vk::BufferUsageFlagBits::eTransferDst,
+					vk::SharingMode::eExclusive
+				),
+				nullptr,
+				dispatcher
+			);
+
+			//Prefer cached memory, as it will be read by the CPU
+			const auto requirements = device.getBufferMemoryRequirements(*readbackBuffer.buffer, dispatcher);
+			const auto memoryType = findMemoryType(
+				requirements.memoryTypeBits,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostCached,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+			);
+
+			readbackBuffer.memory = device.allocateMemoryUnique(
+				vk::MemoryAllocateInfo(requirements.size, memoryType),
+				nullptr,
+				dispatcher
+			);
+			device.bindBufferMemory(*readbackBuffer.buffer, *readbackBuffer.memory, 0, dispatcher);
+
+			//Keep it mapped all the time
+			readbackBuffer.data = static_cast<std::byte*>(
+				device.mapMemory(*readbackBuffer.memory, 0, VK_WHOLE_SIZE, {}, dispatcher)
+			);
+
+			readbackBuffer.commandBuffer = std::move(device.allocateCommandBuffersUnique(
+				vk::CommandBufferAllocateInfo(*commandPool, vk::CommandBufferLevel::ePrimary, 1),
+				dispatcher
+			).front());
+
+			readbackBuffer.fence = device.createFenceUnique(
+				vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled),
+				nullptr,
+				dispatcher
+			);
+		}
+
+		uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags preferred, vk::MemoryPropertyFlags required) const {
+			const auto properties = vulkan.getPhysicalDevice().getMemoryProperties(vulkan.getDispatcher());
+
+			for(const auto flags : { preferred, required }) {
+				for(uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
+					if((typeBits & (1U << i)) && (properties.memoryTypes[i].propertyFlags & flags) == flags) {
+						return i;
+					}
+				}
+			}
+
+			throw Exception("Unable to find a suitable memory type for downloading");
+		}
+
+		bool isSignaled(const ReadbackBuffer& readbackBuffer) const {
+			return vulkan.getDevice().getFenceStatus(*readbackBuffer.fence, vulkan.getDispatcher()) == vk::Result::eSuccess;
+		}
+
+		void waitFence(const ReadbackBuffer& readbackBuffer) const {
+			vulkan.getDevice().waitForFences(
+				*readbackBuffer.fence,
+				true,
+				std::numeric_limits<uint64_t>::max(),
+				vulkan.getDispatcher()
+			);
+		}
+
+		static vk::UniqueCommandPool createCommandPool(const Graphics::Vulkan& vulkan) {
+			return vulkan.getDevice().createCommandPoolUnique(
+				vk::CommandPoolCreateInfo(
+					vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+					vulkan.getGraphicsQueueIndex()
+				),
+				nullptr,
+				vulkan.getDispatcher()
+			);
+		}
+
+		static FFmpeg::PixelFormat getReadbackFormat(const Graphics::Frame::Descriptor& frameDesc) {
+			return FFmpeg::toFFmpeg(FFmpeg::PixelFormatConversion{
+				frameDesc.getColorFormat(),
+				frameDesc.getColorSubsampling(),
+				isYCbCr(frameDesc.getColorModel())
+			});
+		}
+
+		static size_t calculatePlaneOffsets(std::array<size_t, MAX_PLANES>& offsets,
+											FFmpeg::PixelFormat format,
+											Resolution resolution,
+											const std::array<int, MAX_PLANES>& lineSizes )
+		{
+			//Fill the pointers relative to a null base
+			std::array<uint8_t*, MAX_PLANES> pointers = {};
+			const auto size = av_image_fill_pointers(
+				pointers.data(),
+				static_cast<AVPixelFormat>(format),
+				resolution.height,
+				nullptr,
+				lineSizes.data()
+			);
+
+			for(size_t i = 0; i < MAX_PLANES; ++i) {
+				offsets[i] = reinterpret_cast<uintptr_t>(pointers[i]);
+			}
+
+			return std::max(size, 0);
+		}
+
+	};
+
+	using Input = Signal::Input<Video>;
+	using Output = Signal::Output<FFmpeg::FrameStream>;
+
+	std::reference_wrapper<FFmpegDownloader> owner;
+
+	Input 								videoIn;
+	Output								frameOut;
+
+	FFmpeg::PixelFormat					pixelFormat;
+	size_t								bufferCount;
+
+	std::unique_ptr<Open>				opened;
+	std::queue<FFmpeg::FrameStream>		drained; //Read back before recreating the buffers. Delivered first
+
+	FFmpegDownloaderImpl(FFmpegDownloader& downloader, FFmpeg::PixelFormat pixelFormat)
+		: owner(downloader)
+		, videoIn(downloader, std::string(Signal::makeInputName<Video>()))
+		, frameOut(downloader, std::string(Signal::makeOutputName<FFmpeg::FrameStream>()))
+		, pixelFormat(pixelFormat)
+		, bufferCount(3)
+		, opened()
+		, drained()
+	{
+	}
+
+	~FFmpegDownloaderImpl() = default;
+
+	void moved(ZuazoBase& base) {
+		owner = static_cast<FFmpegDownloader&>(base);
+		videoIn.setLayout(base);
+		frameOut.setLayout(base);
+	}
+
+	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		const auto& downloader = static_cast<FFmpegDownloader&>(base);
+		assert(&owner.get() == &downloader); (void)(downloader);
+		assert(!opened);
+		Utils::ignore(lock); //Just to avoid warnings
+		//It gets opened with update(), once the frame layout is known
+	}
+
+	void asyncOpen(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		open(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void close(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& downloader = static_cast<FFmpegDownloader&>(base);
+		assert(&downloader == &owner.get()); (void)(downloader);
+
+		//Apply changes while locked
+		auto oldOpened = std::move(opened);
+		drained = {};
+		videoIn.reset();
+		frameOut.reset();
+
+		//Destroy stuff while unlocked
+		if(oldOpened) {
+			if(lock) lock->unlock();
+			oldOpened.reset();
+			if(lock) lock->lock();
+		}
+
+		assert(!opened);
+	}
+
+	void asyncClose(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		close(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void update() {
+		auto& downloader = owner.get();
+
+		if(downloader.isOpen()) {
+			FFmpeg::FrameStream result;
+
+			if(videoIn.hasChanged()) {
+				const auto& frame = videoIn.pull();
+
+				if(frame) {
+					const auto& frameDesc = frame->getDescriptor();
+
+					//Recreate the readback buffers if the frame layout has changed
+					if(!opened || !opened->isCompatible(frameDesc)) {
+						drain();
+						opened = Utils::makeUnique<Open>(
+							downloader.getInstance().getVulkan(),
+							frameDesc,
+							pixelFormat,
+							bufferCount
+						);
+					}
+
+					//Make room for the new frame if necessary
+					assert(opened);
+					if(opened->isFull()) {
+						result = opened->readback(true);
+					}
+
+					opened->download(frame);
+				}
+			}
+
+			//Collect a finished copy, if any
+			if(!result && opened) {
+				result = opened->readback(false);
+			}
+
+			//Keep the order if there are frames left from the previous buffers
+			if(!drained.empty()) {
+				if(result) {
+					drained.push(std::move(result));
+				}
+
+				result = std::move(drained.front());
+				drained.pop();
+			}
+
+			if(result) {
+				frameOut.push(std::move(result));
+			}
+		}
+	}
+
+
+	void setPixelFormat(FFmpeg::PixelFormat fmt) {
+		if(pixelFormat != fmt) {
+			pixelFormat = fmt;
+			drain(); //Will be recreated with the next frame
+		}
+	}
+
+	FFmpeg::PixelFormat getPixelFormat() const {
+		return pixelFormat;
+	}
+
+
+	void setBufferCount(size_t count) {
+		if(bufferCount != count) {
+			bufferCount = count;
+			drain(); //Will be recreated with the next frame
+		}
+	}
+
+	size_t getBufferCount() const {
+		return bufferCount;
+	}
+
+
+	static bool isSupportedOutput(FFmpeg::PixelFormat fmt) {
+		return FFmpeg::SWScaleContext::isSupportedOutput(fmt);
+	}
+
+private:
+	void drain() {
+		//Collect the copies in flight, so that they are not lost
+		if(opened) {
+			FFmpeg::FrameStream frame;
+			while(!opened->isEmpty()) {
+				frame = opened->readback(true);
+				if(frame) {
+					drained.push(std::move(frame));
+				}
+			}
+
+			opened.reset();
+		}
+	}
+
+};
+
+
+
+/*
+ * FFmpegDownloader
+ */
+
+FFmpegDownloader::FFmpegDownloader(Instance& instance, std::string name, FFmpeg::PixelFormat pixelFormat)
+	: Utils::Pimpl<FFmpegDownloaderImpl>({}, *this, pixelFormat)
+	, ZuazoBase(
+		instance,
+		std::move(name),
+		{ (*this)->videoIn, (*this)->frameOut },
+		std::bind(&FFmpegDownloaderImpl::moved, std::ref(**this), std::placeholders::_1),
+		std::bind(&FFmpegDownloaderImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegDownloaderImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegDownloaderImpl::close, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegDownloaderImpl::asyncClose, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegDownloaderImpl::update, std::ref(**this)) )
+	, Signal::ProcessorLayout<Video, FFmpeg::FrameStream>((*this)->videoIn.getProxy(), (*this)->frameOut.getProxy())
+{
+}
+
+FFmpegDownloader::FFmpegDownloader(FFmpegDownloader&& other) = default;
+
+FFmpegDownloader::~FFmpegDownloader() = default;
+
+FFmpegDownloader& FFmpegDownloader::operator=(FFmpegDownloader&& other) = default;
+
+
+
+void FFmpegDownloader::setPixelFormat(FFmpeg::PixelFormat fmt) {
+	(*this)->setPixelFormat(fmt);
+}
+
+FFmpeg::PixelFormat FFmpegDownloader::getPixelFormat() const {
+	return (*this)->getPixelFormat();
+}
+
+
+void FFmpegDownloader::setBufferCount(size_t count) {
+	(*this)->setBufferCount(count);
+}
+
+size_t FFmpegDownloader::getBufferCount() const {
+	return (*this)->getBufferCount();
+}
+
+
+bool FFmpegDownloader::isSupportedOutput(FFmpeg::PixelFormat fmt) {
+	return FFmpegDownloaderImpl::isSupportedOutput(fmt);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,873 @@
+#include <zuazo/Processors/FFmpegEncoder.h>
+
+#include "../FFmpeg/CodecContext.h"
+#include "../FFmpeg/Reclaimer.h"
+#include "../FFmpeg/RecyclingPool.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/Utils/Functions.h>
+#include <zuazo/Signal/Input.h>
+#include <zuazo/Signal/Output.h>
+#include <zuazo/FFmpeg/Frame.h>
+#include <zuazo/FFmpeg/Packet.h>
+#include <zuazo/FFmpeg/Signals.h>
+
+#include <memory>
+#include <queue>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cassert>
+
+extern "C" {
+	#include <libavcodec/avcodec.h>
+}
+
+namespace Zuazo::Processors {
+
+/*
+ * FFmpegEncoderImpl
+ */
+
+struct FFmpegEncoderImpl {
+	struct Metrics {
+		FFmpeg::Counter				frameCount;
+		FFmpeg::Counter				packetCount;
+		FFmpeg::Counter				droppedFrameCount;
+		FFmpeg::Counter				errorCount;
+	};
+
+	struct Open {
+		using FramePool = FFmpeg::RecyclingPool<FFmpeg::Frame>;
+		using PacketPool = FFmpeg::RecyclingPool<FFmpeg::Packet>;
+		using FrameQueue = std::deque<std::shared_ptr<FFmpeg::Frame>>;
+		using PacketQueue = std::queue<FFmpeg::PacketStream>;
+
+		//Settings of the codec context, kept in order to reopen it
+		struct Configuration {
+			FFmpeg::CodecParameters	codecParameters;
+			Math::Rational<int>		frameRate;
+			FFmpeg::ThreadType		threadType;
+			int						threadCount;
+			int64_t					bitrate;
+			int64_t					minBitrate;
+			int64_t					maxBitrate;
+			int						bufferSize;
+			int						gopSize;
+			int						maxBFrames;
+			int						globalQuality;
+			bool					globalHeaderEnabled;
+		};
+
+		const AVCodec*			codec;
+		Configuration			configuration;
+		FFmpeg::CodecContext	codecContext; //Only used by the encoding thread once launched
+		FFmpeg::CodecParameters	parameters;
+		Math::Rational<int>		timeBase;
+
+		FramePool				framePool;
+		PacketPool				packetPool;
+		Metrics&				metrics;
+		Math::Rational<int>		inputTimeBase;
+		int64_t					nextPTS;
+
+		size_t					queueSize;
+		FrameQueue				frameQueue;
+		PacketQueue				packetQueue;
+		bool					draining;
+		bool					exit;
+
+		std::mutex				mutex;
+		std::condition_variable	queueCond;
+		std::thread				encodingThread;
+
+		Open(	const FFmpeg::CodecParameters& codecPar,
+				const std::string& codecName,
+				Math::Rational<int> frameRate,
+				FFmpeg::ThreadType threadType,
+				int threadCount,
+				const FFmpegEncoderImpl& settings,
+				Metrics& metrics )
+			: codec(findEncoder(codecPar, codecName))
+			, configuration{
+				codecPar,
+				frameRate,
+				threadType,
+				threadCount,
+				settings.bitrate,
+				settings.minBitrate,
+				settings.maxBitrate,
+				settings.bufferSize,
+				settings.gopSize,
+				settings.maxBFrames,
+				settings.globalQuality,
+				settings.globalHeaderEnabled }
+			, codecContext(createCodecContext(codec, configuration))
+			, parameters(codecContext.getParameters()) //Reopening yields the same parameters
+			, timeBase(codecContext.getTimeBase())
+			, framePool(FFmpeg::Reclaimer::getShared(&settings.owner.get().getInstance()))
+			, packetPool(FFmpeg::Reclaimer::getShared(&settings.owner.get().getInstance()))
+			, metrics(metrics)
+			, inputTimeBase(settings.inputTimeBase.getNumerator() > 0 ? settings.inputTimeBase : timeBase)
+			, nextPTS(0)
+			, queueSize(std::max(settings.queueSize, size_t(1)))
+			, frameQueue()
+			, packetQueue()
+			, draining(false)
+			, exit(false)
+		{
+			//Everything went OK. Launch the encoding thread
+			encodingThread = std::thread(&Open::encodingThreadFunc, std::ref(*this));
+		}
+
+		~Open() {
+			//Stop the encoding thread
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				exit = true;
+			}
+			queueCond.notify_all();
+
+			assert(encodingThread.joinable());
+			encodingThread.join();
+		}
+
+		void encode(const FFmpeg::FrameStream& frame) {
+			assert(frame);
+
+			//Reference the frame's buffers instead of copying them
+			auto encodedFrame = framePool.acquire();
+			assert(encodedFrame);
+			if(encodedFrame->ref(*frame) < 0) {
+				metrics.errorCount.add();
+				return;
+			}
+
+			//Let the encoder decide the picture type. Keep the original timing
+			//if present, otherwise timestamp it by its index
+			encodedFrame->setPictureType(FFmpeg::PictureType::none);
+			auto pts = frame->getPTS();
+			if(pts != AV_NOPTS_VALUE) {
+				pts = av_rescale_q(
+					pts,
+					AVRational{ inputTimeBase.getNumerator(), inputTimeBase.getDenominator() },
+					AVRational{ timeBase.getNumerator(), timeBase.getDenominator() }
+				);
+			}
+			if(pts == AV_NOPTS_VALUE || pts < nextPTS) {
+				pts = nextPTS; //Encoders require increasing timestamps
+			}
+			encodedFrame->setPTS(pts);
+			nextPTS = pts + 1;
+
+			//Wait until there is room in the queue
+			std::unique_lock<std::mutex> lock(mutex);
+			queueCond.wait(lock, [this] { return frameQueue.size() < queueSize; });
+			frameQueue.push_back(std::move(encodedFrame));
+			lock.unlock();
+			queueCond.notify_all();
+		}
+
+		PacketQueue readPackets() {
+			PacketQueue result;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			std::swap(result, packetQueue);
+
+			return result;
+		}
+
+		const FFmpeg::CodecParameters& getParameters() const {
+			return parameters;
+		}
+
+		Math::Rational<int> getTimeBase() const {
+			return timeBase;
+		}
+
+		void flush() {
+			//Wait until all the enqueued frames have been encoded and drained
+			std::unique_lock<std::mutex> lock(mutex);
+			draining = true;
+			queueCond.notify_all();
+			queueCond.wait(lock, [this] { return !draining; });
+		}
+
+	private:
+		void encodingThreadFunc() {
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while(!exit) {
+				if(!frameQueue.empty()) {
+					//Retrieve a frame from the queue
+					auto frame = std::move(frameQueue.front());
+					frameQueue.pop_front();
+					queueCond.notify_all();
+
+					//Encode in a unlocked environment
+					lock.unlock();
+					sendFrame(*frame, lock);
+					frame.reset();
+					receivePackets(lock);
+				} else if(draining) {
+					//All frames have been sent. Output the buffered packets
+					lock.unlock();
+					codecContext.sendEndOfStream();
+					receivePackets(lock);
+
+					//Make it usable for the following frames
+					lock.unlock();
+					reset();
+					lock.lock();
+
+					draining = false;
+					queueCond.notify_all();
+				} else {
+					queueCond.wait(lock);
+				}
+			}
+		}
+
+		void sendFrame(const FFmpeg::Frame& frame, std::unique_lock<std::mutex>& lock) {
+			assert(!lock.owns_lock());
+
+			int error;
+			while((error = codecContext.sendFrame(frame)) == AVERROR(EAGAIN)) {
+				//The encoder is full. Make room by retrieving its packets
+				const auto count = receivePackets(lock);
+				lock.unlock();
+
+				if(count == 0) {
+					break; //Not making progress
+				}
+			}
+
+			if(error == 0) {
+				metrics.frameCount.add();
+			} else {
+				//Can not be recovered. The frame is dropped
+				metrics.droppedFrameCount.add();
+			}
+		}
+
+		size_t receivePackets(std::unique_lock<std::mutex>& lock) {
+			assert(!lock.owns_lock());
+			size_t count = 0;
+
+			while(true) {
+				lock.lock();
+				auto packet = packetPool.acquire();
+				lock.unlock();
+				assert(packet);
+
+				const auto error = codecContext.readPacket(*packet);
+				if(error != 0) {
+					if(error != AVERROR(EAGAIN) && error != AVERROR_EOF) {
+						metrics.errorCount.add();
+					}
+
+					break; //No more packets for the moment
+				}
+
+				lock.lock();
+				packetQueue.push(std::move(packet));
+				lock.unlock();
+				metrics.packetCount.add();
+				++count;
+			}
+
+			lock.lock();
+			return count;
+		}
+
+		void reset() {
+			if(codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH) {
+				codecContext.flush();
+			} else {
+				//Otherwise it would remain at the end of stream. Open it again
+				try {
+					codecContext = createCodecContext(codec, configuration);
+				} catch(const Exception&) {
+					//Following frames will be rejected and dropped
+					metrics.errorCount.add();
+				}
+			}
+		}
+
+		static FFmpeg::CodecContext createCodecContext(const AVCodec* codec, const Configuration& configuration) {
+			if(!codec) {
+				throw Exception("Unable to find a suitable encoder");
+			}
+
+			FFmpeg::CodecContext result(codec);
+			if(result.setParameters(configuration.codecParameters) < 0) {
+				throw Exception("Unable to set the encoder parameters");
+			}
+
+			//Use the first supported pixel format if not specified
+			if(static_cast<AVCodecContext*>(result)->pix_fmt == AV_PIX_FMT_NONE && codec->pix_fmts) {
+				static_cast<AVCodecContext*>(result)->pix_fmt = codec->pix_fmts[0];
+			}
+
+			//Frames are timestamped in frame periods
+			const auto frameRate = configuration.frameRate;
+			result.setFrameRate(frameRate);
+			result.setTimeBase(Math::Rational<int>(frameRate.getDenominator(), frameRate.getNumerator()));
+
+			//Configure the rate control
+			result.setBitrate(configuration.bitrate);
+			result.setMinBitrate(configuration.minBitrate);
+			result.setMaxBitrate(configuration.maxBitrate);
+			result.setBufferSize(configuration.bufferSize);
+			if(configuration.gopSize >= 0) result.setGOPSize(configuration.gopSize);
+			if(configuration.maxBFrames >= 0) result.setMaxBFrames(configuration.maxBFrames);
+			result.setGlobalQuality(configuration.globalQuality);
+
+			if(configuration.globalHeaderEnabled) {
+				result.setFlags(result.getFlags() | AV_CODEC_FLAG_GLOBAL_HEADER);
+			}
+
+			//Enable the multithreading
+			result.setThreadCount(configuration.threadCount);
+			result.setThreadType(configuration.threadType);
+
+			if(result.open(codec) != 0) {
+				throw Exception("Unable to open the encoder: " + std::string(codec->name));
+			}
+
+			return result;
+		}
+
+		static const AVCodec* findEncoder(	const FFmpeg::CodecParameters& codecPar,
+											const std::string& codecName )
+		{
+			if(!codecName.empty()) {
+				return avcodec_find_encoder_by_name(codecName.c_str());
+			} else {
+				const auto id = codecPar.getCodecId();
+				return avcodec_find_encoder(static_cast<AVCodecID>(id));
+			}
+		}
+	};
+
+	using Input = Signal::Input<FFmpeg::FrameStream>;
+	using Output = Signal::Output<FFmpeg::PacketStream>;
+
+	std::reference_wrapper<FFmpegEncoder> owner;
+
+	Input 							frameIn;
+	Output							packetOut;
+
+	FFmpeg::CodecParameters			codecParameters;
+	std::string						codecName;
+	Math::Rational<int>				frameRate;
+	Math::Rational<int>				inputTimeBase; //Zero for the encoder's time base
+	FFmpeg::ThreadType				threadType;
+	int								threadCount;
+
+	int64_t							bitrate;
+	int64_t							minBitrate;
+	int64_t							maxBitrate;
+	int								bufferSize;
+	int								gopSize;
+	int								maxBFrames;
+	int								globalQuality;
+	bool							globalHeaderEnabled;
+	size_t							queueSize;
+
+	FFmpegEncoder::MuxCallback		muxCallback;
+
+	Metrics							metrics;
+	std::unique_ptr<Open> 			opened;
+
+	FFmpegEncoderImpl(	FFmpegEncoder& owner,
+						FFmpeg::CodecParameters codecPar,
+						FFmpegEncoder::MuxCallback muxCbk )
+		: owner(owner)
+		, frameIn(owner, std::string(Signal::makeInputName<FFmpeg::FrameStream>()))
+		, packetOut(owner, std::string(Signal::makeOutputName<FFmpeg::PacketStream>()))
+		, codecParameters(std::move(codecPar))
+		, codecName()
+		, frameRate(25, 1)
+		, inputTimeBase(0, 1)
+		, threadType(FFmpeg::ThreadType::none)
+		, threadCount(1)
+		, bitrate(0)
+		, minBitrate(0)
+		, maxBitrate(0)
+		, bufferSize(0)
+		, gopSize(-1)
+		, maxBFrames(-1)
+		, globalQuality(0)
+		, globalHeaderEnabled(false)
+		, queueSize(4)
+		, muxCallback(std::move(muxCbk))
+		, metrics()
+		, opened()
+	{
+	}
+
+	~FFmpegEncoderImpl() = default;
+
+	void moved(ZuazoBase& base) {
+		owner = static_cast<FFmpegEncoder&>(base);
+		frameIn.setLayout(base);
+		packetOut.setLayout(base);
+	}
+
+
+	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		const auto& encoder = static_cast<FFmpegEncoder&>(base);
+		assert(&encoder == &owner.get()); (void)(encoder);
+		assert(!opened);
+
+		//Create in a unlocked environment
+		if(lock) lock->unlock();
+		std::unique_ptr<Open> newOpened;
+		try {
+			newOpened = Utils::makeUnique<Open>(
+				codecParameters,
+				codecName,
+				frameRate,
+				threadType,
+				threadCount,
+				*this,
+				metrics
+			);
+		} catch(...) {
+			if(lock) lock->lock();
+			throw;
+		}
+		if(lock) lock->lock();
+
+		//Apply changes after locking
+		opened = std::move(newOpened);
+
+		assert(opened);
+	}
+
+	void asyncOpen(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		open(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void close(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		const auto& encoder = static_cast<FFmpegEncoder&>(base);
+		assert(&encoder == &owner.get()); (void)(encoder);
+		assert(opened);
+
+		//Apply changes while locked
+		auto oldOpened = std::move(opened);
+		frameIn.reset();
+		packetOut.reset();
+
+		//Destroy in a unlocked environment
+		if(lock) lock->unlock();
+		oldOpened.reset();
+		if(lock) lock->lock();
+
+		assert(!opened);
+	}
+
+	void asyncClose(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		close(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void update() {
+		if(opened) {
+			if(frameIn.hasChanged()) {
+				const auto& frame = frameIn.pull();
+				if(frame) {
+					opened->encode(frame);
+				}
+			}
+
+			pushPackets();
+		}
+	}
+
+	void flush() {
+		if(opened) {
+			opened->flush();
+			pushPackets();
+		}
+	}
+
+
+	void setCodecParameters(FFmpeg::CodecParameters codecPar) {
+		codecParameters = std::move(codecPar);
+	}
+
+	const FFmpeg::CodecParameters& getCodecParameters() const {
+		return codecParameters;
+	}
+
+	FFmpeg::CodecParameters getEncodedCodecParameters() const {
+		return opened ? opened->getParameters() : FFmpeg::CodecParameters();
+	}
+
+
+	void setCodecName(std::string name) {
+		codecName = std::move(name);
+	}
+
+	const std::string& getCodecName() const {
+		return codecName;
+	}
+
+
+	void setFrameRate(Math::Rational<int> rate) {
+		frameRate = rate;
+	}
+
+	Math::Rational<int> getFrameRate() const {
+		return frameRate;
+	}
+
+	Math::Rational<int> getTimeBase() const {
+		return opened ? opened->getTimeBase() : Math::Rational<int>(frameRate.getDenominator(), frameRate.getNumerator());
+	}
+
+	void setInputTimeBase(Math::Rational<int> tb) {
+		inputTimeBase = tb;
+	}
+
+	Math::Rational<int> getInputTimeBase() const {
+		return inputTimeBase;
+	}
+
+
+	void setThreadType(FFmpeg::ThreadType type) {
+		threadType = type;
+	}
+
+	FFmpeg::ThreadType getThreadType() const {
+		return threadType;
+	}
+
+
+	void setThreadCount(int cnt) {
+		threadCount = cnt;
+	}
+
+	int getThreadCount() const {
+		return threadCount;
+	}
+
+
+	void setBitrate(int64_t bps) {
+		bitrate = bps;
+	}
+
+	int64_t getBitrate() const {
+		return bitrate;
+	}
+
+
+	void setMinBitrate(int64_t bps) {
+		minBitrate = bps;
+	}
+
+	int64_t getMinBitrate() const {
+		return minBitrate;
+	}
+
+
+	void setMaxBitrate(int64_t bps) {
+		maxBitrate = bps;
+	}
+
+	int64_t getMaxBitrate() const {
+		return maxBitrate;
+	}
+
+
+	void setBufferSize(int bits) {
+		bufferSize = bits;
+	}
+
+	int getBufferSize() const {
+		return bufferSize;
+	}
+
+
+	void setGOPSize(int size) {
+		gopSize = size;
+	}
+
+	int getGOPSize() const {
+		return gopSize;
+	}
+
+
+	void setMaxBFrames(int cnt) {
+		maxBFrames = cnt;
+	}
+
+	int getMaxBFrames() const {
+		return maxBFrames;
+	}
+
+
+	void setGlobalQuality(int quality) {
+		globalQuality = quality;
+	}
+
+	int getGlobalQuality() const {
+		return globalQuality;
+	}
+
+
+	void setGlobalHeaderEnabled(bool ena) {
+		globalHeaderEnabled = ena;
+	}
+
+	bool getGlobalHeaderEnabled() const {
+		return globalHeaderEnabled;
+	}
+
+
+	void setQueueSize(size_t size) {
+		queueSize = size;
+	}
+
+	size_t getQueueSize() const {
+		return queueSize;
+	}
+
+
+	void setMuxCallback(FFmpegEncoder::MuxCallback cbk) {
+		muxCallback = std::move(cbk);
+	}
+
+	const FFmpegEncoder::MuxCallback& getMuxCallback() const {
+		return muxCallback;
+	}
+
+
+	FFmpeg::Statistics getStatistics() const {
+		FFmpeg::Statistics result(owner.get().getName());
+
+		result.addCounter("frames", metrics.frameCount);
+		result.addCounter("packets", metrics.packetCount);
+		result.addCounter("droppedFrames", metrics.droppedFrameCount);
+		result.addCounter("errors", metrics.errorCount);
+
+		return result;
+	}
+
+private:
+	void pushPackets() {
+		assert(opened);
+
+		//Output all the packets encoded so far, one at a time
+		auto packets = opened->readPackets();
+		while(!packets.empty()) {
+			packetOut.push(std::move(packets.front()));
+			packets.pop();
+
+			if(muxCallback) muxCallback();
+		}
+	}
+
+};
+
+
+
+/*
+ * FFmpegEncoder
+ */
+
+FFmpegEncoder::FFmpegEncoder(	Instance& instance,
+								std::string name,
+								FFmpeg::CodecParameters codecPar,
+								MuxCallback muxCbk )
+	: Utils::Pimpl<FFmpegEncoderImpl>({}, *this, std::move(codecPar), std::move(muxCbk))
+	, ZuazoBase(
+		instance,
+		std::move(name),
+		{ (*this)->frameIn, (*this)->packetOut },
+		std::bind(&FFmpegEncoderImpl::moved, std::ref(**this), std::placeholders::_1),
+		std::bind(&FFmpegEncoderImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegEncoderImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegEncoderImpl::close, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegEncoderImpl::asyncClose, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegEncoderImpl::update, std::ref(**this)) )
+	, Signal::ProcessorLayout<FFmpeg::FrameStream, FFmpeg::PacketStream>((*this)->frameIn.getProxy(), (*this)->packetOut.getProxy())
+{
+}
+
+FFmpegEncoder::FFmpegEncoder(FFmpegEncoder&& other) = default;
+
+FFmpegEncoder::~FFmpegEncoder() = default;
+
+FFmpegEncoder& FFmpegEncoder::operator=(FFmpegEncoder&& other) = default;
+
+
+
+void FFmpegEncoder::flush() {
+	(*this)->flush();
+}
+
+
+void FFmpegEncoder::setCodecParameters(FFmpeg::CodecParameters codecPar) {
+	(*this)->setCodecParameters(std::move(codecPar));
+}
+
+const FFmpeg::CodecParameters& FFmpegEncoder::getCodecParameters() const {
+	return (*this)->getCodecParameters();
+}
+
+FFmpeg::CodecParameters FFmpegEncoder::getEncodedCodecParameters() const {
+	return (*this)->getEncodedCodecParameters();
+}
+
+
+void FFmpegEncoder::setCodecName(std::string name) {
+	(*this)->setCodecName(std::move(name));
+}
+
+const std::string& FFmpegEncoder::getCodecName() const {
+	return (*this)->getCodecName();
+}
+
+
+void FFmpegEncoder::setFrameRate(Math::Rational<int> rate) {
+	(*this)->setFrameRate(rate);
+}
+
+Math::Rational<int> FFmpegEncoder::getFrameRate() const {
+	return (*this)->getFrameRate();
+}
+
+Math::Rational<int> FFmpegEncoder::getTimeBase() const {
+	return (*this)->getTimeBase();
+}
+
+void FFmpegEncoder::setInputTimeBase(Math::Rational<int> tb) {
+	(*this)->setInputTimeBase(tb);
+}
+
+Math::Rational<int> FFmpegEncoder::getInputTimeBase() const {
+	return (*this)->getInputTimeBase();
+}
+
+
+void FFmpegEncoder::setThreadType(FFmpeg::ThreadType type) {
+	(*this)->setThreadType(type);
+}
+
+FFmpeg::ThreadType FFmpegEncoder::getThreadType() const {
+	return (*this)->getThreadType();
+}
+
+
+void FFmpegEncoder::setThreadCount(int cnt) {
+	(*this)->setThreadCount(cnt);
+}
+
+int FFmpegEncoder::getThreadCount() const {
+	return (*this)->getThreadCount();
+}
+
+
+void FFmpegEncoder::setBitrate(int64_t bps) {
+	(*this)->setBitrate(bps);
+}
+
+int64_t FFmpegEncoder::getBitrate() const {
+	return (*this)->getBitrate();
+}
+
+
+void FFmpegEncoder::setMinBitrate(int64_t bps) {
+	(*this)->setMinBitrate(bps);
+}
+
+int64_t FFmpegEncoder::getMinBitrate() const {
+	return (*this)->getMinBitrate();
+}
+
+
+void FFmpegEncoder::setMaxBitrate(int64_t bps) {
+	(*this)->setMaxBitrate(bps);
+}
+
+int64_t FFmpegEncoder::getMaxBitrate() const {
+	return (*this)->getMaxBitrate();
+}
+
+
+void FFmpegEncoder::setBufferSize(int bits) {
+	(*this)->setBufferSize(bits);
+}
+
+int FFmpegEncoder::getBufferSize() const {
+	return (*this)->getBufferSize();
+}
+
+
+void FFmpegEncoder::setGOPSize(int size) {
+	(*this)->setGOPSize(size);
+}
+
+int FFmpegEncoder::getGOPSize() const {
+	return (*this)->getGOPSize();
+}
+
+
+void FFmpegEncoder::setMaxBFrames(int cnt) {
+	(*this)->setMaxBFrames(cnt);
+}
+
+int FFmpegEncoder::getMaxBFrames() const {
+	return (*this)->getMaxBFrames();
+}
+
+
+void FFmpegEncoder::setGlobalQuality(int quality) {
+	(*this)->setGlobalQuality(quality);
+}
+
+int FFmpegEncoder::getGlobalQuality() const {
+	return (*this)->getGlobalQuality();
+}
+
+
+void FFmpegEncoder::setGlobalHeaderEnabled(bool ena) {
+	(*this)->setGlobalHeaderEnabled(ena);
+}
+
+bool FFmpegEncoder::getGlobalHeaderEnabled() const {
+	return (*this)->getGlobalHeaderEnabled();
+}
+
+
+void FFmpegEncoder::setQueueSize(size_t size) {
+	(*this)->setQueueSize(size);
+}
+
+size_t FFmpegEncoder::getQueueSize() const {
+	return (*this)->getQueueSize();
+}
+
+
+void FFmpegEncoder::setMuxCallback(MuxCallback cbk) {
+	(*this)->setMuxCallback(std::move(cbk));
+}
+
+const FFmpegEncoder::MuxCallback& FFmpegEncoder::getMuxCallback() const {
+	return (*this)->getMuxCallback();
+}
+
+
+FFmpeg::Statistics FFmpegEncoder::getStatistics() const {
+	return (*this)->getStatistics();
+}
+
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <zuazo/Processors/FFmpegUploader.h>
 
 #include "../FFmpeg/SWScaleContext.h"
+#include "../FFmpeg/Tracing.h"
 
 #include <zuazo/Utils/Functions.h>
 #include <zuazo/Math/Comparisons.h>
@@ -14,13 +15,17 @@
 
 #include <memory>
 #include <cassert>
+#include <cstring>
 #include <tuple>
+#include <optional>
+#include <unordered_map>
 
 extern "C" {
 	#include <libavutil/hwcontext.h>
 	#include <libavutil/imgutils.h>
 	#include <libavutil/pixdesc.h>
 	#include <libavutil/mastering_display_metadata.h>
+	#include <libavutil/buffer.h>
 }
 
 namespace Zuazo::Processors {
@@ -30,19 +35,278 @@ namespace Zuazo::Processors {
  */
 
 struct FFmpegUploaderImpl {
+	struct Metrics {
+		FFmpeg::LatencyHistogram	processLatency;
+		FFmpeg::LatencyHistogram	transferLatency;
+		FFmpeg::LatencyHistogram	convertLatency;
+		FFmpeg::Counter				frameCount;
+		FFmpeg::Counter				hardwareFrameCount;
+		FFmpeg::Counter				downscaledFrameCount;
+		FFmpeg::Counter				hdrMetadataParseCount;
+	};
+
+	//Characteristics of a frame which affect the video mode negotiation
+	struct FrameFormat {
+		Resolution							resolution;
+		AspectRatio							pixelAspectRatio;
+		FFmpeg::ColorPrimaries				colorPrimaries;
+		FFmpeg::ColorSpace					colorSpace;
+		FFmpeg::ColorTransferCharacteristic	colorTransferCharacteristic;
+		FFmpeg::ColorRange					colorRange;
+		FFmpeg::PixelFormat					pixelFormat;
+		FFmpeg::PixelFormat					softwarePixelFormat; //Only for hardware frames
+		size_t								hash;
+
+		explicit FrameFormat(const FFmpeg::Frame& frame)
+			: resolution(frame.getResolution())
+			, pixelAspectRatio(frame.getPixelAspectRatio())
+			, colorPrimaries(frame.getColorPrimaries())
+			, colorSpace(frame.getColorSpace())
+			, colorTransferCharacteristic(frame.getColorTransferCharacteristic())
+			, colorRange(frame.getColorRange())
+			, pixelFormat(frame.getPixelFormat())
+			, softwarePixelFormat(getSoftwarePixelFormat(frame))
+			, hash(computeHash())
+		{
+		}
+
+		bool operator==(const FrameFormat& other) const noexcept {
+			//Compare the hash first, as it is likely to differ
+			return	hash == other.hash &&
+					resolution == other.resolution &&
+					pixelAspectRatio == other.pixelAspectRatio &&
+					colorPrimaries == other.colorPrimaries &&
+					colorSpace == other.colorSpace &&
+					colorTransferCharacteristic == other.colorTransferCharacteristic &&
+					colorRange == other.colorRange &&
+					pixelFormat == other.pixelFormat &&
+					softwarePixelFormat == other.softwarePixelFormat ;
+		}
+
+		bool operator!=(const FrameFormat& other) const noexcept {
+			return !operator==(other);
+		}
+
+	private:
+		size_t computeHash() const noexcept {
+			size_t result = 0;
+			const auto combine = [&result] (auto value) {
+				//Same as boost::hash_combine
+				result ^= static_cast<size_t>(value) + 0x9e3779b9 + (result << 6) + (result >> 2);
+			};
+
+			combine(resolution.width);
+			combine(resolution.height);
+			combine(pixelAspectRatio.getNumerator());
+			combine(pixelAspectRatio.getDenominator());
+			combine(colorPrimaries);
+			combine(colorSpace);
+			combine(colorTransferCharacteristic);
+			combine(colorRange);
+			combine(pixelFormat);
+			combine(softwarePixelFormat);
+
+			return result;
+		}
+
+		static FFmpeg::PixelFormat getSoftwarePixelFormat(const FFmpeg::Frame& frame) noexcept {
+			const auto* hwFramesBuffer = static_cast<const AVFrame*>(frame)->hw_frames_ctx;
+			return hwFramesBuffer ?
+				static_cast<FFmpeg::PixelFormat>(reinterpret_cast<const AVHWFramesContext*>(hwFramesBuffer->data)->sw_format) :
+				FFmpeg::PixelFormat::none ;
+		}
+
+	};
+
+	struct FrameFormatHash {
+		size_t operator()(const FrameFormat& format) const noexcept {
+			return format.hash;
+		}
+	};
+
+	using CompatibilityCache = std::unordered_map<FrameFormat, std::vector<VideoMode>, FrameFormatHash>;
+
+	//Alternating formats are expected to be only a few
+	static constexpr size_t MAX_COMPATIBILITY_CACHE_SIZE = 64;
+
+	//HDR static metadata is usually constant for the whole stream, so it is 
+	//only parsed when the side data changes. A reference to the last side data
+	//buffer is held, so that its address can not be reused while it is cached. 
+	//This way, comparing the address is enough to skip unchanged side data
+	class HDRMetadataCache {
+	public:
+		HDRMetadataCache()
+			: m_masteringDisplay()
+			, m_contentLightLevel()
+			, m_colorPrimaries(FFmpeg::ColorPrimaries::none)
+			, m_value()
+		{
+		}
+
+		~HDRMetadataCache() = default;
+
+		//Returns true if it has been parsed again
+		bool update(const FFmpeg::Frame& frame) {
+			const AVFrameSideData* masteringDisplay = nullptr;
+			const AVFrameSideData* contentLightLevel = nullptr;
+
+			for(const auto& sideData : frame.getSideData()) {
+				switch(sideData.getType()) {
+				case FFmpeg::FrameSideDataType::masteringDisplayMetadata:
+					masteringDisplay = static_cast<FFmpeg::FrameSideData::ConstHandle>(sideData);
+					break;
+				case FFmpeg::FrameSideDataType::contentLightLevel:
+					contentLightLevel = static_cast<FFmpeg::FrameSideData::ConstHandle>(sideData);
+					break;
+				default:
+					break;
+				}
+			}
+
+			//Evaluate all of them, so that the references are updated
+			const auto colorPrimaries = frame.getColorPrimaries();
+			const auto masteringDisplayChanged = m_masteringDisplay.update(masteringDisplay);
+			const auto contentLightLevelChanged = m_contentLightLevel.update(contentLightLevel);
+			const auto colorPrimariesChanged = masteringDisplay && colorPrimaries != m_colorPrimaries;
+			m_colorPrimaries = colorPrimaries;
+
+			if(!masteringDisplayChanged && !contentLightLevelChanged && !colorPrimariesChanged) {
+				return false;
+			}
+
+			m_value = parse(masteringDisplay, contentLightLevel, colorPrimaries);
+			return true;
+		}
+
+		void reset() {
+			m_masteringDisplay.reset();
+			m_contentLightLevel.reset();
+			m_colorPrimaries = FFmpeg::ColorPrimaries::none;
+			m_value.reset();
+		}
+
+		const FFmpeg::HDRMetadataStream& get() const {
+			return m_value;
+		}
+
+	private:
+		class Entry {
+		public:
+			Entry()
+				: m_buffer(nullptr, &Entry::unref)
+				, m_size(0)
+			{
+			}
+
+			//Returns true if the contents have changed
+			bool update(const AVFrameSideData* sideData) {
+				if(!sideData) {
+					const auto changed = static_cast<bool>(m_buffer);
+					reset();
+					return changed;
+				}
+
+				if(m_buffer && m_buffer->data == sideData->data && m_size == sideData->size) {
+					return false; //Same buffer. Nothing to do
+				}
+
+				//Some decoders allocate new side data for each frame. Compare the contents
+				const auto changed = 	!m_buffer || 
+										m_size != sideData->size ||
+										std::memcmp(m_buffer->data, sideData->data, m_size) != 0 ;
+
+				m_buffer.reset((sideData->buf && sideData->buf->data == sideData->data) ? av_buffer_ref(sideData->buf) : nullptr);
+				m_size = m_buffer ? sideData->size : 0;
+				return changed || !m_buffer; //Unreferenced side data can not be cached
+			}
+
+			void reset() {
+				m_buffer.reset();
+				m_size = 0;
+			}
+
+		private:
+			std::unique_ptr<AVBufferRef, void(*)(AVBufferRef*)> m_buffer;
+			size_t							m_size;
+
+			static void unref(AVBufferRef* buffer) {
+				av_buffer_unref(&buffer);
+			}
+
+		};
+
+		Entry								m_masteringDisplay;
+		Entry								m_contentLightLevel;
+		FFmpeg::ColorPrimaries				m_colorPrimaries;
+		FFmpeg::HDRMetadataStream			m_value;
+
+		static FFmpeg::HDRMetadataStream parse(	const AVFrameSideData* masteringDisplay, 
+												const AVFrameSideData* contentLightLevel,
+												FFmpeg::ColorPrimaries colorPrimaries ) 
+		{
+			if(!masteringDisplay && !contentLightLevel) {
+				return nullptr; //Not a HDR10 stream
+			}
+
+			//Use the primaries of the frame unless the mastering display tells otherwise
+			auto result = std::make_shared<FFmpeg::HDRMetadata>();
+			result->masteringDisplay = getChromaticities(
+				(colorPrimaries != FFmpeg::ColorPrimaries::none) 
+				? FFmpeg::fromFFmpeg(colorPrimaries) 
+				: ColorPrimaries::bt709
+			);
+			result->masteringDisplayMinLuminance = 0.0;
+
+			AVMasteringDisplayMetadata masteringDisplayMetadata;
+			if(masteringDisplay && masteringDisplay->size >= sizeof(masteringDisplayMetadata)) {
+				std::memcpy(&masteringDisplayMetadata, masteringDisplay->data, sizeof(masteringDisplayMetadata));
+
+				if(masteringDisplayMetadata.has_luminance) {
+					result->masteringDisplay.setWhiteLuminance(av_q2d(masteringDisplayMetadata.max_luminance));
+					result->masteringDisplayMinLuminance = av_q2d(masteringDisplayMetadata.min_luminance);
+				}
+
+				if(masteringDisplayMetadata.has_primaries) {
+					const auto& primaries = masteringDisplayMetadata.display_primaries;
+					const auto& whitePoint = masteringDisplayMetadata.white_point;
+
+					result->masteringDisplay.setRedPrimary(Math::Vec2f(av_q2d(primaries[0][0]), av_q2d(primaries[0][1])));
+					result->masteringDisplay.setGreenPrimary(Math::Vec2f(av_q2d(primaries[1][0]), av_q2d(primaries[1][1])));
+					result->masteringDisplay.setBluePrimary(Math::Vec2f(av_q2d(primaries[2][0]), av_q2d(primaries[2][1])));
+					result->masteringDisplay.setWhitePoint(Math::Vec2f(av_q2d(whitePoint[0]), av_q2d(whitePoint[1])));
+				}
+			}
+
+			AVContentLightMetadata contentLightMetadata;
+			if(contentLightLevel && contentLightLevel->size >= sizeof(contentLightMetadata)) {
+				std::memcpy(&contentLightMetadata, contentLightLevel->data, sizeof(contentLightMetadata));
+				result->contentLightLevel = FFmpeg::HDRMetadata::ContentLightLevel{ 
+					contentLightMetadata.MaxCLL, 
+					contentLightMetadata.MaxFALL 
+				};
+			}
+
+			return result;
+		}
+
+	};
+
 	struct Open {
 		Graphics::StagedFramePool	framePool;
 		FFmpeg::Frame				intermediateFrame;
 		FFmpeg::Frame				dstFrame;
 		FFmpeg::SWScaleContext		swscaleContext;
+		Metrics&					metrics;
 
 
 		Open(	const Graphics::Vulkan& vulkan, 
-				const Graphics::Frame::Descriptor& frameDesc ) 
+				const Graphics::Frame::Descriptor& frameDesc,
+				Metrics& metrics ) 
 			: framePool(vulkan, frameDesc)
 			, intermediateFrame()
 			, dstFrame()
 			, swscaleContext()
+			, metrics(metrics)
 		{
 			fillFrameData(dstFrame, frameDesc);
 
@@ -58,12 +322,13 @@ struct FFmpegUploaderImpl {
 		~Open() = default;
 
 		Zuazo::Video process(const FFmpeg::Frame& frame) {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegUploader::process");
+			FFmpeg::ScopedLatency processLatency(metrics.processLatency);
 			auto result = framePool.acquireFrame();
 			assert(result);
-			assert(frame.getResolution() == dstFrame.getResolution());
 
 			//Gather information about the destination frame
-			const auto resolution = frame.getResolution();
+			const auto downscaling = frame.getResolution() != dstFrame.getResolution();
 			auto* hwAccelBuffer = static_cast<const AVFrame*>(frame)->hw_frames_ctx;
 
 			//Fill the data pointers in the destination frame
@@ -76,6 +341,7 @@ struct FFmpegUploaderImpl {
 			//Evaluate if the frame needs to be downloaded
 			if(hwAccelBuffer) {
 				//This is a hardware accelerated frame
+				metrics.hardwareFrameCount.add();
 				//Obtain which formats are supported for destination
 				FFmpeg::PixelFormat *supportedFormatsBegin, *supportedFormatsEnd;
 				av_hwframe_transfer_get_formats( //FIXME this function allocates data, undesired for real-time
@@ -88,22 +354,14 @@ struct FFmpegUploaderImpl {
 				while(*supportedFormatsEnd != FFmpeg::PixelFormat::none) ++supportedFormatsEnd; //Advance the end pointer til the end of the array
 
 				//Evaluate if any conversion is needed
-				if(std::find(supportedFormatsBegin, supportedFormatsEnd, dstFrame.getPixelFormat()) != supportedFormatsEnd) {
+				if(!downscaling && std::find(supportedFormatsBegin, supportedFormatsEnd, dstFrame.getPixelFormat()) != supportedFormatsEnd) {
 					//Destination format is directly supported for download
 					//Transfer the data to the destination
-					av_hwframe_transfer_data(
-						static_cast<AVFrame*>(dstFrame),
-						static_cast<const AVFrame*>(frame),
-						0
-					);
+					transfer(dstFrame, frame);
 				} else {
 					//TODO evaluate if intermediateFrame remains compatible for download
 					//Download the data. This will call reallocate the frame if necessary
-					av_hwframe_transfer_data(
-						static_cast<AVFrame*>(intermediateFrame),
-						static_cast<const AVFrame*>(frame),
-						0
-					);
+					transfer(intermediateFrame, frame);
 
 					//Copy the data from the intermediate frame
 					convert(dstFrame, intermediateFrame);
@@ -118,6 +376,10 @@ struct FFmpegUploaderImpl {
 			}
 
 			result->flush();
+			metrics.frameCount.add();
+			if(downscaling) {
+				metrics.downscaledFrameCount.add();
+			}
 			return result;
 		}
 
@@ -130,8 +392,20 @@ struct FFmpegUploaderImpl {
 		}
 
 	private:
+		void transfer(FFmpeg::Frame& dst, const FFmpeg::Frame& src) {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegUploader::transfer");
+			FFmpeg::ScopedLatency latency(metrics.transferLatency);
+			av_hwframe_transfer_data(
+				static_cast<AVFrame*>(dst),
+				static_cast<const AVFrame*>(src),
+				0
+			);
+		}
+
 		void convert(FFmpeg::Frame& dst, const FFmpeg::Frame& src) {
-			if(dst.getPixelFormat() == src.getPixelFormat()) {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegUploader::convert");
+			FFmpeg::ScopedLatency latency(metrics.convertLatency);
+			if(dst.getPixelFormat() == src.getPixelFormat() && dst.getResolution() == src.getResolution()) {
 				//No need for conversion, simply copy
 				av_frame_copy(
 					static_cast<AVFrame*>(dst), 
@@ -140,12 +414,13 @@ struct FFmpegUploaderImpl {
 			} else {
 				//A conversion needs to be done
 				constexpr int SWS_NO_SCALING_FILTER = 0x10;
+				constexpr int SWS_FAST_BILINEAR_FILTER = 0x01; //Cheap, as downscaling is only used for previews
 
 				//Ensure that the scaler (converter) is properly set-up
 				swscaleContext.recreate(
 					src.getResolution(), src.getPixelFormat(),
 					dst.getResolution(), dst.getPixelFormat(),
-					SWS_NO_SCALING_FILTER
+					(dst.getResolution() == src.getResolution()) ? SWS_NO_SCALING_FILTER : SWS_FAST_BILINEAR_FILTER
 				);
 
 				//Convert
@@ -184,18 +459,34 @@ struct FFmpegUploaderImpl {
 
 	using Input = Signal::Input<FFmpeg::FrameStream>;
 	using Output = Signal::Output<Zuazo::Video>;
+	using HDRMetadataOutput = Signal::Output<FFmpeg::HDRMetadataStream>;
 
 	std::reference_wrapper<FFmpegUploader> 	owner;
 
 	Input 									frameIn;
 	Output									videoOut;
+	HDRMetadataOutput						hdrMetadataOut;
 
+	Metrics									metrics;
 	std::unique_ptr<Open> 					opened;
 
+	std::unordered_map<FFmpeg::PixelFormat, FFmpeg::PixelFormat> bestConversions;
+	CompatibilityCache						compatibilities;
+	std::optional<FrameFormat>				currentFrameFormat;
+	HDRMetadataCache						hdrMetadataCache;
+	bool									downscalingEnabled;
+
 	FFmpegUploaderImpl(FFmpegUploader& uploader)
 		: owner(uploader)
 		, frameIn(uploader, std::string(Signal::makeInputName<FFmpeg::PacketStream>()))
 		, videoOut(uploader, std::string(Signal::makeOutputName<Video>()), createPullCallback(uploader))
+		, hdrMetadataOut(uploader, std::string(Signal::makeOutputName<FFmpeg::HDRMetadataStream>()))
+		, metrics()
+		, bestConversions()
+		, compatibilities()
+		, currentFrameFormat()
+		, hdrMetadataCache()
+		, downscalingEnabled(false)
 	{
 	}
 
@@ -206,6 +497,7 @@ struct FFmpegUploaderImpl {
 		frameIn.setLayout(base);
 		videoOut.setLayout(base);
 		videoOut.setPullCallback(createPullCallback(owner));
+		hdrMetadataOut.setLayout(base);
 	}
 
 	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
@@ -230,6 +522,9 @@ struct FFmpegUploaderImpl {
 		auto oldOpened = std::move(opened);
 		frameIn.reset();
 		videoOut.reset();
+		hdrMetadataOut.reset();
+		currentFrameFormat.reset();
+		hdrMetadataCache.reset();
 		
 		//Destroy stuff while unlocked
 		if(oldOpened) {
@@ -251,35 +546,30 @@ struct FFmpegUploaderImpl {
 		auto& uploader = owner.get();
 
 		if(uploader.isOpen() && frameIn.hasChanged()) {
-			const auto oldFrame = frameIn.getLastElement();
 			const auto& newFrame = frameIn.pull();
 
-			if(oldFrame && newFrame) {
-				//Frame remains valid. Check if characteristics have changed
-				if(	oldFrame->getResolution() != newFrame->getResolution() ||
-					oldFrame->getPixelAspectRatio() != newFrame->getPixelAspectRatio() ||
-					oldFrame->getColorPrimaries() != newFrame->getColorPrimaries() ||
-					oldFrame->getColorSpace() != newFrame->getColorSpace() ||
-					oldFrame->getColorTransferCharacteristic() != newFrame->getColorTransferCharacteristic() ||
-					oldFrame->getColorRange() != newFrame->getColorRange() ||
-					oldFrame->getPixelFormat() != newFrame->getPixelFormat() )
-				{
-					assert(newFrame);
-					uploader.setVideoModeCompatibility(createVideoModeCompatibility(*newFrame)); //May call videoModeCallback() in order to recreate
+			if(newFrame) {
+				//Only renegotiate if the characteristics have changed
+				FrameFormat frameFormat(*newFrame);
+				if(!currentFrameFormat || *currentFrameFormat != frameFormat) {
+					currentFrameFormat = frameFormat;
+					uploader.setVideoModeCompatibility(getVideoModeCompatibility(*newFrame, std::move(frameFormat))); //May call videoModeCallback() in order to recreate
 				}
-			} else if(oldFrame && !newFrame) {
+			} else if(currentFrameFormat) {
 				//Frame has become invalid
+				currentFrameFormat.reset();
 				uploader.setVideoModeCompatibility({});
-			} else if(!oldFrame && newFrame) {
-				//Frame has become valid
-				assert(newFrame);
-				uploader.setVideoModeCompatibility(createVideoModeCompatibility(*newFrame));
 			}
 
 			//Convert the frame if possible
 			if(opened){
 				assert(newFrame); //Opened should have been reset if invalid
+				if(hdrMetadataCache.update(*newFrame)) {
+					metrics.hdrMetadataParseCount.add();
+				}
+
 				videoOut.push(opened->process(*newFrame));
+				hdrMetadataOut.push(hdrMetadataCache.get()); //Shared among all the frames which use it
 			} 
 		}
 	}
@@ -301,6 +591,7 @@ struct FFmpegUploaderImpl {
 				//It has become invalid
 				opened.reset();
 				videoOut.reset();
+				hdrMetadataOut.reset();
 			} else if(!opened && isValid) {
 				//It has become valid
 				assert(frameIn.getLastElement());
@@ -308,19 +599,51 @@ struct FFmpegUploaderImpl {
 
 				opened = Utils::makeUnique<Open>(
 					uploader.getInstance().getVulkan(),
-					frameDesc
+					frameDesc,
+					metrics
 				);
 			}
 		}
 	}
 	
+	FFmpeg::Statistics getStatistics() const {
+		FFmpeg::Statistics result(owner.get().getName());
+
+		result.addLatency("process", metrics.processLatency);
+		result.addLatency("hwTransfer", metrics.transferLatency);
+		result.addLatency("convert", metrics.convertLatency);
+		result.addCounter("frames", metrics.frameCount);
+		result.addCounter("hwFrames", metrics.hardwareFrameCount);
+		result.addCounter("downscaledFrames", metrics.downscaledFrameCount);
+		result.addCounter("hdrMetadataParses", metrics.hdrMetadataParseCount);
+
+		return result;
+	}
+	
+	void setDownscalingEnabled(bool ena) {
+		if(downscalingEnabled != ena) {
+			downscalingEnabled = ena;
+
+			//Cached compatibilities are no longer valid. Renegotiate with the next frame
+			compatibilities.clear();
+			currentFrameFormat.reset();
+		}
+	}
+
+	bool getDownscalingEnabled() const {
+		return downscalingEnabled;
+	}
+
+	const FFmpeg::HDRMetadataStream& getHDRMetadata() const {
+		return hdrMetadataOut.getLastElement();
+	}
+
 	static bool isSupportedInput(FFmpeg::PixelFormat fmt) {
 		return isHardwarePixelFormat(fmt) || FFmpeg::SWScaleContext::isSupportedInput(fmt);
 	}
 
 private:
-	std::vector<VideoMode> createVideoModeCompatibility(const FFmpeg::Frame& frame) const {	
-		const auto& uploader = owner.get();
+	std::vector<VideoMode> createVideoModeCompatibility(const FFmpeg::Frame& frame) {	
 		std::vector<VideoMode> result;
 
 		const auto frameResolution = frame.getResolution();
@@ -331,7 +654,7 @@ private:
 		const auto frameColorRange = frame.getColorRange();
 		const auto framePixelFormat = getFramePixelFormat(frame);
 
-		const auto fmtConversion = FFmpeg::fromFFmpeg(getBestConversion(uploader.getInstance().getVulkan(), framePixelFormat));
+		const auto fmtConversion = FFmpeg::fromFFmpeg(getBestConversion(framePixelFormat));
 		constexpr auto defaultPixelAspectRatio = AspectRatio(1, 1);
 		const auto defaultColorPrimaries = ColorPrimaries::bt709;
 		const auto defaultColorModel = fmtConversion.isYCbCr ? ColorModel::bt709 : ColorModel::rgb;
@@ -351,7 +674,7 @@ private:
 
 		result.emplace_back(
 			Utils::Limit<Rate>(Utils::Any<Rate>()),
-			resolution ? Utils::Limit<Resolution>(Utils::MustBe<Resolution>(resolution)) : Utils::Limit<Resolution>(),
+			resolution ? createResolutionLimit(resolution) : Utils::Limit<Resolution>(),
 			pixelAspectRatio != AspectRatio(0, 1) ? Utils::Limit<AspectRatio>(Utils::MustBe<AspectRatio>(pixelAspectRatio)) : Utils::Limit<AspectRatio>(),
 			colorPrimaries != ColorPrimaries::none ? Utils::Limit<ColorPrimaries>(Utils::MustBe<ColorPrimaries>(colorPrimaries)) : Utils::Limit<ColorPrimaries>(),
 			colorModel != ColorModel::none ? Utils::Limit<ColorModel>(Utils::MustBe<ColorModel>(colorModel)) : Utils::Limit<ColorModel>(),
@@ -364,47 +687,38 @@ private:
 		return result;
 	}
 
-	static Chromaticities calculateColorPrimaries(	const Graphics::Frame::Descriptor& frameDesc, 
-													const FFmpeg::Frame& frame ) 
-	{
-		Chromaticities result = getChromaticities(frameDesc.getColorPrimaries());
-
-		//Evaluate if there is any information about the mastering display
-		const auto sideData = frame.getSideData();
-		const auto ite = std::find_if(
-			sideData.cbegin(), sideData.cend(),
-			[] (const FFmpeg::FrameSideData& entry) -> bool {
-				return entry.getType() == FFmpeg::FrameSideDataType::masteringDisplayMetadata;
-			}
-		);
-		if(ite != sideData.cend()) {
-			//It contains information about the mastering display
-			assert(ite->getData().size() >= sizeof(AVMasteringDisplayMetadata));
-			const auto& masteringDisplayMetadata = *reinterpret_cast<const AVMasteringDisplayMetadata*>(ite->getData().data());
-
-			if(masteringDisplayMetadata.has_luminance) {
-				const auto luminance = av_q2d(masteringDisplayMetadata.max_luminance);
-				result.setWhiteLuminance(luminance);
-			}
+	Utils::Limit<Resolution> createResolutionLimit(Resolution resolution) const {
+		//When downscaling, any smaller resolution can be produced with swscale.
+		//Scaling on the CPU is worth it as it reduces the amount of data to be uploaded
+		return 	downscalingEnabled 
+				? Utils::Limit<Resolution>(Utils::Range<Resolution>(Resolution(1, 1), resolution))
+				: Utils::Limit<Resolution>(Utils::MustBe<Resolution>(resolution));
+	}
 
-			if(masteringDisplayMetadata.has_primaries) {
-				const auto red_x = av_q2d(masteringDisplayMetadata.display_primaries[0][0]);
-				const auto red_y = av_q2d(masteringDisplayMetadata.display_primaries[0][1]);
-				const auto green_x = av_q2d(masteringDisplayMetadata.display_primaries[1][0]);
-				const auto green_y = av_q2d(masteringDisplayMetadata.display_primaries[1][1]);
-				const auto blue_x = av_q2d(masteringDisplayMetadata.display_primaries[2][0]);
-				const auto blue_y = av_q2d(masteringDisplayMetadata.display_primaries[2][1]);
-				const auto white_x = av_q2d(masteringDisplayMetadata.white_point[0]);
-				const auto white_y = av_q2d(masteringDisplayMetadata.white_point[1]);
-
-				result.setRedPrimary(Math::Vec2f(red_x, red_y));
-				result.setGreenPrimary(Math::Vec2f(green_x, green_y));
-				result.setBluePrimary(Math::Vec2f(blue_x, blue_y));
-				result.setWhitePoint(Math::Vec2f(white_x, white_y));
+	const std::vector<VideoMode>& getVideoModeCompatibility(const FFmpeg::Frame& frame, FrameFormat frameFormat) {
+		auto ite = compatibilities.find(frameFormat);
+		if(ite == compatibilities.cend()) {
+			if(compatibilities.size() >= MAX_COMPATIBILITY_CACHE_SIZE) {
+				compatibilities.clear();
 			}
+
+			ite = compatibilities.emplace(std::move(frameFormat), createVideoModeCompatibility(frame)).first;
 		}
 
-		return result;
+		assert(ite != compatibilities.cend());
+		return ite->second;
+	}
+
+	FFmpeg::PixelFormat getBestConversion(FFmpeg::PixelFormat srcFormat) {
+		//Supported formats do not change for a given instance, so the result can be reused
+		auto ite = bestConversions.find(srcFormat);
+		if(ite == bestConversions.cend()) {
+			const auto& vulkan = owner.get().getInstance().getVulkan();
+			ite = bestConversions.emplace(srcFormat, findBestConversion(vulkan, srcFormat)).first;
+		}
+
+		assert(ite != bestConversions.cend());
+		return ite->second;
 	}
 
 	static Output::PullCallback createPullCallback(FFmpegUploader& uplo) {
@@ -428,6 +742,7 @@ private:
 
 			assert(list);
 			result = list[0];
+			av_freep(&list);
 		} else {
 			result = frame.getPixelFormat();
 		}
@@ -435,7 +750,7 @@ private:
 		return result;
 	}
 
-	static FFmpeg::PixelFormat getBestConversion(	const Graphics::Vulkan& vulkan, 
+	static FFmpeg::PixelFormat findBestConversion(	const Graphics::Vulkan& vulkan, 
 													FFmpeg::PixelFormat srcFormat ) 
 	{
 		FFmpeg::PixelFormat best = FFmpeg::PixelFormat::none;
@@ -481,7 +796,7 @@ FFmpegUploader::FFmpegUploader(Instance& instance, std::string name)
 	, ZuazoBase(
 		instance, 
 		std::move(name),
-		{ (*this)->frameIn, (*this)->videoOut },
+		{ (*this)->frameIn, (*this)->videoOut, (*this)->hdrMetadataOut },
 		std::bind(&FFmpegUploaderImpl::moved, std::ref(**this), std::placeholders::_1),
 		std::bind(&FFmpegUploaderImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
 		std::bind(&FFmpegUploaderImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
@@ -500,6 +815,22 @@ FFmpegUploader::~FFmpegUploader() = default;
 
 FFmpegUploader& FFmpegUploader::operator=(FFmpegUploader&& other) = default;
 
+FFmpeg::Statistics FFmpegUploader::getStatistics() const {
+	return (*this)->getStatistics();
+}
+
+void FFmpegUploader::setDownscalingEnabled(bool ena) {
+	(*this)->setDownscalingEnabled(ena);
+}
+
+bool FFmpegUploader::getDownscalingEnabled() const {
+	return (*this)->getDownscalingEnabled();
+}
+
+const FFmpeg::HDRMetadataStream& FFmpegUploader::getHDRMetadata() const {
+	return (*this)->getHDRMetadata();
+}
+
 bool FFmpegUploader::isSupportedInput(FFmpeg::PixelFormat fmt) {
 	return FFmpegUploaderImpl::isSupportedInput(fmt);
 }
@@ -1,5 +1,8 @@
 #include <zuazo/Sources/FFmpegClip.h>
 
+#include "../FFmpeg/Tracing.h"
+#include "../FFmpeg/MetadataExtractor.h"
+
 #include <zuazo/FFmpeg/FFmpegConversions.h>
 #include <zuazo/Sources/FFmpegDemuxer.h>
 #include <zuazo/Processors/FFmpegDecoder.h>
@@ -11,8 +14,10 @@
 #include <zuazo/FFmpeg/Signals.h>
 
 #include <memory>
+#include <optional>
 #include <utility>
 #include <thread>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 
@@ -28,6 +33,29 @@ namespace Zuazo::Sources {
  */
 
 struct FFmpegClipImpl {
+	struct Metrics {
+		FFmpeg::LatencyHistogram	waitLatency;
+		FFmpeg::LatencyHistogram	decodeLatency;
+		FFmpeg::Counter				requestCount;
+		FFmpeg::Counter				blockedWaitCount;
+		FFmpeg::Counter				incompleteCount;
+		FFmpeg::Counter				seekCount;
+		FFmpeg::Counter				profileSwitchCount;
+		FFmpeg::Counter				loopCount;
+		FFmpeg::Counter				preRollFrameCount;
+		FFmpeg::Counter				preRollPacketDropCount;
+		FFmpeg::Counter				spliceCueCount;
+		FFmpeg::Counter				timecodeSeekCount;
+	};
+
+	//Written by the user, read by the decoding thread
+	struct DecodingSettings {
+		std::atomic<FFmpeg::DecodingProfile> profile;
+		std::atomic<bool>			adaptive;
+		std::atomic<Resolution>		previewResolution; //Zero when disabled
+		std::atomic<bool>			looping;
+	};
+
 	struct Open {
 		using DecoderOutput = Signal::PadProxy<Signal::Output<FFmpeg::FrameStream>>;
 
@@ -36,36 +64,90 @@ struct FFmpegClipImpl {
 		int							audioStreamIndex;
 		Processors::FFmpegDecoder 	videoDecoder;
 		Processors::FFmpegDecoder 	audioDecoder;
-
-		TimePoint					targetTimeStamp;
-		TimePoint					decodedTimeStamp;
+		FFmpegDemuxer::PacketQueues	packetQueues; //Reused among demux calls
+		FFmpeg::MetadataExtractor	metadataExtractor;
+		Duration					startTime; //Timestamp of the first frame
+		Metrics&					metrics;
+		const DecodingSettings&		settings;
+
+		//Shared between the render thread and the decoding thread without locking.
+		//The mutex and condition variables are only used to sleep
+		std::atomic<TimePoint>		targetTimeStamp;
+		std::atomic<TimePoint>		decodedTimeStamp;
+		std::atomic<uint32_t>		requestSequence;
+		std::atomic<uint32_t>		completeSequence;
+		std::atomic<bool>			decodingThreadExit;
+		std::atomic<bool>			decodingThreadSleeping;
+		std::atomic<bool>			consumerSleeping;
+
+		//Published along with the decoded timestamp
+		FFmpeg::FrameMetadata		metadata;
+
+		//Only accessed from the decoding thread
+		TimePoint					lastDecodedTimeStamp;
+		TimePoint					lastTargetTimeStamp;
+		FFmpeg::DecodingProfile		decodingProfile;
+		Resolution					previewResolution;
+		Duration					steadyPlayback;
+
+		//When looping, timestamps are unwrapped into a continuous timeline,
+		//so that the decoders don't need to be flushed at the loop point
+		Duration					loopDuration; //Zero if unknown
+		Duration					loopTargetOffset;
+		Duration					loopFrameOffset;
+		uint32_t					pendingLoops; //Demuxed but not decoded yet
+		bool						demuxedSinceLoop;
+		TimePoint					lastRequestedTimeStamp;
+
+		//Set while landing on the target after a seek
+		TimePoint					preRollTarget;
 
 		std::thread					decodingThread;
 		std::mutex					decodingMutex;
 		std::condition_variable		decodingStartCond;
 		std::condition_variable		decodingFinishCond;
-		bool						decodingComplete;
-		bool						decodingThreadExit;
 
 		static constexpr auto NO_TS = TimePoint(Duration(-1));
+		static constexpr Duration STEADY_PLAYBACK_THRESHOLD = std::chrono::seconds(1);
+		static constexpr Duration::rep MAX_UNSKIPPED_FRAMES = 16; //TODO find a way to obtain it from the codec GOP
+		static constexpr size_t MAX_BATCH_PACKETS = 64;
+		static constexpr size_t MAX_BATCH_BYTES = 16 << 20; //16MiB
 
-		Open(Sources::FFmpegDemuxer& demux)
+		Open(Sources::FFmpegDemuxer& demux, Metrics& metrics, const DecodingSettings& settings)
 			: demuxer(demux)
 			, videoStreamIndex(getStreamIndex(demuxer, Zuazo::FFmpeg::MediaType::video))
 			, audioStreamIndex(getStreamIndex(demuxer, Zuazo::FFmpeg::MediaType::video))
 			, videoDecoder(demuxer.getInstance(), "Video Decoder", getCodecParameters(demuxer, videoStreamIndex), Open::pixelFormatNegotiationCallback,	createDemuxCallback(videoStreamIndex))
 			, audioDecoder(demuxer.getInstance(), "Audio Decoder", getCodecParameters(demuxer, audioStreamIndex), {}, 									createDemuxCallback(audioStreamIndex))
+			, packetQueues()
+			, metadataExtractor(demuxer.getStreams(), videoStreamIndex)
+			, startTime(getStartTime(demuxer, videoStreamIndex))
+			, metrics(metrics)
+			, settings(settings)
+			, targetTimeStamp(NO_TS)
 			, decodedTimeStamp(NO_TS)
-			, decodingComplete(false)
+			, requestSequence(0)
+			, completeSequence(0)
 			, decodingThreadExit(false)
+			, decodingThreadSleeping(false)
+			, consumerSleeping(false)
+			, metadata()
+			, lastDecodedTimeStamp(NO_TS)
+			, lastTargetTimeStamp(NO_TS)
+			, decodingProfile(getInitialDecodingProfile(settings))
+			, previewResolution(settings.previewResolution.load(std::memory_order_relaxed))
+			, steadyPlayback()
+			, loopDuration(std::chrono::duration_cast<Duration>(demuxer.getDuration()))
+			, loopTargetOffset()
+			, loopFrameOffset()
+			, pendingLoops(0)
+			, demuxedSinceLoop(true)
+			, lastRequestedTimeStamp(NO_TS)
+			, preRollTarget(NO_TS)
 		{
-			//Route all the signals
-			routePacketStream(demuxer, videoDecoder, videoStreamIndex);
-			routePacketStream(demuxer, audioDecoder, audioStreamIndex);
-
 			//Enable multithreading and HW acceleration
-			configure(videoDecoder);
-			configure(audioDecoder);
+			configure(videoDecoder, decodingProfile, previewResolution);
+			configure(audioDecoder, FFmpeg::DecodingProfile::throughput, Resolution());
 
 			//Open them
 			open(videoDecoder, videoStreamIndex);
@@ -77,30 +159,55 @@ struct FFmpegClipImpl {
 
 		~Open() {
 			//Wait until the thread dies
-			std::unique_lock<std::mutex> lock(decodingMutex);
-			decodingThreadExit = true;
-			decodingStartCond.notify_all();
-			lock.unlock();
+			decodingThreadExit.store(true);
+			wakeDecodingThread();
 			decodingThread.join();
 		}
 
 		void decode(TimePoint target) {
-			std::lock_guard<std::mutex> lock(decodingMutex);
-
-			//Start decoding
-			decodingComplete = false;
-			targetTimeStamp = target;
-			decodingStartCond.notify_all();
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegClip::requestDecode");
+			//Publish the new target. The sequence number is incremented after writing 
+			//the target, so that the decoding thread sees it when noticing the request
+			targetTimeStamp.store(target, std::memory_order_relaxed);
+			requestSequence.fetch_add(1);
+			wakeDecodingThread();
+			metrics.requestCount.add();
 		}
 
 		bool waitDecode() {
-			std::unique_lock<std::mutex> lock(decodingMutex);
-
-			while(!decodingComplete) {
-				decodingFinishCond.wait(lock);
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegClip::waitDecode");
+			FFmpeg::ScopedLatency latency(metrics.waitLatency);
+			const auto request = requestSequence.load(std::memory_order_relaxed); //Only written by this thread
+
+			//Fast path: decoding has already finished
+			if(completeSequence.load(std::memory_order_acquire) != request) {
+				//Slow path: sleep until the decoding thread signals completion.
+				//The flag is raised before re-checking, so the notification can't be missed
+				metrics.blockedWaitCount.add();
+				std::unique_lock<std::mutex> lock(decodingMutex);
+				consumerSleeping.store(true);
+				decodingFinishCond.wait(lock, [this, request] { 
+					return completeSequence.load() == request; 
+				});
+				consumerSleeping.store(false, std::memory_order_relaxed);
 			}
 
-			return decodedTimeStamp >= targetTimeStamp;
+			return decodedTimeStamp.load(std::memory_order_relaxed) >= targetTimeStamp.load(std::memory_order_relaxed);
+		}
+
+		TimePoint getDecodedTimeStamp() const {
+			return decodedTimeStamp.load(std::memory_order_relaxed);
+		}
+
+		const FFmpeg::FrameMetadata& getMetadata() const {
+			return metadata;
+		}
+
+		std::optional<Duration> toClipTime(const FFmpeg::Timecode& timecode) const {
+			const auto timeStamp = metadataExtractor.toTimeStamp(timecode);
+			return 	timeStamp
+					? std::optional<Duration>(std::chrono::duration_cast<Duration>(*timeStamp) - startTime)
+					: std::nullopt;
 		}
 
 		Rate getFrameRate() {
@@ -110,62 +217,274 @@ struct FFmpegClipImpl {
 
 	private:
 		void decodingThreadFunc() {
-			std::unique_lock<std::mutex> lock(decodingMutex);
+			FFmpeg::Tracing::setThreadName("FFmpegClip decoding");
+			uint32_t served = 0;
+
+			while(waitRequest(served)) {
+				//Decoding is done without holding any lock
+				ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegClip::decode");
+				FFmpeg::ScopedLatency latency(metrics.decodeLatency);
+				served = requestSequence.load(std::memory_order_acquire);
+				const auto requested = targetTimeStamp.load(std::memory_order_relaxed);
 
-			while(!decodingThreadExit) {
 				//Evaluate if flushing is needed
 				const auto framePeriod = getPeriod(getFrameRate());
-				const auto delta = targetTimeStamp - decodedTimeStamp;
+				auto target = unwrapTimeStamp(requested, framePeriod);
+				const auto delta = target - lastDecodedTimeStamp;
 				const auto frameDelta = delta / framePeriod;
 			
-				constexpr Duration::rep MAX_UNSKIPPED_FRAMES = 16; //TODO find a way to obtain it from the codec GOP
-				if(frameDelta < 0 || frameDelta > MAX_UNSKIPPED_FRAMES) {
-					//Time delta is too high, seek the demuxer and flush all buffers
+				const auto seekNeeded = frameDelta < 0 || frameDelta > MAX_UNSKIPPED_FRAMES;
+				const auto decoderReconfigured = updateDecoderConfiguration(seekNeeded, target);
+				if(seekNeeded || decoderReconfigured) {
+					//Time delta is too high or the decoder has lost its references,
+					//seek the demuxer and flush all buffers
+					metrics.seekCount.add();
+					resetLoop();
+					target = requested;
+					preRollTarget = target;
 					demuxer.seek(
-						std::chrono::duration_cast<FFmpeg::Duration>(targetTimeStamp.time_since_epoch()), 
+						std::chrono::duration_cast<FFmpeg::Duration>(target.time_since_epoch() + startTime), 
 						FFmpeg::SeekFlags::backward
 					);
 
 					demuxer.flush();
 					flush(videoDecoder, videoStreamIndex);
 					flush(audioDecoder, audioStreamIndex);
+					metadataExtractor.flush();
 				}
 
 				//Decode
 				const auto streams = demuxer.getStreams();
-				decodedTimeStamp = TimePoint::max();
+				lastDecodedTimeStamp = TimePoint::max();
 				if(isValidIndex(videoStreamIndex)) {
-					decodedTimeStamp = Math::min(decodedTimeStamp, decode(videoDecoder, videoStreamIndex, streams, targetTimeStamp));
+					lastDecodedTimeStamp = Math::min(lastDecodedTimeStamp, decode(videoDecoder, videoStreamIndex, streams, target, framePeriod));
 				}
+				preRollTarget = NO_TS; //Landed
+				updateMetadata();
 				/*if(isValidIndex(audioStreamIndex)) { //TODO uncomment when audio decoding is used
-					decodedTimeStamp = Math::min(decodedTimeStamp, decode(audioDecoder, audioStreamIndex, streams, targetTimeStamp));
+					lastDecodedTimeStamp = Math::min(lastDecodedTimeStamp, decode(audioDecoder, audioStreamIndex, streams, target, framePeriod));
 				}*/
 				
-				//Wait until decoding is signaled
-				decodingComplete = true;
-				decodingFinishCond.notify_all();
-				decodingStartCond.wait(lock);
+				//Publish the result in the requested timeline. Releasing the sequence number also publishes the decoded frames
+				decodedTimeStamp.store(lastDecodedTimeStamp - loopTargetOffset, std::memory_order_relaxed);
+				completeSequence.store(served);
+				if(consumerSleeping.load()) {
+					//Lock so that the notification can't be lost
+					std::lock_guard<std::mutex> lock(decodingMutex);
+					decodingFinishCond.notify_all();
+				}
+			}
+		}
+
+		void updateMetadata() {
+			const auto& output = videoDecoder.getOutput();
+			if(isValidIndex(videoStreamIndex) && output.getLastElement()) {
+				metadataExtractor.extract(*(output.getLastElement()), metadata);
+
+				//Express the cues in the timeline of the clip
+				if(metadata.spliceCue) {
+					metadata.spliceCue->time -= std::chrono::duration_cast<FFmpeg::Duration>(startTime);
+					metrics.spliceCueCount.add();
+				}
+			} else {
+				metadata = FFmpeg::FrameMetadata();
+			}
+		}
+
+		bool updateDecoderConfiguration(bool seeking, TimePoint target) {
+			const auto profile = selectDecodingProfile(seeking, target);
+			const auto preview = settings.previewResolution.load(std::memory_order_relaxed);
+			if(profile == decodingProfile && preview == previewResolution) {
+				return false; //Nothing to do
+			}
+
+			//Threading and lowres can only be configured when opening the decoder
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegClip::reconfigureDecoder");
+			if(profile != decodingProfile) {
+				metrics.profileSwitchCount.add();
+			}
+
+			decodingProfile = profile;
+			previewResolution = preview;
+			reconfigure(videoDecoder, videoStreamIndex, decodingProfile, previewResolution);
+			return true;
+		}
+
+		FFmpeg::DecodingProfile selectDecodingProfile(bool seeking, TimePoint target) {
+			auto profile = settings.profile.load(std::memory_order_relaxed);
+
+			if(settings.adaptive.load(std::memory_order_relaxed)) {
+				//Measure how long the playback has been steady
+				if(seeking || lastTargetTimeStamp == NO_TS) {
+					steadyPlayback = Duration();
+				} else if(target > lastTargetTimeStamp) {
+					steadyPlayback += target - lastTargetTimeStamp;
+				}
+
+				//Use slice threading while scrubbing, so that seeks are not delayed by 
+				//the frame threads. As switching back implies decoding again from the 
+				//previous keyframe, only do it when the playback has been steady for a while
+				if(seeking || (decodingProfile == FFmpeg::DecodingProfile::scrub && steadyPlayback < STEADY_PLAYBACK_THRESHOLD)) {
+					profile = FFmpeg::DecodingProfile::scrub;
+				}
+			}
+
+			lastTargetTimeStamp = target;
+			return profile;
+		}
+
+		bool isLooping() const {
+			return loopDuration > Duration() && settings.looping.load(std::memory_order_relaxed);
+		}
+
+		TimePoint unwrapTimeStamp(TimePoint requested, Duration framePeriod) {
+			if(isLooping() && lastRequestedTimeStamp != NO_TS && requested < lastRequestedTimeStamp) {
+				//Evaluate if it has wrapped around the end, continuing close to the previous request
+				const auto distance = (loopDuration - lastRequestedTimeStamp.time_since_epoch()) + requested.time_since_epoch();
+				if(distance / framePeriod <= MAX_UNSKIPPED_FRAMES) {
+					loopTargetOffset += loopDuration;
+				}
+			}
+
+			lastRequestedTimeStamp = requested;
+			return requested + loopTargetOffset;
+		}
+
+		void resetLoop() {
+			loopTargetOffset = Duration();
+			loopFrameOffset = Duration();
+			pendingLoops = 0;
+			demuxedSinceLoop = true;
+		}
+
+		bool waitRequest(uint32_t served) {
+			//Fast path: there is a pending request
+			if(requestSequence.load(std::memory_order_acquire) == served && !decodingThreadExit.load(std::memory_order_relaxed)) {
+				//Slow path: sleep until a new request arrives
+				std::unique_lock<std::mutex> lock(decodingMutex);
+				decodingThreadSleeping.store(true);
+				decodingStartCond.wait(lock, [this, served] {
+					return requestSequence.load() != served || decodingThreadExit.load();
+				});
+				decodingThreadSleeping.store(false, std::memory_order_relaxed);
+			}
+
+			return !decodingThreadExit.load();
+		}
+
+		void wakeDecodingThread() {
+			if(decodingThreadSleeping.load()) {
+				//Lock so that the notification can't be lost
+				std::lock_guard<std::mutex> lock(decodingMutex);
+				decodingStartCond.notify_all();
 			}
 		}
 
 		void demuxCallback(int index) {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegClip::demuxCallback");
 			assert(isValidIndex(index));
 
-			do {
-				demuxer.update();
-				const auto lastIndex = demuxer.getLastStreamIndex();
+			for(;;) {
+				//Read all the packets up to the next one of this stream at once
+				const auto count = demuxer.readBatch(packetQueues, MAX_BATCH_PACKETS, MAX_BATCH_BYTES, index);
+				if(count > 0) {
+					demuxedSinceLoop = true;
+				}
 
-				if(isValidIndex(lastIndex)) {
-					if(lastIndex == videoStreamIndex) {
-						readPacket(videoDecoder, videoStreamIndex);
-					} else if (lastIndex == audioStreamIndex) {
-						readPacket(audioDecoder, audioStreamIndex);
+				if(dispatchPackets(index) > 0) {
+					break;
+				}
+
+				if(demuxer.isEndOfFile()) {
+					//Instead of draining the decoders, keep feeding them from the beginning, so that
+					//the first frames are ready when the loop point is reached. Don't do it if nothing 
+					//has been demuxed since the last loop, to avoid spinning on empty files
+					if(isLooping() && demuxedSinceLoop) {
+						loopDemuxer();
+						continue;
 					}
+
+					//Signal the flushing mode
+					readPacket(getDecoder(index), index, std::make_shared<const Zuazo::FFmpeg::Packet>());
+					break;
 				}
-			} while(demuxer.getLastStreamIndex() != index);
+
+				if(count == 0) {
+					break; //Unexpected error. Give up
+				}
+			}
+		}
+
+		size_t dispatchPackets(int index) {
+			size_t result = 0;
+
+			for(size_t i = 0; i < packetQueues.size(); ++i) {
+				const auto stream = static_cast<int>(i);
+				auto& queue = packetQueues[i];
+
+				for(auto& packet : queue) {
+					if(stream == videoStreamIndex) {
+						if(isDroppablePreRollPacket(*packet)) {
+							metrics.preRollPacketDropCount.add();
+							continue;
+						}
+						readPacket(videoDecoder, videoStreamIndex, std::move(packet));
+					} else if(stream == audioStreamIndex) {
+						readPacket(audioDecoder, audioStreamIndex, std::move(packet));
+					} else if(metadataExtractor.isCueStream(stream)) {
+						metadataExtractor.parse(*packet);
+						continue;
+					} else {
+						continue; //Not decoded
+					}
+
+					if(stream == index) {
+						++result;
+					}
+				}
+
+				queue.clear();
+			}
+
+			return result;
+		}
+
+		Processors::FFmpegDecoder& getDecoder(int index) {
+			assert(index == videoStreamIndex || index == audioStreamIndex);
+			return (index == videoStreamIndex) ? videoDecoder : audioDecoder;
+		}
+
+		void loopDemuxer() {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegClip::loopDemuxer");
+			metrics.loopCount.add();
+			demuxer.seek(std::chrono::duration_cast<FFmpeg::Duration>(startTime), FFmpeg::SeekFlags::backward);
+			demuxedSinceLoop = false;
+			++pendingLoops;
 		}
 
 
+		bool isDroppablePreRollPacket(const Zuazo::FFmpeg::Packet& packet) const {
+			//Non reference frames before the seek target won't be shown nor
+			//needed to decode other frames, so they can be skipped altogether
+			if(preRollTarget == NO_TS || pendingLoops > 0) {
+				return false;
+			}
+
+			if((packet.getFlags() & FFmpeg::PacketFlags::disposable) == FFmpeg::PacketFlags::none) {
+				return false;
+			}
+
+			const auto streams = demuxer.getStreams();
+			const auto& stream = streams[videoStreamIndex];
+			const auto pts = packet.getPTS();
+			const auto dur = packet.getDuration();
+			if(pts == AV_NOPTS_VALUE || dur <= 0) {
+				return false; //Not enough information
+			}
+
+			return toClipTime(stream, pts + dur) <= preRollTarget.time_since_epoch();
+		}
+
 		Processors::FFmpegDecoder::DemuxCallback createDemuxCallback(int index) {
 			return isValidIndex(index) ? std::bind(&Open::demuxCallback, std::ref(*this), index) : Processors::FFmpegDecoder::DemuxCallback();
 		}
@@ -183,12 +502,18 @@ struct FFmpegClipImpl {
 					: Zuazo::FFmpeg::CodecParameters();
 		}
 
-		static void routePacketStream(Sources::FFmpegDemuxer& demuxer, Processors::FFmpegDecoder& decoder, int index) {
-			if(isValidIndex(index)){
-				const auto outputName = Signal::makeOutputName<Zuazo::FFmpeg::PacketStream>(index);
-				auto& output = Signal::getOutput<Zuazo::FFmpeg::PacketStream>(demuxer, outputName);
-				decoder << output;
-			} 
+		static Duration getStartTime(const Sources::FFmpegDemuxer& demuxer, int index) {
+			Duration result = Duration();
+
+			if(isValidIndex(index)) {
+				const auto streams = demuxer.getStreams();
+				const auto& stream = streams[index];
+				if(stream.getStartTime() != AV_NOPTS_VALUE) {
+					result = rescale(stream, stream.getStartTime());
+				}
+			}
+
+			return result;
 		}
 
 		static void open(Processors::FFmpegDecoder& decoder, int index) {
@@ -203,14 +528,19 @@ struct FFmpegClipImpl {
 			}
 		}
 
-		static void readPacket(Processors::FFmpegDecoder& decoder, int index) {
+		static void readPacket(Processors::FFmpegDecoder& decoder, int index, Zuazo::FFmpeg::PacketStream packet) {
 			if(isValidIndex(index)) {
 				assert(decoder.isOpen());
-				decoder.readPacket();
+				decoder.readPacket(std::move(packet));
 			}
 		}
 
-		static TimePoint decode(Processors::FFmpegDecoder& decoder, int index, const FFmpegDemuxer::Streams& streams, TimePoint targetTimeStamp) {
+		TimePoint decode(	Processors::FFmpegDecoder& decoder, 
+							int index, 
+							const FFmpegDemuxer::Streams& streams, 
+							TimePoint targetTimeStamp,
+							Duration framePeriod ) 
+		{
 			TimePoint decodedTimeStamp = NO_TS;
 
 			if(isValidIndex(index)) {
@@ -222,15 +552,31 @@ struct FFmpegClipImpl {
 
 				//Set the decoded timestamp if available
 				if(output.getLastElement()) {
-					decodedTimeStamp = calculateTimeStamp(stream, *(output.getLastElement()));
+					decodedTimeStamp = calculateTimeStamp(stream, *(output.getLastElement()), NO_TS, framePeriod) + loopFrameOffset;
 				}
 
-				//Decode until the target timestamp is reached
+				//Decode until the target timestamp is reached. Frames before it are replaced
+				//by the following ones, returning them to the pool without being uploaded
 				while(decodedTimeStamp < targetTimeStamp) {
+					//Only after seeking. Otherwise the previous frame is always behind the target
+					if(preRollTarget != NO_TS && decodedTimeStamp != NO_TS) {
+						metrics.preRollFrameCount.add();
+					}
+
 					decoder.update();
 					if(output.getLastElement()) {
 						//Successfully decoded something!
-						decodedTimeStamp = calculateTimeStamp(stream, *(output.getLastElement()));
+						const auto previous = (decodedTimeStamp != NO_TS) ? decodedTimeStamp - loopFrameOffset : NO_TS;
+						auto timeStamp = calculateTimeStamp(stream, *(output.getLastElement()), previous, framePeriod) + loopFrameOffset;
+
+						//Frames of the next iteration go back in time. Move them after the current one
+						if(pendingLoops > 0 && decodedTimeStamp != NO_TS && timeStamp + loopDuration / 2 < decodedTimeStamp) {
+							--pendingLoops;
+							loopFrameOffset += loopDuration;
+							timeStamp += loopDuration;
+						}
+
+						decodedTimeStamp = timeStamp;
 					} else {
 						//Failed to decode. Exit
 						break;
@@ -248,29 +594,79 @@ struct FFmpegClipImpl {
 			}
 		}
 
-		static void configure(Processors::FFmpegDecoder& decoder) {
+		static void reconfigure(Processors::FFmpegDecoder& decoder, 
+								int index, 
+								FFmpeg::DecodingProfile profile,
+								Resolution previewResolution ) 
+		{
+			if(isValidIndex(index)) {
+				//Called from the decoding thread, so don't close and open it
+				assert(decoder.isOpen());
+				configure(decoder, profile, previewResolution);
+				decoder.reconfigure();
+			}
+		}
+
+		static void configure(	Processors::FFmpegDecoder& decoder, 
+								FFmpeg::DecodingProfile profile,
+								Resolution previewResolution ) 
+		{
 			decoder.setHardwareAccelerationEnabled(true); //Use hardware accel if possible
-			decoder.setThreadCount(0); //Use all available threads
-			decoder.setThreadType(FFmpeg::ThreadType::frame); //Don't care about the delay
+			decoder.setProfile(profile); //Threading
+			decoder.setPreviewResolution(previewResolution);
+		}
+
+		static FFmpeg::DecodingProfile getInitialDecodingProfile(const DecodingSettings& settings) {
+			//The first request always seeks
+			return 	settings.adaptive.load(std::memory_order_relaxed)
+					? FFmpeg::DecodingProfile::scrub
+					: settings.profile.load(std::memory_order_relaxed);
 		}
 
 		static bool isValidIndex(int index) {
 			return index >= 0;
 		}
 
-		static TimePoint calculateTimeStamp(const FFmpeg::StreamParameters& stream, const FFmpeg::Frame& frame) {
-			const auto pts = frame.getPTS();
+		//Returns the last instant where the frame is shown
+		TimePoint calculateTimeStamp(	const FFmpeg::StreamParameters& stream, 
+										const FFmpeg::Frame& frame,
+										TimePoint previous,
+										Duration framePeriod ) const
+		{
+			//Prefer the presentation timestamp. Otherwise use the one guessed by the decoder
+			auto pts = frame.getPTS();
+			if(pts == AV_NOPTS_VALUE) {
+				pts = frame.getBestEffortTS();
+			}
+
+			Duration begin;
+			if(pts != AV_NOPTS_VALUE) {
+				begin = toClipTime(stream, pts);
+			} else if(previous != NO_TS) {
+				begin = previous.time_since_epoch() + Duration(1); //Right after the previous one
+			} else {
+				return NO_TS;
+			}
+
+			//Some streams lack the duration. Assume the nominal frame period
 			const auto dur = frame.getPacketDuration();
-			const auto timeStamp = pts + dur;
+			const auto duration = (dur > 0) ? rescale(stream, dur) : framePeriod;
 
+			return TimePoint(begin + Math::max(duration, Duration(1)) - Duration(1));
+		}
+
+		//Converts a stream timestamp into the timeline of the clip
+		Duration toClipTime(const FFmpeg::StreamParameters& stream, int64_t timeStamp) const {
+			return rescale(stream, timeStamp) - startTime;
+		}
+
+		static Duration rescale(const FFmpeg::StreamParameters& stream, int64_t timeStamp) {
 			const auto timeBase = stream.getTimeBase();
-			const auto rescaledTimeStamp = (dur != 0 ? -1 : 0) + av_rescale_q(
+			return Duration(av_rescale_q(
 				timeStamp, 
 				AVRational{ timeBase.getNumerator(), timeBase.getDenominator() },	//Src time base
 				AVRational{ Duration::period::num, Duration::period::den }			//Dst time-base
-			);
-
-			return TimePoint(Duration(rescaledTimeStamp));
+			));
 		}
 
 		static FFmpeg::PixelFormat pixelFormatNegotiationCallback(	Processors::FFmpegDecoder& decoder,
@@ -301,21 +697,37 @@ struct FFmpegClipImpl {
 	std::reference_wrapper<FFmpegClip> 	owner;
 
 	Signal::DummyPad<Video>				videoOut;
+	Signal::Output<FFmpeg::MetadataStream> metadataOut;
 
 	Sources::FFmpegDemuxer 				demuxer;
 	Processors::FFmpegUploader 			videoUploader;
 
+	Metrics								metrics;
+	DecodingSettings					decodingSettings;
+	bool								previewEnabled;
+	Utils::Pool<FFmpeg::FrameMetadata>	metadataPool;
+	FFmpeg::FrameMetadata				metadata; //Of the last uploaded frame
 	std::unique_ptr<Open>				opened;
 
 	FFmpegClipImpl(FFmpegClip& ffmpeg, Instance& instance, std::string url)
 		: owner(ffmpeg)
 		, videoOut(ffmpeg, std::string(Signal::makeOutputName<Zuazo::Video>()))
+		, metadataOut(ffmpeg, std::string(Signal::makeOutputName<FFmpeg::MetadataStream>()))
 		, demuxer(instance, "Demuxer", std::move(url))
 		, videoUploader(instance, "Video Uploader")
+		, metrics()
+		, decodingSettings{ {FFmpeg::DecodingProfile::throughput}, {true}, {Resolution()}, {false} }
+		, previewEnabled(false)
+		, metadataPool()
+		, metadata()
 	{
 		//Route the output signal
 		videoOut << videoUploader;
 		videoUploader.setPreUpdateCallback(std::bind(&FFmpegClipImpl::uploaderPreUpdateCallback, std::ref(*this)));
+
+		//The timeline of the clip requires monotonic timestamps. Otherwise wraps and
+		//discontinuities would be taken as seeks
+		demuxer.setTimestampNormalizationEnabled(true);
 	}
 
 	~FFmpegClipImpl() = default;
@@ -323,6 +735,7 @@ struct FFmpegClipImpl {
 	void moved(ZuazoBase& base) {
 		owner = static_cast<FFmpegClip&>(base);
 		videoOut.setLayout(base);
+		metadataOut.setLayout(base);
 		auto& clip = static_cast<FFmpegClip&>(base);
 		clip.setRefreshCallback(std::bind(&FFmpegClip::update, std::ref(clip)));
 	}
@@ -343,7 +756,7 @@ struct FFmpegClipImpl {
 		}
 
 		//Open the decoders
-		opened = Utils::makeUnique<Open>(demuxer); //TODO create asynchronously
+		opened = Utils::makeUnique<Open>(demuxer, metrics, decodingSettings); //TODO create asynchronously
 
 		//Route the decoder signal
 		videoUploader << opened->videoDecoder;
@@ -368,6 +781,8 @@ struct FFmpegClipImpl {
 		clip.setTimeStep(Duration());
 
 		opened.reset(); //TODO reset asynchronously
+		metadata = FFmpeg::FrameMetadata();
+		metadataOut.reset();
 
 		//Close childs asynchronously if possible
 		if(lock) {
@@ -390,6 +805,7 @@ struct FFmpegClipImpl {
 	void update() {
 		if(opened) {
 			auto& clip = owner.get();
+			decodingSettings.looping.store(clip.getRepeat() == ClipBase::Repeat::repeat, std::memory_order_relaxed);
 			opened->decode(clip.getTime());
 		}
 	}
@@ -399,6 +815,7 @@ struct FFmpegClipImpl {
 		assert(&owner.get() == &clip); (void)(clip);
 
 		videoUploader.setVideoMode(videoMode);
+		updatePreviewResolution(videoMode);
 	}
 
 	VideoMode videoModeNegotiationCallback(VideoBase&, std::vector<VideoMode> compatibility) {
@@ -419,7 +836,132 @@ struct FFmpegClipImpl {
 		return clip.getVideoMode();
 	}
 
+	FFmpeg::Statistics getStatistics() const {
+		FFmpeg::Statistics result(owner.get().getName());
+
+		result.addLatency("waitDecode", metrics.waitLatency);
+		result.addLatency("decode", metrics.decodeLatency);
+		result.addCounter("requests", metrics.requestCount);
+		result.addCounter("blockedWaits", metrics.blockedWaitCount);
+		result.addCounter("incomplete", metrics.incompleteCount);
+		result.addCounter("seeks", metrics.seekCount);
+		result.addCounter("profileSwitches", metrics.profileSwitchCount);
+		result.addCounter("loops", metrics.loopCount);
+		result.addCounter("preRollFrames", metrics.preRollFrameCount);
+		result.addCounter("preRollPacketDrops", metrics.preRollPacketDropCount);
+		result.addCounter("spliceCues", metrics.spliceCueCount);
+		result.addCounter("timecodeSeeks", metrics.timecodeSeekCount);
+
+		result.addChild(demuxer.getStatistics());
+		if(opened) {
+			result.addChild(opened->videoDecoder.getStatistics());
+		}
+		result.addChild(videoUploader.getStatistics());
+
+		return result;
+	}
+
+	void setDecodingProfile(FFmpeg::DecodingProfile profile) {
+		decodingSettings.profile.store(profile, std::memory_order_relaxed);
+	}
+
+	FFmpeg::DecodingProfile getDecodingProfile() const {
+		return decodingSettings.profile.load(std::memory_order_relaxed);
+	}
+
+
+	void setAdaptiveDecodingProfile(bool ena) {
+		decodingSettings.adaptive.store(ena, std::memory_order_relaxed);
+	}
+
+	bool getAdaptiveDecodingProfile() const {
+		return decodingSettings.adaptive.load(std::memory_order_relaxed);
+	}
+
+
+	void setPreviewEnabled(bool ena) {
+		previewEnabled = ena;
+		videoUploader.setDownscalingEnabled(previewEnabled);
+		updatePreviewResolution(owner.get().getVideoMode());
+	}
+
+	bool getPreviewEnabled() const {
+		return previewEnabled;
+	}
+
+
+	void setAsyncIOEnabled(bool ena) {
+		demuxer.setAsyncIOEnabled(ena);
+	}
+
+	bool getAsyncIOEnabled() const {
+		return demuxer.getAsyncIOEnabled();
+	}
+
+
+	void setDirectIOEnabled(bool ena) {
+		demuxer.setDirectIOEnabled(ena);
+	}
+
+	bool getDirectIOEnabled() const {
+		return demuxer.getDirectIOEnabled();
+	}
+
+
+	void setSharingEnabled(bool ena) {
+		demuxer.setSharingEnabled(ena);
+	}
+
+	bool getSharingEnabled() const {
+		return demuxer.getSharingEnabled();
+	}
+
+
+	void setSegmentedURLEnabled(bool ena) {
+		demuxer.setSegmentedURLEnabled(ena);
+	}
+
+	bool getSegmentedURLEnabled() const {
+		return demuxer.getSegmentedURLEnabled();
+	}
+
+
+	void setFollowTimeout(Duration timeout) {
+		demuxer.setFollowTimeout(std::chrono::duration_cast<FFmpeg::Duration>(timeout));
+	}
+
+	Duration getFollowTimeout() const {
+		return std::chrono::duration_cast<Duration>(demuxer.getFollowTimeout());
+	}
+
+
+	const FFmpeg::FrameMetadata& getMetadata() const {
+		return metadata;
+	}
+
+	bool setTimecode(const FFmpeg::Timecode& timecode) {
+		const auto time = opened ? opened->toClipTime(timecode) : std::nullopt;
+		if(!time) {
+			return false; //Unknown
+		}
+
+		//The decoding thread will seek to the keyframe before it
+		metrics.timecodeSeekCount.add();
+		owner.get().setTime(TimePoint(Math::max(*time, Duration())));
+		return true;
+	}
+
+	const FFmpeg::HDRMetadataStream& getHDRMetadata() const {
+		return videoUploader.getHDRMetadata();
+	}
+
 private:
+	void updatePreviewResolution(const VideoMode& videoMode) {
+		//The decoding thread will pick it on the next request
+		const auto resolution = (previewEnabled && videoMode) ? videoMode.getResolutionValue() : Resolution();
+		decodingSettings.previewResolution.store(resolution, std::memory_order_relaxed);
+	}
+
 	void uploaderPreUpdateCallback() {
 		//Ensure the decoding has finished before pulling a frame
 		assert(opened);
@@ -427,8 +969,15 @@ private:
 		auto& clip = owner.get();
 		if(!opened->waitDecode()) {
 			//Could not decode til the end
-			clip.setDuration(opened->decodedTimeStamp.time_since_epoch());
+			metrics.incompleteCount.add();
+			clip.setDuration(opened->getDecodedTimeStamp().time_since_epoch());
 		}
+
+		//Publish the metadata of the frame which is about to be uploaded
+		metadata = opened->getMetadata();
+		auto element = metadataPool.acquire();
+		*element = metadata;
+		metadataOut.push(std::move(element));
 	}
 
 	static Duration calculateDuration(FFmpegDemuxer& demux) {
@@ -464,8 +1013,9 @@ FFmpegClip::FFmpegClip(	Instance& instance,
 		std::bind(&FFmpegClip::update, std::ref(*this)) )
 	, Signal::SourceLayout<Video>((*this)->videoOut.getOutput())
 {
-	//Add the output
+	//Add the outputs
 	ZuazoBase::registerPad((*this)->videoOut.getOutput());
+	ZuazoBase::registerPad((*this)->metadataOut);
 
 	//Setup the compatibility callback
 	(*this)->videoUploader.setVideoModeNegotiationCallback(
@@ -480,4 +1030,95 @@ FFmpegClip::~FFmpegClip() = default;
 
 FFmpegClip& FFmpegClip::operator=(FFmpegClip&& other) = default;
 
+
+
+void FFmpegClip::setDecodingProfile(FFmpeg::DecodingProfile profile) {
+	(*this)->setDecodingProfile(profile);
+}
+
+FFmpeg::DecodingProfile FFmpegClip::getDecodingProfile() const {
+	return (*this)->getDecodingProfile();
+}
+
+
+void FFmpegClip::setAdaptiveDecodingProfile(bool ena) {
+	(*this)->setAdaptiveDecodingProfile(ena);
+}
+
+bool FFmpegClip::getAdaptiveDecodingProfile() const {
+	return (*this)->getAdaptiveDecodingProfile();
+}
+
+
+void FFmpegClip::setPreviewEnabled(bool ena) {
+	(*this)->setPreviewEnabled(ena);
+}
+
+bool FFmpegClip::getPreviewEnabled() const {
+	return (*this)->getPreviewEnabled();
+}
+
+
+void FFmpegClip::setAsyncIOEnabled(bool ena) {
+	(*this)->setAsyncIOEnabled(ena);
+}
+
+bool FFmpegClip::getAsyncIOEnabled() const {
+	return (*this)->getAsyncIOEnabled();
+}
+
+
+void FFmpegClip::setDirectIOEnabled(bool ena) {
+	(*this)->setDirectIOEnabled(ena);
+}
+
+bool FFmpegClip::getDirectIOEnabled() const {
+	return (*this)->getDirectIOEnabled();
+}
+
+
+void FFmpegClip::setSharingEnabled(bool ena) {
+	(*this)->setSharingEnabled(ena);
+}
+
+bool FFmpegClip::getSharingEnabled() const {
+	return (*this)->getSharingEnabled();
+}
+
+
+void FFmpegClip::setSegmentedURLEnabled(bool ena) {
+	(*this)->setSegmentedURLEnabled(ena);
+}
+
+bool FFmpegClip::getSegmentedURLEnabled() const {
+	return (*this)->getSegmentedURLEnabled();
+}
+
+
+void FFmpegClip::setFollowTimeout(Duration timeout) {
+	(*this)->setFollowTimeout(timeout);
+}
+
+Duration FFmpegClip::getFollowTimeout() const {
+	return (*this)->getFollowTimeout();
+}
+
+
+const FFmpeg::FrameMetadata& FFmpegClip::getMetadata() const {
+	return (*this)->getMetadata();
+}
+
+bool FFmpegClip::setTimecode(const FFmpeg::Timecode& timecode) {
+	return (*this)->setTimecode(timecode);
+}
+
+const FFmpeg::HDRMetadataStream& FFmpegClip::getHDRMetadata() const {
+	return (*this)->getHDRMetadata();
+}
+
+
+FFmpeg::Statistics FFmpegClip::getStatistics() const {
+	return (*this)->getStatistics();
+}
+
 }
\ No newline at end of file
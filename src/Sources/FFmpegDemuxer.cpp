@@ -1,10 +1,16 @@
 #include <zuazo/Sources/FFmpegDemuxer.h>
 
 #include "../FFmpeg/InputFormatContext.h"
+#include "../FFmpeg/InputIOContext.h"
+#include "../FFmpeg/Reclaimer.h"
+#include "../FFmpeg/RecyclingPool.h"
+#include "../FFmpeg/SegmentedInputContext.h"
+#include "../FFmpeg/TimestampNormalizer.h"
+#include "../FFmpeg/Tracing.h"
 
 
+#include <zuazo/Exception.h>
 #include <zuazo/Utils/Functions.h>
-#include <zuazo/Utils/Pool.h>
 #include <zuazo/Signal/Output.h>
 #include <zuazo/FFmpeg/Signals.h>
 #include <zuazo/FFmpeg/FFmpegConversions.h>
@@ -12,6 +18,12 @@
 #include <memory>
 #include <cassert>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
 
 extern "C" {
 	#include <libavutil/avutil.h>
@@ -26,45 +38,565 @@ namespace Zuazo::Sources {
  */
 
 struct FFmpegDemuxerImpl {
-	struct Open {
+	struct Metrics {
+		FFmpeg::LatencyHistogram	readLatency;
+		FFmpeg::LatencyHistogram	seekLatency;
+		FFmpeg::Counter				packetCount;
+		FFmpeg::Counter				byteCount;
+		FFmpeg::Counter				endOfFileCount;
+		FFmpeg::Counter				errorCount;
+		FFmpeg::Counter				seekCount;
+		FFmpeg::Counter				flushCount;
+		FFmpeg::Counter				asyncIOFallbackCount;
+		FFmpeg::Counter				sharedPacketCount;
+		FFmpeg::Counter				sharedJoinCount;
+		FFmpeg::Counter				divergeCount;
+		FFmpeg::Counter				skippedPacketCount;
+		FFmpeg::Counter				timestampWrapCount;
+		FFmpeg::Counter				discontinuityCount;
+		FFmpeg::Counter				batchCount;
+	};
 
-		using PacketPool = Utils::Pool<FFmpeg::Packet>;
-		using Output = Signal::Output<FFmpeg::PacketStream>;
+	struct SourceSettings {
+		const Instance*				instance;
+		std::string					url;
+		FFmpegDemuxer::Options		options;
+		void*						interruptOpaque;
+		bool						asyncIOEnabled;
+		bool						directIOEnabled;
+		FFmpegDemuxer::Segments		segments;
+		bool						segmented;
+		FFmpeg::Duration			followTimeout;
+		bool						timestampNormalization;
+		std::string					key; //Empty if it can not be shared
+	};
+
+	//Opened input. It may be shared among several demuxers of the same instance,
+	//each of them reading it through its own cursor
+	struct Source {
+		using PacketPool = FFmpeg::RecyclingPool<FFmpeg::Packet>;
+		using PacketPtr = decltype(std::declval<PacketPool&>().acquire());
 
-		FFmpeg::InputFormatContext 	formatContext;
+		//Describes the last seek performed on the input. Nothing if it has not been seeked
+		struct Origin {
+			int							stream; //Negative if the timestamp is a FFmpeg::Duration
+			int64_t						timestamp;
+			FFmpeg::SeekFlags			flags;
+
+			bool operator==(const Origin& other) const {
+				return stream == other.stream && timestamp == other.timestamp && flags == other.flags;
+			}
+		};
+
+		struct Cursor {
+			uint64_t					position;
+			std::optional<Origin>		resume; //Where to continue if it has fallen out of the window
+		};
+
+		static constexpr int DIVERGED = 1; //Returned by read when the cursor needs to be relocated
+		static constexpr size_t HISTORY_SIZE = 64; //Consumed packets kept for late joiners
+		static constexpr size_t MAX_WINDOW_SIZE = 1024;
+		static constexpr size_t MAX_WINDOW_BYTES = 64 << 20; //64MiB
+
+		std::unique_ptr<FFmpeg::InputIOContext> ioContext; //Declared first, so that it outlives formatContext
+		FFmpeg::InputFormatContext 	formatContext; //Empty for segmented inputs
+		std::unique_ptr<FFmpeg::SegmentedInputContext> segmentedContext;
+		std::unique_ptr<FFmpeg::TimestampNormalizer> normalizer;
 		PacketPool 					pool;
-		std::vector<Output> 		pads;
-		int							lastIndex;
+		size_t						historySize;
+
+		std::mutex					mutex;
+		std::deque<PacketPtr>		window;
+		size_t						windowBytes;
+		uint64_t					windowBegin; //Position of the first packet in the window
+		std::optional<Origin>		origin;
+		uint64_t					originPosition;
+		bool						endOfFile;
+		std::vector<Cursor*>		cursors;
+
+		Source(const SourceSettings& settings, Metrics& metrics)
+			: ioContext((settings.asyncIOEnabled && !settings.segmented) ? createIOContext(settings, metrics) : nullptr)
+			, formatContext(
+				settings.segmented
+				? FFmpeg::InputFormatContext()
+				: FFmpeg::InputFormatContext(
+					settings.url.c_str(), 
+					settings.options, 
+					FFmpegDemuxerImpl::interruptCallback, 
+					settings.interruptOpaque, 
+					ioContext ? static_cast<FFmpeg::InputIOContext::Handle>(*ioContext) : nullptr ) )
+			, segmentedContext(settings.segmented ? createSegmentedContext(settings) : nullptr)
+			, normalizer(settings.timestampNormalization ? Utils::makeUnique<FFmpeg::TimestampNormalizer>(getStreams()) : nullptr)
+			, pool(FFmpeg::Reclaimer::getShared(settings.instance))
+			, historySize(settings.key.empty() ? 0 : HISTORY_SIZE)
+			, window()
+			, windowBytes(0)
+			, windowBegin(0)
+			, origin()
+			, originPosition(0)
+			, endOfFile(false)
+			, cursors()
+		{
+		}
 
+		~Source() {
+			assert(cursors.empty());
+		}
 
-		Open(const FFmpegDemuxer& demux, const char* url) 
-			: formatContext(url)
-			, pool()
-			, pads(createPads(demux, formatContext))
-			, lastIndex(-1)
+		FFmpegDemuxer::Streams getStreams() const {
+			return segmentedContext
+			? segmentedContext->getStreams()
+			: formatContext.getStreams();
+		}
+
+		int findBestStream(FFmpeg::MediaType type) const {
+			return segmentedContext
+			? segmentedContext->findBestStream(type)
+			: formatContext.findBestStream(type);
+		}
+
+		FFmpeg::Duration getDuration() const {
+			return segmentedContext
+			? segmentedContext->getDuration()
+			: formatContext.getDuration();
+		}
+
+		void attach(Cursor& cursor) {
+			std::lock_guard<std::mutex> lock(mutex);
+			cursor.position = originPosition;
+			cursor.resume.reset();
+			cursors.push_back(&cursor);
+		}
+
+		bool tryAttach(Cursor& cursor, const std::optional<Origin>& target) {
+			//Only possible if it has been seeked to the same place and 
+			//the packets from there are still available
+			std::lock_guard<std::mutex> lock(mutex);
+			if(origin == target && originPosition >= windowBegin) {
+				cursor.position = originPosition;
+				cursor.resume.reset();
+				cursors.push_back(&cursor);
+				return true;
+			}
+
+			return false;
+		}
+
+		void detach(Cursor& cursor) {
+			std::lock_guard<std::mutex> lock(mutex);
+			const auto ite = std::find(cursors.cbegin(), cursors.cend(), &cursor);
+			assert(ite != cursors.cend());
+			cursors.erase(ite);
+			trimWindow();
+		}
+
+		int read(Cursor& cursor, PacketPtr& packet, Metrics& metrics) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return readUnlocked(cursor, packet, metrics);
+		}
+
+		//Reads packets until the limits are reached or a packet of the stop 
+		//stream is read, locking only once. Packets are appended to the batch
+		int read(	Cursor& cursor, 
+					std::vector<PacketPtr>& batch, 
+					size_t& bytes,
+					size_t maxPackets,
+					size_t maxBytes,
+					int stopStream,
+					Metrics& metrics ) 
 		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			int result = 0;
+			PacketPtr packet;
+			while(batch.size() < maxPackets && bytes < maxBytes) {
+				result = readUnlocked(cursor, packet, metrics);
+				if(result != 0) {
+					break;
+				}
+
+				const auto index = packet->getStreamIndex();
+				bytes += packet->getData().size();
+				batch.push_back(std::move(packet));
+
+				if(index == stopStream) {
+					break;
+				}
+			}
+
+			return result;
 		}
 
-		~Open() = default;
+		bool trySeek(Cursor& cursor, const Origin& target, int& result) {
+			std::lock_guard<std::mutex> lock(mutex);
 
-		void update() {
-			//Acuqire a frame from the pool for demuxing
-			auto packet = pool.acquire();
+			//Only if nobody else is reading it
+			if(cursors.size() != 1) {
+				return false;
+			}
+
+			assert(cursors.front() == &cursor);
+			result = seek(target);
+			cursor.position = originPosition;
+			cursor.resume.reset();
+			return true;
+		}
+
+		int seek(const Origin& target) {
+			//Seek in the timeline of the input
+			auto input = target;
+			if(normalizer) {
+				input.timestamp = (target.stream < 0)
+				? normalizer->toInput(FFmpeg::Duration(target.timestamp)).count()
+				: normalizer->toInput(target.stream, target.timestamp);
+			}
+
+			int result;
+			if(segmentedContext) {
+				result = (input.stream < 0)
+				? segmentedContext->seek(FFmpeg::Duration(input.timestamp), input.flags)
+				: segmentedContext->seek(input.stream, input.timestamp, input.flags) ;
+			} else {
+				result = (input.stream < 0)
+				? formatContext.seek(FFmpeg::Duration(input.timestamp), input.flags)
+				: formatContext.seek(input.stream, input.timestamp, input.flags) ;
+			}
+
+			if(normalizer) {
+				normalizer->reset(target.stream, target.timestamp);
+			}
+
+			//Start over
+			windowBegin += window.size();
+			window.clear();
+			windowBytes = 0;
+			origin = target;
+			originPosition = windowBegin;
+			endOfFile = false;
+
+			return result;
+		}
+
+		bool tryFlush(Cursor& cursor, int& result) {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			//Flushing would discard data needed by others
+			if(cursors.size() != 1) {
+				return false;
+			}
+
+			assert(cursors.front() == &cursor);
+			Utils::ignore(cursor);
+			result = segmentedContext ? segmentedContext->flush() : formatContext.flush();
+			return true;
+		}
+
+	private:
+		int readUnlocked(Cursor& cursor, PacketPtr& packet, Metrics& metrics) {
+			if(cursor.position < windowBegin) {
+				//Fallen behind the window
+				if(cursor.resume) {
+					return DIVERGED;
+				}
+
+				//Nowhere to resume from. Continue with what is available
+				metrics.skippedPacketCount.add(windowBegin - cursor.position);
+				cursor.position = windowBegin;
+			}
+
+			const auto windowEnd = windowBegin + window.size();
+			if(cursor.position < windowEnd) {
+				//Already read by other consumer
+				packet = window[cursor.position - windowBegin];
+				++cursor.position;
+				metrics.sharedPacketCount.add();
+				trimWindow();
+				return 0;
+			}
+
+			//Read a new packet. The pool hands it out clear, so that garbage is not sent
+			packet = pool.acquire();
 			assert(packet);
 
-			//Ensure that the frame is clear in order to avoid sending garbage
-			packet->unref();
+			if(endOfFile) {
+				return AVERROR_EOF;
+			}
+
+			const auto result = segmentedContext
+				? segmentedContext->readPacket(*packet)
+				: formatContext.readPacket(*packet);
+			if(result == AVERROR_EOF) {
+				endOfFile = true;
+			} else if(result == 0) {
+				if(normalizer) {
+					normalize(*packet, metrics);
+				}
+
+				window.push_back(packet);
+				windowBytes += packet->getData().size();
+				++cursor.position;
+				trimWindow();
+			}
+
+			return result;
+		}
+
+		void trimWindow() {
+			//Drop the consumed packets, but keep some history for late joiners
+			uint64_t minPosition = windowBegin + window.size();
+			for(const auto* cursor : cursors) {
+				minPosition = std::min(minPosition, cursor->position);
+			}
+
+			while(!window.empty() && windowBegin < minPosition && window.size() > historySize) {
+				popWindow();
+			}
+
+			//Bound the memory when a consumer lags far behind. It will diverge
+			while(window.size() > MAX_WINDOW_SIZE || (windowBytes > MAX_WINDOW_BYTES && window.size() > 1)) {
+				for(auto* cursor : cursors) {
+					if(cursor->position == windowBegin && !cursor->resume) {
+						cursor->resume = getResumeOrigin(*window.front());
+					}
+				}
+
+				popWindow();
+			}
+		}
+
+		void normalize(FFmpeg::Packet& packet, Metrics& metrics) {
+			assert(normalizer);
+			const auto wrapCount = normalizer->getWrapCount();
+			const auto discontinuityCount = normalizer->getDiscontinuityCount();
+
+			normalizer->normalize(packet);
+
+			metrics.timestampWrapCount.add(normalizer->getWrapCount() - wrapCount);
+			metrics.discontinuityCount.add(normalizer->getDiscontinuityCount() - discontinuityCount);
+		}
+
+		void popWindow() {
+			assert(!window.empty());
+			windowBytes -= window.front()->getData().size();
+			window.pop_front();
+			++windowBegin;
+		}
+
+		static std::optional<Origin> getResumeOrigin(const FFmpeg::Packet& packet) {
+			std::optional<Origin> result;
+
+			const auto timestamp = (packet.getDTS() != AV_NOPTS_VALUE) ? packet.getDTS() : packet.getPTS();
+			if(timestamp != AV_NOPTS_VALUE) {
+				result = Origin{ packet.getStreamIndex(), timestamp, FFmpeg::SeekFlags::backward };
+			}
+
+			return result;
+		}
+
+		static std::unique_ptr<FFmpeg::SegmentedInputContext> createSegmentedContext(const SourceSettings& settings) {
+			FFmpeg::SegmentedInputContext::IOSettings ioSettings;
+			ioSettings.ring = settings.asyncIOEnabled ? FFmpeg::InputIOContext::getSharedRing(settings.instance) : nullptr;
+			ioSettings.direct = settings.asyncIOEnabled && settings.directIOEnabled;
+			ioSettings.followTimeout = settings.followTimeout;
+
+			//May throw!
+			return settings.segments.empty()
+			? Utils::makeUnique<FFmpeg::SegmentedInputContext>(
+				settings.url.c_str(),
+				settings.options,
+				FFmpegDemuxerImpl::interruptCallback,
+				settings.interruptOpaque,
+				std::move(ioSettings) )
+			: Utils::makeUnique<FFmpeg::SegmentedInputContext>(
+				settings.segments,
+				settings.options,
+				FFmpegDemuxerImpl::interruptCallback,
+				settings.interruptOpaque,
+				std::move(ioSettings) );
+		}
+
+		static std::unique_ptr<FFmpeg::InputIOContext> createIOContext(const SourceSettings& settings, Metrics& metrics) {
+			std::unique_ptr<FFmpeg::InputIOContext> result;
+
+			const auto* path = FFmpeg::InputIOContext::getLocalPath(settings.url.c_str());
+			if(path) {
+				try {
+					result = Utils::makeUnique<FFmpeg::InputIOContext>(
+						path, 
+						FFmpeg::InputIOContext::getSharedRing(settings.instance),
+						settings.directIOEnabled
+					);
+				} catch(const Exception&) {
+					//Not a regular file. Let FFmpeg open it
+					metrics.asyncIOFallbackCount.add();
+				}
+			}
+
+			return result;
+		}
+
+	};
+
+	using SourcePtr = std::shared_ptr<Source>;
+
+	//Opened sources which may be shared, indexed by instance, URL and options
+	class SourceCache {
+	public:
+		static SourcePtr attach(const SourceSettings& settings, 
+								const std::optional<Source::Origin>& origin, 
+								Source::Cursor& cursor,
+								const Source* exclude,
+								Metrics& metrics,
+								int* seekResult = nullptr )
+		{
+			if(!settings.key.empty()) {
+				auto result = tryAttach(settings.key, origin, cursor, exclude);
+				if(result) {
+					metrics.sharedJoinCount.add();
+					return result;
+				}
+			}
+
+			//Open a new one. Done in an unlocked environment as it may take a while
+			//May throw!
+			auto result = std::make_shared<Source>(settings, metrics);
+			if(origin) {
+				const auto res = result->seek(*origin);
+				if(seekResult) *seekResult = res;
+			}
+			result->attach(cursor);
+
+			if(!settings.key.empty()) {
+				std::lock_guard<std::mutex> lock(getMutex());
+				auto& sources = getSources();
+
+				//Drop the sources which are no longer in use
+				for(auto ite = sources.begin(); ite != sources.end(); ) {
+					ite = ite->second.expired() ? sources.erase(ite) : std::next(ite);
+				}
+
+				sources.emplace(settings.key, result);
+			}
+
+			return result;
+		}
+
+		static SourcePtr tryAttach(	const std::string& key, 
+									const std::optional<Source::Origin>& origin, 
+									Source::Cursor& cursor,
+									const Source* exclude )
+		{
+			std::lock_guard<std::mutex> lock(getMutex());
+			const auto range = getSources().equal_range(key);
+			for(auto ite = range.first; ite != range.second; ++ite) {
+				auto source = ite->second.lock();
+				if(source && source.get() != exclude && source->tryAttach(cursor, origin)) {
+					return source;
+				}
+			}
+
+			return nullptr;
+		}
+
+		static std::string makeKey(const SourceSettings& settings) {
+			//Sort the options, so that the order does not matter
+			std::vector<std::pair<std::string, std::string>> sortedOptions(settings.options.cbegin(), settings.options.cend());
+			std::sort(sortedOptions.begin(), sortedOptions.end());
+
+			std::ostringstream result;
+			result 	<< static_cast<const void*>(settings.instance) << '\n' 
+					<< settings.url << '\n' 
+					<< settings.asyncIOEnabled << settings.directIOEnabled << '\n'
+					<< settings.segmented << '\n'
+					<< settings.followTimeout.count() << '\n'
+					<< settings.timestampNormalization << '\n';
+			for(const auto& segment : settings.segments) {
+				result << segment << '\n';
+			}
+			for(const auto& option : sortedOptions) {
+				result << option.first << '=' << option.second << '\n';
+			}
+
+			return result.str();
+		}
+
+	private:
+		static std::mutex& getMutex() {
+			static std::mutex mutex;
+			return mutex;
+		}
+
+		static std::unordered_multimap<std::string, std::weak_ptr<Source>>& getSources() {
+			static std::unordered_multimap<std::string, std::weak_ptr<Source>> sources;
+			return sources;
+		}
+
+	};
+
+	struct Open {
+		using Output = Signal::Output<FFmpeg::PacketStream>;
+
+		SourceSettings				settings;
+		Metrics&					metrics;
+		Source::Cursor				cursor; //Declared before source, as it is attached to it
+		SourcePtr					source;
+		std::vector<Output> 		pads;
+		std::vector<Source::PacketPtr> batch; //Reused among batch reads
+		int							lastIndex;
+		bool						endOfFile;
+
+
+		Open(	const FFmpegDemuxer& demux, 
+				SourceSettings settings,
+				Metrics& metrics ) 
+			: settings(std::move(settings))
+			, metrics(metrics)
+			, cursor()
+			, source(SourceCache::attach(this->settings, std::nullopt, cursor, nullptr, metrics))
+			, pads(createPads(demux, source->getStreams().size()))
+			, batch()
+			, lastIndex(-1)
+			, endOfFile(false)
+		{
+		}
+
+		~Open() {
+			source->detach(cursor);
+		}
+
+		void update() {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegDemuxer::update");
+
+			Source::PacketPtr packet;
+			int readResult;
+			{
+				FFmpeg::ScopedLatency latency(metrics.readLatency);
+				readResult = source->read(cursor, packet, metrics);
+
+				if(readResult == Source::DIVERGED) {
+					//Other consumer has gone too far ahead. Continue on our own
+					assert(cursor.resume);
+					metrics.divergeCount.add();
+					relocate(*cursor.resume);
+					readResult = source->read(cursor, packet, metrics);
+				}
+			}
 
-			const int readResult = formatContext.readPacket(*packet);
 			switch(readResult) {
 			case 0:	//Success!
 				lastIndex = packet->getStreamIndex(); //Succesfully extracted a frame
+				endOfFile = false;
+				metrics.packetCount.add();
+				metrics.byteCount.add(packet->getData().size());
 				break;
 			case AVERROR_EOF: //End of file: Signal flusing mode (packet will be empty)
 				lastIndex = (lastIndex + 1) % pads.size(); //Just walk though all the pads
+				endOfFile = true;
+				metrics.endOfFileCount.add();
 				break;
 			default: //Unexpected!
 				lastIndex = -1;
+				metrics.errorCount.add();
 				return;
 
 			}
@@ -73,9 +605,112 @@ struct FFmpegDemuxerImpl {
 			pads[lastIndex].push(std::move(packet));
 		}
 
+		size_t readBatch(	FFmpegDemuxer::PacketQueues& queues, 
+							size_t maxPackets, 
+							size_t maxBytes, 
+							int stopStream ) 
+		{
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegDemuxer::readBatch");
+			assert(batch.empty());
+
+			size_t bytes = 0;
+			int readResult;
+			{
+				FFmpeg::ScopedLatency latency(metrics.readLatency);
+				readResult = source->read(cursor, batch, bytes, maxPackets, maxBytes, stopStream, metrics);
+
+				if(readResult == Source::DIVERGED) {
+					//Other consumer has gone too far ahead. Continue on our own
+					assert(cursor.resume);
+					metrics.divergeCount.add();
+					relocate(*cursor.resume);
+					readResult = source->read(cursor, batch, bytes, maxPackets, maxBytes, stopStream, metrics);
+				}
+			}
+
+			//Distribute the packets among their streams
+			const auto result = batch.size();
+			queues.resize(pads.size());
+			for(auto& packet : batch) {
+				lastIndex = packet->getStreamIndex();
+				assert(lastIndex >= 0 && lastIndex < static_cast<int>(queues.size()));
+				queues[lastIndex].push_back(std::move(packet));
+			}
+			batch.clear();
+
+			metrics.batchCount.add();
+			metrics.packetCount.add(result);
+			metrics.byteCount.add(bytes);
+
+			switch(readResult) {
+			case 0:	//Success!
+				endOfFile = false;
+				break;
+			case AVERROR_EOF: //End of file. Flushing is left to the caller
+				endOfFile = true;
+				metrics.endOfFileCount.add();
+				break;
+			default: //Unexpected!
+				if(result == 0) {
+					lastIndex = -1;
+				}
+				metrics.errorCount.add();
+				break;
+			}
+
+			return result;
+		}
+
+		bool seek(const Source::Origin& target) {
+			endOfFile = false;
+			return relocate(target) >= 0;
+		}
+
+		bool flush() {
+			int result = 0;
+			if(!source->tryFlush(cursor, result)) {
+				return false; //Shared. It would discard the data needed by the others
+			}
+
+			return result >= 0;
+		}
+
 	private:
-		static std::vector<Output> createPads(const FFmpegDemuxer& demux, const FFmpeg::InputFormatContext& fmt) {
-			const size_t streamCount = fmt.getStreams().size();
+		int relocate(const Source::Origin& target) {
+			int result = 0;
+
+			//Prefer joining others which have seeked to the same place
+			if(!settings.key.empty()) {
+				auto other = SourceCache::tryAttach(settings.key, target, cursor, source.get());
+				if(other) {
+					metrics.sharedJoinCount.add();
+					source->detach(cursor);
+					source = std::move(other);
+					return result;
+				}
+			}
+
+			//Seek in place if nobody else is reading it
+			if(source->trySeek(cursor, target, result)) {
+				return result;
+			}
+
+			//Diverge from the rest, opening it again
+			try {
+				Source::Cursor newCursor;
+				auto newSource = SourceCache::attach(settings, target, newCursor, source.get(), metrics, &result);
+				source->detach(cursor);
+				newSource->attach(cursor); //Before detaching, so that the window is kept
+				newSource->detach(newCursor);
+				source = std::move(newSource);
+			} catch(const Exception&) {
+				result = AVERROR(EIO);
+			}
+
+			return result;
+		}
+
+		static std::vector<Output> createPads(const FFmpegDemuxer& demux, size_t streamCount) {
 			std::vector<Output> result;
 			result.reserve(streamCount);
 
@@ -89,10 +724,30 @@ struct FFmpegDemuxerImpl {
 	};
 
 	std::string 			url;
+	FFmpegDemuxer::Options	options;
+	FFmpegDemuxer::InterruptCallback interruptCbk;
+	bool					asyncIOEnabled;
+	bool					directIOEnabled;
+	bool					sharingEnabled;
+	FFmpegDemuxer::Segments	segments;
+	bool					segmentedURLEnabled;
+	FFmpeg::Duration		followTimeout;
+	bool					timestampNormalizationEnabled;
+	Metrics					metrics;
 	std::unique_ptr<Open> 	opened;
 
 	FFmpegDemuxerImpl(std::string url) 
 		: url(std::move(url))
+		, options()
+		, interruptCbk()
+		, asyncIOEnabled(false)
+		, directIOEnabled(false)
+		, sharingEnabled(false)
+		, segments()
+		, segmentedURLEnabled(false)
+		, followTimeout()
+		, timestampNormalizationEnabled(false)
+		, metrics()
 	{
 	}
 
@@ -107,7 +762,7 @@ struct FFmpegDemuxerImpl {
 		//Create in a unlocked environment
 		if(lock) lock->unlock(); //FIXME, if it throws, lock must be re-locked
 		//May throw! (nothing has been done yet, so don't worry about cleaning)
-		auto newOpened = Utils::makeUnique<Open>(demux, url.c_str()); 
+		auto newOpened = Utils::makeUnique<Open>(demux, createSourceSettings(demux), metrics); 
 		if(lock) lock->lock();
 		
 		//Apply changes after locking
@@ -157,15 +812,109 @@ struct FFmpegDemuxerImpl {
 
 
 
+	size_t readBatch(	FFmpegDemuxer::PacketQueues& queues, 
+						size_t maxPackets, 
+						size_t maxBytes, 
+						int stopStream ) 
+	{
+		return opened 
+		? opened->readBatch(queues, maxPackets, maxBytes, stopStream)
+		: 0;
+	}
+
+
+
+	void setOptions(FFmpegDemuxer::Options opt) {
+		options = std::move(opt);
+	}
+
+	const FFmpegDemuxer::Options& getOptions() const {
+		return options;
+	}
+
+
+	void setInterruptCallback(FFmpegDemuxer::InterruptCallback cbk) {
+		interruptCbk = std::move(cbk);
+	}
+
+	const FFmpegDemuxer::InterruptCallback& getInterruptCallback() const {
+		return interruptCbk;
+	}
+
+
+	void setAsyncIOEnabled(bool ena) {
+		asyncIOEnabled = ena;
+	}
+
+	bool getAsyncIOEnabled() const {
+		return asyncIOEnabled;
+	}
+
+
+	void setDirectIOEnabled(bool ena) {
+		directIOEnabled = ena;
+	}
+
+	bool getDirectIOEnabled() const {
+		return directIOEnabled;
+	}
+
+
+	void setSharingEnabled(bool ena) {
+		sharingEnabled = ena;
+	}
+
+	bool getSharingEnabled() const {
+		return sharingEnabled;
+	}
+
+
+	void setSegments(FFmpegDemuxer::Segments seg) {
+		segments = std::move(seg);
+	}
+
+	const FFmpegDemuxer::Segments& getSegments() const {
+		return segments;
+	}
+
+
+	void setSegmentedURLEnabled(bool ena) {
+		segmentedURLEnabled = ena;
+	}
+
+	bool getSegmentedURLEnabled() const {
+		return segmentedURLEnabled;
+	}
+
+
+	void setFollowTimeout(FFmpeg::Duration timeout) {
+		followTimeout = timeout;
+	}
+
+	FFmpeg::Duration getFollowTimeout() const {
+		return followTimeout;
+	}
+
+
+	void setTimestampNormalizationEnabled(bool ena) {
+		timestampNormalizationEnabled = ena;
+	}
+
+	bool getTimestampNormalizationEnabled() const {
+		return timestampNormalizationEnabled;
+	}
+
+
+
 	FFmpegDemuxer::Streams getStreams() const {
 		return opened
-		? opened->formatContext.getStreams()
+		? opened->source->getStreams()
 		: FFmpegDemuxer::Streams();
 	}
 
 	int findBestStream(FFmpeg::MediaType type) const {
 		return opened
-		? opened->formatContext.findBestStream(type)
+		? opened->source->findBestStream(type)
 		: -1;
 	}
 	
@@ -175,31 +924,97 @@ struct FFmpegDemuxerImpl {
 		: -1;
 	}
 
+	bool isEndOfFile() const {
+		return opened && opened->endOfFile;
+	}
+
 	FFmpeg::Duration getDuration() const {
 		return opened 
-		? opened->formatContext.getDuration()
+		? opened->source->getDuration()
 		: FFmpeg::Duration();
 	}
 
 
 
 	bool seek(int stream, int64_t timestamp, FFmpeg::SeekFlags flags) {
+		metrics.seekCount.add();
+		FFmpeg::ScopedLatency latency(metrics.seekLatency);
 		return opened 
-		? opened->formatContext.seek(stream, timestamp, flags) >= 0
+		? opened->seek(Source::Origin{ stream, timestamp, flags })
 		: false;
 	}
 
 	bool seek(FFmpeg::Duration timestamp, FFmpeg::SeekFlags flags) {
+		metrics.seekCount.add();
+		FFmpeg::ScopedLatency latency(metrics.seekLatency);
 		return opened 
-		? opened->formatContext.seek(timestamp, flags) >= 0
+		? opened->seek(Source::Origin{ -1, timestamp.count(), flags })
 		: false;
 	}
 	
 	bool flush() {
+		metrics.flushCount.add();
 		return opened 
-		? opened->formatContext.flush() >= 0
+		? opened->flush()
 		: false;
 	}
+
+
+	FFmpeg::Statistics getStatistics(const std::string& name) const {
+		FFmpeg::Statistics result(name);
+
+		result.addLatency("read", metrics.readLatency);
+		result.addLatency("seek", metrics.seekLatency);
+		result.addCounter("packets", metrics.packetCount);
+		result.addCounter("bytes", metrics.byteCount);
+		result.addCounter("endOfFile", metrics.endOfFileCount);
+		result.addCounter("errors", metrics.errorCount);
+		result.addCounter("seeks", metrics.seekCount);
+		result.addCounter("flushes", metrics.flushCount);
+		result.addCounter("asyncIOFallbacks", metrics.asyncIOFallbackCount);
+		result.addCounter("sharedPackets", metrics.sharedPacketCount);
+		result.addCounter("sharedJoins", metrics.sharedJoinCount);
+		result.addCounter("diverges", metrics.divergeCount);
+		result.addCounter("skippedPackets", metrics.skippedPacketCount);
+		result.addCounter("timestampWraps", metrics.timestampWrapCount);
+		result.addCounter("discontinuities", metrics.discontinuityCount);
+		result.addCounter("batches", metrics.batchCount);
+
+		return result;
+	}
+
+private:
+	SourceSettings createSourceSettings(const FFmpegDemuxer& demux) {
+		//Inputs with an interrupt callback are not shared, as it belongs to a single demuxer
+		const auto shared = sharingEnabled && !interruptCbk;
+
+		SourceSettings result = {
+			&demux.getInstance(),
+			url,
+			options,
+			shared ? nullptr : this,
+			asyncIOEnabled,
+			directIOEnabled,
+			segments,
+			!segments.empty() || (segmentedURLEnabled && FFmpeg::SegmentedInputContext::isSegmentedURL(url.c_str())),
+			followTimeout,
+			timestampNormalizationEnabled,
+			std::string()
+		};
+
+		if(shared) {
+			result.key = SourceCache::makeKey(result);
+		}
+
+		return result;
+	}
+
+	static int interruptCallback(void* opaque) {
+		//Called by FFmpeg while blocking. Non-zero aborts the operation
+		const auto* demuxer = static_cast<const FFmpegDemuxerImpl*>(opaque);
+		return (demuxer && demuxer->interruptCbk) ? static_cast<int>(demuxer->interruptCbk()) : 0;
+	}
+
 };
 
 
@@ -231,6 +1046,93 @@ FFmpegDemuxer& FFmpegDemuxer::operator=(FFmpegDemuxer&& other) = default;
 
 
 
+size_t FFmpegDemuxer::readBatch(PacketQueues& queues, size_t maxPackets, size_t maxBytes, int stopStream) {
+	return (*this)->readBatch(queues, maxPackets, maxBytes, stopStream);
+}
+
+
+void FFmpegDemuxer::setOptions(Options options) {
+	(*this)->setOptions(std::move(options));
+}
+
+const FFmpegDemuxer::Options& FFmpegDemuxer::getOptions() const {
+	return (*this)->getOptions();
+}
+
+
+void FFmpegDemuxer::setInterruptCallback(InterruptCallback cbk) {
+	(*this)->setInterruptCallback(std::move(cbk));
+}
+
+const FFmpegDemuxer::InterruptCallback& FFmpegDemuxer::getInterruptCallback() const {
+	return (*this)->getInterruptCallback();
+}
+
+
+void FFmpegDemuxer::setAsyncIOEnabled(bool ena) {
+	(*this)->setAsyncIOEnabled(ena);
+}
+
+bool FFmpegDemuxer::getAsyncIOEnabled() const {
+	return (*this)->getAsyncIOEnabled();
+}
+
+
+void FFmpegDemuxer::setDirectIOEnabled(bool ena) {
+	(*this)->setDirectIOEnabled(ena);
+}
+
+bool FFmpegDemuxer::getDirectIOEnabled() const {
+	return (*this)->getDirectIOEnabled();
+}
+
+
+void FFmpegDemuxer::setSharingEnabled(bool ena) {
+	(*this)->setSharingEnabled(ena);
+}
+
+bool FFmpegDemuxer::getSharingEnabled() const {
+	return (*this)->getSharingEnabled();
+}
+
+
+void FFmpegDemuxer::setSegments(Segments segments) {
+	(*this)->setSegments(std::move(segments));
+}
+
+const FFmpegDemuxer::Segments& FFmpegDemuxer::getSegments() const {
+	return (*this)->getSegments();
+}
+
+
+void FFmpegDemuxer::setSegmentedURLEnabled(bool ena) {
+	(*this)->setSegmentedURLEnabled(ena);
+}
+
+bool FFmpegDemuxer::getSegmentedURLEnabled() const {
+	return (*this)->getSegmentedURLEnabled();
+}
+
+
+void FFmpegDemuxer::setFollowTimeout(FFmpeg::Duration timeout) {
+	(*this)->setFollowTimeout(timeout);
+}
+
+FFmpeg::Duration FFmpegDemuxer::getFollowTimeout() const {
+	return (*this)->getFollowTimeout();
+}
+
+
+void FFmpegDemuxer::setTimestampNormalizationEnabled(bool ena) {
+	(*this)->setTimestampNormalizationEnabled(ena);
+}
+
+bool FFmpegDemuxer::getTimestampNormalizationEnabled() const {
+	return (*this)->getTimestampNormalizationEnabled();
+}
+
+
+
 FFmpegDemuxer::Streams FFmpegDemuxer::getStreams() const {
 	return (*this)->getStreams();
 }
@@ -243,6 +1145,10 @@ int FFmpegDemuxer::getLastStreamIndex() const {
 	return (*this)->getLastStreamIndex();
 }
 
+bool FFmpegDemuxer::isEndOfFile() const {
+	return (*this)->isEndOfFile();
+}
+
 FFmpeg::Duration FFmpegDemuxer::getDuration() const {
 	return (*this)->getDuration();
 }
@@ -261,4 +1167,9 @@ bool FFmpegDemuxer::flush() {
 }
 
 
+FFmpeg::Statistics FFmpegDemuxer::getStatistics() const {
+	return (*this)->getStatistics(getName());
+}
+
+
 }
\ No newline at end of file
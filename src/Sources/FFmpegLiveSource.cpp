@@ -0,0 +1,619 @@
+#include <zuazo/Sources/FFmpegLiveSource.h>
+
+#include "../FFmpeg/Tracing.h"
+
+#include <zuazo/Exception.h>
+#include <zuazo/FFmpeg/FFmpegConversions.h>
+#include <zuazo/Processors/FFmpegDecoder.h>
+#include <zuazo/Processors/FFmpegUploader.h>
+#include <zuazo/Signal/Output.h>
+#include <zuazo/Signal/DummyPad.h>
+#include <zuazo/FFmpeg/Signals.h>
+
+#include <memory>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <cassert>
+
+extern "C" {
+	#include <libavutil/avutil.h>
+	#include <libavutil/mathematics.h>
+}
+
+namespace Zuazo::Sources {
+
+/*
+ * FFmpegLiveSourceImpl
+ */
+
+struct FFmpegLiveSourceImpl {
+	using Clock = std::chrono::steady_clock;
+
+	struct Metrics {
+		FFmpeg::LatencyHistogram	decodeLatency;
+		FFmpeg::Counter				frameCount;
+		FFmpeg::Counter				presentedCount;
+		FFmpeg::Counter				lateDropCount;
+		FFmpeg::Counter				overflowDropCount;
+		FFmpeg::Counter				skipCount;
+		FFmpeg::Counter				underrunCount;
+		FFmpeg::Counter				resyncCount;
+		FFmpeg::Gauge				bufferDepth;
+		FFmpeg::Gauge				clockDrift; //In microseconds
+	};
+
+	//Maps stream timestamps into the local clock. The mapping slowly
+	//follows the arrival times, so that the drift between the sender's
+	//and the local clock does not starve nor overflow the jitter buffer
+	class PresentationClock {
+	public:
+		PresentationClock()
+			: m_valid(false)
+			, m_streamOrigin()
+			, m_localOrigin()
+			, m_offset()
+			, m_averageError()
+		{
+		}
+
+		//Returns false if the mapping needed to be re-established
+		bool update(Duration timeStamp, Clock::time_point arrival) {
+			bool result = true;
+
+			if(m_valid) {
+				const auto error = std::chrono::duration_cast<Duration>(arrival - map(timeStamp));
+
+				if(error > MAX_DISCONTINUITY || error < -MAX_DISCONTINUITY) {
+					//Timestamps have jumped (i.e. the sender has restarted)
+					result = false;
+					anchor(timeStamp, arrival);
+				} else {
+					//Exponential moving average of the arrival error. Correct
+					//a fraction of it, as most of it will be network jitter
+					m_averageError += (error - m_averageError) / ERROR_AVERAGE_WEIGHT;
+					m_offset += m_averageError / DRIFT_CORRECTION_WEIGHT;
+				}
+			} else {
+				anchor(timeStamp, arrival);
+			}
+
+			assert(m_valid);
+			return result;
+		}
+
+		Clock::time_point map(Duration timeStamp) const {
+			assert(m_valid);
+			return m_localOrigin + std::chrono::duration_cast<Clock::duration>(timeStamp - m_streamOrigin + m_offset);
+		}
+
+		Duration getOffset() const noexcept {
+			return m_offset;
+		}
+
+	private:
+		static constexpr Duration MAX_DISCONTINUITY = std::chrono::seconds(2);
+		static constexpr Duration::rep ERROR_AVERAGE_WEIGHT = 16;
+		static constexpr Duration::rep DRIFT_CORRECTION_WEIGHT = 32;
+
+		bool					m_valid;
+		Duration				m_streamOrigin;
+		Clock::time_point		m_localOrigin;
+		Duration				m_offset;
+		Duration				m_averageError;
+
+		void anchor(Duration timeStamp, Clock::time_point arrival) {
+			m_valid = true;
+			m_streamOrigin = timeStamp;
+			m_localOrigin = arrival;
+			m_offset = Duration();
+			m_averageError = Duration();
+		}
+
+	};
+
+	struct Open {
+		struct BufferedFrame {
+			FFmpeg::FrameStream		frame;
+			Clock::time_point		presentationTime;
+		};
+
+		using JitterBuffer = std::deque<BufferedFrame>;
+
+		FFmpegDemuxer&				demuxer;
+		int							videoStreamIndex;
+		Processors::FFmpegDecoder 	videoDecoder;
+		const std::atomic<Duration>& jitterBufferDelay;
+		Metrics&					metrics;
+
+		//Only accessed from the decoding thread
+		PresentationClock			presentationClock;
+		bool						demuxed;
+
+		std::atomic<bool>			decodingThreadExit;
+		std::thread					decodingThread;
+
+		std::mutex					jitterBufferMutex;
+		JitterBuffer				jitterBuffer;
+
+		static constexpr size_t MAX_BUFFERED_FRAMES = 64;
+		static constexpr auto IDLE_PERIOD = std::chrono::milliseconds(5);
+		static constexpr auto DEFAULT_FRAME_PERIOD = std::chrono::milliseconds(40);
+
+		Open(	Sources::FFmpegDemuxer& demux,
+				const std::atomic<Duration>& jitterBufferDelay,
+				Metrics& metrics )
+			: demuxer(demux)
+			, videoStreamIndex(demuxer.findBestStream(FFmpeg::MediaType::video))
+			, videoDecoder(demuxer.getInstance(), "Video Decoder", getCodecParameters(demuxer, videoStreamIndex), Open::pixelFormatNegotiationCallback, std::bind(&Open::demuxCallback, std::ref(*this)))
+			, jitterBufferDelay(jitterBufferDelay)
+			, metrics(metrics)
+			, presentationClock()
+			, demuxed(false)
+			, decodingThreadExit(false)
+			, decodingThread()
+			, jitterBufferMutex()
+			, jitterBuffer()
+		{
+			if(videoStreamIndex < 0) {
+				throw Exception("No video stream was found on the live input");
+			}
+
+			//Route the video stream
+			const auto outputName = Signal::makeOutputName<FFmpeg::PacketStream>(videoStreamIndex);
+			videoDecoder << Signal::getOutput<FFmpeg::PacketStream>(demuxer, outputName);
+
+			//Slice threading does not add delay, as opposed to frame threading
+			videoDecoder.setHardwareAccelerationEnabled(true);
+			videoDecoder.setProfile(FFmpeg::DecodingProfile::lowLatency);
+			videoDecoder.open();
+
+			//Start the thread
+			decodingThread = std::thread(&Open::decodingThreadFunc, std::ref(*this));
+		}
+
+		~Open() {
+			//The demuxer should have been interrupted, so that it does not block
+			decodingThreadExit.store(true);
+			decodingThread.join();
+		}
+
+		//Returns the most recent frame which is due, if any
+		FFmpeg::FrameStream present(Clock::time_point now) {
+			FFmpeg::FrameStream result;
+			std::lock_guard<std::mutex> lock(jitterBufferMutex);
+
+			if(jitterBuffer.empty()) {
+				metrics.underrunCount.add();
+			}
+
+			while(!jitterBuffer.empty() && jitterBuffer.front().presentationTime <= now) {
+				if(result) {
+					//Rendering is slower than the stream. Superseded without being shown
+					metrics.skipCount.add();
+				}
+
+				result = std::move(jitterBuffer.front().frame);
+				jitterBuffer.pop_front();
+			}
+
+			metrics.bufferDepth.set(jitterBuffer.size());
+			return result;
+		}
+
+		Rate getFrameRate() const {
+			const auto streams = demuxer.getStreams();
+			return Rate(streams[videoStreamIndex].getRealFrameRate());
+		}
+
+	private:
+		void decodingThreadFunc() {
+			FFmpeg::Tracing::setThreadName("FFmpegLiveSource decoding");
+			const auto& output = videoDecoder.getOutput();
+
+			while(!decodingThreadExit.load(std::memory_order_relaxed)) {
+				demuxed = false;
+
+				{
+					ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegLiveSource::decode");
+					FFmpeg::ScopedLatency latency(metrics.decodeLatency);
+					videoDecoder.update(); //Blocks until data arrives
+				}
+
+				const auto& frame = output.getLastElement();
+				if(frame) {
+					metrics.frameCount.add();
+					enqueue(frame, Clock::now());
+				} else if(!demuxed) {
+					//Nothing could be read (i.e. the input has ended). Avoid spinning
+					std::this_thread::sleep_for(IDLE_PERIOD);
+				}
+			}
+		}
+
+		void demuxCallback() {
+			ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegLiveSource::demuxCallback");
+
+			//Read a single packet, so that the decoder returns if this
+			//gets interrupted or fails
+			demuxer.update();
+			const auto lastIndex = demuxer.getLastStreamIndex();
+			demuxed = lastIndex >= 0;
+
+			if(lastIndex == videoStreamIndex) {
+				videoDecoder.readPacket();
+			}
+		}
+
+		void enqueue(const FFmpeg::FrameStream& frame, Clock::time_point arrival) {
+			assert(frame);
+			const auto delay = jitterBufferDelay.load(std::memory_order_relaxed);
+			const auto timeStamp = frame->getBestEffortTS();
+			Clock::time_point presentationTime;
+
+			if(timeStamp != AV_NOPTS_VALUE) {
+				if(!presentationClock.update(calculateTimeStamp(timeStamp), arrival)) {
+					metrics.resyncCount.add();
+				}
+
+				presentationTime = presentationClock.map(calculateTimeStamp(timeStamp)) + delay;
+				metrics.clockDrift.set(std::chrono::duration_cast<std::chrono::microseconds>(presentationClock.getOffset()).count());
+			} else {
+				//No timing information. Present it as it arrives
+				presentationTime = arrival + delay;
+			}
+
+			//Drop the frame if it would be shown after its successor
+			if(presentationTime + getFramePeriod() < arrival) {
+				metrics.lateDropCount.add();
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(jitterBufferMutex);
+
+			if(jitterBuffer.size() >= MAX_BUFFERED_FRAMES) {
+				//Rendering has stalled
+				jitterBuffer.pop_front();
+				metrics.overflowDropCount.add();
+			}
+
+			jitterBuffer.push_back(BufferedFrame{ frame, presentationTime });
+			metrics.bufferDepth.set(jitterBuffer.size());
+		}
+
+		Duration calculateTimeStamp(int64_t timeStamp) const {
+			const auto streams = demuxer.getStreams();
+			const auto timeBase = streams[videoStreamIndex].getTimeBase();
+
+			return Duration(av_rescale_q(
+				timeStamp,
+				AVRational{ timeBase.getNumerator(), timeBase.getDenominator() },	//Src time base
+				AVRational{ Duration::period::num, Duration::period::den }			//Dst time-base
+			));
+		}
+
+		Duration getFramePeriod() const {
+			const auto frameRate = getFrameRate();
+			return frameRate ? getPeriod(frameRate) : Duration(DEFAULT_FRAME_PERIOD);
+		}
+
+		static Zuazo::FFmpeg::CodecParameters getCodecParameters(const Sources::FFmpegDemuxer& demuxer, int index) {
+			const auto streams = demuxer.getStreams();
+			return 	index >= 0
+					? Zuazo::FFmpeg::CodecParameters(streams[index].getCodecParameters())
+					: Zuazo::FFmpeg::CodecParameters();
+		}
+
+		static FFmpeg::PixelFormat pixelFormatNegotiationCallback(	Processors::FFmpegDecoder& decoder,
+																	const FFmpeg::PixelFormat* formats )
+		{
+			//Check if a desired hardware accelerated format is present
+			for(const auto* f = formats; static_cast<int>(*f) >= 0; ++f) {
+				if(	Processors::FFmpegUploader::isSupportedInput(*f) &&
+					decoder.getHardwareDeviceType() == getHardwareDeviceType(*f) )
+				{
+					return *f; //A hardware accelerated format was found!
+				}
+			}
+
+			//No luck with hardware accelerated formats try with normal ones
+			for(const auto* f = formats; static_cast<int>(*f) >= 0; ++f) {
+				if(Processors::FFmpegUploader::isSupportedInput(*f) && !isHardwarePixelFormat(*f)) {
+					return *f; //A compatible format was found!
+				}
+			}
+
+			return *formats; //Nothing was found :-<
+		}
+
+	};
+
+	using Output = Signal::Output<FFmpeg::FrameStream>;
+
+	std::reference_wrapper<FFmpegLiveSource> owner;
+
+	Signal::DummyPad<Video>				videoOut;
+
+	Sources::FFmpegDemuxer 				demuxer;
+	Output								frameOut;
+	Processors::FFmpegUploader 			videoUploader;
+
+	std::atomic<Duration>				jitterBufferDelay;
+	std::atomic<bool>					interrupted;
+
+	Metrics								metrics;
+	std::unique_ptr<Open>				opened;
+
+	static constexpr auto DEFAULT_JITTER_BUFFER_DELAY = std::chrono::milliseconds(50);
+
+	FFmpegLiveSourceImpl(FFmpegLiveSource& source, Instance& instance, std::string url)
+		: owner(source)
+		, videoOut(source, std::string(Signal::makeOutputName<Zuazo::Video>()))
+		, demuxer(instance, "Demuxer", std::move(url))
+		, frameOut(source, std::string(Signal::makeOutputName<FFmpeg::FrameStream>()))
+		, videoUploader(instance, "Video Uploader")
+		, jitterBufferDelay(DEFAULT_JITTER_BUFFER_DELAY)
+		, interrupted(false)
+		, metrics()
+	{
+		demuxer.setOptions(FFmpegLiveSource::getDefaultDemuxerOptions());
+		demuxer.setInterruptCallback(std::bind(&FFmpegLiveSourceImpl::interruptCallback, std::cref(*this)));
+
+		//Route the signals
+		videoUploader << frameOut;
+		videoOut << videoUploader;
+		videoUploader.setPreUpdateCallback(std::bind(&FFmpegLiveSourceImpl::uploaderPreUpdateCallback, std::ref(*this)));
+	}
+
+	~FFmpegLiveSourceImpl() = default;
+
+	void moved(ZuazoBase& base) {
+		owner = static_cast<FFmpegLiveSource&>(base);
+		videoOut.setLayout(base);
+		frameOut.setLayout(base);
+	}
+
+	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& source = static_cast<FFmpegLiveSource&>(base);
+		assert(&owner.get() == &source); (void)(source);
+		assert(!opened);
+
+		//Open childs asynchronously if possible
+		//May throw! (nothing has been done yet, so don't worry about cleaning)
+		interrupted.store(false);
+		if(lock) {
+			demuxer.asyncOpen(*lock);
+		} else {
+			demuxer.open();
+		}
+
+		try {
+			if(lock) {
+				videoUploader.asyncOpen(*lock);
+			} else {
+				videoUploader.open();
+			}
+
+			//Start decoding. Throws if there is no video stream
+			opened = Utils::makeUnique<Open>(demuxer, jitterBufferDelay, metrics);
+		} catch(...) {
+			//Leave the childs closed, as the source remains closed
+			if(lock && !lock->owns_lock()) {
+				lock->lock();
+			}
+
+			if(videoUploader.isOpen()) {
+				if(lock) {
+					videoUploader.asyncClose(*lock);
+				} else {
+					videoUploader.close();
+				}
+			}
+
+			if(lock) {
+				demuxer.asyncClose(*lock);
+			} else {
+				demuxer.close();
+			}
+
+			throw;
+		}
+
+		assert(opened);
+	}
+
+	void asyncOpen(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		open(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void close(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& source = static_cast<FFmpegLiveSource&>(base);
+		assert(&owner.get() == &source); (void)(source);
+		assert(opened);
+
+		//Unblock the decoding thread before joining it
+		interrupted.store(true);
+		opened.reset();
+		frameOut.reset();
+
+		//Close childs asynchronously if possible
+		if(lock) {
+			videoUploader.asyncClose(*lock);
+			demuxer.asyncClose(*lock);
+		} else {
+			videoUploader.close();
+			demuxer.close();
+		}
+
+		assert(!opened);
+	}
+
+	void asyncClose(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		close(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void videoModeCallback(VideoBase& base, const VideoMode& videoMode) {
+		auto& source = static_cast<FFmpegLiveSource&>(base);
+		assert(&owner.get() == &source); (void)(source);
+
+		videoUploader.setVideoMode(videoMode);
+	}
+
+	VideoMode videoModeNegotiationCallback(VideoBase&, std::vector<VideoMode> compatibility) {
+		auto& source = owner.get();
+		assert(opened);
+
+		//Advertise the nominal framerate of the stream if known
+		const Rate frameRate = opened->getFrameRate();
+		if(frameRate) {
+			for(auto& vm : compatibility) {
+				vm.setFrameRate(Utils::MustBe<Rate>(frameRate));
+			}
+		}
+
+		//Update the compatibility in the VideoBase
+		source.setVideoModeCompatibility(std::move(compatibility));
+		return source.getVideoMode();
+	}
+
+
+	void setJitterBufferDelay(Duration delay) {
+		jitterBufferDelay.store(delay, std::memory_order_relaxed);
+	}
+
+	Duration getJitterBufferDelay() const {
+		return jitterBufferDelay.load(std::memory_order_relaxed);
+	}
+
+
+	void setDemuxerOptions(FFmpegLiveSource::DemuxerOptions options) {
+		demuxer.setOptions(std::move(options));
+	}
+
+	const FFmpegLiveSource::DemuxerOptions& getDemuxerOptions() const {
+		return demuxer.getOptions();
+	}
+
+
+	FFmpeg::Statistics getStatistics() const {
+		FFmpeg::Statistics result(owner.get().getName());
+
+		result.addLatency("decode", metrics.decodeLatency);
+		result.addCounter("frames", metrics.frameCount);
+		result.addCounter("presented", metrics.presentedCount);
+		result.addCounter("lateDrops", metrics.lateDropCount);
+		result.addCounter("overflowDrops", metrics.overflowDropCount);
+		result.addCounter("skipped", metrics.skipCount);
+		result.addCounter("underruns", metrics.underrunCount);
+		result.addCounter("resyncs", metrics.resyncCount);
+		result.addGauge("jitterBufferDepth", metrics.bufferDepth);
+		result.addGauge("clockDriftUs", metrics.clockDrift);
+
+		result.addChild(demuxer.getStatistics());
+		if(opened) {
+			result.addChild(opened->videoDecoder.getStatistics());
+		}
+		result.addChild(videoUploader.getStatistics());
+
+		return result;
+	}
+
+private:
+	void uploaderPreUpdateCallback() {
+		//Hand the due frame to the uploader. If there is none, it will keep the last one
+		if(opened) {
+			auto frame = opened->present(Clock::now());
+			if(frame) {
+				metrics.presentedCount.add();
+				frameOut.push(std::move(frame));
+			}
+		}
+	}
+
+	bool interruptCallback() const {
+		return interrupted.load(std::memory_order_relaxed);
+	}
+
+};
+
+
+/*
+ * FFmpegLiveSource
+ */
+
+FFmpegLiveSource::FFmpegLiveSource(	Instance& instance,
+									std::string name,
+									std::string url )
+	: Utils::Pimpl<FFmpegLiveSourceImpl>({}, *this, instance, std::move(url))
+	, ZuazoBase(
+		instance,
+		std::move(name),
+		{},
+		std::bind(&FFmpegLiveSourceImpl::moved, std::ref(**this), std::placeholders::_1),
+		std::bind(&FFmpegLiveSourceImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegLiveSourceImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegLiveSourceImpl::close, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegLiveSourceImpl::asyncClose, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		ZuazoBase::UpdateCallback() )
+	, VideoBase(
+		std::bind(&FFmpegLiveSourceImpl::videoModeCallback, std::ref(**this), std::placeholders::_1, std::placeholders::_2) )
+	, Signal::SourceLayout<Video>((*this)->videoOut.getOutput())
+{
+	//Add the output
+	ZuazoBase::registerPad((*this)->videoOut.getOutput());
+
+	//Setup the compatibility callback
+	(*this)->videoUploader.setVideoModeNegotiationCallback(
+		std::bind(&FFmpegLiveSourceImpl::videoModeNegotiationCallback, std::ref(**this), std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+
+FFmpegLiveSource::FFmpegLiveSource(FFmpegLiveSource&& other) = default;
+
+FFmpegLiveSource::~FFmpegLiveSource() = default;
+
+FFmpegLiveSource& FFmpegLiveSource::operator=(FFmpegLiveSource&& other) = default;
+
+
+
+void FFmpegLiveSource::setJitterBufferDelay(Duration delay) {
+	(*this)->setJitterBufferDelay(delay);
+}
+
+Duration FFmpegLiveSource::getJitterBufferDelay() const {
+	return (*this)->getJitterBufferDelay();
+}
+
+
+void FFmpegLiveSource::setDemuxerOptions(DemuxerOptions options) {
+	(*this)->setDemuxerOptions(std::move(options));
+}
+
+const FFmpegLiveSource::DemuxerOptions& FFmpegLiveSource::getDemuxerOptions() const {
+	return (*this)->getDemuxerOptions();
+}
+
+
+FFmpeg::Statistics FFmpegLiveSource::getStatistics() const {
+	return (*this)->getStatistics();
+}
+
+
+const FFmpegLiveSource::DemuxerOptions& FFmpegLiveSource::getDefaultDemuxerOptions() {
+	static const DemuxerOptions options = {
+		{ "fflags", "nobuffer" },			//AVFMT_FLAG_NOBUFFER: Don't buffer packets while probing
+		{ "analyzeduration", "500000" },	//Probe for 0.5s instead of 5s
+	};
+
+	return options;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,549 @@
+#include <zuazo/Sources/FFmpegPlaylist.h>
+
+#include "../FFmpeg/Tracing.h"
+
+#include <zuazo/Sources/FFmpegClip.h>
+#include <zuazo/Utils/Functions.h>
+#include <zuazo/Math/Comparisons.h>
+#include <zuazo/Signal/Output.h>
+#include <zuazo/Signal/DummyPad.h>
+
+#include <memory>
+#include <utility>
+#include <future>
+#include <optional>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace Zuazo::Sources {
+
+/*
+ * FFmpegPlaylistImpl
+ */
+
+struct FFmpegPlaylistImpl {
+	struct Metrics {
+		FFmpeg::LatencyHistogram	openLatency;
+		FFmpeg::Counter				switchCount;
+		FFmpeg::Counter				preloadMissCount;
+		FFmpeg::Counter				failedItemCount;
+	};
+
+	//An opened item of the playlist. It is opened in the background, as
+	//it is not part of the graph until it becomes the current item. It must
+	//be closed before destroying it, as it requires the instance lock
+	struct Entry {
+		size_t						index;
+		Duration					inPoint;
+		Duration					outPoint;
+		FFmpegClip					clip;
+		std::vector<VideoMode>		compatibility;
+		std::future<void>			preroll;
+		bool						failed;
+
+		Entry(	FFmpegPlaylistImpl& playlist,
+				std::string name,
+				size_t index,
+				const FFmpegPlaylist::Item& item )
+			: index(index)
+			, inPoint(item.inPoint)
+			, outPoint(item.outPoint)
+			, clip(playlist.owner.get().getInstance(), std::move(name), item.url)
+			, compatibility()
+			, preroll()
+			, failed(false)
+		{
+			//Negotiation happens when opening, so it needs to be set beforehand
+			clip.setVideoModeNegotiationCallback(
+				std::bind(&FFmpegPlaylistImpl::videoModeNegotiationCallback, std::ref(playlist), std::ref(*this), std::placeholders::_2)
+			);
+
+			//Open it and decode the first frame
+			preroll = std::async(std::launch::async, [this, &metrics = playlist.metrics] {
+				FFmpeg::Tracing::setThreadName("FFmpegPlaylist preroll");
+				ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegPlaylist::preroll");
+				FFmpeg::ScopedLatency latency(metrics.openLatency);
+				std::unique_lock<Instance> lock(clip.getInstance());
+				clip.asyncOpen(lock);
+				clip.setTime(TimePoint(inPoint));
+			});
+		}
+
+		Entry(const Entry& other) = delete;
+
+		~Entry() {
+			if(preroll.valid()) {
+				preroll.wait();
+			}
+
+			assert(!clip.isOpen());
+		}
+
+		Entry&						operator=(const Entry& other) = delete;
+
+		void close(std::unique_lock<Instance>* lock = nullptr) {
+			//Opening holds the lock, so wait for it while unlocked
+			if(preroll.valid()) {
+				if(lock) lock->unlock();
+				preroll.wait();
+				if(lock) lock->lock();
+			}
+
+			if(clip.isOpen()) {
+				if(lock) {
+					clip.asyncClose(*lock);
+				} else {
+					clip.close();
+				}
+			}
+		}
+
+		bool isReady() const {
+			return !preroll.valid() || preroll.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+
+		bool collect() {
+			assert(isReady());
+			if(preroll.valid()) {
+				try {
+					preroll.get(); //Rethrows if opening has failed
+				} catch(...) {
+					failed = true;
+				}
+			}
+
+			return !failed;
+		}
+
+		Duration getDuration() const {
+			assert(isReady());
+			if(failed) {
+				return Duration();
+			}
+
+			//Limited by the out point and the actual length of the clip
+			const auto end = Math::min(outPoint, clip.getDuration());
+			if(end == Duration::max()) {
+				return end; //Unknown yet
+			}
+
+			auto result = end > inPoint ? end - inPoint : Duration();
+
+			//Round it to whole frames, so that switching does not repeat nor drop frames
+			const auto timeStep = clip.getTimeStep();
+			if(timeStep > Duration()) {
+				result = ((result + timeStep / 2 - Duration(1)) / timeStep) * timeStep;
+			}
+
+			return result;
+		}
+	};
+
+	//At most the current item and the next one are opened
+	using EntryPtr = std::unique_ptr<Entry>;
+
+	std::reference_wrapper<FFmpegPlaylist> 	owner;
+
+	Signal::DummyPad<Video>				videoOut;
+
+	FFmpegPlaylist::Items				items;
+	Duration							preloadTime;
+
+	Metrics								metrics;
+
+	EntryPtr							current;
+	EntryPtr							next;
+	bool								connected; //Whether the current item has been opened and routed
+	Duration							currentStart; //Playlist time at the in point of the current item
+	std::vector<std::optional<Duration>> itemDurations; //Known once they have been played
+	std::vector<std::future<void>>		retired; //Entries being closed in the background
+
+	FFmpegPlaylistImpl(FFmpegPlaylist& playlist, FFmpegPlaylist::Items items)
+		: owner(playlist)
+		, videoOut(playlist, std::string(Signal::makeOutputName<Zuazo::Video>()))
+		, items(std::move(items))
+		, preloadTime(std::chrono::seconds(2))
+		, metrics()
+		, current()
+		, next()
+		, connected(false)
+		, currentStart()
+		, itemDurations(this->items.size())
+		, retired()
+	{
+	}
+
+	~FFmpegPlaylistImpl() = default;
+
+	void moved(ZuazoBase& base) {
+		owner = static_cast<FFmpegPlaylist&>(base);
+		videoOut.setLayout(base);
+		auto& playlist = static_cast<FFmpegPlaylist&>(base);
+		playlist.setRefreshCallback(std::bind(&FFmpegPlaylist::update, std::ref(playlist)));
+	}
+
+	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& playlist = static_cast<FFmpegPlaylist&>(base);
+		assert(&owner.get() == &playlist); (void)(playlist);
+		assert(!current && !next);
+		Utils::ignore(lock); //Items are opened in the background
+
+		//Start opening the first item. It will be routed by the first update after it is ready
+		if(!items.empty()) {
+			next = createEntry(0);
+		}
+	}
+
+	void asyncOpen(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		open(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void close(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
+		auto& playlist = static_cast<FFmpegPlaylist&>(base);
+		assert(&owner.get() == &playlist);
+
+		playlist.setDuration(Duration::max());
+		playlist.setTimeStep(Duration());
+		videoOut << Signal::noSignal;
+
+		auto oldCurrent = std::move(current);
+		auto oldNext = std::move(next);
+		auto oldRetired = std::move(retired);
+		retired.clear();
+		connected = false;
+		currentStart = Duration();
+
+		for(auto* entry : { oldCurrent.get(), oldNext.get() }) {
+			if(entry) {
+				entry->close(lock);
+			}
+		}
+
+		//Retired entries need the lock to be closed
+		if(lock) lock->unlock();
+		for(auto& future : oldRetired) {
+			future.wait();
+		}
+		if(lock) lock->lock();
+
+		assert(!current && !next);
+	}
+
+	void asyncClose(ZuazoBase& base, std::unique_lock<Instance>& lock) {
+		assert(lock.owns_lock());
+		close(base, &lock);
+		assert(lock.owns_lock());
+	}
+
+	void update() {
+		auto& playlist = owner.get();
+		if(!playlist.isOpen()) {
+			return;
+		}
+
+		ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegPlaylist::update");
+		const auto time = playlist.getTime().time_since_epoch();
+
+		//Find the item for this time
+		if(!current || time < currentStart) {
+			relocate(time);
+		}
+
+		while(connect() && time - currentStart >= current->getDuration()) {
+			if(!advance()) {
+				break; //End of the playlist
+			}
+		}
+
+		if(connected) {
+			if(!current->failed) {
+				current->clip.setTime(TimePoint(current->inPoint + (time - currentStart)));
+			}
+
+			//Open the next item in the background when approaching the boundary
+			const auto nextIndex = current->index + 1;
+			const auto remaining = current->getDuration() - (time - currentStart);
+			if(!next && nextIndex < items.size() && remaining <= preloadTime) {
+				next = createEntry(nextIndex);
+			}
+		}
+	}
+
+	void videoModeCallback(VideoBase& base, const VideoMode& videoMode) {
+		auto& playlist = static_cast<FFmpegPlaylist&>(base);
+		assert(&owner.get() == &playlist); (void)(playlist);
+
+		//Items being opened will pick it when negotiating
+		if(connected && !current->failed) {
+			current->clip.setVideoMode(videoMode);
+		}
+	}
+
+	VideoMode videoModeNegotiationCallback(Entry& entry, std::vector<VideoMode> compatibility) {
+		auto& playlist = owner.get();
+
+		//Only the current item determines the compatibility of the playlist
+		entry.compatibility = std::move(compatibility);
+		if(&entry == current.get()) {
+			playlist.setVideoModeCompatibility(entry.compatibility);
+		}
+
+		return playlist.getVideoMode();
+	}
+
+
+	void setItems(FFmpegPlaylist::Items i) {
+		items = std::move(i);
+		itemDurations.assign(items.size(), std::nullopt);
+
+		//Everything needs to be re-evaluated on the next update
+		videoOut << Signal::noSignal;
+		retire(std::move(current));
+		retire(std::move(next));
+		connected = false;
+		currentStart = Duration();
+		owner.get().setDuration(Duration::max());
+	}
+
+	const FFmpegPlaylist::Items& getItems() const {
+		return items;
+	}
+
+
+	void setPreloadTime(Duration time) {
+		preloadTime = time;
+	}
+
+	Duration getPreloadTime() const {
+		return preloadTime;
+	}
+
+
+	int getCurrentIndex() const {
+		return current ? static_cast<int>(current->index) : -1;
+	}
+
+
+	FFmpeg::Statistics getStatistics() const {
+		FFmpeg::Statistics result(owner.get().getName());
+
+		result.addLatency("open", metrics.openLatency);
+		result.addCounter("switches", metrics.switchCount);
+		result.addCounter("preloadMisses", metrics.preloadMissCount);
+		result.addCounter("failedItems", metrics.failedItemCount);
+
+		if(connected && !current->failed) {
+			result.addChild(current->clip.getStatistics());
+		}
+
+		return result;
+	}
+
+private:
+	EntryPtr createEntry(size_t index) {
+		assert(index < items.size());
+		auto& playlist = owner.get();
+
+		return Utils::makeUnique<Entry>(
+			*this,
+			playlist.getName() + " - Item " + std::to_string(index),
+			index,
+			items[index]
+		);
+	}
+
+	EntryPtr takeEntry(size_t index) {
+		//Reuse the preloaded item if possible
+		EntryPtr result;
+		if(next && next->index == index) {
+			result = std::move(next);
+		} else {
+			retire(std::move(next));
+			result = createEntry(index);
+		}
+
+		//Opening needs the instance lock, so it can't be waited here. Output
+		//will be empty until it is ready
+		if(!result->isReady()) {
+			metrics.preloadMissCount.add();
+		}
+
+		return result;
+	}
+
+	void relocate(Duration time) {
+		ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegPlaylist::relocate");
+
+		//Skip all the items known to end before the given time
+		size_t index = 0;
+		Duration start = Duration();
+		while(index < items.size() && itemDurations[index] && time - start >= *itemDurations[index]) {
+			start += *itemDurations[index];
+			++index;
+		}
+
+		retire(std::move(current));
+		connected = false;
+		if(index < items.size()) {
+			currentStart = start;
+			activate(takeEntry(index));
+		} else {
+			videoOut << Signal::noSignal; //Past the end
+		}
+	}
+
+	bool advance() {
+		ZUAZO_FFMPEG_TRACE_SCOPE("FFmpegPlaylist::advance");
+		assert(current);
+		auto& playlist = owner.get();
+
+		const auto duration = current->getDuration();
+		const auto nextIndex = current->index + 1;
+		itemDurations[current->index] = duration;
+
+		if(nextIndex >= items.size()) {
+			//Reached the last item, so the total duration is known
+			playlist.setDuration(currentStart + duration);
+			return false;
+		}
+
+		currentStart += duration;
+		retire(std::move(current));
+		activate(takeEntry(nextIndex));
+		metrics.switchCount.add();
+		return true;
+	}
+
+	void activate(EntryPtr entry) {
+		assert(entry);
+
+		current = std::move(entry);
+		connected = false;
+		connect();
+	}
+
+	bool connect() {
+		if(connected) {
+			return true;
+		} else if(!current || !current->isReady()) {
+			videoOut << Signal::noSignal; //Still opening. Check it again on the next update
+			return false;
+		}
+
+		auto& playlist = owner.get();
+		connected = true;
+		if(!current->collect()) {
+			metrics.failedItemCount.add(); //It will be skipped
+		}
+
+		if(current->failed) {
+			videoOut << Signal::noSignal;
+		} else {
+			current->clip.setVideoMode(playlist.getVideoMode());
+			videoOut << current->clip;
+			playlist.setTimeStep(current->clip.getTimeStep());
+			if(!current->compatibility.empty()) {
+				playlist.setVideoModeCompatibility(current->compatibility);
+			}
+		}
+
+		return true;
+	}
+
+	void retire(EntryPtr entry) {
+		//Forget about the entries which have already been closed. Destroying
+		//their futures does not block
+		retired.erase(
+			std::remove_if(
+				retired.begin(), retired.end(),
+				[] (const std::future<void>& future) -> bool {
+					return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+				}
+			),
+			retired.end()
+		);
+
+		if(entry) {
+			//Closing joins the decoding threads. Don't do it on the rendering thread
+			retired.push_back(std::async(std::launch::async, [entry = std::move(entry)] () mutable {
+				std::unique_lock<Instance> lock(entry->clip.getInstance());
+				entry->close(&lock);
+				lock.unlock();
+				entry.reset();
+			}));
+		}
+	}
+
+};
+
+
+/*
+ * FFmpegPlaylist
+ */
+
+FFmpegPlaylist::FFmpegPlaylist(	Instance& instance,
+								std::string name,
+								Items items )
+	: Utils::Pimpl<FFmpegPlaylistImpl>({}, *this, std::move(items))
+	, ZuazoBase(
+		instance,
+		std::move(name),
+		{},
+		std::bind(&FFmpegPlaylistImpl::moved, std::ref(**this), std::placeholders::_1),
+		std::bind(&FFmpegPlaylistImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegPlaylistImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegPlaylistImpl::close, std::ref(**this), std::placeholders::_1, nullptr),
+		std::bind(&FFmpegPlaylistImpl::asyncClose, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
+		std::bind(&FFmpegPlaylistImpl::update, std::ref(**this)) )
+	, VideoBase(
+		std::bind(&FFmpegPlaylistImpl::videoModeCallback, std::ref(**this), std::placeholders::_1, std::placeholders::_2) )
+	, ClipBase(
+		Duration::max(),
+		Duration(),
+		std::bind(&FFmpegPlaylist::update, std::ref(*this)) )
+	, Signal::SourceLayout<Video>((*this)->videoOut.getOutput())
+{
+	//Add the output
+	ZuazoBase::registerPad((*this)->videoOut.getOutput());
+}
+
+
+FFmpegPlaylist::FFmpegPlaylist(FFmpegPlaylist&& other) = default;
+
+FFmpegPlaylist::~FFmpegPlaylist() = default;
+
+FFmpegPlaylist& FFmpegPlaylist::operator=(FFmpegPlaylist&& other) = default;
+
+
+
+void FFmpegPlaylist::setItems(Items items) {
+	(*this)->setItems(std::move(items));
+}
+
+const FFmpegPlaylist::Items& FFmpegPlaylist::getItems() const {
+	return (*this)->getItems();
+}
+
+
+void FFmpegPlaylist::setPreloadTime(Duration time) {
+	(*this)->setPreloadTime(time);
+}
+
+Duration FFmpegPlaylist::getPreloadTime() const {
+	return (*this)->getPreloadTime();
+}
+
+
+int FFmpegPlaylist::getCurrentIndex() const {
+	return (*this)->getCurrentIndex();
+}
+
+
+FFmpeg::Statistics FFmpegPlaylist::getStatistics() const {
+	return (*this)->getStatistics();
+}
+
+}
\ No newline at end of file